@@ -971,6 +971,12 @@ struct __DRIdri2LoaderExtensionRec {
  */
 #define __DRI_CTX_FLAG_ROBUST_BUFFER_ACCESS	0x00000004
 
+/**
+ * Create a context where API validation may be skipped
+ * (GL_KHR_no_error).
+ */
+#define __DRI_CTX_FLAG_NO_ERROR			0x00000008
+
 /**
  * \name Context reset strategies.
  */
@@ -581,6 +581,7 @@ dri2_setup_screen(_EGLDisplay *disp)
    if ((dri2_dpy->dri2 && dri2_dpy->dri2->base.version >= 3) ||
        (dri2_dpy->swrast && dri2_dpy->swrast->base.version >= 3)) {
       disp->Extensions.KHR_create_context = EGL_TRUE;
+      disp->Extensions.KHR_create_context_no_error = EGL_TRUE;
 
       if (dri2_dpy->robustness)
          disp->Extensions.EXT_create_context_robustness = EGL_TRUE;
@@ -899,6 +900,7 @@ dri2_fill_context_attribs(struct dri2_egl_context *dri2_ctx,
                           uint32_t *ctx_attribs,
                           unsigned *num_attribs)
 {
+   uint32_t flags = dri2_ctx->base.Flags;
    int pos = 0;
 
    assert(*num_attribs >= 8);
@@ -908,7 +910,10 @@ dri2_fill_context_attribs(struct dri2_egl_context *dri2_ctx,
    ctx_attribs[pos++] = __DRI_CTX_ATTRIB_MINOR_VERSION;
    ctx_attribs[pos++] = dri2_ctx->base.ClientMinorVersion;
 
-   if (dri2_ctx->base.Flags != 0) {
+   if (dri2_ctx->base.NoError)
+      flags |= __DRI_CTX_FLAG_NO_ERROR;
+
+   if (flags != 0) {
       /* If the implementation doesn't support the __DRI2_ROBUSTNESS
        * extension, don't even try to send it the robust-access flag.
        * It may explode.  Instead, generate the required EGL error here.
@@ -920,7 +925,7 @@ dri2_fill_context_attribs(struct dri2_egl_context *dri2_ctx,
       }
 
       ctx_attribs[pos++] = __DRI_CTX_ATTRIB_FLAGS;
-      ctx_attribs[pos++] = dri2_ctx->base.Flags;
+      ctx_attribs[pos++] = flags;
    }
 
    if (dri2_ctx->base.ResetNotificationStrategy != EGL_NO_RESET_NOTIFICATION_KHR) {
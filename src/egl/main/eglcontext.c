@@ -298,6 +298,20 @@ _eglParseContextAttribList(_EGLContext *ctx, _EGLDisplay *dpy,
             ctx->Flags |= EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE_BIT_KHR;
          break;
 
+      case EGL_CONTEXT_OPENGL_NO_ERROR_KHR:
+         if (!dpy->Extensions.KHR_create_context_no_error) {
+            err = EGL_BAD_ATTRIBUTE;
+            break;
+         }
+
+         if (val != EGL_TRUE && val != EGL_FALSE) {
+            err = EGL_BAD_ATTRIBUTE;
+            break;
+         }
+
+         ctx->NoError = val;
+         break;
+
       default:
          err = EGL_BAD_ATTRIBUTE;
          break;
@@ -309,6 +323,14 @@ _eglParseContextAttribList(_EGLContext *ctx, _EGLDisplay *dpy,
       }
    }
 
+   /* EGL_KHR_create_context_no_error doesn't allow a no-error context to
+    * also be a debug or robust one.
+    */
+   if (ctx->NoError &&
+       (ctx->Flags & (EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR |
+                      EGL_CONTEXT_OPENGL_ROBUST_ACCESS_BIT_KHR)) != 0)
+      err = EGL_BAD_MATCH;
+
    if (api == EGL_OPENGL_API) {
       /* The EGL_KHR_create_context spec says:
        *
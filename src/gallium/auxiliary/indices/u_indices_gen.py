@@ -102,6 +102,8 @@ static unsigned in_size_idx( unsigned index_size )
 static u_translate_func translate[IN_COUNT][OUT_COUNT][PV_COUNT][PV_COUNT][PR_COUNT][PRIM_COUNT];
 static u_generate_func  generate[OUT_COUNT][PV_COUNT][PV_COUNT][PRIM_COUNT];
 
+#include "indices/u_indices_simd.c"
+
 
 '''
 
@@ -397,6 +399,7 @@ def emit_init():
     print '  if (!firsttime) return;'
     print '  firsttime = 0;'
     emit_all_inits()
+    print '  u_index_init_simd();'
     print '}'
 
 
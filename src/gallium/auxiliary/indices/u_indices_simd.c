@@ -0,0 +1,400 @@
+/*
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.  IN NO EVENT SHALL
+ * VMWARE AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * SSE2 versions of the hottest index translators.
+ *
+ * This file is included by the generated u_indices_gen.c, after the
+ * translate[] table declaration and before u_index_init(), which calls
+ * u_index_init_simd() to replace the scalar generated functions.
+ *
+ * Only the cases where the provoking vertex convention doesn't change are
+ * handled, which is what u_primconvert and most drivers need:
+ *  - index size widening for point/line/triangle lists,
+ *  - quads to triangles, with and without primitive restart,
+ *  - triangle strips to triangles.
+ *
+ * Every function must produce exactly the same output as the generated
+ * one it replaces.
+ */
+
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_sse.h"
+
+
+#if defined(PIPE_ARCH_SSE)
+
+
+/*
+ * Index size widening for lists.  Note that, like the generated
+ * functions, these write the output at offset 'start'.
+ */
+
+static void
+translate_list_ubyte2ushort_sse2(const void *_in,
+                                 unsigned start,
+                                 unsigned in_nr,
+                                 unsigned out_nr,
+                                 unsigned restart_index,
+                                 void *_out)
+{
+   const ubyte *in = (const ubyte *)_in + start;
+   ushort *out = (ushort *)_out + start;
+   const __m128i zero = _mm_setzero_si128();
+   unsigned i = 0;
+
+   for (; i + 16 <= out_nr; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+      _mm_storeu_si128((__m128i *)(out + i), _mm_unpacklo_epi8(v, zero));
+      _mm_storeu_si128((__m128i *)(out + i + 8), _mm_unpackhi_epi8(v, zero));
+   }
+
+   for (; i < out_nr; i++)
+      out[i] = (ushort)in[i];
+}
+
+static void
+translate_list_ushort2uint_sse2(const void *_in,
+                                unsigned start,
+                                unsigned in_nr,
+                                unsigned out_nr,
+                                unsigned restart_index,
+                                void *_out)
+{
+   const ushort *in = (const ushort *)_in + start;
+   uint *out = (uint *)_out + start;
+   const __m128i zero = _mm_setzero_si128();
+   unsigned i = 0;
+
+   for (; i + 8 <= out_nr; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+      _mm_storeu_si128((__m128i *)(out + i), _mm_unpacklo_epi16(v, zero));
+      _mm_storeu_si128((__m128i *)(out + i + 4), _mm_unpackhi_epi16(v, zero));
+   }
+
+   for (; i < out_nr; i++)
+      out[i] = (uint)in[i];
+}
+
+
+/*
+ * Loading four consecutive indices, either as 16-bit lanes (for ushort
+ * output) or 32-bit lanes (for uint output).
+ */
+
+static inline __m128i
+load4_ubyte_epi16(const ubyte *in)
+{
+   uint32_t v;
+   memcpy(&v, in, sizeof v);
+   return _mm_unpacklo_epi8(_mm_cvtsi32_si128(v), _mm_setzero_si128());
+}
+
+static inline __m128i
+load4_ushort_epi16(const ushort *in)
+{
+   return _mm_loadl_epi64((const __m128i *)in);
+}
+
+static inline __m128i
+load4_ushort_epi32(const ushort *in)
+{
+   return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)in),
+                             _mm_setzero_si128());
+}
+
+static inline __m128i
+load4_uint_epi32(const uint *in)
+{
+   return _mm_loadu_si128((const __m128i *)in);
+}
+
+
+/*
+ * Storing six indices (two triangles) picked from the four loaded ones.
+ * 'a' selects the first four and 'b' the last two, in _MM_SHUFFLE order.
+ */
+
+#define STORE6_epi16(out, v, a, b)                                       \
+   do {                                                                  \
+      uint32_t _tail = _mm_cvtsi128_si32(_mm_shufflelo_epi16(v, b));     \
+      _mm_storel_epi64((__m128i *)(out), _mm_shufflelo_epi16(v, a));     \
+      memcpy((out) + 4, &_tail, sizeof _tail);                           \
+   } while (0)
+
+#define STORE6_epi32(out, v, a, b)                                       \
+   do {                                                                  \
+      _mm_storeu_si128((__m128i *)(out), _mm_shuffle_epi32(v, a));       \
+      _mm_storel_epi64((__m128i *)((out) + 4), _mm_shuffle_epi32(v, b)); \
+   } while (0)
+
+
+/*
+ * Return the position of the first of four loaded indices which is equal
+ * to the restart index, or -1.  The comparison is done on the zero
+ * extended values, like the generated code does.
+ */
+
+static inline int
+find_restart_epi16(__m128i v, unsigned restart_index)
+{
+   unsigned mask;
+
+   if (restart_index > 0xffff)
+      return -1;
+
+   mask = _mm_movemask_epi8(_mm_cmpeq_epi16(v,
+                              _mm_set1_epi16((short)restart_index))) & 0xff;
+   return mask ? (ffs(mask) - 1) / 2 : -1;
+}
+
+static inline int
+find_restart_epi32(__m128i v, unsigned restart_index)
+{
+   unsigned mask;
+
+   mask = _mm_movemask_epi8(_mm_cmpeq_epi32(v,
+                              _mm_set1_epi32((int)restart_index)));
+   return mask ? (ffs(mask) - 1) / 4 : -1;
+}
+
+
+/* Tri order (0,1,2),(0,2,3) for first and (0,1,3),(1,2,3) for last PV */
+#define QUAD_FIRST_A _MM_SHUFFLE(0, 2, 1, 0)
+#define QUAD_FIRST_B _MM_SHUFFLE(3, 3, 3, 2)
+#define QUAD_LAST_A  _MM_SHUFFLE(1, 3, 1, 0)
+#define QUAD_LAST_B  _MM_SHUFFLE(3, 3, 3, 2)
+
+/* Strip pair order (0,1,2),(1,3,2) for first and (0,1,2),(2,1,3) for last */
+#define STRIP_FIRST_A _MM_SHUFFLE(1, 2, 1, 0)
+#define STRIP_FIRST_B _MM_SHUFFLE(3, 3, 2, 3)
+#define STRIP_LAST_A  _MM_SHUFFLE(2, 2, 1, 0)
+#define STRIP_LAST_B  _MM_SHUFFLE(3, 3, 3, 1)
+
+
+#define QUADS(INTYPE, OUTTYPE, LANES, PV, A, B)                               \
+static void                                                                   \
+translate_quads_##INTYPE##2##OUTTYPE##_##PV##_sse2(const void *_in,           \
+                                                   unsigned start,            \
+                                                   unsigned in_nr,            \
+                                                   unsigned out_nr,           \
+                                                   unsigned restart_index,    \
+                                                   void *_out)                \
+{                                                                             \
+   const INTYPE *in = (const INTYPE *)_in;                                    \
+   OUTTYPE *out = (OUTTYPE *)_out;                                            \
+   unsigned i, j;                                                             \
+                                                                              \
+   for (i = start, j = 0; j < out_nr; j += 6, i += 4) {                       \
+      __m128i v = load4_##INTYPE##_##LANES(in + i);                           \
+      STORE6_##LANES(out + j, v, A, B);                                       \
+   }                                                                          \
+}                                                                             \
+                                                                              \
+static void                                                                   \
+translate_quads_##INTYPE##2##OUTTYPE##_##PV##_prenable_sse2(const void *_in,  \
+                                                   unsigned start,            \
+                                                   unsigned in_nr,            \
+                                                   unsigned out_nr,           \
+                                                   unsigned restart_index,    \
+                                                   void *_out)                \
+{                                                                             \
+   const INTYPE *in = (const INTYPE *)_in;                                    \
+   OUTTYPE *out = (OUTTYPE *)_out;                                            \
+   unsigned i, j;                                                             \
+                                                                              \
+   for (i = start, j = 0; j < out_nr; j += 6, i += 4) {                       \
+      __m128i v;                                                              \
+      int r;                                                                  \
+restart:                                                                      \
+      if (i + 4 > in_nr) {                                                    \
+         unsigned k;                                                          \
+         for (k = 0; k < 6; k++)                                              \
+            out[j + k] = (OUTTYPE)restart_index;                              \
+         continue;                                                            \
+      }                                                                       \
+      v = load4_##INTYPE##_##LANES(in + i);                                   \
+      r = find_restart_##LANES(v, restart_index);                             \
+      if (r >= 0) {                                                           \
+         i += r + 1;                                                          \
+         goto restart;                                                        \
+      }                                                                       \
+      STORE6_##LANES(out + j, v, A, B);                                       \
+   }                                                                          \
+}
+
+#define TRISTRIP(INTYPE, OUTTYPE, LANES, PV, A, B, TRI)                       \
+static void                                                                   \
+translate_tristrip_##INTYPE##2##OUTTYPE##_##PV##_sse2(const void *_in,        \
+                                                      unsigned start,         \
+                                                      unsigned in_nr,         \
+                                                      unsigned out_nr,        \
+                                                      unsigned restart_index, \
+                                                      void *_out)             \
+{                                                                             \
+   const INTYPE *in = (const INTYPE *)_in;                                    \
+   OUTTYPE *out = (OUTTYPE *)_out;                                            \
+   unsigned i = start, j = 0;                                                 \
+                                                                              \
+   /* the winding depends on the parity of the absolute vertex index */       \
+   if ((i & 1) && j < out_nr) {                                               \
+      TRI(out + j, in, i);                                                    \
+      j += 3, i++;                                                            \
+   }                                                                          \
+   for (; j + 6 <= out_nr; j += 6, i += 2) {                                  \
+      __m128i v = load4_##INTYPE##_##LANES(in + i);                           \
+      STORE6_##LANES(out + j, v, A, B);                                       \
+   }                                                                          \
+   for (; j < out_nr; j += 3, i++)                                            \
+      TRI(out + j, in, i);                                                    \
+}
+
+/* Same formulas as u_indices_gen.py for matching provoking vertices */
+#define STRIP_TRI_FIRST(out, in, i)                                           \
+   do {                                                                       \
+      (out)[0] = in[i];                                                       \
+      (out)[1] = in[i + 1 + (i & 1)];                                         \
+      (out)[2] = in[i + 2 - (i & 1)];                                         \
+   } while (0)
+
+#define STRIP_TRI_LAST(out, in, i)                                            \
+   do {                                                                       \
+      (out)[0] = in[i + (i & 1)];                                             \
+      (out)[1] = in[i + 1 - (i & 1)];                                         \
+      (out)[2] = in[i + 2];                                                   \
+   } while (0)
+
+
+QUADS(ubyte,  ushort, epi16, first, QUAD_FIRST_A, QUAD_FIRST_B)
+QUADS(ubyte,  ushort, epi16, last,  QUAD_LAST_A,  QUAD_LAST_B)
+QUADS(ushort, ushort, epi16, first, QUAD_FIRST_A, QUAD_FIRST_B)
+QUADS(ushort, ushort, epi16, last,  QUAD_LAST_A,  QUAD_LAST_B)
+QUADS(ushort, uint,   epi32, first, QUAD_FIRST_A, QUAD_FIRST_B)
+QUADS(ushort, uint,   epi32, last,  QUAD_LAST_A,  QUAD_LAST_B)
+QUADS(uint,   uint,   epi32, first, QUAD_FIRST_A, QUAD_FIRST_B)
+QUADS(uint,   uint,   epi32, last,  QUAD_LAST_A,  QUAD_LAST_B)
+
+TRISTRIP(ubyte,  ushort, epi16, first, STRIP_FIRST_A, STRIP_FIRST_B, STRIP_TRI_FIRST)
+TRISTRIP(ubyte,  ushort, epi16, last,  STRIP_LAST_A,  STRIP_LAST_B,  STRIP_TRI_LAST)
+TRISTRIP(ushort, ushort, epi16, first, STRIP_FIRST_A, STRIP_FIRST_B, STRIP_TRI_FIRST)
+TRISTRIP(ushort, ushort, epi16, last,  STRIP_LAST_A,  STRIP_LAST_B,  STRIP_TRI_LAST)
+TRISTRIP(ushort, uint,   epi32, first, STRIP_FIRST_A, STRIP_FIRST_B, STRIP_TRI_FIRST)
+TRISTRIP(ushort, uint,   epi32, last,  STRIP_LAST_A,  STRIP_LAST_B,  STRIP_TRI_LAST)
+TRISTRIP(uint,   uint,   epi32, first, STRIP_FIRST_A, STRIP_FIRST_B, STRIP_TRI_FIRST)
+TRISTRIP(uint,   uint,   epi32, last,  STRIP_LAST_A,  STRIP_LAST_B,  STRIP_TRI_LAST)
+
+
+#define SET_QUADS(in, out, intype, outtype)                                   \
+   do {                                                                       \
+      translate[in][out][PV_FIRST][PV_FIRST][PR_DISABLE][PIPE_PRIM_QUADS] =   \
+         translate_quads_##intype##2##outtype##_first_sse2;                   \
+      translate[in][out][PV_LAST][PV_LAST][PR_DISABLE][PIPE_PRIM_QUADS] =     \
+         translate_quads_##intype##2##outtype##_last_sse2;                    \
+      translate[in][out][PV_FIRST][PV_FIRST][PR_ENABLE][PIPE_PRIM_QUADS] =    \
+         translate_quads_##intype##2##outtype##_first_prenable_sse2;          \
+      translate[in][out][PV_LAST][PV_LAST][PR_ENABLE][PIPE_PRIM_QUADS] =      \
+         translate_quads_##intype##2##outtype##_last_prenable_sse2;           \
+   } while (0)
+
+/* The generated strip translators ignore primitive restart. */
+#define SET_TRISTRIP(in, out, intype, outtype)                                \
+   do {                                                                       \
+      unsigned pr;                                                            \
+      for (pr = 0; pr < PR_COUNT; pr++) {                                     \
+         translate[in][out][PV_FIRST][PV_FIRST][pr][PIPE_PRIM_TRIANGLE_STRIP] = \
+            translate_tristrip_##intype##2##outtype##_first_sse2;             \
+         translate[in][out][PV_LAST][PV_LAST][pr][PIPE_PRIM_TRIANGLE_STRIP] = \
+            translate_tristrip_##intype##2##outtype##_last_sse2;              \
+      }                                                                       \
+   } while (0)
+
+
+static void
+u_index_init_sse2(void)
+{
+   unsigned in_pv, out_pv, pr;
+
+   /* Points ignore the provoking vertex, lines and triangles only when it
+    * doesn't change.  None of them care about primitive restart.
+    */
+   for (in_pv = 0; in_pv < PV_COUNT; in_pv++) {
+      for (out_pv = 0; out_pv < PV_COUNT; out_pv++) {
+         for (pr = 0; pr < PR_COUNT; pr++) {
+            translate[IN_UBYTE][OUT_USHORT][in_pv][out_pv][pr][PIPE_PRIM_POINTS] =
+               translate_list_ubyte2ushort_sse2;
+            translate[IN_USHORT][OUT_UINT][in_pv][out_pv][pr][PIPE_PRIM_POINTS] =
+               translate_list_ushort2uint_sse2;
+
+            if (in_pv != out_pv)
+               continue;
+
+            translate[IN_UBYTE][OUT_USHORT][in_pv][out_pv][pr][PIPE_PRIM_LINES] =
+               translate_list_ubyte2ushort_sse2;
+            translate[IN_UBYTE][OUT_USHORT][in_pv][out_pv][pr][PIPE_PRIM_TRIANGLES] =
+               translate_list_ubyte2ushort_sse2;
+            translate[IN_USHORT][OUT_UINT][in_pv][out_pv][pr][PIPE_PRIM_LINES] =
+               translate_list_ushort2uint_sse2;
+            translate[IN_USHORT][OUT_UINT][in_pv][out_pv][pr][PIPE_PRIM_TRIANGLES] =
+               translate_list_ushort2uint_sse2;
+         }
+      }
+   }
+
+   SET_QUADS(IN_UBYTE,  OUT_USHORT, ubyte,  ushort);
+   SET_QUADS(IN_USHORT, OUT_USHORT, ushort, ushort);
+   SET_QUADS(IN_USHORT, OUT_UINT,   ushort, uint);
+   SET_QUADS(IN_UINT,   OUT_UINT,   uint,   uint);
+
+   SET_TRISTRIP(IN_UBYTE,  OUT_USHORT, ubyte,  ushort);
+   SET_TRISTRIP(IN_USHORT, OUT_USHORT, ushort, ushort);
+   SET_TRISTRIP(IN_USHORT, OUT_UINT,   ushort, uint);
+   SET_TRISTRIP(IN_UINT,   OUT_UINT,   uint,   uint);
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(indices_simd, "GALLIUM_INDICES_SIMD", TRUE)
+
+/**
+ * Replace generated translators with vectorized ones where the CPU
+ * supports it.  GALLIUM_INDICES_SIMD=0 keeps the scalar ones, which is
+ * useful for comparing results and performance.
+ */
+static void
+u_index_init_simd(void)
+{
+   if (!debug_get_option_indices_simd())
+      return;
+
+   util_cpu_detect();
+
+#if defined(PIPE_ARCH_SSE)
+   if (util_cpu_caps.has_sse2)
+      u_index_init_sse2();
+#endif
+}
@@ -0,0 +1,659 @@
+/**************************************************************************
+ *
+ * Copyright 2015 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Vertex translate implemented with gallivm.
+ *
+ * For each translate_key a fully specialized fetch/convert/emit loop is
+ * generated, one per index mode (linear, 8, 16 and 32-bit elements).
+ * Unlike translate_sse this works on any host LLVM can target, and
+ * input formats are fetched with lp_build_fetch_rgba_aos so every format
+ * util_format knows about can be read.
+ *
+ * Keys with pure integer inputs or output formats we can't emit directly
+ * are rejected, so the caller falls back to translate_generic.
+ */
+
+#include "pipe/p_config.h"
+#include "pipe/p_compiler.h"
+#include "util/u_debug.h"
+#include "util/u_memory.h"
+#include "util/u_format.h"
+#include "util/u_string.h"
+
+#include "gallivm/lp_bld.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_format.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_struct.h"
+#include "gallivm/lp_bld_swizzle.h"
+#include "gallivm/lp_bld_type.h"
+
+#include "translate.h"
+
+
+enum translate_llvm_mode {
+   TRANSLATE_LLVM_LINEAR = 0,
+   TRANSLATE_LLVM_ELTS8,
+   TRANSLATE_LLVM_ELTS16,
+   TRANSLATE_LLVM_ELTS32,
+   TRANSLATE_LLVM_NUM_MODES
+};
+
+
+/**
+ * Per-attribute input state, filled in by set_buffer() and read by the
+ * generated code.  Keep in sync with create_jit_attrib_type().
+ */
+struct translate_llvm_attrib {
+   const uint8_t *input_ptr;
+   unsigned input_stride;
+   unsigned max_index;
+};
+
+enum {
+   TRANSLATE_LLVM_ATTRIB_INPUT_PTR = 0,
+   TRANSLATE_LLVM_ATTRIB_INPUT_STRIDE,
+   TRANSLATE_LLVM_ATTRIB_MAX_INDEX,
+   TRANSLATE_LLVM_ATTRIB_NUM_FIELDS
+};
+
+
+typedef void
+(*translate_llvm_jit_func)(const struct translate_llvm_attrib *attribs,
+                           const void *elts,
+                           unsigned start,
+                           unsigned count,
+                           unsigned start_instance,
+                           unsigned instance_id,
+                           void *output_buffer);
+
+
+struct translate_llvm {
+   struct translate translate;
+
+   struct translate_llvm_attrib attrib[TRANSLATE_MAX_ATTRIBS];
+
+   LLVMContextRef context;
+   struct gallivm_state *gallivm;
+   LLVMTypeRef attrib_ptr_type;
+
+   LLVMValueRef function[TRANSLATE_LLVM_NUM_MODES];
+   translate_llvm_jit_func jit_func[TRANSLATE_LLVM_NUM_MODES];
+};
+
+
+static struct translate_llvm *
+translate_llvm(struct translate *translate)
+{
+   return (struct translate_llvm *)translate;
+}
+
+
+static boolean
+is_identity_swizzle(const struct util_format_description *desc)
+{
+   unsigned i;
+
+   for (i = 0; i < desc->nr_channels; i++) {
+      if (desc->swizzle[i] != i)
+         return FALSE;
+   }
+   return TRUE;
+}
+
+
+/**
+ * Whether we can emit a float4 attribute in the given format.  We only
+ * handle the 32-bit per channel RGBA-ordered formats here, which is what
+ * draw and u_vbuf translate to in practice.
+ */
+static boolean
+is_output_format_supported(const struct util_format_description *desc)
+{
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       !is_identity_swizzle(desc))
+      return FALSE;
+
+   for (i = 0; i < desc->nr_channels; i++) {
+      if (desc->channel[i].size != 32 ||
+          desc->channel[i].normalized ||
+          desc->channel[i].pure_integer)
+         return FALSE;
+
+      if (desc->channel[i].type != UTIL_FORMAT_TYPE_FLOAT &&
+          desc->channel[i].type != UTIL_FORMAT_TYPE_UNSIGNED &&
+          desc->channel[i].type != UTIL_FORMAT_TYPE_SIGNED)
+         return FALSE;
+
+      if (desc->channel[i].type != desc->channel[0].type)
+         return FALSE;
+   }
+   return TRUE;
+}
+
+
+/**
+ * Returns the number of bytes to copy verbatim for the element, or -1 if
+ * a format conversion is needed.
+ */
+static int
+get_copy_size(const struct translate_element *elem)
+{
+   const struct util_format_description *desc =
+      util_format_description(elem->input_format);
+
+   if (elem->type == TRANSLATE_ELEMENT_INSTANCE_ID) {
+      if (elem->output_format == PIPE_FORMAT_R32_USCALED ||
+          elem->output_format == PIPE_FORMAT_R32_SSCALED)
+         return 4;
+      return -1;
+   }
+
+   if (elem->input_format == elem->output_format &&
+       desc->block.width == 1 &&
+       desc->block.height == 1 &&
+       !(desc->block.bits & 7))
+      return desc->block.bits >> 3;
+
+   return -1;
+}
+
+
+static boolean
+is_key_supported(const struct translate_key *key)
+{
+   unsigned i;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      const struct translate_element *elem = &key->element[i];
+      const struct util_format_description *out_desc =
+         util_format_description(elem->output_format);
+
+      if (get_copy_size(elem) >= 0)
+         continue;
+
+      if (!out_desc || !is_output_format_supported(out_desc))
+         return FALSE;
+
+      if (elem->type == TRANSLATE_ELEMENT_NORMAL) {
+         const struct util_format_description *in_desc =
+            util_format_description(elem->input_format);
+
+         if (!in_desc ||
+             in_desc->channel[0].pure_integer ||
+             in_desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS)
+            return FALSE;
+      }
+   }
+   return TRUE;
+}
+
+
+static LLVMTypeRef
+create_jit_attrib_type(struct gallivm_state *gallivm)
+{
+   LLVMTargetDataRef target = gallivm->target;
+   LLVMTypeRef elem_types[TRANSLATE_LLVM_ATTRIB_NUM_FIELDS];
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(gallivm->context);
+   LLVMTypeRef attrib_type;
+
+   elem_types[TRANSLATE_LLVM_ATTRIB_INPUT_PTR] =
+      LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+   elem_types[TRANSLATE_LLVM_ATTRIB_INPUT_STRIDE] = int32_type;
+   elem_types[TRANSLATE_LLVM_ATTRIB_MAX_INDEX] = int32_type;
+
+   attrib_type = LLVMStructTypeInContext(gallivm->context, elem_types,
+                                         Elements(elem_types), 0);
+
+   (void) target; /* silence unused var warning for non-debug build */
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_attrib, input_ptr,
+                          target, attrib_type,
+                          TRANSLATE_LLVM_ATTRIB_INPUT_PTR);
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_attrib, input_stride,
+                          target, attrib_type,
+                          TRANSLATE_LLVM_ATTRIB_INPUT_STRIDE);
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_attrib, max_index,
+                          target, attrib_type,
+                          TRANSLATE_LLVM_ATTRIB_MAX_INDEX);
+   LP_CHECK_STRUCT_SIZE(struct translate_llvm_attrib,
+                        target, attrib_type);
+
+   return attrib_type;
+}
+
+
+/**
+ * Store 'size' bytes of 'value' (an integer or vector of that many
+ * bytes) at byte offset 'offset' of 'base', without assuming alignment.
+ */
+static void
+store_unaligned(struct gallivm_state *gallivm,
+                LLVMValueRef base, unsigned offset, LLVMValueRef value)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef index = lp_build_const_int32(gallivm, offset);
+   LLVMValueRef ptr;
+
+   ptr = LLVMBuildGEP(builder, base, &index, 1, "");
+   ptr = LLVMBuildBitCast(builder, ptr,
+                          LLVMPointerType(LLVMTypeOf(value), 0), "");
+   lp_set_store_alignment(LLVMBuildStore(builder, value, ptr), 1);
+}
+
+
+/**
+ * Emit the float4 'rgba' converted to the 32-bit per channel format
+ * described by 'desc'.
+ */
+static void
+emit_rgba(struct gallivm_state *gallivm,
+          const struct util_format_description *desc,
+          LLVMValueRef rgba,
+          LLVMValueRef dst,
+          unsigned output_offset)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(gallivm->context);
+   unsigned i;
+
+   for (i = 0; i < desc->nr_channels; i++) {
+      LLVMValueRef chan =
+         LLVMBuildExtractElement(builder, rgba,
+                                 lp_build_const_int32(gallivm, i), "");
+
+      switch (desc->channel[i].type) {
+      case UTIL_FORMAT_TYPE_UNSIGNED:
+         chan = LLVMBuildFPToUI(builder, chan, int32_type, "");
+         break;
+      case UTIL_FORMAT_TYPE_SIGNED:
+         chan = LLVMBuildFPToSI(builder, chan, int32_type, "");
+         break;
+      default:
+         assert(desc->channel[i].type == UTIL_FORMAT_TYPE_FLOAT);
+         break;
+      }
+
+      store_unaligned(gallivm, dst, output_offset + i * 4, chan);
+   }
+}
+
+
+static void
+generate_element(struct translate_llvm *tl,
+                 unsigned attr,
+                 LLVMValueRef attribs_ptr,
+                 LLVMValueRef index,
+                 LLVMValueRef start_instance,
+                 LLVMValueRef instance_id,
+                 LLVMValueRef dst)
+{
+   struct gallivm_state *gallivm = tl->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct translate_element *elem = &tl->translate.key.element[attr];
+   const struct util_format_description *out_desc =
+      util_format_description(elem->output_format);
+   LLVMValueRef zero = lp_build_const_int32(gallivm, 0);
+   LLVMValueRef attr_index = lp_build_const_int32(gallivm, attr);
+   int copy_size = get_copy_size(elem);
+   LLVMValueRef attrib_ptr;
+   LLVMValueRef input_ptr;
+   LLVMValueRef input_stride;
+   LLVMValueRef src;
+
+   if (elem->type == TRANSLATE_ELEMENT_INSTANCE_ID) {
+      if (copy_size >= 0)
+         store_unaligned(gallivm, dst, elem->output_offset, instance_id);
+      else {
+         LLVMValueRef rgba =
+            LLVMBuildUIToFP(builder, instance_id,
+                            LLVMFloatTypeInContext(gallivm->context), "");
+         rgba = lp_build_broadcast(gallivm,
+                                   lp_build_vec_type(gallivm,
+                                                     lp_float32_vec4_type()),
+                                   rgba);
+         emit_rgba(gallivm, out_desc, rgba, dst, elem->output_offset);
+      }
+      return;
+   }
+
+   attrib_ptr = LLVMBuildGEP(builder, attribs_ptr, &attr_index, 1, "");
+
+   if (elem->instance_divisor) {
+      index = LLVMBuildUDiv(builder, instance_id,
+                            lp_build_const_int32(gallivm,
+                                                 elem->instance_divisor), "");
+      index = LLVMBuildAdd(builder, start_instance, index, "");
+   }
+   else {
+      /* clamp to avoid going out of bounds */
+      LLVMValueRef max_index =
+         lp_build_struct_get(gallivm, attrib_ptr,
+                             TRANSLATE_LLVM_ATTRIB_MAX_INDEX, "max_index");
+      LLVMValueRef cond = LLVMBuildICmp(builder, LLVMIntULT,
+                                        index, max_index, "");
+      index = LLVMBuildSelect(builder, cond, index, max_index, "");
+   }
+
+   input_ptr = lp_build_struct_get(gallivm, attrib_ptr,
+                                   TRANSLATE_LLVM_ATTRIB_INPUT_PTR,
+                                   "input_ptr");
+   input_stride = lp_build_struct_get(gallivm, attrib_ptr,
+                                      TRANSLATE_LLVM_ATTRIB_INPUT_STRIDE,
+                                      "input_stride");
+   src = LLVMBuildMul(builder, input_stride, index, "");
+   src = LLVMBuildGEP(builder, input_ptr, &src, 1, "");
+
+   if (copy_size >= 0) {
+      LLVMTypeRef copy_type =
+         LLVMIntTypeInContext(gallivm->context, copy_size * 8);
+      LLVMValueRef val;
+
+      src = LLVMBuildBitCast(builder, src,
+                             LLVMPointerType(copy_type, 0), "");
+      val = LLVMBuildLoad(builder, src, "");
+      lp_set_load_alignment(val, 1);
+      store_unaligned(gallivm, dst, elem->output_offset, val);
+   }
+   else {
+      LLVMValueRef rgba =
+         lp_build_fetch_rgba_aos(gallivm,
+                                 util_format_description(elem->input_format),
+                                 lp_float32_vec4_type(),
+                                 FALSE,
+                                 src, zero, zero, zero);
+      emit_rgba(gallivm, out_desc, rgba, dst, elem->output_offset);
+   }
+}
+
+
+static LLVMValueRef
+generate_run(struct translate_llvm *tl, enum translate_llvm_mode mode)
+{
+   static const char *mode_names[TRANSLATE_LLVM_NUM_MODES] = {
+      "linear", "elts8", "elts16", "elts32"
+   };
+   struct gallivm_state *gallivm = tl->gallivm;
+   LLVMContextRef context = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(context);
+   LLVMTypeRef int8_ptr_type = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+   LLVMTypeRef arg_types[7];
+   LLVMTypeRef func_type;
+   LLVMValueRef func;
+   LLVMValueRef attribs_ptr, elts_ptr, start, count;
+   LLVMValueRef start_instance, instance_id, output_ptr;
+   LLVMBasicBlockRef block;
+   struct lp_build_for_loop_state loop;
+   LLVMValueRef index, dst;
+   char func_name[64];
+   unsigned i;
+
+   util_snprintf(func_name, sizeof(func_name), "translate_%s",
+                 mode_names[mode]);
+
+   arg_types[0] = tl->attrib_ptr_type;   /* attribs */
+   arg_types[1] = int8_ptr_type;         /* elts */
+   arg_types[2] = int32_type;            /* start */
+   arg_types[3] = int32_type;            /* count */
+   arg_types[4] = int32_type;            /* start_instance */
+   arg_types[5] = int32_type;            /* instance_id */
+   arg_types[6] = int8_ptr_type;         /* output_buffer */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                arg_types, Elements(arg_types), 0);
+
+   func = LLVMAddFunction(gallivm->module, func_name, func_type);
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+   for (i = 0; i < Elements(arg_types); ++i) {
+      if (LLVMGetTypeKind(arg_types[i]) == LLVMPointerTypeKind)
+         LLVMAddAttribute(LLVMGetParam(func, i), LLVMNoAliasAttribute);
+   }
+
+   attribs_ptr    = LLVMGetParam(func, 0);
+   elts_ptr       = LLVMGetParam(func, 1);
+   start          = LLVMGetParam(func, 2);
+   count          = LLVMGetParam(func, 3);
+   start_instance = LLVMGetParam(func, 4);
+   instance_id    = LLVMGetParam(func, 5);
+   output_ptr     = LLVMGetParam(func, 6);
+
+   lp_build_name(attribs_ptr, "attribs");
+   lp_build_name(elts_ptr, "elts");
+   lp_build_name(start, "start");
+   lp_build_name(count, "count");
+   lp_build_name(start_instance, "start_instance");
+   lp_build_name(instance_id, "instance_id");
+   lp_build_name(output_ptr, "output_buffer");
+
+   block = LLVMAppendBasicBlockInContext(context, func, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_for_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0),
+                           LLVMIntULT, count,
+                           lp_build_const_int32(gallivm, 1));
+   {
+      if (mode == TRANSLATE_LLVM_LINEAR) {
+         index = LLVMBuildAdd(builder, start, loop.counter, "");
+      }
+      else {
+         unsigned elt_bits = mode == TRANSLATE_LLVM_ELTS8 ? 8 :
+                             mode == TRANSLATE_LLVM_ELTS16 ? 16 : 32;
+         LLVMTypeRef elt_type = LLVMIntTypeInContext(context, elt_bits);
+         LLVMValueRef elt_ptr =
+            LLVMBuildBitCast(builder, elts_ptr,
+                             LLVMPointerType(elt_type, 0), "");
+
+         elt_ptr = LLVMBuildGEP(builder, elt_ptr, &loop.counter, 1, "");
+         index = LLVMBuildLoad(builder, elt_ptr, "elt");
+         if (elt_bits < 32)
+            index = LLVMBuildZExt(builder, index, int32_type, "");
+      }
+
+      dst = LLVMBuildMul(builder, loop.counter,
+                         lp_build_const_int32(gallivm,
+                                              tl->translate.key.output_stride),
+                         "");
+      dst = LLVMBuildGEP(builder, output_ptr, &dst, 1, "");
+
+      for (i = 0; i < tl->translate.key.nr_elements; i++) {
+         generate_element(tl, i, attribs_ptr, index,
+                          start_instance, instance_id, dst);
+      }
+   }
+   lp_build_for_loop_end(&loop);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+static void PIPE_CDECL
+llvm_run_elts(struct translate *translate,
+              const unsigned *elts,
+              unsigned count,
+              unsigned start_instance,
+              unsigned instance_id,
+              void *output_buffer)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+
+   tl->jit_func[TRANSLATE_LLVM_ELTS32](tl->attrib, elts, 0, count,
+                                       start_instance, instance_id,
+                                       output_buffer);
+}
+
+static void PIPE_CDECL
+llvm_run_elts16(struct translate *translate,
+                const uint16_t *elts,
+                unsigned count,
+                unsigned start_instance,
+                unsigned instance_id,
+                void *output_buffer)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+
+   tl->jit_func[TRANSLATE_LLVM_ELTS16](tl->attrib, elts, 0, count,
+                                       start_instance, instance_id,
+                                       output_buffer);
+}
+
+static void PIPE_CDECL
+llvm_run_elts8(struct translate *translate,
+               const uint8_t *elts,
+               unsigned count,
+               unsigned start_instance,
+               unsigned instance_id,
+               void *output_buffer)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+
+   tl->jit_func[TRANSLATE_LLVM_ELTS8](tl->attrib, elts, 0, count,
+                                      start_instance, instance_id,
+                                      output_buffer);
+}
+
+static void PIPE_CDECL
+llvm_run(struct translate *translate,
+         unsigned start,
+         unsigned count,
+         unsigned start_instance,
+         unsigned instance_id,
+         void *output_buffer)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+
+   tl->jit_func[TRANSLATE_LLVM_LINEAR](tl->attrib, NULL, start, count,
+                                       start_instance, instance_id,
+                                       output_buffer);
+}
+
+
+static void
+llvm_set_buffer(struct translate *translate,
+                unsigned buf,
+                const void *ptr,
+                unsigned stride,
+                unsigned max_index)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+   unsigned i;
+
+   for (i = 0; i < tl->translate.key.nr_elements; i++) {
+      const struct translate_element *elem = &tl->translate.key.element[i];
+
+      if (elem->type == TRANSLATE_ELEMENT_NORMAL &&
+          elem->input_buffer == buf) {
+         tl->attrib[i].input_ptr = (const uint8_t *)ptr + elem->input_offset;
+         tl->attrib[i].input_stride = stride;
+         tl->attrib[i].max_index = max_index;
+      }
+   }
+}
+
+
+static void
+llvm_release(struct translate *translate)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+
+   if (tl->gallivm)
+      gallivm_destroy(tl->gallivm);
+   if (tl->context)
+      LLVMContextDispose(tl->context);
+   FREE(tl);
+}
+
+
+struct translate *
+translate_llvm_create(const struct translate_key *key)
+{
+   struct translate_llvm *tl;
+   unsigned mode;
+
+   assert(key->nr_elements <= TRANSLATE_MAX_ATTRIBS);
+
+   if (!is_key_supported(key))
+      return NULL;
+
+   if (!lp_build_init())
+      return NULL;
+
+   tl = CALLOC_STRUCT(translate_llvm);
+   if (!tl)
+      return NULL;
+
+   tl->translate.key = *key;
+   tl->translate.release = llvm_release;
+   tl->translate.set_buffer = llvm_set_buffer;
+   tl->translate.run_elts = llvm_run_elts;
+   tl->translate.run_elts16 = llvm_run_elts16;
+   tl->translate.run_elts8 = llvm_run_elts8;
+   tl->translate.run = llvm_run;
+
+   /* Each translate owns its context so that creation is safe from any
+    * thread, like the other translate implementations.
+    */
+   tl->context = LLVMContextCreate();
+   if (!tl->context)
+      goto fail;
+
+   tl->gallivm = gallivm_create("translate", tl->context);
+   if (!tl->gallivm)
+      goto fail;
+
+   tl->attrib_ptr_type =
+      LLVMPointerType(create_jit_attrib_type(tl->gallivm), 0);
+
+   for (mode = 0; mode < TRANSLATE_LLVM_NUM_MODES; mode++)
+      tl->function[mode] = generate_run(tl, mode);
+
+   gallivm_compile_module(tl->gallivm);
+
+   for (mode = 0; mode < TRANSLATE_LLVM_NUM_MODES; mode++) {
+      tl->jit_func[mode] = (translate_llvm_jit_func)
+         gallivm_jit_function(tl->gallivm, tl->function[mode]);
+      if (!tl->jit_func[mode])
+         goto fail;
+   }
+
+   gallivm_free_ir(tl->gallivm);
+
+   return &tl->translate;
+
+fail:
+   llvm_release(&tl->translate);
+   return NULL;
+}
@@ -38,6 +38,7 @@
 
 
 from u_format_parse import *
+from u_format_simd import generate_format_unpack_simd, generate_format_pack_simd
 
 
 def inv_swizzles(swizzles):
@@ -616,6 +617,10 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
 
     name = format.short_name()
 
+    simd_name = None
+    if is_format_supported(format):
+        simd_name = generate_format_unpack_simd(format, dst_native_type, dst_suffix)
+
     print 'static inline void'
     print 'util_format_%s_unpack_%s(%s *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, dst_suffix, dst_native_type)
     print '{'
@@ -625,7 +630,17 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
         print '      %s *dst = dst_row;' % (dst_native_type)
         print '      const uint8_t *src = src_row;'
-        print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
+        if simd_name:
+            print '#if defined(PIPE_ARCH_SSE)'
+            print '      x = %s(dst, src, width);' % simd_name
+            print '      src += x * %u;' % (format.block_size() / 8,)
+            print '      dst += x * 4;'
+            print '#else'
+            print '      x = 0;'
+            print '#endif'
+            print '      for(; x < width; x += %u) {' % (format.block_width,)
+        else:
+            print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
         
         generate_unpack_kernel(format, dst_channel, dst_native_type)
     
@@ -645,6 +660,10 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
 
     name = format.short_name()
 
+    simd_name = None
+    if is_format_supported(format):
+        simd_name = generate_format_pack_simd(format, src_native_type, src_suffix)
+
     print 'static inline void'
     print 'util_format_%s_pack_%s(uint8_t *dst_row, unsigned dst_stride, const %s *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, src_suffix, src_native_type)
     print '{'
@@ -654,7 +673,17 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
         print '      const %s *src = src_row;' % (src_native_type)
         print '      uint8_t *dst = dst_row;'
-        print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
+        if simd_name:
+            print '#if defined(PIPE_ARCH_SSE)'
+            print '      x = %s(dst, src, width);' % simd_name
+            print '      src += x * 4;'
+            print '      dst += x * %u;' % (format.block_size() / 8,)
+            print '#else'
+            print '      x = 0;'
+            print '#endif'
+            print '      for(; x < width; x += %u) {' % (format.block_width,)
+        else:
+            print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
     
         generate_pack_kernel(format, src_channel, src_native_type)
             
@@ -699,6 +728,7 @@ def generate(formats):
     print '#include "util/format_srgb.h"'
     print '#include "u_format_yuv.h"'
     print '#include "u_format_zs.h"'
+    print '#include "u_sse.h"'
     print
 
     for format in formats:
@@ -0,0 +1,496 @@
+#!/usr/bin/env python
+
+'''
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * SSE2 row helpers for the pixel format packing and unpacking functions.
+ *
+ * The helpers convert four pixels at a time and return the number of pixels
+ * converted, leaving the remainder of the row to the scalar code.  Results
+ * are bit identical to the scalar code generated by u_format_pack.py.
+ */
+'''
+
+
+from u_format_parse import *
+
+
+ONE_8UNORM = '_mm_set1_epi32(0xff)'
+
+
+def is_unorm8_bitmask(format):
+    '''16/32bpp formats made of unsigned normalized channels of at most 8 bits,
+    such as B8G8R8A8_UNORM or B5G6R5_UNORM.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB:
+        return False
+    if format.block_width != 1 or format.block_height != 1:
+        return False
+    if format.block_size() not in (16, 32):
+        return False
+    for channel in format.le_channels:
+        if channel.type == VOID:
+            continue
+        if channel.type != UNSIGNED or not channel.norm or channel.size > 8:
+            return False
+    return True
+
+
+def is_float_array(format):
+    '''1, 2 or 4 channel arrays of half or single floats, such as
+    R16G16B16A16_FLOAT or R32_FLOAT.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB:
+        return False
+    if format.block_width != 1 or format.block_height != 1:
+        return False
+    if format.nr_channels() not in (1, 2, 4):
+        return False
+    size = format.le_channels[0].size
+    if size not in (16, 32):
+        return False
+    for channel in format.le_channels[:format.nr_channels()]:
+        if channel.type != FLOAT or channel.size != size:
+            return False
+    return True
+
+
+def is_identity(swizzles):
+    return list(swizzles) == [SWIZZLE_X, SWIZZLE_Y, SWIZZLE_Z, SWIZZLE_W]
+
+
+def inv_swizzles(swizzles):
+    '''Same as u_format_pack.inv_swizzles.'''
+    inv_swizzle = [None]*4
+    for i in range(4):
+        swizzle = swizzles[i]
+        if swizzle < 4 and inv_swizzle[swizzle] == None:
+            inv_swizzle[swizzle] = i
+    return inv_swizzle
+
+
+def epi32_constant(value):
+    value &= 0xffffffff
+    if value >= 0x80000000:
+        return '_mm_set1_epi32((int)0x%x)' % value
+    return '_mm_set1_epi32(0x%x)' % value
+
+
+def division_magic(size):
+    '''Find M and k such that x * 0xff / max == ((x * M) >> 16) >> k for all
+    the 16 bit values x * 0xff can take, so that the division can be done
+    with _mm_mulhi_epu16.'''
+
+    max = (1 << size) - 1
+    for k in range(16):
+        m = ((1 << (16 + k)) + max - 1) // max
+        if m > 0xffff:
+            break
+        for x in range(0, 0xff * max + 1, 0xff):
+            if x // max != ((x * m) >> 16) >> k:
+                break
+        else:
+            return m, k
+    assert False
+
+
+def unorm_to_unorm8_expr(size, value):
+    '''Rescale a size-bit unorm held in 32 bit lanes to 8 bits, like the
+    scalar (uint8_t)(value * 0xff / max) does.'''
+
+    if size == 8:
+        return value
+    value = '_mm_mullo_epi16(%s, _mm_set1_epi32(0xff))' % value
+    if size == 1:
+        return value
+    m, k = division_magic(size)
+    value = '_mm_mulhi_epu16(%s, _mm_set1_epi32(0x%x))' % (value, m)
+    if k:
+        value = '_mm_srli_epi32(%s, %u)' % (value, k)
+    return value
+
+
+def shift_expr(value, shift):
+    if shift > 0:
+        return '_mm_slli_epi32(%s, %u)' % (value, shift)
+    if shift < 0:
+        return '_mm_srli_epi32(%s, %u)' % (value, -shift)
+    return value
+
+
+def print_or(name, terms):
+    '''Print the declaration of an __m128i which is the OR of all terms.'''
+    assert terms
+    print '      __m128i %s = %s;' % (name, terms[0])
+    for term in terms[1:]:
+        print '      %s = _mm_or_si128(%s, %s);' % (name, name, term)
+
+
+def print_store_rgba_float(components):
+    '''Transpose four SoA vectors and store them as four RGBA pixels.'''
+    for i in range(4):
+        print '      __m128 %s = %s;' % ('rgba'[i], components[i])
+    print '      _MM_TRANSPOSE4_PS(r, g, b, a);'
+    for i in range(4):
+        print '      _mm_storeu_ps(dst + %u, %s);' % (4*i, 'rgba'[i])
+
+
+def print_store_rgba_8unorm(components):
+    '''Store four SoA vectors of 32 bit lanes with values in [0, 255] as
+    four RGBA8 pixels.'''
+    terms = []
+    for i in range(4):
+        if components[i] == ONE_8UNORM:
+            terms.append(epi32_constant(0xff << 8*i))
+        elif components[i] is not None:
+            terms.append(shift_expr(components[i], 8*i))
+    print_or('rgba', terms)
+    print '      _mm_storeu_si128((__m128i *)dst, rgba);'
+
+
+def print_load_rgba_float():
+    '''Load four RGBA pixels and transpose them into SoA vectors r, g, b, a.'''
+    for i in range(4):
+        print '      __m128 %s = _mm_loadu_ps(src + %u);' % ('rgba'[i], 4*i)
+    print '      _MM_TRANSPOSE4_PS(r, g, b, a);'
+
+
+def print_load_rgba_8unorm_float(used):
+    '''Load four RGBA8 pixels as SoA float vectors r, g, b, a, converting
+    the used ones like ubyte_to_float does.'''
+    print '      __m128i rgba = _mm_loadu_si128((const __m128i *)src);'
+    for i in used:
+        value = shift_expr('rgba', -8*i)
+        if i < 3:
+            value = '_mm_and_si128(%s, _mm_set1_epi32(0xff))' % value
+        print '      __m128 %s = _mm_mul_ps(_mm_cvtepi32_ps(%s), _mm_set1_ps(1.0f/0xff));' % ('rgba'[i], value)
+
+
+def unpack_bitmask(format, dst_suffix):
+    channels = format.le_channels
+    swizzles = format.le_swizzles
+    depth = format.block_size()
+
+    if depth == 32:
+        print '      __m128i value = _mm_loadu_si128((const __m128i *)src);'
+    else:
+        print '      __m128i value = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)src), _mm_setzero_si128());'
+
+    if dst_suffix == 'rgba_8unorm' and depth == 32 and is_identity(swizzles) and \
+       [channel.size for channel in channels] == [8, 8, 8, 8]:
+        print '      _mm_storeu_si128((__m128i *)dst, value);'
+        return
+
+    for i in range(4):
+        channel = channels[i]
+        if channel.type == VOID or i not in swizzles:
+            continue
+        value = shift_expr('value', -channel.shift)
+        if channel.shift + channel.size < depth:
+            value = '_mm_and_si128(%s, _mm_set1_epi32(0x%x))' % (value, (1 << channel.size) - 1)
+        print '      __m128i c%u = %s;' % (i, value)
+
+    components = []
+    for i in range(4):
+        swizzle = swizzles[i]
+        if swizzle < 4:
+            size = channels[swizzle].size
+            value = 'c%u' % swizzle
+            if dst_suffix == 'rgba_float':
+                value = '_mm_mul_ps(_mm_cvtepi32_ps(%s), _mm_set1_ps(1.0f/0x%x))' % (value, (1 << size) - 1)
+            else:
+                value = unorm_to_unorm8_expr(size, value)
+        elif swizzle == SWIZZLE_1:
+            if dst_suffix == 'rgba_float':
+                value = '_mm_set1_ps(1.0f)'
+            else:
+                value = ONE_8UNORM
+        else:
+            if dst_suffix == 'rgba_float':
+                value = '_mm_setzero_ps()'
+            else:
+                value = None
+        components.append(value)
+
+    if dst_suffix == 'rgba_float':
+        print_store_rgba_float(components)
+    else:
+        print_store_rgba_8unorm(components)
+
+
+def pack_bitmask(format, src_suffix):
+    channels = format.le_channels
+    swizzles = format.le_swizzles
+    depth = format.block_size()
+    inv_swizzle = inv_swizzles(swizzles)
+
+    if src_suffix == 'rgba_float':
+        print_load_rgba_float()
+    else:
+        print '      __m128i rgba = _mm_loadu_si128((const __m128i *)src);'
+
+    terms = []
+    for i in range(4):
+        channel = channels[i]
+        if channel.type == VOID or inv_swizzle[i] is None:
+            continue
+        j = inv_swizzle[i]
+        if src_suffix == 'rgba_float':
+            value = 'mm_float_to_ubyte(%s)' % 'rgba'[j]
+            terms.append(shift_expr(value, channel.shift))
+        else:
+            # Keep the top channel.size bits of the source byte
+            lsb = 8*j + 8 - channel.size
+            mask = ((1 << channel.size) - 1) << lsb
+            value = 'rgba'
+            if channel.shift or mask != 0xffffffff << lsb & 0xffffffff:
+                value = '_mm_and_si128(%s, %s)' % (value, epi32_constant(mask))
+            terms.append(shift_expr(value, channel.shift - lsb))
+
+    print_or('value', terms)
+    if depth == 32:
+        print '      _mm_storeu_si128((__m128i *)dst, value);'
+    else:
+        print '      _mm_storel_epi64((__m128i *)dst, mm_packlo_epi32(value, value));'
+
+
+def print_load_float_array(format):
+    '''Load four pixels of a float array format into SoA float vectors
+    c0..cN.'''
+    nr_channels = format.nr_channels()
+    size = format.le_channels[0].size
+
+    if size == 32:
+        if nr_channels == 4:
+            for i in range(4):
+                print '      __m128 c%u = _mm_loadu_ps((const float *)src + %u);' % (i, 4*i)
+            print '      _MM_TRANSPOSE4_PS(c0, c1, c2, c3);'
+        elif nr_channels == 2:
+            print '      __m128 lo = _mm_loadu_ps((const float *)src);'
+            print '      __m128 hi = _mm_loadu_ps((const float *)src + 4);'
+            print '      __m128 c0 = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));'
+            print '      __m128 c1 = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));'
+        else:
+            print '      __m128 c0 = _mm_loadu_ps((const float *)src);'
+    else:
+        if nr_channels == 4:
+            print '      __m128i lo = _mm_loadu_si128((const __m128i *)src);'
+            print '      __m128i hi = _mm_loadu_si128((const __m128i *)src + 1);'
+            print '      __m128 c0 = mm_half_to_float(_mm_unpacklo_epi16(lo, _mm_setzero_si128()));'
+            print '      __m128 c1 = mm_half_to_float(_mm_unpackhi_epi16(lo, _mm_setzero_si128()));'
+            print '      __m128 c2 = mm_half_to_float(_mm_unpacklo_epi16(hi, _mm_setzero_si128()));'
+            print '      __m128 c3 = mm_half_to_float(_mm_unpackhi_epi16(hi, _mm_setzero_si128()));'
+            print '      _MM_TRANSPOSE4_PS(c0, c1, c2, c3);'
+        elif nr_channels == 2:
+            print '      __m128i value = _mm_loadu_si128((const __m128i *)src);'
+            print '      __m128 c0 = mm_half_to_float(value);'
+            print '      __m128 c1 = mm_half_to_float(_mm_srli_epi32(value, 16));'
+        else:
+            print '      __m128i value = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)src), _mm_setzero_si128());'
+            print '      __m128 c0 = mm_half_to_float(value);'
+
+
+def unpack_float_array(format, dst_suffix):
+    swizzles = format.le_swizzles
+    nr_channels = format.nr_channels()
+    size = format.le_channels[0].size
+
+    if dst_suffix == 'rgba_float' and size == 32 and nr_channels == 4 and is_identity(swizzles):
+        for i in range(4):
+            print '      _mm_storeu_ps(dst + %u, _mm_loadu_ps((const float *)src + %u));' % (4*i, 4*i)
+        return
+
+    if dst_suffix == 'rgba_float' and nr_channels == 4 and is_identity(swizzles):
+        # No need to go through SoA
+        print '      __m128i lo = _mm_loadu_si128((const __m128i *)src);'
+        print '      __m128i hi = _mm_loadu_si128((const __m128i *)src + 1);'
+        print '      _mm_storeu_ps(dst + 0, mm_half_to_float(_mm_unpacklo_epi16(lo, _mm_setzero_si128())));'
+        print '      _mm_storeu_ps(dst + 4, mm_half_to_float(_mm_unpackhi_epi16(lo, _mm_setzero_si128())));'
+        print '      _mm_storeu_ps(dst + 8, mm_half_to_float(_mm_unpacklo_epi16(hi, _mm_setzero_si128())));'
+        print '      _mm_storeu_ps(dst + 12, mm_half_to_float(_mm_unpackhi_epi16(hi, _mm_setzero_si128())));'
+        return
+
+    print_load_float_array(format)
+
+    components = []
+    for i in range(4):
+        swizzle = swizzles[i]
+        if swizzle < 4:
+            value = 'c%u' % swizzle
+            if dst_suffix == 'rgba_8unorm':
+                value = 'mm_float_to_ubyte(%s)' % value
+        elif swizzle == SWIZZLE_1:
+            if dst_suffix == 'rgba_float':
+                value = '_mm_set1_ps(1.0f)'
+            else:
+                value = ONE_8UNORM
+        else:
+            if dst_suffix == 'rgba_float':
+                value = '_mm_setzero_ps()'
+            else:
+                value = None
+        components.append(value)
+
+    if dst_suffix == 'rgba_float':
+        print_store_rgba_float(components)
+    else:
+        print_store_rgba_8unorm(components)
+
+
+def pack_float_array(format, src_suffix):
+    swizzles = format.le_swizzles
+    nr_channels = format.nr_channels()
+    size = format.le_channels[0].size
+    inv_swizzle = inv_swizzles(swizzles)
+
+    if src_suffix == 'rgba_float' and size == 32 and nr_channels == 4 and is_identity(swizzles):
+        for i in range(4):
+            print '      _mm_storeu_ps((float *)dst + %u, _mm_loadu_ps(src + %u));' % (4*i, 4*i)
+        return
+
+    if src_suffix == 'rgba_float' and nr_channels == 4 and is_identity(swizzles):
+        # No need to go through SoA
+        for i in range(4):
+            print '      __m128i h%u = mm_float_to_half(_mm_loadu_ps(src + %u));' % (i, 4*i)
+        print '      _mm_storeu_si128((__m128i *)dst, mm_packlo_epi32(h0, h1));'
+        print '      _mm_storeu_si128((__m128i *)dst + 1, mm_packlo_epi32(h2, h3));'
+        return
+
+    if src_suffix == 'rgba_float':
+        print_load_rgba_float()
+    else:
+        print_load_rgba_8unorm_float(sorted(set(inv_swizzle[:nr_channels])))
+
+    if size == 32:
+        if nr_channels == 4:
+            for i in range(4):
+                print '      __m128 c%u = %s;' % (i, 'rgba'[inv_swizzle[i]])
+            print '      _MM_TRANSPOSE4_PS(c0, c1, c2, c3);'
+            for i in range(4):
+                print '      _mm_storeu_ps((float *)dst + %u, c%u);' % (4*i, i)
+        elif nr_channels == 2:
+            c0 = 'rgba'[inv_swizzle[0]]
+            c1 = 'rgba'[inv_swizzle[1]]
+            print '      _mm_storeu_ps((float *)dst, _mm_unpacklo_ps(%s, %s));' % (c0, c1)
+            print '      _mm_storeu_ps((float *)dst + 4, _mm_unpackhi_ps(%s, %s));' % (c0, c1)
+        else:
+            print '      _mm_storeu_ps((float *)dst, %s);' % 'rgba'[inv_swizzle[0]]
+    else:
+        for i in range(nr_channels):
+            print '      __m128i h%u = mm_float_to_half(%s);' % (i, 'rgba'[inv_swizzle[i]])
+        if nr_channels == 4:
+            print '      __m128i lo = _mm_or_si128(h0, _mm_slli_epi32(h1, 16));'
+            print '      __m128i hi = _mm_or_si128(h2, _mm_slli_epi32(h3, 16));'
+            print '      _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi32(lo, hi));'
+            print '      _mm_storeu_si128((__m128i *)dst + 1, _mm_unpackhi_epi32(lo, hi));'
+        elif nr_channels == 2:
+            print '      _mm_storeu_si128((__m128i *)dst, _mm_or_si128(h0, _mm_slli_epi32(h1, 16)));'
+        else:
+            print '      _mm_storel_epi64((__m128i *)dst, mm_packlo_epi32(h0, h0));'
+
+
+def simd_function_name(format, op, suffix):
+    return 'util_format_%s_%s_%s_sse2' % (format.short_name(), op, suffix)
+
+
+def generate_format_unpack_simd(format, dst_native_type, dst_suffix):
+    '''Generate the SSE2 row helper to unpack pixels from a particular format.
+    Returns the name of the helper, or None if the format is not handled.'''
+
+    if dst_suffix not in ('rgba_float', 'rgba_8unorm'):
+        return None
+
+    if is_unorm8_bitmask(format):
+        kernel = unpack_bitmask
+    elif is_float_array(format):
+        kernel = unpack_float_array
+    else:
+        return None
+
+    name = simd_function_name(format, 'unpack', dst_suffix)
+
+    print '#if defined(PIPE_ARCH_SSE)'
+    print 'static inline unsigned'
+    print '%s(%s *dst, const uint8_t *src, unsigned width)' % (name, dst_native_type)
+    print '{'
+    print '   unsigned x;'
+    print '   for(x = 0; x + 4 <= width; x += 4) {'
+    kernel(format, dst_suffix)
+    print '      src += %u;' % (4 * format.block_size() / 8,)
+    print '      dst += 16;'
+    print '   }'
+    print '   return x;'
+    print '}'
+    print '#endif'
+    print
+
+    return name
+
+
+def generate_format_pack_simd(format, src_native_type, src_suffix):
+    '''Generate the SSE2 row helper to pack pixels to a particular format.
+    Returns the name of the helper, or None if the format is not handled.'''
+
+    if src_suffix not in ('rgba_float', 'rgba_8unorm'):
+        return None
+
+    if is_unorm8_bitmask(format):
+        # Floats are rounded with util_iround() for channels narrower than
+        # 8 bits, whose rounding is not portable to SSE.
+        if src_suffix == 'rgba_float':
+            for channel in format.le_channels:
+                if channel.type != VOID and channel.size != 8:
+                    return None
+        kernel = pack_bitmask
+    elif is_float_array(format):
+        if None in inv_swizzles(format.le_swizzles)[:format.nr_channels()]:
+            return None
+        kernel = pack_float_array
+    else:
+        return None
+
+    name = simd_function_name(format, 'pack', src_suffix)
+
+    print '#if defined(PIPE_ARCH_SSE)'
+    print 'static inline unsigned'
+    print '%s(uint8_t *dst, const %s *src, unsigned width)' % (name, src_native_type)
+    print '{'
+    print '   unsigned x;'
+    print '   for(x = 0; x + 4 <= width; x += 4) {'
+    kernel(format, src_suffix)
+    print '      src += 16;'
+    print '      dst += %u;' % (4 * format.block_size() / 8,)
+    print '   }'
+    print '   return x;'
+    print '}'
+    print '#endif'
+    print
+
+    return name
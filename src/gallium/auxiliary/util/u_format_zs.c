@@ -29,6 +29,7 @@
 #include "u_debug.h"
 #include "u_math.h"
 #include "u_format_zs.h"
+#include "u_sse.h"
 
 
 /*
@@ -334,6 +335,95 @@ util_format_z32_float_pack_z_32unorm(uint8_t *dst_row, unsigned dst_stride,
    }
 }
 
+#if defined(PIPE_ARCH_SSE)
+
+/*
+ * SSE2 row helpers for Z24_UNORM_S8_UINT.  They convert four pixels at a
+ * time, giving the same results as the scalar code, and return the number
+ * of pixels converted.
+ */
+
+static inline unsigned
+z24_unorm_s8_uint_unpack_z_float_sse2(float *dst, const uint32_t *src,
+                                      unsigned width)
+{
+   const __m128i mask = _mm_set1_epi32(0xffffff);
+   const __m128d scale = _mm_set1_pd(1.0 / 0xffffff);
+   unsigned x;
+   for(x = 0; x + 4 <= width; x += 4) {
+      __m128i z = _mm_and_si128(_mm_loadu_si128((const __m128i *)src), mask);
+      __m128 lo = _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtepi32_pd(z), scale));
+      __m128 hi = _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(z, 8)), scale));
+      _mm_storeu_ps(dst, _mm_movelh_ps(lo, hi));
+      src += 4;
+      dst += 4;
+   }
+   return x;
+}
+
+static inline unsigned
+z24_unorm_s8_uint_pack_z_float_sse2(uint32_t *dst, const float *src,
+                                    unsigned width)
+{
+   const __m128i mask = _mm_set1_epi32(0xffffff);
+   const __m128d scale = _mm_set1_pd(0xffffff);
+   const __m128 limit = _mm_set1_ps(128.0f);
+   const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+   unsigned x;
+   for(x = 0; x + 4 <= width; x += 4) {
+      __m128 z = _mm_loadu_ps(src);
+      __m128i value, lo, hi;
+
+      /* Leave NaNs and values out of the 32 bit integer range to the
+       * scalar code. */
+      if (_mm_movemask_ps(_mm_cmplt_ps(_mm_and_ps(z, abs_mask), limit)) != 0xf)
+         break;
+
+      lo = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtps_pd(z), scale));
+      hi = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(z, z)), scale));
+      value = _mm_and_si128(_mm_unpacklo_epi64(lo, hi), mask);
+      value = _mm_or_si128(value, _mm_andnot_si128(mask, _mm_loadu_si128((const __m128i *)dst)));
+      _mm_storeu_si128((__m128i *)dst, value);
+      src += 4;
+      dst += 4;
+   }
+   return x;
+}
+
+static inline unsigned
+z24_unorm_s8_uint_unpack_z_32unorm_sse2(uint32_t *dst, const uint32_t *src,
+                                        unsigned width)
+{
+   const __m128i mask = _mm_set1_epi32(0xffffff);
+   unsigned x;
+   for(x = 0; x + 4 <= width; x += 4) {
+      __m128i z = _mm_and_si128(_mm_loadu_si128((const __m128i *)src), mask);
+      z = _mm_or_si128(_mm_slli_epi32(z, 8), _mm_srli_epi32(z, 16));
+      _mm_storeu_si128((__m128i *)dst, z);
+      src += 4;
+      dst += 4;
+   }
+   return x;
+}
+
+static inline unsigned
+z24_unorm_s8_uint_pack_z_32unorm_sse2(uint32_t *dst, const uint32_t *src,
+                                      unsigned width)
+{
+   const __m128i mask = _mm_set1_epi32(0xffffff);
+   unsigned x;
+   for(x = 0; x + 4 <= width; x += 4) {
+      __m128i z = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)src), 8);
+      z = _mm_or_si128(z, _mm_andnot_si128(mask, _mm_loadu_si128((const __m128i *)dst)));
+      _mm_storeu_si128((__m128i *)dst, z);
+      src += 4;
+      dst += 4;
+   }
+   return x;
+}
+
+#endif /* PIPE_ARCH_SSE */
+
 void
 util_format_z24_unorm_s8_uint_unpack_z_float(float *dst_row, unsigned dst_stride,
                                                 const uint8_t *src_row, unsigned src_stride,
@@ -343,7 +433,14 @@ util_format_z24_unorm_s8_uint_unpack_z_float(float *dst_row, unsigned dst_stride
    for(y = 0; y < height; ++y) {
       float *dst = dst_row;
       const uint32_t *src = (const uint32_t *)src_row;
-      for(x = 0; x < width; ++x) {
+#if defined(PIPE_ARCH_SSE)
+      x = z24_unorm_s8_uint_unpack_z_float_sse2(dst, src, width);
+      src += x;
+      dst += x;
+#else
+      x = 0;
+#endif
+      for(; x < width; ++x) {
          uint32_t value =  util_cpu_to_le32(*src++);
          *dst++ = z24_unorm_to_z32_float(value & 0xffffff);
       }
@@ -361,7 +458,14 @@ util_format_z24_unorm_s8_uint_pack_z_float(uint8_t *dst_row, unsigned dst_stride
    for(y = 0; y < height; ++y) {
       const float *src = src_row;
       uint32_t *dst = (uint32_t *)dst_row;
-      for(x = 0; x < width; ++x) {
+#if defined(PIPE_ARCH_SSE)
+      x = z24_unorm_s8_uint_pack_z_float_sse2(dst, src, width);
+      src += x;
+      dst += x;
+#else
+      x = 0;
+#endif
+      for(; x < width; ++x) {
          uint32_t value = util_le32_to_cpu(*dst);
          value &= 0xff000000;
          value |= z32_float_to_z24_unorm(*src++);
@@ -381,7 +485,14 @@ util_format_z24_unorm_s8_uint_unpack_z_32unorm(uint32_t *dst_row, unsigned dst_s
    for(y = 0; y < height; ++y) {
       uint32_t *dst = dst_row;
       const uint32_t *src = (const uint32_t *)src_row;
-      for(x = 0; x < width; ++x) {
+#if defined(PIPE_ARCH_SSE)
+      x = z24_unorm_s8_uint_unpack_z_32unorm_sse2(dst, src, width);
+      src += x;
+      dst += x;
+#else
+      x = 0;
+#endif
+      for(; x < width; ++x) {
          uint32_t value = util_cpu_to_le32(*src++);
          *dst++ = z24_unorm_to_z32_unorm(value & 0xffffff);
       }
@@ -399,7 +510,14 @@ util_format_z24_unorm_s8_uint_pack_z_32unorm(uint8_t *dst_row, unsigned dst_stri
    for(y = 0; y < height; ++y) {
       const uint32_t *src = src_row;
       uint32_t *dst = (uint32_t *)dst_row;
-      for(x = 0; x < width; ++x) {
+#if defined(PIPE_ARCH_SSE)
+      x = z24_unorm_s8_uint_pack_z_32unorm_sse2(dst, src, width);
+      src += x;
+      dst += x;
+#else
+      x = 0;
+#endif
+      for(; x < width; ++x) {
          uint32_t value = util_le32_to_cpu(*dst);
          value &= 0xff000000;
          value |= z32_unorm_to_z24_unorm(*src++);
@@ -777,7 +895,9 @@ util_format_z32_float_s8x24_uint_pack_z_32unorm(uint8_t *dst_row, unsigned dst_s
       const uint32_t *src = src_row;
       float *dst = (float *)dst_row;
       for(x = 0; x < width; ++x) {
-         *dst++ = z32_unorm_to_z32_float(*src++);
+         *dst = z32_unorm_to_z32_float(*src);
+         src += 1;
+         dst += 2;
       }
       dst_row += dst_stride/sizeof(*dst_row);
       src_row += src_stride/sizeof(*src_row);
@@ -228,6 +228,109 @@ transpose4_epi32(const __m128i * restrict a,
 #define SCALAR_EPI32(m, i) _mm_shuffle_epi32((m), _MM_SHUFFLE(i,i,i,i))
 
 
+/**
+ * Pack the low 16 bits of each 32-bit lane of a and b into a single vector,
+ * a in the low half.  SSE2 only has a signed saturating pack, so sign-extend
+ * the low halves first.
+ */
+static inline __m128i
+mm_packlo_epi32(__m128i a, __m128i b)
+{
+   a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+   b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+   return _mm_packs_epi32(a, b);
+}
+
+
+/**
+ * Vector version of util_half_to_float(), for half floats in the low 16 bits
+ * of each 32-bit lane.  Gives bit identical results.
+ */
+static inline __m128
+mm_half_to_float(__m128i h)
+{
+   const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(0xef << 23));
+   const __m128 infnan = _mm_set1_ps(65536.0f);
+   __m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+   __m128 f;
+
+   /* Exponent / Mantissa */
+   f = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13));
+
+   /* Adjust */
+   f = _mm_mul_ps(f, magic);
+
+   /* Inf / NaN */
+   f = _mm_or_ps(f, _mm_and_ps(_mm_cmpge_ps(f, infnan),
+                               _mm_castsi128_ps(_mm_set1_epi32(0xff << 23))));
+
+   /* Sign */
+   return _mm_or_ps(f, _mm_castsi128_ps(sign));
+}
+
+
+/**
+ * Vector version of util_float_to_half(), returning the half floats in the
+ * low 16 bits of each 32-bit lane.  Gives bit identical results.
+ */
+static inline __m128i
+mm_float_to_half(__m128 f)
+{
+   const __m128i f32inf = _mm_set1_epi32(0xff << 23);
+   const __m128i f16inf = _mm_set1_epi32(0x1f << 23);
+   const __m128i round_mask = _mm_set1_epi32(~0xfff);
+   const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(0xf << 23));
+   __m128i f32 = _mm_castps_si128(f);
+   __m128i sign = _mm_and_si128(f32, _mm_set1_epi32(0x80000000));
+   __m128i is_inf, is_nan, num, f16;
+
+   f32 = _mm_xor_si128(f32, sign);
+   is_inf = _mm_cmpeq_epi32(f32, f32inf);
+   is_nan = _mm_cmpgt_epi32(f32, f32inf);
+
+   /* Number */
+   num = _mm_and_si128(f32, round_mask);
+   num = _mm_castps_si128(_mm_mul_ps(_mm_castsi128_ps(num), magic));
+   num = _mm_sub_epi32(num, round_mask);
+
+   /* Clamp to max finite value if overflowed. */
+   num = _mm_or_si128(_mm_andnot_si128(_mm_cmpgt_epi32(num, f16inf), num),
+                      _mm_and_si128(_mm_cmpgt_epi32(num, f16inf),
+                                    _mm_sub_epi32(f16inf, _mm_set1_epi32(1))));
+   f16 = _mm_srli_epi32(num, 13);
+
+   f16 = _mm_or_si128(_mm_andnot_si128(is_inf, f16),
+                      _mm_and_si128(is_inf, _mm_set1_epi32(0x7c00)));
+   f16 = _mm_or_si128(_mm_andnot_si128(is_nan, f16),
+                      _mm_and_si128(is_nan, _mm_set1_epi32(0x7e00)));
+
+   /* Sign */
+   return _mm_or_si128(f16, _mm_srli_epi32(sign, 16));
+}
+
+
+/**
+ * Vector version of float_to_ubyte(), returning values in 32-bit lanes.
+ * Gives bit identical results.
+ */
+static inline __m128i
+mm_float_to_ubyte(__m128 f)
+{
+   __m128i i = _mm_castps_si128(f);
+   __m128i is_neg = _mm_cmplt_epi32(i, _mm_setzero_si128());
+   __m128i is_one = _mm_cmpgt_epi32(i, _mm_set1_epi32(0x3f7fffff));
+   __m128i ub;
+
+   f = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.0f/256.0f)),
+                  _mm_set1_ps(32768.0f));
+   ub = _mm_and_si128(_mm_castps_si128(f), _mm_set1_epi32(0xff));
+
+   ub = _mm_andnot_si128(is_neg, ub);
+   return _mm_or_si128(_mm_andnot_si128(is_one, ub),
+                       _mm_and_si128(is_one, _mm_set1_epi32(0xff)));
+}
+
+
 #endif /* PIPE_ARCH_SSE */
 
 #endif /* U_SSE_H_ */
@@ -34,6 +34,8 @@
 #include "pipe/p_context.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
+#include "util/u_debug.h"
+#include <inttypes.h>
 
 #include "u_upload_mgr.h"
 
@@ -52,9 +54,21 @@ struct u_upload_mgr {
    uint8_t *map;    /* Pointer to the mapped upload buffer. */
    unsigned offset; /* Aligned offset to the upload buffer, pointing
                      * at the first unused byte. */
+
+   /* Ring mode: buffers which filled up, oldest first.  They are handed
+    * out again once nobody else references them and the GPU is done
+    * with them, instead of allocating a new buffer every time. */
+   struct pipe_resource *ring[U_UPLOAD_MAX_RING_BUFFERS];
+   unsigned num_ring;  /* Number of retired buffers in the ring. */
+   unsigned max_ring;  /* Ring size, 0 if ring mode is disabled. */
+
+   struct u_upload_stats stats;
 };
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(upload_stats, "GALLIUM_UPLOAD_STATS", FALSE)
+
+
 struct u_upload_mgr *u_upload_create( struct pipe_context *pipe,
                                       unsigned default_size,
                                       unsigned alignment,
@@ -124,11 +138,119 @@ static void u_upload_release_buffer(struct u_upload_mgr *upload)
 
 void u_upload_destroy( struct u_upload_mgr *upload )
 {
+   unsigned i;
+
+   if (debug_get_option_upload_stats()) {
+      debug_printf("u_upload_mgr %p: %"PRIu64" bytes uploaded, "
+                   "%u buffers allocated, %u buffers reused\n",
+                   (void *) upload, upload->stats.bytes_uploaded,
+                   upload->stats.buffers_allocated,
+                   upload->stats.buffers_reused);
+   }
+
    u_upload_release_buffer( upload );
+   for (i = 0; i < upload->num_ring; i++)
+      pipe_resource_reference(&upload->ring[i], NULL);
    FREE( upload );
 }
 
 
+boolean
+u_upload_enable_ring(struct u_upload_mgr *upload, unsigned num_buffers)
+{
+   /* Reused buffers are mapped once and written while the GPU may still
+    * be reading other parts of them, which needs persistent mappings. */
+   if (!upload->map_persistent)
+      return FALSE;
+
+   upload->max_ring = MIN2(num_buffers, U_UPLOAD_MAX_RING_BUFFERS);
+   return TRUE;
+}
+
+
+void
+u_upload_get_stats(const struct u_upload_mgr *upload,
+                   struct u_upload_stats *stats)
+{
+   *stats = upload->stats;
+}
+
+
+/**
+ * Put the current upload buffer at the back of the ring, dropping the
+ * oldest buffer if the ring is full.
+ */
+static void
+u_upload_retire_buffer(struct u_upload_mgr *upload)
+{
+   upload_unmap_internal(upload, TRUE);
+
+   if (!upload->buffer)
+      return;
+
+   if (upload->num_ring == upload->max_ring) {
+      pipe_resource_reference(&upload->ring[0], NULL);
+      memmove(&upload->ring[0], &upload->ring[1],
+              (upload->num_ring - 1) * sizeof(upload->ring[0]));
+      upload->num_ring--;
+   }
+
+   /* Transfer our reference to the ring. */
+   upload->ring[upload->num_ring++] = upload->buffer;
+   upload->buffer = NULL;
+}
+
+
+/**
+ * Try to make the oldest buffer in the ring the current upload buffer.
+ *
+ * A buffer can only be reused when the ring holds the last reference to
+ * it -- otherwise it may still be bound and read by future draws -- and
+ * the GPU is done with it, which the driver tells us by failing a
+ * non-blocking map.
+ */
+static boolean
+u_upload_reuse_buffer(struct u_upload_mgr *upload, unsigned min_size)
+{
+   struct pipe_resource *buf;
+   struct pipe_transfer *transfer;
+   uint8_t *map;
+
+   if (!upload->num_ring)
+      return FALSE;
+
+   buf = upload->ring[0];
+   if (buf->width0 < min_size) {
+      /* Too small to ever be useful again. */
+      pipe_resource_reference(&upload->ring[0], NULL);
+      memmove(&upload->ring[0], &upload->ring[1],
+              (upload->num_ring - 1) * sizeof(upload->ring[0]));
+      upload->num_ring--;
+      return FALSE;
+   }
+
+   if (p_atomic_read(&buf->reference.count) != 1)
+      return FALSE;
+
+   map = pipe_buffer_map_range(upload->pipe, buf, 0, buf->width0,
+                               upload->map_flags | PIPE_TRANSFER_DONTBLOCK,
+                               &transfer);
+   if (!map)
+      return FALSE;
+
+   memmove(&upload->ring[0], &upload->ring[1],
+           (upload->num_ring - 1) * sizeof(upload->ring[0]));
+   upload->num_ring--;
+
+   upload->buffer = buf;
+   upload->transfer = transfer;
+   upload->map = map;
+   upload->offset = 0;
+   upload->stats.buffers_reused++;
+   return TRUE;
+}
+
+
 static void
 u_upload_alloc_buffer(struct u_upload_mgr *upload,
                       unsigned min_size)
@@ -137,9 +259,16 @@ u_upload_alloc_buffer(struct u_upload_mgr *upload,
    struct pipe_resource buffer;
    unsigned size;
 
-   /* Release the old buffer, if present:
+   /* Release the old buffer, if present, or recycle one from the ring:
     */
-   u_upload_release_buffer( upload );
+   if (upload->max_ring) {
+      u_upload_retire_buffer(upload);
+      if (u_upload_reuse_buffer(upload, min_size))
+         return;
+   }
+   else {
+      u_upload_release_buffer( upload );
+   }
 
    /* Allocate a new one: 
     */
@@ -164,6 +293,8 @@ u_upload_alloc_buffer(struct u_upload_mgr *upload,
    if (upload->buffer == NULL)
       return;
 
+   upload->stats.buffers_allocated++;
+
    /* Map the new buffer. */
    upload->map = pipe_buffer_map_range(upload->pipe, upload->buffer,
                                        0, size, upload->map_flags,
@@ -234,6 +365,7 @@ u_upload_alloc(struct u_upload_mgr *upload,
    *out_offset = offset;
 
    upload->offset = offset + alloc_size;
+   upload->stats.bytes_uploaded += size;
 }
 
 void u_upload_data(struct u_upload_mgr *upload,
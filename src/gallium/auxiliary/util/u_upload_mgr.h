@@ -38,6 +38,16 @@ struct pipe_context;
 struct pipe_resource;
 
 
+/** Maximum number of retired buffers kept by u_upload_enable_ring(). */
+#define U_UPLOAD_MAX_RING_BUFFERS 8
+
+struct u_upload_stats {
+   uint64_t bytes_uploaded;     /**< Sum of all allocation sizes */
+   unsigned buffers_allocated;  /**< Upload buffers created */
+   unsigned buffers_reused;     /**< Upload buffers recycled from the ring */
+};
+
+
 /**
  * Create the upload manager.
  *
@@ -56,6 +66,24 @@ struct u_upload_mgr *u_upload_create( struct pipe_context *pipe,
  */
 void u_upload_destroy( struct u_upload_mgr *upload );
 
+/**
+ * Keep up to \p num_buffers full upload buffers around and recycle them,
+ * oldest first, once they are idle, rather than allocating a new buffer
+ * each time the current one fills up.
+ *
+ * Requires PIPE_CAP_BUFFER_MAP_PERSISTENT_COHERENT.  Returns FALSE, and
+ * leaves the upload manager unchanged, if that's not supported.
+ */
+boolean u_upload_enable_ring( struct u_upload_mgr *upload,
+                              unsigned num_buffers );
+
+/**
+ * Return upload statistics.  Setting GALLIUM_UPLOAD_STATS also prints
+ * them when the upload manager is destroyed.
+ */
+void u_upload_get_stats( const struct u_upload_mgr *upload,
+                         struct u_upload_stats *stats );
+
 /**
  * Unmap upload buffer
  *
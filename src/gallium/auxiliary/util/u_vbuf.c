@@ -91,6 +91,7 @@
 #include "util/u_format.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
+#include "util/u_sse.h"
 #include "util/u_upload_mgr.h"
 #include "translate/translate.h"
 #include "translate/translate_cache.h"
@@ -316,6 +317,7 @@ u_vbuf_create(struct pipe_context *pipe,
 
    mgr->uploader = u_upload_create(pipe, 1024 * 1024, 4,
                                    PIPE_BIND_VERTEX_BUFFER);
+   u_upload_enable_ring(mgr->uploader, 4);
 
    return mgr;
 }
@@ -1021,6 +1023,140 @@ static boolean u_vbuf_mapping_vertex_buffer_blocks(struct u_vbuf *mgr)
             mgr->nonzero_stride_vb_mask)) != 0;
 }
 
+#if defined(PIPE_ARCH_SSE)
+
+/*
+ * SSE2 min/max index scans.  Each returns the number of indices consumed
+ * and merges its result into *min and *max; the caller finishes the tail.
+ *
+ * SSE2 only has unsigned byte and signed word min/max, so wider indices
+ * are biased into the signed range, and 32-bit min/max is done with
+ * compares.  With primitive restart, restart indices are replaced by all
+ * ones for the min and zero for the max so that they never win; a lane
+ * which saw only restart indices ends up with min > max and is skipped.
+ */
+
+static inline __m128i
+u_vbuf_select(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static unsigned
+u_vbuf_minmax_ubyte_sse2(const uint8_t *indices, unsigned count,
+                         boolean primitive_restart, unsigned restart_index,
+                         unsigned *min, unsigned *max)
+{
+   const __m128i restart = _mm_set1_epi8((char)restart_index);
+   __m128i vmin = _mm_set1_epi8(-1), vmax = _mm_setzero_si128();
+   uint8_t min_arr[16], max_arr[16];
+   unsigned i, n = count & ~15;
+
+   if (n == 0)
+      return 0;
+
+   for (i = 0; i < n; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)&indices[i]);
+      __m128i v_min = v, v_max = v;
+      if (primitive_restart) {
+         __m128i is_restart = _mm_cmpeq_epi8(v, restart);
+         v_min = _mm_or_si128(v, is_restart);
+         v_max = _mm_andnot_si128(is_restart, v);
+      }
+      vmin = _mm_min_epu8(vmin, v_min);
+      vmax = _mm_max_epu8(vmax, v_max);
+   }
+
+   _mm_storeu_si128((__m128i *)min_arr, vmin);
+   _mm_storeu_si128((__m128i *)max_arr, vmax);
+   for (i = 0; i < 16; i++) {
+      if (min_arr[i] > max_arr[i])
+         continue; /* nothing but restart indices in this lane */
+      if (min_arr[i] < *min) *min = min_arr[i];
+      if (max_arr[i] > *max) *max = max_arr[i];
+   }
+   return n;
+}
+
+static unsigned
+u_vbuf_minmax_ushort_sse2(const uint16_t *indices, unsigned count,
+                          boolean primitive_restart, unsigned restart_index,
+                          unsigned *min, unsigned *max)
+{
+   const __m128i bias = _mm_set1_epi16((short)0x8000);
+   const __m128i restart = _mm_set1_epi16((short)restart_index);
+   __m128i vmin = _mm_set1_epi16(0x7fff), vmax = _mm_set1_epi16(-0x8000);
+   uint16_t min_arr[8], max_arr[8];
+   unsigned i, n = count & ~7;
+
+   if (n == 0)
+      return 0;
+
+   for (i = 0; i < n; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *)&indices[i]);
+      __m128i v_min = v, v_max = v;
+      if (primitive_restart) {
+         __m128i is_restart = _mm_cmpeq_epi16(v, restart);
+         v_min = _mm_or_si128(v, is_restart);
+         v_max = _mm_andnot_si128(is_restart, v);
+      }
+      vmin = _mm_min_epi16(vmin, _mm_xor_si128(v_min, bias));
+      vmax = _mm_max_epi16(vmax, _mm_xor_si128(v_max, bias));
+   }
+
+   _mm_storeu_si128((__m128i *)min_arr, _mm_xor_si128(vmin, bias));
+   _mm_storeu_si128((__m128i *)max_arr, _mm_xor_si128(vmax, bias));
+   for (i = 0; i < 8; i++) {
+      if (min_arr[i] > max_arr[i])
+         continue; /* nothing but restart indices in this lane */
+      if (min_arr[i] < *min) *min = min_arr[i];
+      if (max_arr[i] > *max) *max = max_arr[i];
+   }
+   return n;
+}
+
+static unsigned
+u_vbuf_minmax_uint_sse2(const uint32_t *indices, unsigned count,
+                        boolean primitive_restart, unsigned restart_index,
+                        unsigned *min, unsigned *max)
+{
+   const __m128i bias = _mm_set1_epi32(0x80000000);
+   const __m128i restart = _mm_set1_epi32(restart_index);
+   __m128i vmin = _mm_set1_epi32(0x7fffffff);
+   __m128i vmax = _mm_set1_epi32(0x80000000);
+   uint32_t min_arr[4], max_arr[4];
+   unsigned i, n = count & ~3;
+
+   if (n == 0)
+      return 0;
+
+   for (i = 0; i < n; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)&indices[i]);
+      __m128i v_min = v, v_max = v;
+      if (primitive_restart) {
+         __m128i is_restart = _mm_cmpeq_epi32(v, restart);
+         v_min = _mm_or_si128(v, is_restart);
+         v_max = _mm_andnot_si128(is_restart, v);
+      }
+      v_min = _mm_xor_si128(v_min, bias);
+      v_max = _mm_xor_si128(v_max, bias);
+      vmin = u_vbuf_select(_mm_cmplt_epi32(v_min, vmin), v_min, vmin);
+      vmax = u_vbuf_select(_mm_cmpgt_epi32(v_max, vmax), v_max, vmax);
+   }
+
+   _mm_storeu_si128((__m128i *)min_arr, _mm_xor_si128(vmin, bias));
+   _mm_storeu_si128((__m128i *)max_arr, _mm_xor_si128(vmax, bias));
+   for (i = 0; i < 4; i++) {
+      if (min_arr[i] > max_arr[i])
+         continue; /* nothing but restart indices in this lane */
+      if (min_arr[i] < *min) *min = min_arr[i];
+      if (max_arr[i] > *max) *max = max_arr[i];
+   }
+   return n;
+}
+
+#endif /* PIPE_ARCH_SSE */
+
 static void u_vbuf_get_minmax_index(struct pipe_context *pipe,
                                     struct pipe_index_buffer *ib,
                                     boolean primitive_restart,
@@ -1048,8 +1184,13 @@ static void u_vbuf_get_minmax_index(struct pipe_context *pipe,
       const unsigned *ui_indices = (const unsigned*)indices;
       unsigned max_ui = 0;
       unsigned min_ui = ~0U;
+      i = 0;
+#if defined(PIPE_ARCH_SSE)
+      i = u_vbuf_minmax_uint_sse2(ui_indices, count, primitive_restart,
+                                  restart_index, &min_ui, &max_ui);
+#endif
       if (primitive_restart) {
-         for (i = 0; i < count; i++) {
+         for (; i < count; i++) {
             if (ui_indices[i] != restart_index) {
                if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
                if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
@@ -1057,7 +1198,7 @@ static void u_vbuf_get_minmax_index(struct pipe_context *pipe,
          }
       }
       else {
-         for (i = 0; i < count; i++) {
+         for (; i < count; i++) {
             if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
             if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
          }
@@ -1070,8 +1211,16 @@ static void u_vbuf_get_minmax_index(struct pipe_context *pipe,
       const unsigned short *us_indices = (const unsigned short*)indices;
       unsigned max_us = 0;
       unsigned min_us = ~0U;
+      i = 0;
+#if defined(PIPE_ARCH_SSE)
+      /* a restart index which doesn't fit never matches */
+      i = u_vbuf_minmax_ushort_sse2(us_indices, count,
+                                    primitive_restart &&
+                                    restart_index <= 0xffff,
+                                    restart_index, &min_us, &max_us);
+#endif
       if (primitive_restart) {
-         for (i = 0; i < count; i++) {
+         for (; i < count; i++) {
             if (us_indices[i] != restart_index) {
                if (us_indices[i] > max_us) max_us = us_indices[i];
                if (us_indices[i] < min_us) min_us = us_indices[i];
@@ -1079,7 +1228,7 @@ static void u_vbuf_get_minmax_index(struct pipe_context *pipe,
          }
       }
       else {
-         for (i = 0; i < count; i++) {
+         for (; i < count; i++) {
             if (us_indices[i] > max_us) max_us = us_indices[i];
             if (us_indices[i] < min_us) min_us = us_indices[i];
          }
@@ -1092,8 +1241,15 @@ static void u_vbuf_get_minmax_index(struct pipe_context *pipe,
       const unsigned char *ub_indices = (const unsigned char*)indices;
       unsigned max_ub = 0;
       unsigned min_ub = ~0U;
+      i = 0;
+#if defined(PIPE_ARCH_SSE)
+      i = u_vbuf_minmax_ubyte_sse2(ub_indices, count,
+                                   primitive_restart &&
+                                   restart_index <= 0xff,
+                                   restart_index, &min_ub, &max_ub);
+#endif
       if (primitive_restart) {
-         for (i = 0; i < count; i++) {
+         for (; i < count; i++) {
             if (ub_indices[i] != restart_index) {
                if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
                if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
@@ -1101,7 +1257,7 @@ static void u_vbuf_get_minmax_index(struct pipe_context *pipe,
          }
       }
       else {
-         for (i = 0; i < count; i++) {
+         for (; i < count; i++) {
             if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
             if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
          }
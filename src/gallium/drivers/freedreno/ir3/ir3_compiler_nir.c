@@ -198,6 +198,7 @@ static struct nir_shader *to_nir(struct ir3_compile *ctx,
 		progress |= ir3_nir_lower_if_else(s);
 		progress |= nir_opt_algebraic(s);
 		progress |= nir_opt_constant_folding(s);
+		progress |= nir_opt_loop_unroll(s);
 
 	} while (progress);
 
@@ -1367,6 +1367,7 @@ vc4_optimize_nir(struct nir_shader *s)
                 progress = nir_opt_algebraic(s) || progress;
                 progress = nir_opt_constant_folding(s) || progress;
                 progress = nir_opt_undef(s) || progress;
+                progress = nir_opt_loop_unroll(s) || progress;
         } while (progress);
 }
 
@@ -29,6 +29,7 @@
 #include "util/u_format.h"
 #include "util/u_half.h"
 #include "util/u_cpu_detect.h"
+#include "os/os_time.h"
 #include "rtasm/rtasm_cpu.h"
 
 /* don't use this for serious use */
@@ -46,6 +47,88 @@ static double rand_double()
    return v;
 }
 
+/**
+ * Measure the throughput of a typical vertex layout: float3 position,
+ * unorm8 color, snorm16 normal and half float texcoord, all converted to
+ * float outputs like draw and u_vbuf do.
+ */
+static int
+benchmark(struct translate *(*create_fn)(const struct translate_key *key),
+          const char *name)
+{
+   static const struct {
+      enum pipe_format input_format;
+      enum pipe_format output_format;
+   } layout[] = {
+      { PIPE_FORMAT_R32G32B32_FLOAT,  PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R8G8B8A8_UNORM,   PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R16G16B16_SNORM,  PIPE_FORMAT_R32G32B32_FLOAT },
+      { PIPE_FORMAT_R16G16_FLOAT,     PIPE_FORMAT_R32G32_FLOAT },
+   };
+   const unsigned num_verts = 64 * 1024;
+   const unsigned num_iters = 100;
+   struct translate_key key;
+   struct translate *translate;
+   unsigned input_stride = 0, output_stride = 0;
+   unsigned char *input, *output;
+   unsigned *elts;
+   int64_t start, end;
+   unsigned i;
+
+   memset(&key, 0, sizeof key);
+   for (i = 0; i < Elements(layout); ++i) {
+      key.element[i].type = TRANSLATE_ELEMENT_NORMAL;
+      key.element[i].input_format = layout[i].input_format;
+      key.element[i].output_format = layout[i].output_format;
+      key.element[i].input_buffer = 0;
+      key.element[i].input_offset = input_stride;
+      key.element[i].output_offset = output_stride;
+      input_stride += util_format_get_blocksize(layout[i].input_format);
+      output_stride += util_format_get_blocksize(layout[i].output_format);
+   }
+   key.nr_elements = Elements(layout);
+   key.output_stride = output_stride;
+
+   translate = create_fn(&key);
+   if (!translate) {
+      printf("translate_%s doesn't support the benchmark layout\n", name);
+      return 2;
+   }
+
+   input = align_malloc(num_verts * input_stride, 64);
+   output = align_malloc(num_verts * output_stride, 64);
+   elts = align_malloc(num_verts * sizeof *elts, 64);
+
+   for (i = 0; i < num_verts * input_stride; ++i)
+      input[i] = rand() & 0x7f;
+
+   /* scramble the indices a bit, like a real index buffer */
+   for (i = 0; i < num_verts; ++i)
+      elts[i] = (i * 7) % num_verts;
+
+   translate->set_buffer(translate, 0, input, input_stride, num_verts - 1);
+
+   start = os_time_get();
+   for (i = 0; i < num_iters; ++i)
+      translate->run(translate, 0, num_verts, 0, 0, output);
+   end = os_time_get();
+   printf("translate_%s run:      %.2f Mverts/s\n", name,
+          (double)num_verts * num_iters / (double)(end - start));
+
+   start = os_time_get();
+   for (i = 0; i < num_iters; ++i)
+      translate->run_elts(translate, elts, num_verts, 0, 0, output);
+   end = os_time_get();
+   printf("translate_%s run_elts: %.2f Mverts/s\n", name,
+          (double)num_verts * num_iters / (double)(end - start));
+
+   translate->release(translate);
+   align_free(elts);
+   align_free(output);
+   align_free(input);
+   return 0;
+}
+
 int main(int argc, char** argv)
 {
    struct translate *(*create_fn)(const struct translate_key *key) = 0;
@@ -76,6 +159,10 @@ int main(int argc, char** argv)
       create_fn = translate_generic_create;
    else if (!strcmp(argv[1], "x86"))
       create_fn = translate_sse2_create;
+#if HAVE_LLVM
+   else if (!strcmp(argv[1], "llvm"))
+      create_fn = translate_llvm_create;
+#endif
    else if (!strcmp(argv[1], "nosse"))
    {
       util_cpu_caps.has_sse = 0;
@@ -129,10 +216,13 @@ int main(int argc, char** argv)
 
    if (!create_fn)
    {
-      printf("Usage: ./translate_test [generic|x86|nosse|sse|sse2|sse3|sse4.1]\n");
+      printf("Usage: ./translate_test [generic|x86|llvm|nosse|sse|sse2|sse3|sse4.1] [bench]\n");
       return 2;
    }
 
+   if (argc > 2 && !strcmp(argv[2], "bench"))
+      return benchmark(create_fn, argv[1]);
+
    for (i = 1; i < Elements(buffer); ++i)
       buffer[i] = align_malloc(buffer_size, 4096);
 
@@ -28,8 +28,10 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <float.h>
 
+#include "os/os_time.h"
 #include "util/u_half.h"
 #include "util/u_format.h"
 #include "util/u_format_tests.h"
@@ -679,6 +681,103 @@ test_one_func(const struct util_format_description *format_desc,
 }
 
 
+/*
+ * Row tests.
+ *
+ * The pack/unpack functions of the most common formats convert several
+ * pixels at a time when converting whole rows, which the per-block tests
+ * above never exercise.  Check that converting a row in one go gives
+ * exactly the same bits as converting it pixel by pixel.
+ */
+
+#define ROW_WIDTH 37
+
+
+static void
+fill_random(void *ptr, unsigned size)
+{
+   uint8_t *bytes = ptr;
+   unsigned i;
+
+   for (i = 0; i < size; ++i)
+      bytes[i] = rand() & 0xff;
+}
+
+
+static void
+fill_random_float(float *values, unsigned count)
+{
+   unsigned i;
+
+   for (i = 0; i < count; ++i) {
+      /* Mostly values around [0, 1], with the odd inf/nan/denormal. */
+      if (rand() % 8 == 0)
+         fill_random(&values[i], sizeof values[i]);
+      else
+         values[i] = (float)rand() / RAND_MAX * 1.5f - 0.25f;
+   }
+}
+
+
+#define TEST_ROW(func, dst_type, dst_size, src_type, src_size) \
+   if (format_desc->func) { \
+      dst_type *dst = (dst_type *)row_dst; \
+      dst_type *ref = (dst_type *)row_ref; \
+      const src_type *src = (const src_type *)row_src; \
+      memcpy(row_dst, init, sizeof row_dst); \
+      memcpy(row_ref, init, sizeof row_ref); \
+      format_desc->func(dst, 0, src, 0, ROW_WIDTH, 1); \
+      for (x = 0; x < ROW_WIDTH; ++x) { \
+         format_desc->func((dst_type *)((uint8_t *)ref + x * (dst_size)), 0, \
+                           (const src_type *)((const uint8_t *)src + x * (src_size)), 0, \
+                           1, 1); \
+      } \
+      if (memcmp(row_dst, row_ref, ROW_WIDTH * (dst_size)) != 0) { \
+         printf("FAILED: row util_format_%s_%s mismatch\n", \
+                format_desc->short_name, #func); \
+         success = FALSE; \
+      } \
+   }
+
+
+static boolean
+test_format_rows(const struct util_format_description *format_desc)
+{
+   const unsigned bpp = format_desc->block.bits / 8;
+   uint8_t init[ROW_WIDTH * 16];
+   uint8_t row_src[ROW_WIDTH * 16];
+   uint8_t row_dst[ROW_WIDTH * 16];
+   uint8_t row_ref[ROW_WIDTH * 16];
+   boolean success = TRUE;
+   unsigned x;
+
+   if (format_desc->block.width != 1 || format_desc->block.height != 1 ||
+       format_desc->block.bits % 8 != 0 || bpp > 16) {
+      return TRUE;
+   }
+
+   fill_random(init, sizeof init);
+
+   fill_random(row_src, sizeof row_src);
+   TEST_ROW(unpack_rgba_float, float, 16, uint8_t, bpp);
+   TEST_ROW(unpack_rgba_8unorm, uint8_t, 4, uint8_t, bpp);
+   TEST_ROW(unpack_z_float, float, 4, uint8_t, bpp);
+   TEST_ROW(unpack_z_32unorm, uint32_t, 4, uint8_t, bpp);
+
+   fill_random_float((float *)row_src, sizeof row_src / sizeof(float));
+   TEST_ROW(pack_rgba_float, uint8_t, bpp, float, 16);
+   TEST_ROW(pack_z_float, uint8_t, bpp, float, 4);
+
+   fill_random(row_src, sizeof row_src);
+   TEST_ROW(pack_rgba_8unorm, uint8_t, bpp, uint8_t, 4);
+   TEST_ROW(pack_z_32unorm, uint8_t, bpp, uint32_t, 4);
+
+   return success;
+}
+
+#undef TEST_ROW
+
+
 static boolean
 test_all(void)
 {
@@ -719,18 +818,95 @@ test_all(void)
       TEST_ONE_FUNC(pack_s_8uint);
 
 #     undef TEST_ONE_FUNC
+
+      if (!test_format_rows(format_desc)) {
+         success = FALSE;
+      }
    }
 
    return success;
 }
 
 
+/*
+ * Benchmark.
+ *
+ * Prints the throughput of the row pack/unpack functions of every format,
+ * when invoked as "u_format_test bench".
+ */
+
+#define BENCH_WIDTH 1024
+#define BENCH_HEIGHT 64
+#define BENCH_ITERS 20
+
+
+#define BENCH_FUNC(func, dst_type, dst_size, src_type, src_size) \
+   if (format_desc->func) { \
+      int64_t t0, t1; \
+      unsigned iter; \
+      t0 = os_time_get(); \
+      for (iter = 0; iter < BENCH_ITERS; ++iter) { \
+         format_desc->func((dst_type *)dst, BENCH_WIDTH * (dst_size), \
+                           (const src_type *)src, BENCH_WIDTH * (src_size), \
+                           BENCH_WIDTH, BENCH_HEIGHT); \
+      } \
+      t1 = os_time_get(); \
+      printf("  %-32s %-20s %8.1f Mpixels/s\n", \
+             format_desc->short_name, #func, \
+             (double)BENCH_WIDTH * BENCH_HEIGHT * BENCH_ITERS / \
+             (double)MAX2(t1 - t0, 1)); \
+   }
+
+
+static void
+bench_all(void)
+{
+   const unsigned size = BENCH_WIDTH * BENCH_HEIGHT * 16;
+   enum pipe_format format;
+   float *src = malloc(size);
+   float *dst = malloc(size);
+
+   fill_random_float(src, size / sizeof(float));
+
+   for (format = 1; format < PIPE_FORMAT_COUNT; ++format) {
+      const struct util_format_description *format_desc;
+      unsigned bpp;
+
+      format_desc = util_format_description(format);
+      if (!format_desc ||
+          format_desc->block.width != 1 || format_desc->block.height != 1 ||
+          format_desc->block.bits % 8 != 0 || format_desc->block.bits > 128) {
+         continue;
+      }
+
+      bpp = format_desc->block.bits / 8;
+
+      BENCH_FUNC(unpack_rgba_float, float, 16, uint8_t, bpp);
+      BENCH_FUNC(pack_rgba_float, uint8_t, bpp, float, 16);
+      BENCH_FUNC(unpack_rgba_8unorm, uint8_t, 4, uint8_t, bpp);
+      BENCH_FUNC(pack_rgba_8unorm, uint8_t, bpp, uint8_t, 4);
+      BENCH_FUNC(unpack_z_float, float, 4, uint8_t, bpp);
+      BENCH_FUNC(pack_z_float, uint8_t, bpp, float, 4);
+   }
+
+   free(dst);
+   free(src);
+}
+
+#undef BENCH_FUNC
+
+
 int main(int argc, char **argv)
 {
    boolean success;
 
    util_format_s3tc_init();
 
+   if (argc > 1 && !strcmp(argv[1], "bench")) {
+      bench_all();
+      return 0;
+   }
+
    success = test_all();
 
    return success ? 0 : 1;
@@ -0,0 +1,267 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Index translation test and benchmark.
+ *
+ * Checks the translators returned by u_index_translator() against a
+ * straightforward reference for every primitive/index size combination
+ * that drivers without quad/strip support hit, then times them.  Run with
+ * GALLIUM_INDICES_SIMD=0 to get numbers for the scalar translators.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_defines.h"
+#include "util/u_memory.h"
+#include "os/os_time.h"
+#include "util/u_prim.h"
+#include "indices/u_indices.h"
+
+
+#define NUM_VERTS (64 * 1024 + 5)
+#define RESTART_INDEX 0xffff
+
+/* strips and fans produce three 4-byte indices per vertex */
+#define OUT_SIZE (NUM_VERTS * 4 * 3)
+
+
+static unsigned
+read_index(const void *in, unsigned index_size, unsigned i)
+{
+   switch (index_size) {
+   case 1: return ((const uint8_t *)in)[i];
+   case 2: return ((const uint16_t *)in)[i];
+   default: return ((const uint32_t *)in)[i];
+   }
+}
+
+static void
+write_index(void *out, unsigned index_size, unsigned i, unsigned value)
+{
+   if (index_size == 2)
+      ((uint16_t *)out)[i] = (uint16_t)value;
+   else
+      ((uint32_t *)out)[i] = value;
+}
+
+
+/**
+ * Reference translation, for matching provoking vertex conventions.
+ * Returns FALSE for the cases it doesn't know about.
+ */
+static boolean
+reference(unsigned prim, unsigned pv, boolean prim_restart, boolean is_memcpy,
+          const void *in, unsigned in_size, unsigned start, unsigned nr,
+          void *out, unsigned out_size, unsigned out_nr)
+{
+   unsigned i, j;
+
+   /* the memcpy translators write the output at offset zero */
+   if (is_memcpy) {
+      for (i = 0; i < out_nr; i++)
+         write_index(out, out_size, i, read_index(in, in_size, start + i));
+      return TRUE;
+   }
+
+   switch (prim) {
+   case PIPE_PRIM_POINTS:
+   case PIPE_PRIM_LINES:
+   case PIPE_PRIM_TRIANGLES:
+      for (i = start; i < start + out_nr; i++)
+         write_index(out, out_size, i, read_index(in, in_size, i));
+      return TRUE;
+
+   case PIPE_PRIM_TRIANGLE_STRIP:
+      for (i = start, j = 0; j < out_nr; j += 3, i++) {
+         unsigned v[3];
+         if (pv == PV_FIRST) {
+            v[0] = i;
+            v[1] = i + 1 + (i & 1);
+            v[2] = i + 2 - (i & 1);
+         }
+         else {
+            v[0] = i + (i & 1);
+            v[1] = i + 1 - (i & 1);
+            v[2] = i + 2;
+         }
+         write_index(out, out_size, j + 0, read_index(in, in_size, v[0]));
+         write_index(out, out_size, j + 1, read_index(in, in_size, v[1]));
+         write_index(out, out_size, j + 2, read_index(in, in_size, v[2]));
+      }
+      return TRUE;
+
+   case PIPE_PRIM_QUADS:
+      for (i = start, j = 0; j < out_nr; j += 6, i += 4) {
+         static const unsigned first[6] = { 0, 1, 2, 0, 2, 3 };
+         static const unsigned last[6] = { 0, 1, 3, 1, 2, 3 };
+         const unsigned *order = pv == PV_FIRST ? first : last;
+         unsigned k;
+
+         while (prim_restart) {
+            if (i + 4 > start + nr)
+               break;
+            for (k = 0; k < 4; k++) {
+               if (read_index(in, in_size, i + k) == RESTART_INDEX)
+                  break;
+            }
+            if (k == 4)
+               break;
+            i += k + 1;
+         }
+
+         if (prim_restart && i + 4 > start + nr) {
+            for (k = 0; k < 6; k++)
+               write_index(out, out_size, j + k, RESTART_INDEX);
+            continue;
+         }
+
+         for (k = 0; k < 6; k++)
+            write_index(out, out_size, j + k,
+                        read_index(in, in_size, i + order[k]));
+      }
+      return TRUE;
+
+   default:
+      return FALSE;
+   }
+}
+
+
+int main(int argc, char **argv)
+{
+   static const unsigned prims[] = {
+      PIPE_PRIM_POINTS,
+      PIPE_PRIM_LINES,
+      PIPE_PRIM_LINE_STRIP,
+      PIPE_PRIM_LINE_LOOP,
+      PIPE_PRIM_TRIANGLES,
+      PIPE_PRIM_TRIANGLE_STRIP,
+      PIPE_PRIM_TRIANGLE_FAN,
+      PIPE_PRIM_QUADS,
+      PIPE_PRIM_QUAD_STRIP,
+      PIPE_PRIM_POLYGON,
+   };
+   static const unsigned index_sizes[] = { 1, 2, 4 };
+   const unsigned hw_mask = (1 << PIPE_PRIM_POINTS) |
+                            (1 << PIPE_PRIM_LINES) |
+                            (1 << PIPE_PRIM_TRIANGLES);
+   const unsigned num_iters = 50;
+   boolean bench = argc > 1 && !strcmp(argv[1], "bench");
+   unsigned passed = 0, total = 0;
+   uint8_t *in, *out, *ref;
+   unsigned p, s, pv, pr, i;
+
+   /* quad strips with an odd vertex count read past the last vertex */
+   in = CALLOC(NUM_VERTS + 4, 4);
+   out = MALLOC(OUT_SIZE);
+   ref = MALLOC(OUT_SIZE);
+
+   srand(1234);
+
+   for (p = 0; p < Elements(prims); p++) {
+      for (s = 0; s < Elements(index_sizes); s++) {
+         unsigned in_size = index_sizes[s];
+
+         for (pv = 0; pv < PV_COUNT; pv++) {
+            for (pr = 0; pr < PR_COUNT; pr++) {
+               unsigned start = (pv + pr) & 1;
+               unsigned nr = NUM_VERTS - start;
+               unsigned out_prim, out_size, out_nr;
+               u_translate_func translate;
+               boolean pass = TRUE;
+               int ret;
+
+               /* Sprinkle a few restart indices for the restart cases.  */
+               for (i = 0; i < NUM_VERTS; i++) {
+                  unsigned value = rand() & (in_size == 1 ? 0x7f : 0x7fff);
+                  if (pr && in_size != 1 && (rand() % 64) == 0)
+                     value = RESTART_INDEX;
+                  if (in_size == 1)
+                     ((uint8_t *)in)[i] = (uint8_t)value;
+                  else if (in_size == 2)
+                     ((uint16_t *)in)[i] = (uint16_t)value;
+                  else
+                     ((uint32_t *)in)[i] = value;
+               }
+
+               u_trim_pipe_prim(prims[p], &nr);
+
+               ret = u_index_translator(hw_mask, prims[p], in_size, nr, pv, pv,
+                                        pr, &out_prim, &out_size, &out_nr,
+                                        &translate);
+               if (ret == U_TRANSLATE_ERROR)
+                  continue;
+
+               memset(out, 0xcd, OUT_SIZE);
+               memset(ref, 0xcd, OUT_SIZE);
+
+               translate(in, start, start + nr, out_nr,
+                         RESTART_INDEX, out);
+
+               if (reference(prims[p], pv, pr, ret == U_TRANSLATE_MEMCPY,
+                             in, in_size, start, nr,
+                             ref, out_size, out_nr)) {
+                  pass = memcmp(out, ref, OUT_SIZE) == 0;
+                  printf("%s: %s %u -> %u bytes, pv %u, restart %u\n",
+                         pass ? "PASS" : "FAIL",
+                         u_prim_name(prims[p]), in_size, out_size, pv, pr);
+                  passed += pass;
+                  total++;
+               }
+
+               if (bench) {
+                  int64_t t0, t1;
+                  unsigned iter;
+
+                  t0 = os_time_get();
+                  for (iter = 0; iter < num_iters; iter++)
+                     translate(in, start, start + nr, out_nr,
+                               RESTART_INDEX, out);
+                  t1 = os_time_get();
+
+                  printf("  %-16s %u -> %u bytes, pv %u, restart %u: "
+                         "%.1f Mindices/s\n",
+                         u_prim_name(prims[p]), in_size, out_size, pv, pr,
+                         (double)nr * num_iters / (double)(t1 - t0));
+               }
+            }
+         }
+      }
+   }
+
+   FREE(ref);
+   FREE(out);
+   FREE(in);
+
+   printf("%u/%u tests passed\n", passed, total);
+   return passed != total;
+}
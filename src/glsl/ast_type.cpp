@@ -308,7 +308,7 @@ ast_type_qualifier::merge_out_qualifier(YYLTYPE *loc,
                                         ast_type_qualifier q,
                                         ast_node* &node)
 {
-   void *mem_ctx = state;
+   void *mem_ctx = state->linalloc;
    const bool r = this->merge_qualifier(loc, state, q);
 
    if (state->stage == MESA_SHADER_TESS_CTRL) {
@@ -324,7 +324,7 @@ ast_type_qualifier::merge_in_qualifier(YYLTYPE *loc,
                                        ast_type_qualifier q,
                                        ast_node* &node)
 {
-   void *mem_ctx = state;
+   void *mem_ctx = state->linalloc;
    bool create_gs_ast = false;
    bool create_cs_ast = false;
    ast_type_qualifier valid_in_mask;
@@ -481,19 +481,32 @@ public:
    void release();
    ir_function_signature *find(_mesa_glsl_parse_state *state,
                                const char *name, exec_list *actual_parameters);
+   ir_function *get_function(const char *name);
 
    /**
     * A shader to hold all the built-in signatures; created by this module.
     *
-    * This includes signatures for every built-in, regardless of version or
-    * enabled extensions.  The availability predicate associated with each
-    * signature allows matching_signature() to filter out the irrelevant ones.
+    * This includes signatures for every built-in that has been looked up so
+    * far, regardless of version or enabled extensions.  The availability
+    * predicate associated with each signature allows matching_signature()
+    * to filter out the irrelevant ones.
     */
    gl_shader *shader;
 
 private:
    void *mem_ctx;
 
+   /**
+    * While create_builtins() runs, the only built-in function it should
+    * generate.  NULL means all of them.
+    */
+   const char *wanted_name;
+
+   bool wanted(const char *name) const
+   {
+      return wanted_name == NULL || strcmp(name, wanted_name) == 0;
+   }
+
    /** Global variables used by built-in functions. */
    ir_variable *gl_ModelViewProjectionMatrix;
    ir_variable *gl_Vertex;
@@ -799,6 +812,7 @@ private:
  */
 builtin_builder::builtin_builder()
    : shader(NULL),
+     wanted_name(NULL),
      gl_ModelViewProjectionMatrix(NULL),
      gl_Vertex(NULL)
 {
@@ -823,7 +837,7 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
     */
    state->uses_builtin_functions = true;
 
-   ir_function *f = shader->symbols->get_function(name);
+   ir_function *f = get_function(name);
    if (f == NULL)
       return NULL;
 
@@ -835,6 +849,28 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
    return sig;
 }
 
+/**
+ * Look up a built-in function, generating its IR on first use.
+ *
+ * Building every built-in up front means creating thousands of signatures
+ * that a typical shader never calls, so only the intrinsics are created by
+ * initialize() and each built-in function is generated when a shader first
+ * refers to it.
+ */
+ir_function *
+builtin_builder::get_function(const char *name)
+{
+   ir_function *f = shader->symbols->get_function(name);
+   if (f != NULL)
+      return f;
+
+   wanted_name = name;
+   create_builtins();
+   wanted_name = NULL;
+
+   return shader->symbols->get_function(name);
+}
+
 void
 builtin_builder::initialize()
 {
@@ -845,7 +881,6 @@ builtin_builder::initialize()
    mem_ctx = ralloc_context(NULL);
    create_shader();
    create_intrinsics();
-   create_builtins();
 }
 
 void
@@ -957,11 +992,17 @@ builtin_builder::create_intrinsics()
 /**
  * Create ir_function and ir_function_signature objects for each built-in.
  *
- * Contains a list of every available built-in.
+ * Contains a list of every available built-in.  When \c wanted_name is set,
+ * only that function is created; the signatures passed to the other
+ * add_function() calls are not even built.
  */
 void
 builtin_builder::create_builtins()
 {
+#define add_function(NAME, ...)                 \
+   if (wanted(NAME))                            \
+      add_function(NAME, __VA_ARGS__)
+
 #define F(NAME)                                 \
    add_function(#NAME,                          \
                 _##NAME(glsl_type::float_type), \
@@ -2741,6 +2782,7 @@ builtin_builder::create_builtins()
                 _memory_barrier(shader_image_load_store),
                 NULL);
 
+#undef add_function
 #undef F
 #undef FI
 #undef FIUD
@@ -2781,6 +2823,9 @@ builtin_builder::add_image_function(const char *name,
                                     unsigned num_arguments,
                                     unsigned flags)
 {
+   if (!wanted(name))
+      return;
+
    static const glsl_type *const types[] = {
       glsl_type::image1D_type,
       glsl_type::image2D_type,
@@ -5295,7 +5340,7 @@ _mesa_glsl_find_builtin_function_by_name(const char *name)
 {
    ir_function *f;
    mtx_lock(&builtins_lock);
-   f = builtins.shader->symbols->get_function(name);
+   f = builtins.get_function(name);
    mtx_unlock(&builtins_lock);
    return f;
 }
@@ -5306,6 +5351,22 @@ _mesa_glsl_get_builtin_function_shader()
    return builtins.shader;
 }
 
+/**
+ * Built-in functions are created as shaders use them, so code reading the
+ * built-in shader directly has to hold this lock.
+ */
+void
+_mesa_glsl_lock_builtin_functions()
+{
+   mtx_lock(&builtins_lock);
+}
+
+void
+_mesa_glsl_unlock_builtin_functions()
+{
+   mtx_unlock(&builtins_lock);
+}
+
 
 /**
  * Get the function signature for main from a shader
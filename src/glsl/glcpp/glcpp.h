@@ -221,6 +221,9 @@ int
 glcpp_preprocess(void *ralloc_ctx, const char **shader, char **info_log,
 	   const struct gl_extensions *extensions, struct gl_context *g_ctx);
 
+bool
+glcpp_preprocess_fast(void *ralloc_ctx, const char **shader);
+
 /* Functions for writing to the info log */
 
 void
@@ -211,6 +211,251 @@ remove_line_continuations(glcpp_parser_t *ctx, const char *shader)
 	return clean;
 }
 
+static const char *
+skip_hspace (const char *str)
+{
+	while (*str == ' ' || *str == '\t')
+		str++;
+
+	return str;
+}
+
+static bool
+is_identifier_start (char c)
+{
+	return isalpha((unsigned char) c) || c == '_';
+}
+
+static bool
+is_identifier_char (char c)
+{
+	return isalnum((unsigned char) c) || c == '_';
+}
+
+/* Copy a "#version" directive starting just after the "version" keyword,
+ * in the same form the full preprocessor prints it.
+ *
+ * Returns a pointer to the end of the line, or NULL if the directive is
+ * anything but a well-formed "#version <number> [<profile>]".
+ */
+static const char *
+copy_version_directive (const char *in, char **out)
+{
+	const char *number, *profile = NULL;
+	size_t number_len, profile_len = 0;
+
+	if (*in != ' ' && *in != '\t')
+		return NULL;
+	in = skip_hspace (in);
+
+	if (*in < '1' || *in > '9')
+		return NULL;
+	number = in;
+	while (isdigit((unsigned char) *in))
+		in++;
+	number_len = in - number;
+
+	if (is_identifier_start (*in))
+		return NULL;
+
+	in = skip_hspace (in);
+	if (is_identifier_start (*in)) {
+		profile = in;
+		while (is_identifier_char (*in))
+			in++;
+		profile_len = in - profile;
+		in = skip_hspace (in);
+	}
+
+	if (in[0] == '/' && in[1] == '/')
+		in += strcspn (in, "\r\n");
+
+	if (*in != '\0' && *in != '\r' && *in != '\n')
+		return NULL;
+
+	memcpy (*out, "#version ", 9);
+	*out += 9;
+	memcpy (*out, number, number_len);
+	*out += number_len;
+	if (profile) {
+		*(*out)++ = ' ';
+		memcpy (*out, profile, profile_len);
+		*out += profile_len;
+	}
+
+	return in;
+}
+
+/* Copies the rest of an #extension directive to *out.  The compiler's
+ * lexer only skips // comments on directive lines, so other comments are
+ * replaced by a space.
+ *
+ * Returns NULL for comments that go on past the end of the line and for
+ * line continuations, which are left to the full preprocessor.
+ */
+static const char *
+copy_extension_directive (const char *in, char **out)
+{
+	const char *end = in + strcspn (in, "\r\n");
+
+	if (memchr (in, '\\', end - in) != NULL)
+		return NULL;
+
+	while (in < end) {
+		if (in[0] == '/' && in[1] == '/')
+			break;
+
+		if (in[0] == '/' && in[1] == '*') {
+			const char *close = strstr (in + 2, "*/");
+
+			if (close == NULL || close >= end)
+				return NULL;
+
+			*(*out)++ = ' ';
+			in = close + 2;
+			continue;
+		}
+
+		*(*out)++ = *in++;
+	}
+
+	memcpy (*out, in, end - in);
+	*out += end - in;
+
+	return end;
+}
+
+/* Most shaders use no preprocessor feature beyond #version and #extension
+ * directives and comments.  For those, running the full preprocessor only
+ * to get the source back is a waste of time, so strip the comments here in
+ * a single pass and hand the rest to the compiler unchanged.
+ *
+ * Any construct that the full preprocessor would act upon (other
+ * directives, line continuations, identifiers that could name a built-in
+ * macro, unterminated comments) makes this return false without touching
+ * *shader, and the caller falls back to glcpp_preprocess().
+ */
+bool
+glcpp_preprocess_fast(void *ralloc_ctx, const char **shader)
+{
+	const char *in = *shader;
+	char *output = ralloc_size (ralloc_ctx, strlen (in) + 1);
+	char *out = output;
+	int commented_newlines = 0;
+	bool line_has_token = false;
+	bool shader_has_token = false;
+
+	if (output == NULL)
+		return false;
+
+	while (*in) {
+		const char *start = in;
+
+		if (*in == '\r' || *in == '\n') {
+			/* Newlines inside multi-line comments are emitted at
+			 * the end of the line, as the full preprocessor does.
+			 */
+			*out++ = '\n';
+			for (; commented_newlines; commented_newlines--)
+				*out++ = '\n';
+			in = skip_newline (in);
+			line_has_token = false;
+			continue;
+		}
+
+		if (in[0] == '/' && in[1] == '/') {
+			in += strcspn (in, "\r\n");
+			continue;
+		}
+
+		if (in[0] == '/' && in[1] == '*') {
+			const char *end = strstr (in + 2, "*/");
+
+			if (end == NULL)
+				goto fail;
+
+			for (in += 2; in < end; ) {
+				if (*in == '\r' || *in == '\n') {
+					commented_newlines++;
+					in = skip_newline (in);
+				} else {
+					in++;
+				}
+			}
+
+			*out++ = ' ';
+			in = end + 2;
+			continue;
+		}
+
+		if (*in == '#') {
+			if (line_has_token)
+				goto fail;
+
+			in = skip_hspace (in + 1);
+			if (strncmp (in, "version", 7) == 0) {
+				if (shader_has_token)
+					goto fail;
+				in = copy_version_directive (in + 7, &out);
+				if (in == NULL)
+					goto fail;
+			} else if (strncmp (in, "extension", 9) == 0 &&
+				   (in[9] == ' ' || in[9] == '\t')) {
+				*out++ = '#';
+				in = copy_extension_directive (in, &out);
+				if (in == NULL)
+					goto fail;
+			} else {
+				goto fail;
+			}
+
+			line_has_token = shader_has_token = true;
+			continue;
+		}
+
+		if (is_identifier_start (*in)) {
+			while (is_identifier_char (*in))
+				in++;
+
+			/* Every built-in macro starts with "GL_" or "__". */
+			if (strncmp (start, "GL_", 3) == 0 ||
+			    strncmp (start, "__", 2) == 0)
+				goto fail;
+		} else if (isdigit((unsigned char) *in) ||
+			   (in[0] == '.' && isdigit((unsigned char) in[1]))) {
+			/* Skip whole preprocessing numbers so that their
+			 * suffixes are not mistaken for identifiers.
+			 */
+			in++;
+			while (is_identifier_char (*in) || *in == '.' ||
+			       ((*in == '+' || *in == '-') &&
+				strchr ("eEpP", in[-1]) != NULL))
+				in++;
+		} else if (*in == ' ' || *in == '\t') {
+			in = skip_hspace (in);
+			memcpy (out, start, in - start);
+			out += in - start;
+			continue;
+		} else if (*in == '\\' || *in == '\v' || *in == '\f') {
+			goto fail;
+		} else {
+			in++;
+		}
+
+		memcpy (out, start, in - start);
+		out += in - start;
+		line_has_token = shader_has_token = true;
+	}
+
+	*out = '\0';
+	*shader = output;
+	return true;
+
+fail:
+	ralloc_free (output);
+	return false;
+}
+
 int
 glcpp_preprocess(void *ralloc_ctx, const char **shader, char **info_log,
 	   const struct gl_extensions *extensions, struct gl_context *gl_ctx)
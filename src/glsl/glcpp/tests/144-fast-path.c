@@ -0,0 +1,12 @@
+// glcpp-args: --fast-path
+#version 150 core // comments after #version are dropped
+#extension GL_ARB_explicit_attrib_location : enable // kept verbatim
+
+/* A comment spanning
+ * several lines */ in vec4 v;
+layout(location = 0) out vec4 color;
+
+void main()
+{
+	color = v * 1.0e+2 /* inline */ + 0x1Fu; // trailing
+}
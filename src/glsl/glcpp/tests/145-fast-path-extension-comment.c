@@ -0,0 +1,4 @@
+// glcpp-args: --fast-path
+#version 130
+#extension GL_foo : enable /* c */
+#extension /* name */ GL_bar /* : */ : warn // trailing
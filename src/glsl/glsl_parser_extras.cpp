@@ -24,6 +24,12 @@
 #include <stdarg.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
 
 #include "main/core.h" /* for struct gl_context */
 #include "main/context.h"
@@ -63,6 +69,7 @@ _mesa_glsl_parse_state::_mesa_glsl_parse_state(struct gl_context *_ctx,
    this->scanner = NULL;
    this->translation_unit.make_empty();
    this->symbols = new(mem_ctx) glsl_symbol_table;
+   this->linalloc = linear_alloc_parent(this, 0);
 
    this->info_log = ralloc_strdup(mem_ctx, "");
    this->error = false;
@@ -1724,8 +1731,10 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
       (void) p_atomic_cmpxchg(&ir_variable::temporaries_allocate_names,
                               false, true);
 
-   state->error = glcpp_preprocess(state, &source, &state->info_log,
-                             &ctx->Extensions, ctx);
+   if (!glcpp_preprocess_fast(state, &source)) {
+      state->error = glcpp_preprocess(state, &source, &state->info_log,
+                                      &ctx->Extensions, ctx);
+   }
 
    if (!state->error) {
      _mesa_glsl_lexer_ctor(state, source);
@@ -1759,13 +1768,17 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
       struct gl_shader_compiler_options *options =
          &ctx->Const.ShaderCompilerOptions[shader->Stage];
 
+      char *stats_name = NULL;
+
+      if (ctx->Shader.Flags & GLSL_STATS)
+         stats_name = ralloc_asprintf(state, "shader %u", shader->Name);
+
       lower_subroutine(shader->ir, state);
       /* Do some optimization at compile time to reduce shader IR size
        * and reduce later work if the same shader is linked multiple times
        */
-      while (do_common_optimization(shader->ir, false, false, options,
-                                    ctx->Const.NativeIntegers))
-         ;
+      do_common_optimization_loop(shader->ir, false, false, options,
+                                  ctx->Const.NativeIntegers, stats_name);
 
       validate_ir_tree(shader->ir);
 
@@ -1835,11 +1848,299 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
 
    _mesa_glsl_initialize_derived_variables(shader);
 
+   if (ctx->Shader.Flags & GLSL_STATS) {
+      struct linear_stats stats;
+
+      linear_get_stats(state->linalloc, &stats);
+      printf("GLSL shader %u AST: %u allocations, %lu bytes used of %lu "
+             "in %u buffers\n", shader->Name, stats.num_allocations,
+             (unsigned long) stats.bytes_allocated,
+             (unsigned long) stats.bytes_reserved, stats.num_buffers);
+   }
+
    delete state->symbols;
    ralloc_free(state);
 }
 
 } /* extern "C" */
+namespace {
+
+/**
+ * The passes of do_common_optimization(), in the order they run.
+ */
+enum common_opt_pass {
+   OPT_LOWER_SUB_TO_ADD_NEG,
+   OPT_FUNCTION_INLINING,
+   OPT_DEAD_FUNCTIONS,
+   OPT_STRUCTURE_SPLITTING,
+   OPT_IF_SIMPLIFICATION,
+   OPT_FLATTEN_NESTED_IF_BLOCKS,
+   OPT_CONDITIONAL_DISCARD,
+   OPT_COPY_PROPAGATION,
+   OPT_COPY_PROPAGATION_ELEMENTS,
+   OPT_FLIP_MATRICES,
+   OPT_VECTORIZE,
+   OPT_DEAD_CODE,
+   OPT_DEAD_CODE_LOCAL,
+   OPT_TREE_GRAFTING,
+   OPT_CONSTANT_PROPAGATION,
+   OPT_CONSTANT_VARIABLE,
+   OPT_CONSTANT_FOLDING,
+   OPT_MINMAX_PRUNE,
+   OPT_REBALANCE_TREE,
+   OPT_ALGEBRAIC,
+   OPT_LOWER_JUMPS,
+   OPT_VEC_INDEX_TO_SWIZZLE,
+   OPT_LOWER_VECTOR_INSERT,
+   OPT_SWIZZLE_SWIZZLE,
+   OPT_NOOP_SWIZZLE,
+   OPT_SPLIT_ARRAYS,
+   OPT_REDUNDANT_JUMPS,
+   OPT_LOOPS,
+   OPT_NUM_PASSES
+};
+
+const char *const common_opt_pass_names[OPT_NUM_PASSES] = {
+   "lower_sub_to_add_neg",
+   "function_inlining",
+   "dead_functions",
+   "structure_splitting",
+   "if_simplification",
+   "flatten_nested_if_blocks",
+   "conditional_discard",
+   "copy_propagation",
+   "copy_propagation_elements",
+   "flip_matrices",
+   "vectorize",
+   "dead_code",
+   "dead_code_local",
+   "tree_grafting",
+   "constant_propagation",
+   "constant_variable",
+   "constant_folding",
+   "minmax_prune",
+   "rebalance_tree",
+   "algebraic",
+   "lower_jumps",
+   "vec_index_to_swizzle",
+   "lower_vector_insert",
+   "swizzle_swizzle",
+   "noop_swizzle",
+   "split_arrays",
+   "redundant_jumps",
+   "loop_unrolling",
+};
+
+int64_t
+get_time_ns(void)
+{
+#if defined(_WIN32)
+   LARGE_INTEGER frequency, counter;
+
+   QueryPerformanceFrequency(&frequency);
+   QueryPerformanceCounter(&counter);
+   return counter.QuadPart * INT64_C(1000000000) / frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+#else
+   struct timeval tv;
+
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec * INT64_C(1000000000) + tv.tv_usec * INT64_C(1000);
+#endif
+}
+
+/**
+ * Runs the passes of do_common_optimization() until they stop making
+ * progress.
+ *
+ * A pass that made no progress cannot make progress on the same IR, so
+ * once a pass has run without progress it is skipped until another pass
+ * changes the IR.  This means the final sweep, which only confirms that
+ * nothing changes anymore, stops after the last pass that did something.
+ *
+ * When profiling, the time spent in each pass and the number of times it
+ * ran, was skipped and made progress are recorded.
+ */
+class common_optimizer {
+public:
+   common_optimizer(exec_list *ir, bool linked,
+                    bool uniform_locations_assigned,
+                    const struct gl_shader_compiler_options *options,
+                    bool native_integers, bool profile)
+      : ir(ir), linked(linked),
+        uniform_locations_assigned(uniform_locations_assigned),
+        options(options), native_integers(native_integers),
+        profile(profile), changes(0), sweeps(0)
+   {
+      memset(stats, 0, sizeof(stats));
+      for (unsigned i = 0; i < OPT_NUM_PASSES; i++)
+         stable_since[i] = ~0u;
+   }
+
+   bool sweep();
+   void print_stats(const char *name) const;
+
+private:
+   bool begin_pass(enum common_opt_pass pass, int64_t *start);
+   bool end_pass(enum common_opt_pass pass, int64_t start, bool progress);
+
+   exec_list *ir;
+   bool linked;
+   bool uniform_locations_assigned;
+   const struct gl_shader_compiler_options *options;
+   bool native_integers;
+   bool profile;
+
+   /** Number of pass runs that made progress so far */
+   unsigned changes;
+
+   /** Value of \c changes when each pass last ran without progress */
+   unsigned stable_since[OPT_NUM_PASSES];
+
+   unsigned sweeps;
+   struct {
+      unsigned runs;
+      unsigned skips;
+      unsigned progress;
+      int64_t time_ns;
+   } stats[OPT_NUM_PASSES];
+};
+
+bool
+common_optimizer::begin_pass(enum common_opt_pass pass, int64_t *start)
+{
+   if (stable_since[pass] == changes) {
+      stats[pass].skips++;
+      return false;
+   }
+
+   *start = profile ? get_time_ns() : 0;
+   return true;
+}
+
+bool
+common_optimizer::end_pass(enum common_opt_pass pass, int64_t start,
+                           bool progress)
+{
+   if (profile)
+      stats[pass].time_ns += get_time_ns() - start;
+   stats[pass].runs++;
+
+   if (progress) {
+      stats[pass].progress++;
+      changes++;
+   } else {
+      stable_since[pass] = changes;
+   }
+
+   return progress;
+}
+
+bool
+common_optimizer::sweep()
+{
+   bool progress = false;
+   int64_t start;
+
+#define OPT(PASS, CALL)                                          \
+   do {                                                          \
+      if (begin_pass(PASS, &start))                              \
+         progress = end_pass(PASS, start, CALL) || progress;     \
+   } while (false)
+
+   sweeps++;
+
+   OPT(OPT_LOWER_SUB_TO_ADD_NEG, lower_instructions(ir, SUB_TO_ADD_NEG));
+
+   if (linked) {
+      OPT(OPT_FUNCTION_INLINING, do_function_inlining(ir));
+      OPT(OPT_DEAD_FUNCTIONS, do_dead_functions(ir));
+      OPT(OPT_STRUCTURE_SPLITTING, do_structure_splitting(ir));
+   }
+   OPT(OPT_IF_SIMPLIFICATION, do_if_simplification(ir));
+   OPT(OPT_FLATTEN_NESTED_IF_BLOCKS, opt_flatten_nested_if_blocks(ir));
+   OPT(OPT_CONDITIONAL_DISCARD, opt_conditional_discard(ir));
+   OPT(OPT_COPY_PROPAGATION, do_copy_propagation(ir));
+   OPT(OPT_COPY_PROPAGATION_ELEMENTS, do_copy_propagation_elements(ir));
+
+   if (options->OptimizeForAOS && !linked)
+      OPT(OPT_FLIP_MATRICES, opt_flip_matrices(ir));
+
+   if (linked && options->OptimizeForAOS) {
+      OPT(OPT_VECTORIZE, do_vectorize(ir));
+   }
+
+   if (linked)
+      OPT(OPT_DEAD_CODE, do_dead_code(ir, uniform_locations_assigned));
+   else
+      OPT(OPT_DEAD_CODE, do_dead_code_unlinked(ir));
+   OPT(OPT_DEAD_CODE_LOCAL, do_dead_code_local(ir));
+   OPT(OPT_TREE_GRAFTING, do_tree_grafting(ir));
+   OPT(OPT_CONSTANT_PROPAGATION, do_constant_propagation(ir));
+   if (linked)
+      OPT(OPT_CONSTANT_VARIABLE, do_constant_variable(ir));
+   else
+      OPT(OPT_CONSTANT_VARIABLE, do_constant_variable_unlinked(ir));
+   OPT(OPT_CONSTANT_FOLDING, do_constant_folding(ir));
+   OPT(OPT_MINMAX_PRUNE, do_minmax_prune(ir));
+   OPT(OPT_REBALANCE_TREE, do_rebalance_tree(ir));
+   OPT(OPT_ALGEBRAIC, do_algebraic(ir, native_integers, options));
+   OPT(OPT_LOWER_JUMPS, do_lower_jumps(ir));
+   OPT(OPT_VEC_INDEX_TO_SWIZZLE, do_vec_index_to_swizzle(ir));
+   OPT(OPT_LOWER_VECTOR_INSERT, lower_vector_insert(ir, false));
+   OPT(OPT_SWIZZLE_SWIZZLE, do_swizzle_swizzle(ir));
+   OPT(OPT_NOOP_SWIZZLE, do_noop_swizzle(ir));
+
+   OPT(OPT_SPLIT_ARRAYS, optimize_split_arrays(ir, linked));
+   OPT(OPT_REDUNDANT_JUMPS, optimize_redundant_jumps(ir));
+
+   if (begin_pass(OPT_LOOPS, &start)) {
+      bool loop_progress = false;
+
+      loop_state *ls = analyze_loop_variables(ir);
+      if (ls->loop_found) {
+         loop_progress = set_loop_controls(ir, ls) || loop_progress;
+         loop_progress = unroll_loops(ir, ls, options) || loop_progress;
+      }
+      delete ls;
+
+      progress = end_pass(OPT_LOOPS, start, loop_progress) || progress;
+   }
+
+#undef OPT
+
+   return progress;
+}
+
+void
+common_optimizer::print_stats(const char *name) const
+{
+   int64_t total_ns = 0;
+
+   for (unsigned i = 0; i < OPT_NUM_PASSES; i++)
+      total_ns += stats[i].time_ns;
+
+   printf("GLSL optimization of %s: %u sweeps, %.3f ms\n",
+          name, sweeps, total_ns / 1000000.0);
+   printf("   %-26s %6s %6s %8s %10s\n",
+          "pass", "runs", "skips", "progress", "time (us)");
+
+   for (unsigned i = 0; i < OPT_NUM_PASSES; i++) {
+      if (stats[i].runs == 0 && stats[i].skips == 0)
+         continue;
+
+      printf("   %-26s %6u %6u %8u %10.1f\n", common_opt_pass_names[i],
+             stats[i].runs, stats[i].skips, stats[i].progress,
+             stats[i].time_ns / 1000.0);
+   }
+}
+
+} /* anonymous namespace */
+
 /**
  * Do the set of common optimizations passes
  *
@@ -1864,60 +2165,36 @@ do_common_optimization(exec_list *ir, bool linked,
                        const struct gl_shader_compiler_options *options,
                        bool native_integers)
 {
-   GLboolean progress = GL_FALSE;
-
-   progress = lower_instructions(ir, SUB_TO_ADD_NEG) || progress;
+   common_optimizer opt(ir, linked, uniform_locations_assigned, options,
+                        native_integers, false);
 
-   if (linked) {
-      progress = do_function_inlining(ir) || progress;
-      progress = do_dead_functions(ir) || progress;
-      progress = do_structure_splitting(ir) || progress;
-   }
-   progress = do_if_simplification(ir) || progress;
-   progress = opt_flatten_nested_if_blocks(ir) || progress;
-   progress = opt_conditional_discard(ir) || progress;
-   progress = do_copy_propagation(ir) || progress;
-   progress = do_copy_propagation_elements(ir) || progress;
-
-   if (options->OptimizeForAOS && !linked)
-      progress = opt_flip_matrices(ir) || progress;
+   return opt.sweep();
+}
 
-   if (linked && options->OptimizeForAOS) {
-      progress = do_vectorize(ir) || progress;
-   }
+/**
+ * Repeat do_common_optimization() until it makes no more progress.
+ *
+ * Unlike calling do_common_optimization() in a loop, this skips passes that
+ * cannot make progress because the IR didn't change since they last ran.
+ *
+ * \param stats_name  If not NULL, print the time spent in each pass and how
+ *                    often it made progress, using \c stats_name to identify
+ *                    the shader.
+ */
+void
+do_common_optimization_loop(exec_list *ir, bool linked,
+                            bool uniform_locations_assigned,
+                            const struct gl_shader_compiler_options *options,
+                            bool native_integers, const char *stats_name)
+{
+   common_optimizer opt(ir, linked, uniform_locations_assigned, options,
+                        native_integers, stats_name != NULL);
 
-   if (linked)
-      progress = do_dead_code(ir, uniform_locations_assigned) || progress;
-   else
-      progress = do_dead_code_unlinked(ir) || progress;
-   progress = do_dead_code_local(ir) || progress;
-   progress = do_tree_grafting(ir) || progress;
-   progress = do_constant_propagation(ir) || progress;
-   if (linked)
-      progress = do_constant_variable(ir) || progress;
-   else
-      progress = do_constant_variable_unlinked(ir) || progress;
-   progress = do_constant_folding(ir) || progress;
-   progress = do_minmax_prune(ir) || progress;
-   progress = do_rebalance_tree(ir) || progress;
-   progress = do_algebraic(ir, native_integers, options) || progress;
-   progress = do_lower_jumps(ir) || progress;
-   progress = do_vec_index_to_swizzle(ir) || progress;
-   progress = lower_vector_insert(ir, false) || progress;
-   progress = do_swizzle_swizzle(ir) || progress;
-   progress = do_noop_swizzle(ir) || progress;
-
-   progress = optimize_split_arrays(ir, linked) || progress;
-   progress = optimize_redundant_jumps(ir) || progress;
-
-   loop_state *ls = analyze_loop_variables(ir);
-   if (ls->loop_found) {
-      progress = set_loop_controls(ir, ls) || progress;
-      progress = unroll_loops(ir, ls, options) || progress;
-   }
-   delete ls;
+   while (opt.sweep())
+      ;
 
-   return progress;
+   if (stats_name != NULL)
+      opt.print_stats(stats_name);
 }
 
 extern "C" {
@@ -263,6 +263,9 @@ struct _mesa_glsl_parse_state {
    exec_list translation_unit;
    glsl_symbol_table *symbols;
 
+   /** Linear allocator for the AST and the identifiers of the lexer */
+   void *linalloc;
+
    unsigned num_supported_versions;
    struct {
       unsigned ver;
@@ -720,6 +723,7 @@ _mesa_shader_stage_to_abbrev(unsigned stage);
 
 extern int glcpp_preprocess(void *ctx, const char **shader, char **info_log,
                       const struct gl_extensions *extensions, struct gl_context *gl_ctx);
+extern bool glcpp_preprocess_fast(void *ctx, const char **shader);
 
 extern void _mesa_destroy_shader_compiler(void);
 extern void _mesa_destroy_shader_compiler_caches(void);
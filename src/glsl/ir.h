@@ -2567,6 +2567,12 @@ _mesa_glsl_find_builtin_function_by_name(const char *name);
 extern gl_shader *
 _mesa_glsl_get_builtin_function_shader(void);
 
+extern void
+_mesa_glsl_lock_builtin_functions(void);
+
+extern void
+_mesa_glsl_unlock_builtin_functions(void);
+
 extern ir_function_signature *
 _mesa_get_main_function_signature(gl_shader *sh);
 
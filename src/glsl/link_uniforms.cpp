@@ -476,6 +476,14 @@ public:
 			      union gl_constant_value *values)
       : map(map), uniforms(uniforms), values(values)
    {
+      mem_ctx = ralloc_context(NULL);
+      block_names = NULL;
+      block_array_names = NULL;
+   }
+
+   ~parcel_out_uniform_storage()
+   {
+      ralloc_free(mem_ctx);
    }
 
    void start_shader(gl_shader_stage shader_type)
@@ -501,27 +509,7 @@ public:
 
       ubo_block_index = -1;
       if (var->is_in_buffer_block()) {
-         if (var->is_interface_instance() && var->type->is_array()) {
-            unsigned l = strlen(var->get_interface_type()->name);
-
-            for (unsigned i = 0; i < prog->NumBufferInterfaceBlocks; i++) {
-               if (strncmp(var->get_interface_type()->name,
-                           prog->BufferInterfaceBlocks[i].Name,
-                           l) == 0
-                   && prog->BufferInterfaceBlocks[i].Name[l] == '[') {
-                  ubo_block_index = i;
-                  break;
-               }
-            }
-         } else {
-            for (unsigned i = 0; i < prog->NumBufferInterfaceBlocks; i++) {
-               if (strcmp(var->get_interface_type()->name,
-                          prog->BufferInterfaceBlocks[i].Name) == 0) {
-                  ubo_block_index = i;
-                  break;
-               }
-	    }
-	 }
+         ubo_block_index = find_block_index(prog, var);
 	 assert(ubo_block_index != -1);
 
          /* Uniform blocks that were specified with an instance name must be
@@ -566,6 +554,47 @@ public:
    gl_shader_stage shader_type;
 
 private:
+   /**
+    * Look up the program-wide block that \c var belongs to.
+    *
+    * Instances of block arrays are matched by the name of the block followed
+    * by a subscript, everything else by the exact block name.  Both indexes
+    * are built the first time they are needed and reused for every variable.
+    */
+   int find_block_index(struct gl_shader_program *prog, ir_variable *var)
+   {
+      if (block_names == NULL) {
+         block_names = _mesa_hash_table_create(mem_ctx, _mesa_key_hash_string,
+                                               _mesa_key_string_equal);
+         block_array_names =
+            _mesa_hash_table_create(mem_ctx, _mesa_key_hash_string,
+                                    _mesa_key_string_equal);
+
+         for (unsigned i = 0; i < prog->NumBufferInterfaceBlocks; i++) {
+            const char *name = prog->BufferInterfaceBlocks[i].Name;
+            const char *subscript = strchr(name, '[');
+            struct hash_table *ht = block_names;
+
+            if (subscript != NULL) {
+               name = ralloc_strndup(mem_ctx, name, subscript - name);
+               ht = block_array_names;
+            }
+
+            /* Keep the first block of each name, like a linear search. */
+            if (_mesa_hash_table_search(ht, name) == NULL)
+               _mesa_hash_table_insert(ht, name, (void *) (uintptr_t) (i + 1));
+         }
+      }
+
+      struct hash_table *ht =
+         var->is_interface_instance() && var->type->is_array()
+         ? block_array_names : block_names;
+      struct hash_entry *entry =
+         _mesa_hash_table_search(ht, var->get_interface_type()->name);
+
+      return entry != NULL ? (int) ((uintptr_t) entry->data - 1) : -1;
+   }
+
    void handle_samplers(const glsl_type *base_type,
                         struct gl_uniform_storage *uniform, const char *name)
    {
@@ -877,6 +906,14 @@ private:
     */
    struct string_to_uint_map *record_next_sampler;
 
+   void *mem_ctx;
+
+   /**
+    * Program-wide buffer blocks by name, see find_block_index().
+    */
+   struct hash_table *block_names;
+   struct hash_table *block_array_names;
+
 public:
    union gl_constant_value *values;
 
@@ -897,20 +934,27 @@ public:
  * Merges a uniform block into an array of uniform blocks that may or
  * may not already contain a copy of it.
  *
+ * \c linked_block_names maps the name of each block in the array to its
+ * index plus one, and is updated when a block is added.
+ *
  * Returns the index of the new block in the array.
  */
 int
 link_cross_validate_uniform_block(void *mem_ctx,
 				  struct gl_uniform_block **linked_blocks,
 				  unsigned int *num_linked_blocks,
+				  struct hash_table *linked_block_names,
 				  struct gl_uniform_block *new_block)
 {
-   for (unsigned int i = 0; i < *num_linked_blocks; i++) {
+   struct hash_entry *entry =
+      _mesa_hash_table_search(linked_block_names, new_block->Name);
+
+   if (entry != NULL) {
+      const unsigned i = (uintptr_t) entry->data - 1;
       struct gl_uniform_block *old_block = &(*linked_blocks)[i];
 
-      if (strcmp(old_block->Name, new_block->Name) == 0)
-	 return link_uniform_blocks_are_compatible(old_block, new_block)
-	    ? i : -1;
+      return link_uniform_blocks_are_compatible(old_block, new_block)
+         ? i : -1;
    }
 
    *linked_blocks = reralloc(mem_ctx, *linked_blocks,
@@ -941,9 +985,25 @@ link_cross_validate_uniform_block(void *mem_ctx,
       }
    }
 
+   _mesa_hash_table_insert(linked_block_names, linked_block->Name,
+                           (void *) (uintptr_t) (linked_block_index + 1));
+
    return linked_block_index;
 }
 
+/**
+ * Adds \c name to \c ht unless an earlier block member already claimed it.
+ *
+ * The value is the member's index within its block, biased by one so that
+ * index zero is distinguishable from a missing entry.
+ */
+static void
+add_block_member_name(struct hash_table *ht, const char *name, unsigned j)
+{
+   if (_mesa_hash_table_search(ht, name) == NULL)
+      _mesa_hash_table_insert(ht, name, (void *) (uintptr_t) (j + 1));
+}
+
 /**
  * Walks the IR and update the references to uniform blocks in the
  * ir_variables to point at linked shader's list (previously, they
@@ -953,6 +1013,39 @@ link_cross_validate_uniform_block(void *mem_ctx,
 static void
 link_update_uniform_buffer_variables(struct gl_shader *shader)
 {
+   if (shader->NumBufferInterfaceBlocks == 0)
+      return;
+
+   /* Index the block members by full name and by the prefixes a record or
+    * array of arrays is matched on, so that each variable is one lookup
+    * instead of a scan of every member of every block.
+    */
+   void *mem_ctx = ralloc_context(NULL);
+   struct hash_table *by_name[3];
+   for (unsigned k = 0; k < ARRAY_SIZE(by_name); k++)
+      by_name[k] = _mesa_hash_table_create(mem_ctx, _mesa_key_hash_string,
+                                           _mesa_key_string_equal);
+
+   static const char sentinels[] = { '\0', '.', '[' };
+   for (unsigned i = 0; i < shader->NumBufferInterfaceBlocks; i++) {
+      const gl_uniform_block *block = &shader->BufferInterfaceBlocks[i];
+
+      for (unsigned j = 0; j < block->NumUniforms; j++) {
+         const char *name = block->Uniforms[j].Name;
+
+         add_block_member_name(by_name[0], name, j);
+
+         for (unsigned k = 1; k < ARRAY_SIZE(by_name); k++) {
+            const char *end = strchr(name, sentinels[k]);
+
+            if (end != NULL)
+               add_block_member_name(by_name[k],
+                                     ralloc_strndup(mem_ctx, name, end - name),
+                                     j);
+         }
+      }
+   }
+
    foreach_in_list(ir_instruction, node, shader->ir) {
       ir_variable *const var = node->as_variable();
 
@@ -967,46 +1060,22 @@ link_update_uniform_buffer_variables(struct gl_shader *shader)
          continue;
       }
 
-      bool found = false;
-      char sentinel = '\0';
+      unsigned k = 0;
 
       if (var->type->is_record()) {
-         sentinel = '.';
+         k = 1;
       } else if (var->type->is_array() && (var->type->fields.array->is_array()
                  || var->type->without_array()->is_record())) {
-         sentinel = '[';
+         k = 2;
       }
 
-      const unsigned l = strlen(var->name);
-      for (unsigned i = 0; i < shader->NumBufferInterfaceBlocks; i++) {
-	 for (unsigned j = 0; j < shader->BufferInterfaceBlocks[i].NumUniforms; j++) {
-            if (sentinel) {
-               const char *begin = shader->BufferInterfaceBlocks[i].Uniforms[j].Name;
-               const char *end = strchr(begin, sentinel);
-
-               if (end == NULL)
-                  continue;
-
-               if ((ptrdiff_t) l != (end - begin))
-                  continue;
-
-               if (strncmp(var->name, begin, l) == 0) {
-                  found = true;
-                  var->data.location = j;
-                  break;
-               }
-            } else if (!strcmp(var->name,
-                               shader->BufferInterfaceBlocks[i].Uniforms[j].Name)) {
-	       found = true;
-	       var->data.location = j;
-	       break;
-	    }
-	 }
-	 if (found)
-	    break;
-      }
-      assert(found);
+      struct hash_entry *entry = _mesa_hash_table_search(by_name[k], var->name);
+      assert(entry != NULL);
+      if (entry != NULL)
+         var->data.location = (uintptr_t) entry->data - 1;
    }
+
+   ralloc_free(mem_ctx);
 }
 
 /**
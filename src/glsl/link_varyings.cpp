@@ -38,6 +38,7 @@
 #include "main/macros.h"
 #include "program/hash_table.h"
 #include "program.h"
+#include "util/hash_table.h"
 
 
 /**
@@ -623,6 +624,36 @@ tfeedback_decl::find_candidate(gl_shader_program *prog,
 }
 
 
+/**
+ * Hash consistent with tfeedback_decl::is_same().
+ */
+uint32_t
+tfeedback_decl::hash(const tfeedback_decl &x)
+{
+   assert(x.is_varying());
+
+   uint32_t hash = _mesa_hash_string(x.var_name);
+   if (x.is_subscripted)
+      hash ^= _mesa_hash_data(&x.array_subscript, sizeof(x.array_subscript));
+   return hash;
+}
+
+
+static uint32_t
+hash_tfeedback_decl(const void *key)
+{
+   return tfeedback_decl::hash(*(const tfeedback_decl *) key);
+}
+
+
+static bool
+tfeedback_decls_are_same(const void *a, const void *b)
+{
+   return tfeedback_decl::is_same(*(const tfeedback_decl *) a,
+                                  *(const tfeedback_decl *) b);
+}
+
+
 /**
  * Parse all the transform feedback declarations that were passed to
  * glTransformFeedbackVaryings() and store them in tfeedback_decl objects.
@@ -635,6 +666,10 @@ parse_tfeedback_decls(struct gl_context *ctx, struct gl_shader_program *prog,
                       const void *mem_ctx, unsigned num_names,
                       char **varying_names, tfeedback_decl *decls)
 {
+   struct hash_table *seen =
+      _mesa_hash_table_create(NULL, hash_tfeedback_decl,
+                              tfeedback_decls_are_same);
+
    for (unsigned i = 0; i < num_names; ++i) {
       decls[i].init(ctx, mem_ctx, varying_names[i]);
 
@@ -651,17 +686,16 @@ parse_tfeedback_decls(struct gl_context *ctx, struct gl_shader_program *prog,
        * specify the same varying variable and array index", since transform
        * feedback of arrays would be useless otherwise.
        */
-      for (unsigned j = 0; j < i; ++j) {
-         if (!decls[j].is_varying())
-            continue;
-
-         if (tfeedback_decl::is_same(decls[i], decls[j])) {
-            linker_error(prog, "Transform feedback varying %s specified "
-                         "more than once.", varying_names[i]);
-            return false;
-         }
+      if (_mesa_hash_table_search(seen, &decls[i]) != NULL) {
+         linker_error(prog, "Transform feedback varying %s specified "
+                      "more than once.", varying_names[i]);
+         _mesa_hash_table_destroy(seen, NULL);
+         return false;
       }
+      _mesa_hash_table_insert(seen, &decls[i], &decls[i]);
    }
+
+   _mesa_hash_table_destroy(seen, NULL);
    return true;
 }
 
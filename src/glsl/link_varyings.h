@@ -93,6 +93,7 @@ class tfeedback_decl
 public:
    void init(struct gl_context *ctx, const void *mem_ctx, const char *input);
    static bool is_same(const tfeedback_decl &x, const tfeedback_decl &y);
+   static uint32_t hash(const tfeedback_decl &x);
    bool assign_location(struct gl_context *ctx,
                         struct gl_shader_program *prog);
    unsigned get_num_outputs() const;
@@ -77,6 +77,7 @@
 #include "ir_optimization.h"
 #include "ir_rvalue_visitor.h"
 #include "ir_uniform.h"
+#include "util/hash_table.h"
 
 #include "main/shaderobj.h"
 #include "main/enums.h"
@@ -1174,6 +1175,10 @@ interstage_cross_validate_uniform_blocks(struct gl_shader_program *prog)
 	 max_num_uniform_blocks += prog->_LinkedShaders[i]->NumBufferInterfaceBlocks;
    }
 
+   struct hash_table *linked_block_names =
+      _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                              _mesa_key_string_equal);
+
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
       struct gl_shader *sh = prog->_LinkedShaders[i];
 
@@ -1189,11 +1194,13 @@ interstage_cross_validate_uniform_blocks(struct gl_shader_program *prog)
 	 int index = link_cross_validate_uniform_block(prog,
 						       &prog->BufferInterfaceBlocks,
 						       &prog->NumBufferInterfaceBlocks,
+						       linked_block_names,
 						       &sh->BufferInterfaceBlocks[j]);
 
 	 if (index == -1) {
 	    linker_error(prog, "uniform block `%s' has mismatching definitions\n",
 			 sh->BufferInterfaceBlocks[j].Name);
+	    _mesa_hash_table_destroy(linked_block_names, NULL);
 	    return false;
 	 }
 
@@ -1201,6 +1208,7 @@ interstage_cross_validate_uniform_blocks(struct gl_shader_program *prog)
       }
    }
 
+   _mesa_hash_table_destroy(linked_block_names, NULL);
    return true;
 }
 
@@ -2122,7 +2130,9 @@ link_intrastage_shaders(void *mem_ctx,
          memcpy(linking_shaders, shader_list, num_shaders * sizeof(gl_shader *));
          linking_shaders[num_shaders] = _mesa_glsl_get_builtin_function_shader();
 
+         _mesa_glsl_lock_builtin_functions();
          ok = link_function_calls(prog, linked, linking_shaders, num_shaders + 1);
+         _mesa_glsl_unlock_builtin_functions();
 
          free(linking_shaders);
       } else {
@@ -4160,10 +4170,16 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
          lower_tess_level(prog->_LinkedShaders[i]);
       }
 
-      while (do_common_optimization(prog->_LinkedShaders[i]->ir, true, false,
-                                    &ctx->Const.ShaderCompilerOptions[i],
-                                    ctx->Const.NativeIntegers))
-	 ;
+      char *stats_name = NULL;
+      if (ctx->Shader.Flags & GLSL_STATS) {
+         stats_name = ralloc_asprintf(mem_ctx, "%s shader of program %u",
+                                      _mesa_shader_stage_to_string(i),
+                                      prog->Name);
+      }
+
+      do_common_optimization_loop(prog->_LinkedShaders[i]->ir, true, false,
+                                  &ctx->Const.ShaderCompilerOptions[i],
+                                  ctx->Const.NativeIntegers, stats_name);
 
       lower_const_arrays_to_uniforms(prog->_LinkedShaders[i]->ir);
    }
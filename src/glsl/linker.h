@@ -45,6 +45,7 @@ extern int
 link_cross_validate_uniform_block(void *mem_ctx,
 				  struct gl_uniform_block **linked_blocks,
 				  unsigned int *num_linked_blocks,
+				  struct hash_table *linked_block_names,
 				  struct gl_uniform_block *new_block);
 
 extern bool
@@ -26,6 +26,7 @@
 #include "glsl_parser_extras.h"
 #include "glsl_types.h"
 #include "util/hash_table.h"
+#include "util/blob.h"
 
 
 mtx_t glsl_type::mutex = _MTX_INITIALIZER_NP;
@@ -1743,3 +1744,185 @@ glsl_type::coordinate_components() const
 
 #include "builtin_type_macros.h"
 /** @} */
+
+
+/* Type tag for a NULL type; everything else is written as base_type + 1. */
+#define NULL_TYPE_TAG 0
+
+/**
+ * Look up one of the built-in types that has no instance factory
+ * (images, atomic counters, void) by name.
+ */
+static const glsl_type *
+builtin_type_by_name(const char *name)
+{
+   static const glsl_type *const types[] = {
+#undef DECL_TYPE
+#undef STRUCT_TYPE
+#define DECL_TYPE(NAME, ...) glsl_type::NAME##_type,
+#define STRUCT_TYPE(NAME)
+#include "builtin_type_macros.h"
+   };
+
+   for (unsigned i = 0; i < ARRAY_SIZE(types); i++) {
+      if (strcmp(types[i]->name, name) == 0)
+         return types[i];
+   }
+
+   return NULL;
+}
+
+void
+encode_type_to_blob(struct blob *blob, const glsl_type *type)
+{
+   if (type == NULL) {
+      blob_write_uint32(blob, NULL_TYPE_TAG);
+      return;
+   }
+
+   blob_write_uint32(blob, type->base_type + 1);
+
+   switch (type->base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_DOUBLE:
+   case GLSL_TYPE_BOOL:
+      blob_write_uint32(blob, type->vector_elements);
+      blob_write_uint32(blob, type->matrix_columns);
+      break;
+   case GLSL_TYPE_SAMPLER:
+      blob_write_uint32(blob, type->sampler_dimensionality);
+      blob_write_uint32(blob, type->sampler_shadow);
+      blob_write_uint32(blob, type->sampler_array);
+      blob_write_uint32(blob, type->sampler_type);
+      break;
+   case GLSL_TYPE_IMAGE:
+   case GLSL_TYPE_ATOMIC_UINT:
+   case GLSL_TYPE_VOID:
+   case GLSL_TYPE_ERROR:
+   case GLSL_TYPE_SUBROUTINE:
+      blob_write_string(blob, type->name);
+      break;
+   case GLSL_TYPE_ARRAY:
+      encode_type_to_blob(blob, type->fields.array);
+      blob_write_uint32(blob, type->length);
+      break;
+   case GLSL_TYPE_STRUCT:
+   case GLSL_TYPE_INTERFACE:
+      blob_write_string(blob, type->name);
+      blob_write_uint32(blob, type->length);
+      blob_write_uint32(blob, type->interface_packing);
+      for (unsigned i = 0; i < type->length; i++) {
+         const glsl_struct_field *field = &type->fields.structure[i];
+
+         blob_write_bytes(blob, field, sizeof(*field));
+         encode_type_to_blob(blob, field->type);
+         blob_write_string(blob, field->name);
+      }
+      break;
+   }
+}
+
+const glsl_type *
+decode_type_from_blob(struct blob_reader *blob)
+{
+   const uint32_t tag = blob_read_uint32(blob);
+
+   if (tag == NULL_TYPE_TAG || blob->overrun)
+      return NULL;
+
+   if (tag > GLSL_TYPE_ERROR + 1) {
+      blob->overrun = true;
+      return NULL;
+   }
+
+   const glsl_base_type base_type = (glsl_base_type) (tag - 1);
+   const glsl_type *type = NULL;
+
+   switch (base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_DOUBLE:
+   case GLSL_TYPE_BOOL: {
+      const unsigned rows = blob_read_uint32(blob);
+      const unsigned columns = blob_read_uint32(blob);
+      type = glsl_type::get_instance(base_type, rows, columns);
+      break;
+   }
+   case GLSL_TYPE_SAMPLER: {
+      const unsigned dim = blob_read_uint32(blob);
+      const unsigned shadow = blob_read_uint32(blob);
+      const unsigned array = blob_read_uint32(blob);
+      const unsigned sampled_type = blob_read_uint32(blob);
+      type = glsl_type::get_sampler_instance((glsl_sampler_dim) dim,
+                                             shadow, array,
+                                             (glsl_base_type) sampled_type);
+      break;
+   }
+   case GLSL_TYPE_IMAGE:
+   case GLSL_TYPE_ATOMIC_UINT:
+   case GLSL_TYPE_VOID:
+   case GLSL_TYPE_ERROR: {
+      const char *name = blob_read_string(blob);
+      if (name != NULL)
+         type = builtin_type_by_name(name);
+      break;
+   }
+   case GLSL_TYPE_SUBROUTINE: {
+      const char *name = blob_read_string(blob);
+      if (name != NULL)
+         type = glsl_type::get_subroutine_instance(name);
+      break;
+   }
+   case GLSL_TYPE_ARRAY: {
+      const glsl_type *element = decode_type_from_blob(blob);
+      const unsigned length = blob_read_uint32(blob);
+      if (element != NULL)
+         type = glsl_type::get_array_instance(element, length);
+      break;
+   }
+   case GLSL_TYPE_STRUCT:
+   case GLSL_TYPE_INTERFACE: {
+      const char *name = blob_read_string(blob);
+      const unsigned length = blob_read_uint32(blob);
+      const unsigned packing = blob_read_uint32(blob);
+
+      /* Every field takes up more than a byte, so this rejects absurd
+       * lengths before allocating anything.
+       */
+      if (blob->overrun || length > (size_t) (blob->end - blob->current))
+         break;
+
+      glsl_struct_field *fields = (glsl_struct_field *)
+         malloc(sizeof(glsl_struct_field) * MAX2(length, 1));
+      if (fields == NULL)
+         break;
+
+      bool ok = true;
+      for (unsigned i = 0; i < length && ok; i++) {
+         blob_copy_bytes(blob, (uint8_t *) &fields[i], sizeof(fields[i]));
+         fields[i].type = decode_type_from_blob(blob);
+         fields[i].name = blob_read_string(blob);
+         ok = fields[i].type != NULL && !blob->overrun;
+      }
+
+      if (ok && base_type == GLSL_TYPE_STRUCT)
+         type = glsl_type::get_record_instance(fields, length, name);
+      else if (ok)
+         type = glsl_type::get_interface_instance(fields, length,
+                                                  (glsl_interface_packing) packing,
+                                                  name);
+      free(fields);
+      break;
+   }
+   }
+
+   if (type == NULL || blob->overrun) {
+      blob->overrun = true;
+      return NULL;
+   }
+
+   return type;
+}
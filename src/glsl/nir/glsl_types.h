@@ -35,6 +35,9 @@ extern "C" {
 
 struct _mesa_glsl_parse_state;
 struct glsl_symbol_table;
+struct glsl_type;
+struct blob;
+struct blob_reader;
 
 extern void
 _mesa_glsl_initialize_types(struct _mesa_glsl_parse_state *state);
@@ -42,6 +45,20 @@ _mesa_glsl_initialize_types(struct _mesa_glsl_parse_state *state);
 extern void
 _mesa_glsl_release_types(void);
 
+/**
+ * Writes a type to \p blob by value, so that it can be looked up again by
+ * decode_type_from_blob() in another process running the same build.
+ */
+extern void
+encode_type_to_blob(struct blob *blob, const struct glsl_type *type);
+
+/**
+ * Reads back a type written by encode_type_to_blob().  Malformed input sets
+ * blob->overrun and returns NULL.
+ */
+extern const struct glsl_type *
+decode_type_from_blob(struct blob_reader *blob);
+
 #ifdef __cplusplus
 }
 #endif
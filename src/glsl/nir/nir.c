@@ -356,6 +356,7 @@ nir_loop_create(void *mem_ctx)
    nir_loop *loop = ralloc(mem_ctx, nir_loop);
 
    cf_init(&loop->cf_node, nir_cf_node_loop);
+   loop->info = NULL;
 
    nir_block *body = nir_block_create(mem_ctx);
    exec_list_make_empty(&loop->body);
@@ -1284,10 +1284,41 @@ nir_if_last_else_node(nir_if *if_stmt)
    return exec_node_data(nir_cf_node, tail, node);
 }
 
+/**
+ * Facts about a loop, computed by nir_loop_analyze_impl()
+ */
+typedef struct {
+   /** number of instructions in the loop, not counting phis and jumps */
+   unsigned num_instructions;
+
+   /** whether the loop contains another loop */
+   bool contains_loop;
+
+   /**
+    * The if statement at the top level of the loop body whose then or else
+    * branch ends in a break, when that break is the only way out of the loop
+    * and the loop has no continues.  NULL otherwise.
+    */
+   nir_if *terminator;
+
+   /** whether the break is in the then branch of the terminator */
+   bool break_in_then;
+
+   /**
+    * Number of times the whole loop body runs before the terminator's
+    * break is taken, or -1 if that isn't known at compile time.  The code
+    * in the loop body before the terminator runs one more time than this.
+    */
+   int trip_count;
+} nir_loop_info;
+
 typedef struct {
    nir_cf_node cf_node;
 
    struct exec_list body; /** < list of nir_cf_node */
+
+   /** only valid while nir_metadata_loop_analysis is */
+   nir_loop_info *info;
 } nir_loop;
 
 static inline nir_cf_node *
@@ -1311,6 +1342,7 @@ typedef enum {
    nir_metadata_block_index = 0x1,
    nir_metadata_dominance = 0x2,
    nir_metadata_live_variables = 0x4,
+   nir_metadata_loop_analysis = 0x8,
 } nir_metadata;
 
 typedef struct {
@@ -1954,6 +1986,8 @@ bool nir_normalize_cubemap_coords(nir_shader *shader);
 void nir_live_variables_impl(nir_function_impl *impl);
 bool nir_ssa_defs_interfere(nir_ssa_def *a, nir_ssa_def *b);
 
+void nir_loop_analyze_impl(nir_function_impl *impl);
+
 void nir_convert_to_ssa_impl(nir_function_impl *impl);
 void nir_convert_to_ssa(nir_shader *shader);
 
@@ -1981,6 +2015,8 @@ bool nir_opt_dead_cf(nir_shader *shader);
 
 void nir_opt_gcm(nir_shader *shader);
 
+bool nir_opt_loop_unroll(nir_shader *shader);
+
 bool nir_opt_peephole_select(nir_shader *shader);
 bool nir_opt_peephole_ffma(nir_shader *shader);
 
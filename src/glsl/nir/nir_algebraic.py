@@ -29,6 +29,7 @@ import struct
 import sys
 import mako.template
 import re
+from nir_opcodes import opcodes
 
 # Represents a set of variables, each with a unique id
 class VarSet(object):
@@ -177,6 +178,102 @@ class SearchAndReplace(object):
       else:
          self.replace = Value.create(replace, "replace{0}".format(self.id), varset)
 
+class TreeAutomaton(object):
+   """Bottom-up tree automaton that finds the candidate transforms for an
+   instruction in a single pass over the shader.
+
+   Every distinct search expression (including sub-expressions) is an item.
+   Variables and constants are treated as wildcards; the full matcher in
+   nir_search.c still checks them.  The state of an SSA value is the set of
+   items whose opcode structure it matches, and it is computed from the
+   opcode of its instruction and the states of its sources through
+   per-opcode transition tables.  To keep those tables small, the states of
+   the sources are first mapped ("filtered") to the subset of items that can
+   appear as a source of an expression with that opcode.
+   """
+   def __init__(self, transforms):
+      self.items = {}
+      self.opcode_items = {}
+      self.xform_items = [self._add_item(xform.search) for xform in transforms]
+
+      self._build()
+
+   def _add_item(self, value):
+      if not isinstance(value, Expression):
+         return None
+
+      srcs = tuple(self._add_item(src) for src in value.sources)
+      item = (value.opcode, srcs)
+      if item not in self.items:
+         self.items[item] = len(self.items)
+         self.opcode_items.setdefault(value.opcode, []).append(item)
+      return self.items[item]
+
+   @staticmethod
+   def _srcs_match(srcs, states):
+      return all(src is None or src in state
+                 for (src, state) in zip(srcs, states))
+
+   def _item_matches(self, item, states):
+      opcode, srcs = item
+      if self._srcs_match(srcs, states):
+         return True
+      return ('commutative' in opcodes[opcode].algebraic_properties and
+              self._srcs_match(srcs, states[::-1]))
+
+   def _build(self):
+      self.states = [frozenset()]
+      state_index = {frozenset(): 0}
+
+      # Source items of each opcode; everything else is filtered out.
+      relevant = {}
+      for opcode, items in self.opcode_items.items():
+         relevant[opcode] = frozenset(src for item in items
+                                      for src in item[1] if src is not None)
+
+      changed = True
+      while changed:
+         changed = False
+         self.filters = {}
+         self.tables = {}
+
+         for opcode in sorted(self.opcode_items.keys()):
+            num_inputs = opcodes[opcode].num_inputs
+            classes = {}
+            class_sets = []
+            state_filter = []
+            for state in self.states:
+               filtered = state & relevant[opcode]
+               if filtered not in classes:
+                  classes[filtered] = len(class_sets)
+                  class_sets.append(filtered)
+               state_filter.append(classes[filtered])
+
+            # Source 0 is the least significant digit of the table index.
+            table = []
+            for digits in itertools.product(range(len(class_sets)),
+                                            repeat=num_inputs):
+               src_states = [class_sets[d] for d in reversed(digits)]
+               result = frozenset(self.items[item]
+                                  for item in self.opcode_items[opcode]
+                                  if self._item_matches(item, src_states))
+               if result not in state_index:
+                  state_index[result] = len(self.states)
+                  self.states.append(result)
+                  changed = True
+               table.append(state_index[result])
+
+            self.filters[opcode] = (len(class_sets), state_filter)
+            self.tables[opcode] = table
+
+      # The largest value is reserved for NIR_SEARCH_STATE_UNKNOWN.
+      assert len(self.states) < (1 << 16) - 1
+
+      # The transforms to try for each state, in their original order.
+      self.state_xforms = [[i for (i, item) in enumerate(self.xform_items)
+                            if item in state]
+                           for state in self.states]
+
 _algebraic_pass_template = mako.template.Template("""
 #include "nir.h"
 #include "nir_search.h"
@@ -194,22 +291,60 @@ struct opt_state {
    void *mem_ctx;
    bool progress;
    const bool *condition_flags;
+   uint16_t *states;
+   unsigned num_states;
 };
 
 #endif
 
-% for (opcode, xform_list) in xform_dict.iteritems():
-% for xform in xform_list:
+% for xform in xforms:
    ${xform.search.render()}
    ${xform.replace.render()}
 % endfor
 
-static const struct transform ${pass_name}_${opcode}_xforms[] = {
-% for xform in xform_list:
+static const struct transform ${pass_name}_xforms[] = {
+% for xform in xforms:
    { &${xform.search.name}, ${xform.replace.c_ptr}, ${xform.condition_index} },
 % endfor
 };
+
+/* ${len(automaton.states)} automaton states */
+% for opcode in sorted(automaton.filters.keys()):
+static const uint16_t ${pass_name}_${opcode}_filter[] = {
+   ${', '.join(str(c) for c in automaton.filters[opcode][1])}
+};
+
+static const uint16_t ${pass_name}_${opcode}_table[] = {
+   ${', '.join(str(s) for s in automaton.tables[opcode])}
+};
+
 % endfor
+static const nir_search_op_table ${pass_name}_op_tables[nir_num_opcodes] = {
+% for opcode in sorted(automaton.filters.keys()):
+   [nir_op_${opcode}] = {
+      ${pass_name}_${opcode}_filter,
+      ${automaton.filters[opcode][0]},
+      ${pass_name}_${opcode}_table,
+   },
+% endfor
+};
+
+<% offset = 0 %>
+static const uint16_t ${pass_name}_state_xform_offsets[] = {
+% for xform_list in automaton.state_xforms:
+   ${offset},<% offset += len(xform_list) %>
+% endfor
+   ${offset},
+};
+
+static const uint16_t ${pass_name}_state_xforms[] = {
+% for xform_list in automaton.state_xforms:
+% if xform_list:
+   ${', '.join(str(i) for i in xform_list)},
+% endif
+% endfor
+   0, /* keep the array non-empty */
+};
 
 static bool
 ${pass_name}_block(nir_block *block, void *void_state)
@@ -224,22 +359,22 @@ ${pass_name}_block(nir_block *block, void *void_state)
       if (!alu->dest.dest.is_ssa)
          continue;
 
-      switch (alu->op) {
-      % for opcode in xform_dict.keys():
-      case nir_op_${opcode}:
-         for (unsigned i = 0; i < ARRAY_SIZE(${pass_name}_${opcode}_xforms); i++) {
-            const struct transform *xform = &${pass_name}_${opcode}_xforms[i];
-            if (state->condition_flags[xform->condition_offset] &&
-                nir_replace_instr(alu, xform->search, xform->replace,
-                                  state->mem_ctx)) {
-               state->progress = true;
-               break;
-            }
+      uint16_t xform_state =
+         nir_search_automaton_state(alu, &state->states, &state->num_states,
+                                    ${pass_name}_op_tables);
+      if (alu->dest.dest.ssa.index < state->num_states)
+         state->states[alu->dest.dest.ssa.index] = xform_state;
+
+      for (unsigned i = ${pass_name}_state_xform_offsets[xform_state];
+           i < ${pass_name}_state_xform_offsets[xform_state + 1]; i++) {
+         const struct transform *xform =
+            &${pass_name}_xforms[${pass_name}_state_xforms[i]];
+         if (state->condition_flags[xform->condition_offset] &&
+             nir_replace_instr(alu, xform->search, xform->replace,
+                               state->mem_ctx)) {
+            state->progress = true;
+            break;
          }
-         break;
-      % endfor
-      default:
-         break;
       }
    }
 
@@ -251,12 +386,22 @@ ${pass_name}_impl(nir_function_impl *impl, const bool *condition_flags)
 {
    struct opt_state state;
 
+   /* Automaton states of the SSA values, indexed by nir_ssa_def::index.
+    * Values without a state of their own are in state 0.  Values created by
+    * the replacements are added by nir_search_automaton_state().
+    */
+   nir_index_ssa_defs(impl);
+
    state.mem_ctx = ralloc_parent(impl);
    state.progress = false;
    state.condition_flags = condition_flags;
+   state.num_states = impl->ssa_alloc;
+   state.states = rzalloc_array(NULL, uint16_t, state.num_states + 1);
 
    nir_foreach_block(impl, ${pass_name}_block, &state);
 
+   ralloc_free(state.states);
+
    if (state.progress)
       nir_metadata_preserve(impl, nir_metadata_block_index |
                                   nir_metadata_dominance);
@@ -287,19 +432,19 @@ ${pass_name}(nir_shader *shader)
 
 class AlgebraicPass(object):
    def __init__(self, pass_name, transforms):
-      self.xform_dict = {}
+      self.xforms = []
       self.pass_name = pass_name
 
       for xform in transforms:
          if not isinstance(xform, SearchAndReplace):
             xform = SearchAndReplace(xform)
 
-         if xform.search.opcode not in self.xform_dict:
-            self.xform_dict[xform.search.opcode] = []
+         self.xforms.append(xform)
 
-         self.xform_dict[xform.search.opcode].append(xform)
+      self.automaton = TreeAutomaton(self.xforms)
 
    def render(self):
       return _algebraic_pass_template.render(pass_name=self.pass_name,
-                                             xform_dict=self.xform_dict,
+                                             xforms=self.xforms,
+                                             automaton=self.automaton,
                                              condition_list=condition_list)
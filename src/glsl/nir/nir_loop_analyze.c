@@ -0,0 +1,363 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_constant_expressions.h"
+
+/*
+ * Computes a nir_loop_info for every loop in a function.
+ *
+ * The trip count is only computed for loops with a single exit (see
+ * nir_loop_info::terminator).  Induction variables are the phis at the top
+ * of the loop whose value on entry is a constant.  Starting from those
+ * constants, the terminator's condition and the values the phis take on the
+ * next iteration are evaluated with the constant folding code until the
+ * condition says to break.  Anything the condition depends on other than
+ * induction variables and constants makes the trip count unknown.
+ */
+
+/*
+ * Loops that run longer than this are treated as having an unknown trip
+ * count; nobody would unroll them anyway.
+ */
+#define MAX_SIMULATED_ITERATIONS 1024
+
+/* How deep an expression tree the condition and updates may be. */
+#define MAX_EXPRESSION_DEPTH 8
+
+typedef struct {
+   nir_phi_instr *phi;
+
+   /* the value coming around the back edge */
+   nir_ssa_def *next;
+
+   /* false once the value can no longer be computed */
+   bool valid;
+
+   nir_const_value value;
+   nir_const_value next_value;
+} induction_var;
+
+typedef struct {
+   induction_var *vars;
+   unsigned num_vars;
+} trip_count_state;
+
+typedef struct {
+   nir_loop_info *info;
+
+   unsigned num_exits;
+   nir_jump_instr *exit;
+} scan_state;
+
+static void
+scan_cf_list(struct exec_list *list, scan_state *state, bool nested);
+
+static void
+scan_block(nir_block *block, scan_state *state, bool nested)
+{
+   nir_foreach_instr(block, instr) {
+      if (instr->type == nir_instr_type_phi)
+         continue;
+
+      if (instr->type != nir_instr_type_jump) {
+         state->info->num_instructions++;
+         continue;
+      }
+
+      /* Breaks and continues in a nested loop stay inside of it. */
+      nir_jump_instr *jump = nir_instr_as_jump(instr);
+      if (nested && jump->type != nir_jump_return)
+         continue;
+
+      state->num_exits++;
+      state->exit = jump;
+   }
+}
+
+static void
+scan_cf_list(struct exec_list *list, scan_state *state, bool nested)
+{
+   foreach_list_typed(nir_cf_node, node, node, list) {
+      switch (node->type) {
+      case nir_cf_node_block:
+         scan_block(nir_cf_node_as_block(node), state, nested);
+         break;
+
+      case nir_cf_node_if: {
+         nir_if *if_stmt = nir_cf_node_as_if(node);
+         scan_cf_list(&if_stmt->then_list, state, nested);
+         scan_cf_list(&if_stmt->else_list, state, nested);
+         break;
+      }
+
+      case nir_cf_node_loop:
+         state->info->contains_loop = true;
+         scan_cf_list(&nir_cf_node_as_loop(node)->body, state, true);
+         break;
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+}
+
+static nir_if *
+find_terminator(nir_loop *loop, nir_jump_instr *exit, bool *break_in_then)
+{
+   if (exit->type != nir_jump_break)
+      return NULL;
+
+   nir_cf_node *block = &exit->instr.block->cf_node;
+   nir_cf_node *parent = block->parent;
+   if (parent->type != nir_cf_node_if || parent->parent != &loop->cf_node)
+      return NULL;
+
+   nir_if *if_stmt = nir_cf_node_as_if(parent);
+   if (block == nir_if_last_then_node(if_stmt))
+      *break_in_then = true;
+   else if (block == nir_if_last_else_node(if_stmt))
+      *break_in_then = false;
+   else
+      return NULL;
+
+   return if_stmt;
+}
+
+static induction_var *
+get_induction_var(trip_count_state *state, nir_ssa_def *def)
+{
+   for (unsigned i = 0; i < state->num_vars; i++) {
+      if (&state->vars[i].phi->dest.ssa == def)
+         return &state->vars[i];
+   }
+
+   return NULL;
+}
+
+/*
+ * Computes one component of \p def from the current values of the induction
+ * variables.
+ */
+static bool
+eval_component(trip_count_state *state, nir_ssa_def *def, unsigned comp,
+               unsigned depth, uint32_t *value)
+{
+   if (depth > MAX_EXPRESSION_DEPTH)
+      return false;
+
+   nir_instr *instr = def->parent_instr;
+   switch (instr->type) {
+   case nir_instr_type_load_const:
+      *value = nir_instr_as_load_const(instr)->value.u[comp];
+      return true;
+
+   case nir_instr_type_phi: {
+      induction_var *var = get_induction_var(state, def);
+      if (var == NULL || !var->valid)
+         return false;
+
+      *value = var->value.u[comp];
+      return true;
+   }
+
+   case nir_instr_type_alu: {
+      nir_alu_instr *alu = nir_instr_as_alu(instr);
+      const nir_op_info *info = &nir_op_infos[alu->op];
+
+      if (info->output_size != 0 || alu->dest.saturate)
+         return false;
+
+      nir_const_value src[4];
+      for (unsigned i = 0; i < info->num_inputs; i++) {
+         if (info->input_sizes[i] != 0 || !alu->src[i].src.is_ssa ||
+             alu->src[i].abs || alu->src[i].negate)
+            return false;
+
+         if (!eval_component(state, alu->src[i].src.ssa,
+                             alu->src[i].swizzle[comp], depth + 1,
+                             &src[i].u[0]))
+            return false;
+      }
+
+      *value = nir_eval_const_opcode(alu->op, 1, src).u[0];
+      return true;
+   }
+
+   default:
+      return false;
+   }
+}
+
+static bool
+find_induction_vars(trip_count_state *state, nir_loop *loop, void *mem_ctx)
+{
+   nir_block *preheader =
+      nir_cf_node_as_block(nir_cf_node_prev(&loop->cf_node));
+   nir_block *header = nir_cf_node_as_block(nir_loop_first_cf_node(loop));
+
+   unsigned num_phis = 0;
+   nir_foreach_instr(header, instr) {
+      if (instr->type != nir_instr_type_phi)
+         break;
+      num_phis++;
+   }
+
+   state->vars = ralloc_array(mem_ctx, induction_var, num_phis);
+   state->num_vars = 0;
+
+   nir_foreach_instr(header, instr) {
+      if (instr->type != nir_instr_type_phi)
+         break;
+
+      nir_phi_instr *phi = nir_instr_as_phi(instr);
+      if (!phi->dest.is_ssa)
+         continue;
+
+      nir_const_value *init = NULL;
+      nir_ssa_def *next = NULL;
+      unsigned num_srcs = 0;
+      nir_foreach_phi_src(phi, src) {
+         num_srcs++;
+         if (!src->src.is_ssa)
+            continue;
+
+         if (src->pred == preheader)
+            init = nir_src_as_const_value(src->src);
+         else
+            next = src->src.ssa;
+      }
+
+      if (num_srcs != 2 || init == NULL || next == NULL)
+         continue;
+
+      induction_var *var = &state->vars[state->num_vars++];
+      var->phi = phi;
+      var->next = next;
+      var->valid = true;
+      var->value = *init;
+   }
+
+   return state->num_vars > 0;
+}
+
+static int
+compute_trip_count(nir_loop *loop, nir_loop_info *info)
+{
+   nir_if *terminator = info->terminator;
+   if (!terminator->condition.is_ssa)
+      return -1;
+
+   void *mem_ctx = ralloc_context(NULL);
+   trip_count_state state;
+   int trip_count = -1;
+
+   if (!find_induction_vars(&state, loop, mem_ctx))
+      goto done;
+
+   for (int i = 0; i <= MAX_SIMULATED_ITERATIONS; i++) {
+      uint32_t condition;
+      if (!eval_component(&state, terminator->condition.ssa, 0, 0,
+                          &condition))
+         break;
+
+      if ((condition != 0) == info->break_in_then) {
+         trip_count = i;
+         break;
+      }
+
+      /* All the phis take on their new values at once. */
+      for (unsigned j = 0; j < state.num_vars; j++) {
+         induction_var *var = &state.vars[j];
+         for (unsigned c = 0; c < var->phi->dest.ssa.num_components; c++) {
+            if (var->valid &&
+                !eval_component(&state, var->next, c, 0,
+                                &var->next_value.u[c]))
+               var->valid = false;
+         }
+      }
+
+      for (unsigned j = 0; j < state.num_vars; j++)
+         state.vars[j].value = state.vars[j].next_value;
+   }
+
+done:
+   ralloc_free(mem_ctx);
+   return trip_count;
+}
+
+static void
+analyze_loop(nir_loop *loop)
+{
+   ralloc_free(loop->info);
+   loop->info = rzalloc(loop, nir_loop_info);
+
+   nir_loop_info *info = loop->info;
+   info->trip_count = -1;
+
+   scan_state state = { info, 0, NULL };
+   scan_cf_list(&loop->body, &state, false);
+
+   if (state.num_exits != 1)
+      return;
+
+   info->terminator = find_terminator(loop, state.exit, &info->break_in_then);
+   if (info->terminator == NULL)
+      return;
+
+   info->trip_count = compute_trip_count(loop, info);
+}
+
+static void
+analyze_cf_list(struct exec_list *list)
+{
+   foreach_list_typed(nir_cf_node, node, node, list) {
+      switch (node->type) {
+      case nir_cf_node_block:
+         break;
+
+      case nir_cf_node_if: {
+         nir_if *if_stmt = nir_cf_node_as_if(node);
+         analyze_cf_list(&if_stmt->then_list);
+         analyze_cf_list(&if_stmt->else_list);
+         break;
+      }
+
+      case nir_cf_node_loop: {
+         nir_loop *loop = nir_cf_node_as_loop(node);
+         analyze_cf_list(&loop->body);
+         analyze_loop(loop);
+         break;
+      }
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+}
+
+void
+nir_loop_analyze_impl(nir_function_impl *impl)
+{
+   analyze_cf_list(&impl->body);
+}
@@ -0,0 +1,622 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_control_flow.h"
+#include "util/hash_table.h"
+
+/*
+ * Unrolls loops whose trip count is known at compile time.
+ *
+ * This only handles loops in SSA form that nir_loop_analyze_impl() found a
+ * terminator for.  Such a loop looks like
+ *
+ * loop {
+ *    pre
+ *    if (cond) {
+ *       exit
+ *       break;
+ *    } else {
+ *       continue_path
+ *    }
+ *    post
+ * }
+ *
+ * where the break may also be in the else branch.  With a trip count of n it
+ * is replaced by n copies of "pre continue_path post" followed by
+ * "pre exit".  The loop header's phis become the values from before the loop
+ * in the first copy and the values from the end of the previous copy in the
+ * others; phis after the loop, and any other use of a loop value after the
+ * loop, become the values from the last copy.
+ */
+
+/*
+ * Unrolling is a trade of code size for fewer jumps and more optimization
+ * opportunities, so only do it for short loops that stay small.
+ */
+#define MAX_UNROLL_ITERATIONS 32
+#define MAX_UNROLLED_INSTRUCTIONS 512
+
+typedef struct {
+   nir_builder b;
+
+   nir_loop *loop;
+
+   /* The block after the terminator, whose phis have only one source. */
+   nir_block *terminator_join;
+
+   /* Old SSA defs and blocks to their copies in the current iteration. */
+   struct hash_table *remap;
+} unroll_state;
+
+static bool
+src_is_ssa(nir_src *src, void *state)
+{
+   return src->is_ssa;
+}
+
+static bool
+dest_is_ssa(nir_dest *dest, void *state)
+{
+   return dest->is_ssa;
+}
+
+static bool
+block_can_be_cloned(nir_block *block, void *state)
+{
+   nir_foreach_instr(block, instr) {
+      switch (instr->type) {
+      case nir_instr_type_alu:
+      case nir_instr_type_intrinsic:
+      case nir_instr_type_tex:
+      case nir_instr_type_load_const:
+      case nir_instr_type_ssa_undef:
+      case nir_instr_type_phi:
+      case nir_instr_type_jump:
+         break;
+      default:
+         return false;
+      }
+
+      if (!nir_foreach_src(instr, src_is_ssa, NULL) ||
+          !nir_foreach_dest(instr, dest_is_ssa, NULL))
+         return false;
+   }
+
+   nir_if *following_if = nir_block_get_following_if(block);
+   if (following_if && !following_if->condition.is_ssa)
+      return false;
+
+   return true;
+}
+
+static bool
+should_unroll(nir_loop *loop)
+{
+   nir_loop_info *info = loop->info;
+
+   if (info->terminator == NULL || info->contains_loop ||
+       info->trip_count < 0 || info->trip_count > MAX_UNROLL_ITERATIONS)
+      return false;
+
+   if ((info->trip_count + 1) * info->num_instructions >
+       MAX_UNROLLED_INSTRUCTIONS)
+      return false;
+
+   /* The copies go at the end of the block before the loop. */
+   nir_block *preheader =
+      nir_cf_node_as_block(nir_cf_node_prev(&loop->cf_node));
+   if (!exec_list_is_empty(&preheader->instr_list) &&
+       nir_block_last_instr(preheader)->type == nir_instr_type_jump)
+      return false;
+
+   return nir_foreach_block_in_cf_node(&loop->cf_node, block_can_be_cloned,
+                                       NULL);
+}
+
+static nir_ssa_def *
+remap_ssa(unroll_state *state, nir_ssa_def *def)
+{
+   struct hash_entry *entry = _mesa_hash_table_search(state->remap, def);
+   return entry ? entry->data : def;
+}
+
+static nir_block *
+cursor_block(nir_cursor cursor)
+{
+   switch (cursor.option) {
+   case nir_cursor_before_block:
+   case nir_cursor_after_block:
+      return cursor.block;
+   case nir_cursor_before_instr:
+   case nir_cursor_after_instr:
+      return cursor.instr->block;
+   default:
+      unreachable("Invalid cursor option");
+   }
+}
+
+static bool
+remap_src(nir_src *src, void *void_state)
+{
+   unroll_state *state = void_state;
+
+   src->ssa = remap_ssa(state, src->ssa);
+   return true;
+}
+
+static nir_deref_var *
+clone_deref_var(void *mem_ctx, nir_deref_var *deref)
+{
+   if (deref == NULL)
+      return NULL;
+
+   return nir_deref_as_var(nir_copy_deref(mem_ctx, &deref->deref));
+}
+
+static void
+clone_ssa_dest(nir_instr *instr, nir_dest *dest, const nir_dest *old)
+{
+   nir_ssa_dest_init(instr, dest, old->ssa.num_components, old->ssa.name);
+}
+
+/*
+ * Makes a copy of \p old whose sources are not remapped yet and whose
+ * destination is a fresh SSA value.
+ */
+static nir_instr *
+clone_instr(nir_shader *shader, nir_instr *old)
+{
+   switch (old->type) {
+   case nir_instr_type_alu: {
+      nir_alu_instr *alu = nir_instr_as_alu(old);
+      nir_alu_instr *clone = nir_alu_instr_create(shader, alu->op);
+
+      clone->dest.saturate = alu->dest.saturate;
+      clone->dest.write_mask = alu->dest.write_mask;
+      clone_ssa_dest(&clone->instr, &clone->dest.dest, &alu->dest.dest);
+
+      for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++)
+         nir_alu_src_copy(&clone->src[i], &alu->src[i], clone);
+
+      return &clone->instr;
+   }
+
+   case nir_instr_type_intrinsic: {
+      nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(old);
+      const nir_intrinsic_info *info = &nir_intrinsic_infos[intrin->intrinsic];
+      nir_intrinsic_instr *clone =
+         nir_intrinsic_instr_create(shader, intrin->intrinsic);
+
+      clone->num_components = intrin->num_components;
+      memcpy(clone->const_index, intrin->const_index,
+             sizeof(clone->const_index));
+
+      if (info->has_dest)
+         clone_ssa_dest(&clone->instr, &clone->dest, &intrin->dest);
+
+      for (unsigned i = 0; i < info->num_variables; i++)
+         clone->variables[i] = clone_deref_var(clone, intrin->variables[i]);
+
+      for (unsigned i = 0; i < info->num_srcs; i++)
+         nir_src_copy(&clone->src[i], &intrin->src[i], clone);
+
+      return &clone->instr;
+   }
+
+   case nir_instr_type_tex: {
+      nir_tex_instr *tex = nir_instr_as_tex(old);
+      nir_tex_instr *clone = nir_tex_instr_create(shader, tex->num_srcs);
+
+      clone->sampler_dim = tex->sampler_dim;
+      clone->dest_type = tex->dest_type;
+      clone->op = tex->op;
+      clone->coord_components = tex->coord_components;
+      clone->is_array = tex->is_array;
+      clone->is_shadow = tex->is_shadow;
+      clone->is_new_style_shadow = tex->is_new_style_shadow;
+      memcpy(clone->const_offset, tex->const_offset,
+             sizeof(clone->const_offset));
+      clone->component = tex->component;
+      clone->sampler_index = tex->sampler_index;
+      clone->sampler_array_size = tex->sampler_array_size;
+      clone->sampler = clone_deref_var(clone, tex->sampler);
+
+      clone_ssa_dest(&clone->instr, &clone->dest, &tex->dest);
+
+      for (unsigned i = 0; i < tex->num_srcs; i++) {
+         clone->src[i].src_type = tex->src[i].src_type;
+         nir_src_copy(&clone->src[i].src, &tex->src[i].src, clone);
+      }
+
+      return &clone->instr;
+   }
+
+   case nir_instr_type_load_const: {
+      nir_load_const_instr *load = nir_instr_as_load_const(old);
+      nir_load_const_instr *clone =
+         nir_load_const_instr_create(shader, load->def.num_components);
+
+      clone->value = load->value;
+      clone->def.name = load->def.name;
+
+      return &clone->instr;
+   }
+
+   case nir_instr_type_ssa_undef: {
+      nir_ssa_undef_instr *undef = nir_instr_as_ssa_undef(old);
+      nir_ssa_undef_instr *clone =
+         nir_ssa_undef_instr_create(shader, undef->def.num_components);
+
+      clone->def.name = undef->def.name;
+
+      return &clone->instr;
+   }
+
+   default:
+      unreachable("Instruction type should have been rejected");
+   }
+}
+
+static nir_ssa_def *
+instr_ssa_def(nir_instr *instr)
+{
+   switch (instr->type) {
+   case nir_instr_type_alu:
+      return &nir_instr_as_alu(instr)->dest.dest.ssa;
+   case nir_instr_type_intrinsic: {
+      nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+      if (!nir_intrinsic_infos[intrin->intrinsic].has_dest)
+         return NULL;
+      return &intrin->dest.ssa;
+   }
+   case nir_instr_type_tex:
+      return &nir_instr_as_tex(instr)->dest.ssa;
+   case nir_instr_type_load_const:
+      return &nir_instr_as_load_const(instr)->def;
+   case nir_instr_type_ssa_undef:
+      return &nir_instr_as_ssa_undef(instr)->def;
+   default:
+      return NULL;
+   }
+}
+
+static void
+clone_phi(unroll_state *state, nir_phi_instr *phi)
+{
+   nir_phi_instr *clone = nir_phi_instr_create(state->b.shader);
+   clone_ssa_dest(&clone->instr, &clone->dest, &phi->dest);
+
+   nir_foreach_phi_src(phi, src) {
+      struct hash_entry *entry =
+         _mesa_hash_table_search(state->remap, src->pred);
+      assert(entry);
+
+      nir_phi_src *clone_src = ralloc(clone, nir_phi_src);
+      clone_src->pred = entry->data;
+      clone_src->src = nir_src_for_ssa(remap_ssa(state, src->src.ssa));
+      exec_list_push_tail(&clone->srcs, &clone_src->node);
+   }
+
+   nir_builder_instr_insert(&state->b, &clone->instr);
+   _mesa_hash_table_insert(state->remap, &phi->dest.ssa, &clone->dest.ssa);
+}
+
+static void
+clone_block(unroll_state *state, nir_block *block)
+{
+   nir_block *header = nir_cf_node_as_block(nir_loop_first_cf_node(state->loop));
+
+   nir_foreach_instr(block, instr) {
+      switch (instr->type) {
+      case nir_instr_type_jump:
+         /* The only jump is the break we are getting rid of. */
+         break;
+
+      case nir_instr_type_phi: {
+         nir_phi_instr *phi = nir_instr_as_phi(instr);
+
+         /* The header's phis are taken care of by unroll_loop(). */
+         if (block == header)
+            break;
+
+         /* Only the continue path reaches the block after the terminator. */
+         if (block == state->terminator_join) {
+            assert(exec_list_length(&phi->srcs) == 1);
+            nir_phi_src *src =
+               exec_node_data(nir_phi_src, exec_list_get_head(&phi->srcs),
+                              node);
+            _mesa_hash_table_insert(state->remap, &phi->dest.ssa,
+                                    remap_ssa(state, src->src.ssa));
+            break;
+         }
+
+         clone_phi(state, phi);
+         break;
+      }
+
+      default: {
+         nir_instr *clone = clone_instr(state->b.shader, instr);
+         nir_foreach_src(clone, remap_src, state);
+         nir_builder_instr_insert(&state->b, clone);
+
+         nir_ssa_def *def = instr_ssa_def(instr);
+         if (def)
+            _mesa_hash_table_insert(state->remap, def, instr_ssa_def(clone));
+         break;
+      }
+      }
+   }
+
+   _mesa_hash_table_insert(state->remap, block, cursor_block(state->b.cursor));
+}
+
+static void
+clone_cf_list(unroll_state *state, struct exec_list *list);
+
+static void
+clone_if(unroll_state *state, nir_if *if_stmt)
+{
+   nir_if *clone = nir_if_create(state->b.shader);
+   clone->condition =
+      nir_src_for_ssa(remap_ssa(state, if_stmt->condition.ssa));
+   nir_cf_node_insert(state->b.cursor, &clone->cf_node);
+
+   state->b.cursor = nir_before_cf_list(&clone->then_list);
+   clone_cf_list(state, &if_stmt->then_list);
+
+   state->b.cursor = nir_before_cf_list(&clone->else_list);
+   clone_cf_list(state, &if_stmt->else_list);
+
+   state->b.cursor = nir_after_cf_node(&clone->cf_node);
+}
+
+static void
+clone_cf_node(unroll_state *state, nir_cf_node *node)
+{
+   switch (node->type) {
+   case nir_cf_node_block:
+      clone_block(state, nir_cf_node_as_block(node));
+      break;
+   case nir_cf_node_if:
+      clone_if(state, nir_cf_node_as_if(node));
+      break;
+   default:
+      unreachable("Loops should have been rejected");
+   }
+}
+
+static void
+clone_cf_list(unroll_state *state, struct exec_list *list)
+{
+   foreach_list_typed(nir_cf_node, node, node, list)
+      clone_cf_node(state, node);
+}
+
+static bool
+rewrite_uses_after_loop(nir_ssa_def *def, void *void_state)
+{
+   unroll_state *state = void_state;
+
+   struct hash_entry *entry = _mesa_hash_table_search(state->remap, def);
+   if (entry)
+      nir_ssa_def_rewrite_uses(def, nir_src_for_ssa(entry->data));
+
+   return true;
+}
+
+static bool
+rewrite_block_uses_after_loop(nir_block *block, void *state)
+{
+   nir_foreach_instr(block, instr)
+      nir_foreach_ssa_def(instr, rewrite_uses_after_loop, state);
+
+   return true;
+}
+
+static void
+unroll_loop(nir_function_impl *impl, nir_loop *loop)
+{
+   nir_loop_info *info = loop->info;
+   nir_if *terminator = info->terminator;
+   void *mem_ctx = ralloc_context(NULL);
+
+   unroll_state state;
+   nir_builder_init(&state.b, impl);
+   state.b.cursor = nir_before_cf_node(&loop->cf_node);
+   state.loop = loop;
+   state.terminator_join =
+      nir_cf_node_as_block(nir_cf_node_next(&terminator->cf_node));
+   state.remap = NULL;
+
+   struct exec_list *exit_list, *continue_list;
+   if (info->break_in_then) {
+      exit_list = &terminator->then_list;
+      continue_list = &terminator->else_list;
+   } else {
+      exit_list = &terminator->else_list;
+      continue_list = &terminator->then_list;
+   }
+   nir_block *exit_block = nir_cf_node_as_block(
+      exec_node_data(nir_cf_node, exec_list_get_tail(exit_list), node));
+
+   /* Inserting control flow before the loop replaces the block before it,
+    * so remember the header's sources up front.
+    */
+   nir_block *preheader =
+      nir_cf_node_as_block(nir_cf_node_prev(&loop->cf_node));
+   nir_block *header = nir_cf_node_as_block(nir_loop_first_cf_node(loop));
+
+   unsigned num_phis = 0;
+   nir_foreach_instr(header, instr) {
+      if (instr->type != nir_instr_type_phi)
+         break;
+      num_phis++;
+   }
+
+   nir_phi_instr **phis = ralloc_array(mem_ctx, nir_phi_instr *, num_phis);
+   nir_ssa_def **inits = ralloc_array(mem_ctx, nir_ssa_def *, num_phis);
+   nir_ssa_def **nexts = ralloc_array(mem_ctx, nir_ssa_def *, num_phis);
+
+   num_phis = 0;
+   nir_foreach_instr(header, instr) {
+      if (instr->type != nir_instr_type_phi)
+         break;
+
+      nir_phi_instr *phi = nir_instr_as_phi(instr);
+      phis[num_phis] = phi;
+      nir_foreach_phi_src(phi, src) {
+         if (src->pred == preheader)
+            inits[num_phis] = src->src.ssa;
+         else
+            nexts[num_phis] = src->src.ssa;
+      }
+      num_phis++;
+   }
+
+   for (int i = 0; i <= info->trip_count; i++) {
+      struct hash_table *remap =
+         _mesa_hash_table_create(mem_ctx, _mesa_hash_pointer,
+                                 _mesa_key_pointer_equal);
+
+      for (unsigned j = 0; j < num_phis; j++) {
+         nir_ssa_def *value =
+            i == 0 ? inits[j] : remap_ssa(&state, nexts[j]);
+         _mesa_hash_table_insert(remap, &phis[j]->dest.ssa, value);
+      }
+
+      state.remap = remap;
+
+      for (nir_cf_node *node = nir_loop_first_cf_node(loop);
+           node != &terminator->cf_node; node = nir_cf_node_next(node))
+         clone_cf_node(&state, node);
+
+      if (i == info->trip_count) {
+         clone_cf_list(&state, exit_list);
+         break;
+      }
+
+      clone_cf_list(&state, continue_list);
+
+      for (nir_cf_node *node = nir_cf_node_next(&terminator->cf_node);
+           node != NULL; node = nir_cf_node_next(node))
+         clone_cf_node(&state, node);
+   }
+
+   /* The only way out of the loop is through the exit block. */
+   nir_block *after = nir_cf_node_as_block(nir_cf_node_next(&loop->cf_node));
+   nir_foreach_instr_safe(after, instr) {
+      if (instr->type != nir_instr_type_phi)
+         break;
+
+      nir_phi_instr *phi = nir_instr_as_phi(instr);
+      nir_foreach_phi_src(phi, src) {
+         assert(src->pred == exit_block);
+         assert(src->src.is_ssa);
+         nir_ssa_def_rewrite_uses(&phi->dest.ssa,
+                                  nir_src_for_ssa(remap_ssa(&state,
+                                                            src->src.ssa)));
+      }
+      nir_instr_remove(instr);
+   }
+
+   /* Values from the last partial iteration may be used after the loop. */
+   nir_foreach_block_in_cf_node(&loop->cf_node, rewrite_block_uses_after_loop,
+                                &state);
+
+   nir_cf_node_remove(&loop->cf_node);
+
+   ralloc_free(mem_ctx);
+}
+
+static bool
+unroll_cf_list(nir_function_impl *impl, struct exec_list *list)
+{
+   bool progress = false;
+
+   nir_cf_node *node = exec_node_data(nir_cf_node, exec_list_get_head(list),
+                                      node);
+   while (node != NULL) {
+      switch (node->type) {
+      case nir_cf_node_block:
+         break;
+
+      case nir_cf_node_if: {
+         nir_if *if_stmt = nir_cf_node_as_if(node);
+         progress |= unroll_cf_list(impl, &if_stmt->then_list);
+         progress |= unroll_cf_list(impl, &if_stmt->else_list);
+         break;
+      }
+
+      case nir_cf_node_loop: {
+         nir_loop *loop = nir_cf_node_as_loop(node);
+         progress |= unroll_cf_list(impl, &loop->body);
+
+         if (!should_unroll(loop))
+            break;
+
+         /* Removing the loop merges the blocks around it, so carry on from
+          * the one before.  The unrolled code has no loops left in it.
+          */
+         node = nir_cf_node_prev(&loop->cf_node);
+         unroll_loop(impl, loop);
+         progress = true;
+         break;
+      }
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+
+      node = nir_cf_node_next(node);
+   }
+
+   return progress;
+}
+
+static bool
+opt_loop_unroll_impl(nir_function_impl *impl)
+{
+   nir_metadata_require(impl, nir_metadata_loop_analysis);
+
+   bool progress = unroll_cf_list(impl, &impl->body);
+
+   if (progress)
+      nir_metadata_preserve(impl, nir_metadata_none);
+
+   return progress;
+}
+
+bool
+nir_opt_loop_unroll(nir_shader *shader)
+{
+   bool progress = false;
+
+   nir_foreach_overload(shader, overload) {
+      if (overload->impl)
+         progress |= opt_loop_unroll_impl(overload->impl);
+   }
+
+   return progress;
+}
@@ -334,6 +334,60 @@ construct_value(const nir_search_value *value, nir_alu_type type,
    }
 }
 
+static uint16_t
+src_automaton_state(nir_src src, uint16_t **states, unsigned *num_states,
+                    const nir_search_op_table *op_tables)
+{
+   if (!src.is_ssa)
+      return 0;
+
+   const unsigned index = src.ssa->index;
+
+   if (index >= *num_states) {
+      const unsigned new_size = MAX2(index + 1, *num_states * 2);
+
+      *states = reralloc(ralloc_parent(*states), *states, uint16_t, new_size);
+      for (unsigned i = *num_states; i < new_size; i++)
+         (*states)[i] = NIR_SEARCH_STATE_UNKNOWN;
+      *num_states = new_size;
+   }
+
+   if ((*states)[index] == NIR_SEARCH_STATE_UNKNOWN) {
+      uint16_t state = 0;
+
+      if (src.ssa->parent_instr->type == nir_instr_type_alu) {
+         state = nir_search_automaton_state(
+            nir_instr_as_alu(src.ssa->parent_instr), states, num_states,
+            op_tables);
+      }
+
+      (*states)[index] = state;
+   }
+
+   return (*states)[index];
+}
+
+uint16_t
+nir_search_automaton_state(const nir_alu_instr *instr, uint16_t **states,
+                           unsigned *num_states,
+                           const nir_search_op_table *op_tables)
+{
+   const nir_search_op_table *tbl = &op_tables[instr->op];
+
+   if (tbl->table == NULL)
+      return 0;
+
+   unsigned index = 0, stride = 1;
+   for (unsigned i = 0; i < nir_op_infos[instr->op].num_inputs; i++) {
+      uint16_t src_state = src_automaton_state(instr->src[i].src, states,
+                                               num_states, op_tables);
+      index += tbl->filter[src_state] * stride;
+      stride *= tbl->num_filtered_states;
+   }
+
+   return tbl->table[index];
+}
+
 nir_alu_instr *
 nir_replace_instr(nir_alu_instr *instr, const nir_search_expression *search,
                   const nir_search_value *replace, void *mem_ctx)
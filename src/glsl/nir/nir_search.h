@@ -92,6 +92,32 @@ NIR_DEFINE_CAST(nir_search_value_as_constant, nir_search_value,
 NIR_DEFINE_CAST(nir_search_value_as_expression, nir_search_value,
                 nir_search_expression, value)
 
+/** Transition table of the matching automaton for one opcode */
+typedef struct {
+   /** Maps the state of a source to its class for this opcode */
+   const uint16_t *filter;
+   unsigned num_filtered_states;
+
+   /** Indexed by the classes of the sources, source 0 least significant */
+   const uint16_t *table;
+} nir_search_op_table;
+
+/** Marks SSA values whose automaton state hasn't been computed yet */
+#define NIR_SEARCH_STATE_UNKNOWN 0xffff
+
+/**
+ * Compute the automaton state of \p instr from the states of its sources.
+ *
+ * \p *states is a ralloc'ed array holding the states of the first
+ * \p *num_states SSA values by index.  Values created while optimizing lie
+ * beyond its end; the array is grown to cover them and their states are
+ * computed once, on first use.
+ */
+uint16_t
+nir_search_automaton_state(const nir_alu_instr *instr, uint16_t **states,
+                           unsigned *num_states,
+                           const nir_search_op_table *op_tables);
+
 nir_alu_instr *
 nir_replace_instr(nir_alu_instr *instr, const nir_search_expression *search,
                   const nir_search_value *replace, void *mem_ctx);
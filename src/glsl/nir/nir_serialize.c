@@ -0,0 +1,1273 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir_serialize.h"
+#include "nir_array.h"
+#include "nir_control_flow.h"
+#include "util/hash_table.h"
+
+/*
+ * Binary serialization of NIR.
+ *
+ * Variables, registers, overloads, SSA values and blocks are referred to by
+ * an index.  Variables, registers and overloads are numbered in the order
+ * they are written, and all of them are written before any code.  SSA values
+ * and blocks are numbered per function, in the order nir_foreach_block()
+ * visits them, which is also the order the control flow is written in; the
+ * reader recreates them in the same order and so never needs the index to
+ * be written along with the object.  The only forward references in SSA form
+ * are phi sources, so phis are put into their blocks once the whole function
+ * has been read.
+ *
+ * Plain-old-data structures such as nir_variable_data are copied as raw
+ * bytes, so the layout of the data depends on the build that wrote it and
+ * there is no version in the blob to catch a mismatch.  Anything that keeps
+ * the data across runs has to key it on the build, the way the shader cache
+ * uses build_id_for_address().
+ */
+
+/* Tags for the parameters and return value of a function implementation. */
+#define IMPL_VAR_NULL   0
+#define IMPL_VAR_REF    1
+#define IMPL_VAR_INLINE 2
+
+typedef struct {
+   struct blob *blob;
+
+   /* Maps variables, registers, overloads, SSA values and blocks to their
+    * index.
+    */
+   struct hash_table *remap_table;
+
+   uint32_t next_var;
+   uint32_t next_overload;
+   uint32_t num_global_regs;
+   uint32_t next_reg;
+   uint32_t next_ssa;
+   uint32_t next_block;
+} write_ctx;
+
+typedef struct {
+   nir_phi_instr *phi;
+   nir_block *block;
+   uint32_t num_srcs;
+   uint32_t *srcs; /**< (predecessor block, SSA value) pairs */
+} pending_phi;
+
+typedef struct {
+   struct blob_reader *blob;
+   nir_shader *nir;
+
+   nir_array vars;
+   nir_array overloads;
+   nir_array regs;
+   uint32_t num_global_regs;
+
+   /* Per function implementation. */
+   nir_ssa_def **ssa_defs;
+   uint32_t num_ssa_defs;
+   uint32_t next_ssa;
+   nir_block **blocks;
+   uint32_t num_blocks;
+   uint32_t next_block;
+   nir_array phis;
+} read_ctx;
+
+static void
+write_add_object(write_ctx *ctx, const void *obj, uint32_t index)
+{
+   _mesa_hash_table_insert(ctx->remap_table, obj, (void *)(uintptr_t) index);
+}
+
+static uint32_t
+write_lookup_object(write_ctx *ctx, const void *obj)
+{
+   struct hash_entry *entry = _mesa_hash_table_search(ctx->remap_table, obj);
+   assert(entry);
+   return (uint32_t)(uintptr_t) entry->data;
+}
+
+static void
+write_string(write_ctx *ctx, const char *str)
+{
+   blob_write_uint32(ctx->blob, str != NULL);
+   if (str)
+      blob_write_string(ctx->blob, str);
+}
+
+static const char *
+read_string(read_ctx *ctx)
+{
+   if (!blob_read_uint32(ctx->blob))
+      return NULL;
+
+   const char *str = blob_read_string(ctx->blob);
+   return str ? ralloc_strdup(ctx->nir, str) : NULL;
+}
+
+/*
+ * Reads a count and rejects it if it couldn't possibly fit in what is left of
+ * the blob, so that malformed data can't make us allocate huge arrays.
+ */
+static uint32_t
+read_count(read_ctx *ctx)
+{
+   uint32_t count = blob_read_uint32(ctx->blob);
+   if (count > (size_t) (ctx->blob->end - ctx->blob->current)) {
+      ctx->blob->overrun = true;
+      return 0;
+   }
+
+   return count;
+}
+
+/* Looks up an index in one of the reader's arrays of pointers. */
+static void *
+read_lookup(read_ctx *ctx, nir_array *arr, uint32_t index)
+{
+   if (index >= arr->size / sizeof(void *)) {
+      ctx->blob->overrun = true;
+      return NULL;
+   }
+
+   return ((void **) arr->data)[index];
+}
+
+static void
+write_constant(write_ctx *ctx, const nir_constant *c,
+               const struct glsl_type *type)
+{
+   blob_write_bytes(ctx->blob, &c->value, sizeof(c->value));
+
+   const unsigned num_elements = c->elements ? glsl_get_length(type) : 0;
+   blob_write_uint32(ctx->blob, num_elements);
+
+   for (unsigned i = 0; i < num_elements; i++) {
+      const struct glsl_type *elem_type =
+         glsl_get_base_type(type) == GLSL_TYPE_STRUCT ?
+         glsl_get_struct_field(type, i) : glsl_get_array_element(type);
+      write_constant(ctx, c->elements[i], elem_type);
+   }
+}
+
+static nir_constant *
+read_constant(read_ctx *ctx, void *mem_ctx)
+{
+   nir_constant *c = ralloc(mem_ctx, nir_constant);
+
+   blob_copy_bytes(ctx->blob, (uint8_t *) &c->value, sizeof(c->value));
+
+   const uint32_t num_elements = read_count(ctx);
+   c->elements = num_elements ?
+      ralloc_array(c, nir_constant *, num_elements) : NULL;
+
+   for (unsigned i = 0; i < num_elements && !ctx->blob->overrun; i++)
+      c->elements[i] = read_constant(ctx, c);
+
+   return c;
+}
+
+static void
+write_variable(write_ctx *ctx, const nir_variable *var)
+{
+   write_add_object(ctx, var, ctx->next_var++);
+
+   encode_type_to_blob(ctx->blob, var->type);
+   write_string(ctx, var->name);
+   blob_write_bytes(ctx->blob, &var->data, sizeof(var->data));
+
+   blob_write_uint32(ctx->blob, var->num_state_slots);
+   blob_write_bytes(ctx->blob, var->state_slots,
+                    var->num_state_slots * sizeof(nir_state_slot));
+
+   blob_write_uint32(ctx->blob, var->constant_initializer != NULL);
+   if (var->constant_initializer)
+      write_constant(ctx, var->constant_initializer, var->type);
+
+   encode_type_to_blob(ctx->blob, var->interface_type);
+
+   const unsigned num_ifc_accesses = var->max_ifc_array_access ?
+      glsl_get_length(var->interface_type) : 0;
+   blob_write_uint32(ctx->blob, num_ifc_accesses);
+   blob_write_bytes(ctx->blob, var->max_ifc_array_access,
+                    num_ifc_accesses * sizeof(unsigned));
+}
+
+static nir_variable *
+read_variable(read_ctx *ctx)
+{
+   nir_variable *var = rzalloc(ctx->nir, nir_variable);
+   nir_array_add(&ctx->vars, nir_variable *, var);
+
+   var->type = decode_type_from_blob(ctx->blob);
+   var->name = (char *) read_string(ctx);
+   blob_copy_bytes(ctx->blob, (uint8_t *) &var->data, sizeof(var->data));
+
+   var->num_state_slots = read_count(ctx);
+   if (var->num_state_slots) {
+      var->state_slots = ralloc_array(var, nir_state_slot,
+                                      var->num_state_slots);
+      blob_copy_bytes(ctx->blob, (uint8_t *) var->state_slots,
+                      var->num_state_slots * sizeof(nir_state_slot));
+   }
+
+   if (blob_read_uint32(ctx->blob))
+      var->constant_initializer = read_constant(ctx, var);
+
+   var->interface_type = decode_type_from_blob(ctx->blob);
+
+   const uint32_t num_ifc_accesses = read_count(ctx);
+   if (num_ifc_accesses) {
+      var->max_ifc_array_access = ralloc_array(var, unsigned,
+                                               num_ifc_accesses);
+      blob_copy_bytes(ctx->blob, (uint8_t *) var->max_ifc_array_access,
+                      num_ifc_accesses * sizeof(unsigned));
+   }
+
+   return var;
+}
+
+static void
+write_var_list(write_ctx *ctx, const struct exec_list *list)
+{
+   blob_write_uint32(ctx->blob, exec_list_length(list));
+   foreach_list_typed(nir_variable, var, node, list)
+      write_variable(ctx, var);
+}
+
+static void
+read_var_list(read_ctx *ctx, struct exec_list *list)
+{
+   const uint32_t num_vars = read_count(ctx);
+   for (unsigned i = 0; i < num_vars && !ctx->blob->overrun; i++) {
+      nir_variable *var = read_variable(ctx);
+      exec_list_push_tail(list, &var->node);
+   }
+}
+
+static void
+write_register(write_ctx *ctx, const nir_register *reg)
+{
+   write_add_object(ctx, reg, ctx->next_reg++);
+
+   blob_write_uint32(ctx->blob, reg->num_components);
+   blob_write_uint32(ctx->blob, reg->num_array_elems);
+   blob_write_uint32(ctx->blob, reg->index);
+   blob_write_uint32(ctx->blob, reg->is_packed);
+   write_string(ctx, reg->name);
+}
+
+static void
+read_register(read_ctx *ctx, nir_register *reg)
+{
+   nir_array_add(&ctx->regs, nir_register *, reg);
+
+   reg->num_components = blob_read_uint32(ctx->blob);
+   reg->num_array_elems = blob_read_uint32(ctx->blob);
+   reg->index = blob_read_uint32(ctx->blob);
+   reg->is_packed = blob_read_uint32(ctx->blob);
+   reg->name = read_string(ctx);
+}
+
+static void
+write_reg_list(write_ctx *ctx, const struct exec_list *list)
+{
+   blob_write_uint32(ctx->blob, exec_list_length(list));
+   foreach_list_typed(nir_register, reg, node, list)
+      write_register(ctx, reg);
+}
+
+static void write_src(write_ctx *ctx, const nir_src *src);
+
+/*
+ * A source is either (SSA index << 1) | 1, or (register index << 2) with
+ * bit 1 set if an indirect source follows the base offset.
+ */
+static void
+write_src(write_ctx *ctx, const nir_src *src)
+{
+   if (src->is_ssa) {
+      blob_write_uint32(ctx->blob,
+                        (write_lookup_object(ctx, src->ssa) << 1) | 1);
+      return;
+   }
+
+   blob_write_uint32(ctx->blob,
+                     (write_lookup_object(ctx, src->reg.reg) << 2) |
+                     ((src->reg.indirect != NULL) << 1));
+   blob_write_uint32(ctx->blob, src->reg.base_offset);
+   if (src->reg.indirect)
+      write_src(ctx, src->reg.indirect);
+}
+
+static void
+read_src(read_ctx *ctx, nir_src *src, void *mem_ctx)
+{
+   const uint32_t header = blob_read_uint32(ctx->blob);
+
+   if (header & 1) {
+      src->is_ssa = true;
+      src->ssa = NULL;
+
+      /* Outside of phis, values are always read before their uses. */
+      if ((header >> 1) < ctx->next_ssa)
+         src->ssa = ctx->ssa_defs[header >> 1];
+      else
+         ctx->blob->overrun = true;
+      return;
+   }
+
+   src->is_ssa = false;
+   src->reg.reg = read_lookup(ctx, &ctx->regs, header >> 2);
+   src->reg.base_offset = blob_read_uint32(ctx->blob);
+   src->reg.indirect = NULL;
+   if (header & 2) {
+      src->reg.indirect = ralloc(mem_ctx, nir_src);
+      read_src(ctx, src->reg.indirect, mem_ctx);
+   }
+}
+
+static void
+write_ssa_def(write_ctx *ctx, const nir_ssa_def *def)
+{
+   blob_write_uint32(ctx->blob, def->index);
+   write_string(ctx, def->name);
+}
+
+/* Called once the instruction defining \p def has been created. */
+static void
+read_ssa_def(read_ctx *ctx, nir_ssa_def *def)
+{
+   def->index = blob_read_uint32(ctx->blob);
+   def->name = read_string(ctx);
+
+   if (ctx->next_ssa < ctx->num_ssa_defs)
+      ctx->ssa_defs[ctx->next_ssa++] = def;
+   else
+      ctx->blob->overrun = true;
+}
+
+static void
+write_dest(write_ctx *ctx, const nir_dest *dest)
+{
+   blob_write_uint32(ctx->blob, dest->is_ssa);
+
+   if (dest->is_ssa) {
+      blob_write_uint32(ctx->blob, dest->ssa.num_components);
+      write_ssa_def(ctx, &dest->ssa);
+      return;
+   }
+
+   blob_write_uint32(ctx->blob,
+                     (write_lookup_object(ctx, dest->reg.reg) << 1) |
+                     (dest->reg.indirect != NULL));
+   blob_write_uint32(ctx->blob, dest->reg.base_offset);
+   if (dest->reg.indirect)
+      write_src(ctx, dest->reg.indirect);
+}
+
+static void
+read_dest(read_ctx *ctx, nir_dest *dest, nir_instr *instr)
+{
+   if (blob_read_uint32(ctx->blob)) {
+      const unsigned num_components = blob_read_uint32(ctx->blob);
+      nir_ssa_dest_init(instr, dest, num_components, NULL);
+      read_ssa_def(ctx, &dest->ssa);
+      return;
+   }
+
+   const uint32_t header = blob_read_uint32(ctx->blob);
+
+   dest->is_ssa = false;
+   dest->reg.reg = read_lookup(ctx, &ctx->regs, header >> 1);
+   dest->reg.base_offset = blob_read_uint32(ctx->blob);
+   dest->reg.indirect = NULL;
+   if (header & 1) {
+      dest->reg.indirect = ralloc(instr, nir_src);
+      read_src(ctx, dest->reg.indirect, instr);
+   }
+}
+
+/*
+ * A deref chain is the variable followed by one entry per child, each
+ * starting with its deref type + 1, and terminated by a 0.
+ */
+static void
+write_deref_chain(write_ctx *ctx, const nir_deref_var *deref)
+{
+   if (deref == NULL) {
+      blob_write_uint32(ctx->blob, 0);
+      return;
+   }
+
+   blob_write_uint32(ctx->blob, write_lookup_object(ctx, deref->var) + 1);
+   encode_type_to_blob(ctx->blob, deref->deref.type);
+
+   for (const nir_deref *tail = deref->deref.child; tail;
+        tail = tail->child) {
+      blob_write_uint32(ctx->blob, tail->deref_type + 1);
+      encode_type_to_blob(ctx->blob, tail->type);
+
+      switch (tail->deref_type) {
+      case nir_deref_type_array: {
+         const nir_deref_array *arr = nir_deref_as_array(tail);
+         blob_write_uint32(ctx->blob, arr->deref_array_type);
+         blob_write_uint32(ctx->blob, arr->base_offset);
+         if (arr->deref_array_type == nir_deref_array_type_indirect)
+            write_src(ctx, &arr->indirect);
+         break;
+      }
+
+      case nir_deref_type_struct:
+         blob_write_uint32(ctx->blob, nir_deref_as_struct(tail)->index);
+         break;
+
+      default:
+         unreachable("Invalid deref type");
+      }
+   }
+
+   blob_write_uint32(ctx->blob, 0);
+}
+
+static nir_deref_var *
+read_deref_chain(read_ctx *ctx, nir_instr *instr)
+{
+   const uint32_t var_index = blob_read_uint32(ctx->blob);
+   if (var_index == 0)
+      return NULL;
+
+   nir_variable *var = read_lookup(ctx, &ctx->vars, var_index - 1);
+   if (var == NULL)
+      return NULL;
+
+   nir_deref_var *deref = nir_deref_var_create(instr, var);
+   deref->deref.type = decode_type_from_blob(ctx->blob);
+
+   nir_deref *tail = &deref->deref;
+   while (!ctx->blob->overrun) {
+      const uint32_t tag = blob_read_uint32(ctx->blob);
+      if (tag == 0)
+         break;
+
+      nir_deref *child;
+      switch (tag - 1) {
+      case nir_deref_type_array: {
+         nir_deref_array *arr = nir_deref_array_create(instr);
+         arr->deref.type = decode_type_from_blob(ctx->blob);
+         arr->deref_array_type = blob_read_uint32(ctx->blob);
+         arr->base_offset = blob_read_uint32(ctx->blob);
+         if (arr->deref_array_type == nir_deref_array_type_indirect)
+            read_src(ctx, &arr->indirect, instr);
+         child = &arr->deref;
+         break;
+      }
+
+      case nir_deref_type_struct: {
+         const struct glsl_type *type = decode_type_from_blob(ctx->blob);
+         nir_deref_struct *str =
+            nir_deref_struct_create(instr, blob_read_uint32(ctx->blob));
+         str->deref.type = type;
+         child = &str->deref;
+         break;
+      }
+
+      default:
+         ctx->blob->overrun = true;
+         return deref;
+      }
+
+      tail->child = child;
+      tail = child;
+   }
+
+   return deref;
+}
+
+static void
+write_alu(write_ctx *ctx, const nir_alu_instr *alu)
+{
+   blob_write_uint32(ctx->blob, alu->op);
+   write_dest(ctx, &alu->dest.dest);
+   blob_write_uint32(ctx->blob,
+                     alu->dest.write_mask | (alu->dest.saturate << 4));
+
+   for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+      const nir_alu_src *src = &alu->src[i];
+
+      write_src(ctx, &src->src);
+      blob_write_uint32(ctx->blob,
+                        src->swizzle[0] | src->swizzle[1] << 2 |
+                        src->swizzle[2] << 4 | src->swizzle[3] << 6 |
+                        src->negate << 8 | src->abs << 9);
+   }
+}
+
+static nir_alu_instr *
+read_alu(read_ctx *ctx)
+{
+   const nir_op op = blob_read_uint32(ctx->blob);
+   if (op >= nir_num_opcodes) {
+      ctx->blob->overrun = true;
+      return NULL;
+   }
+
+   nir_alu_instr *alu = nir_alu_instr_create(ctx->nir, op);
+
+   read_dest(ctx, &alu->dest.dest, &alu->instr);
+   const uint32_t dest_flags = blob_read_uint32(ctx->blob);
+   alu->dest.write_mask = dest_flags & 0xf;
+   alu->dest.saturate = (dest_flags >> 4) & 1;
+
+   for (unsigned i = 0; i < nir_op_infos[op].num_inputs; i++) {
+      nir_alu_src *src = &alu->src[i];
+
+      read_src(ctx, &src->src, &alu->instr);
+      const uint32_t src_flags = blob_read_uint32(ctx->blob);
+      for (unsigned c = 0; c < 4; c++)
+         src->swizzle[c] = (src_flags >> (2 * c)) & 3;
+      src->negate = (src_flags >> 8) & 1;
+      src->abs = (src_flags >> 9) & 1;
+   }
+
+   return alu;
+}
+
+static void
+write_intrinsic(write_ctx *ctx, const nir_intrinsic_instr *intrin)
+{
+   const nir_intrinsic_info *info = &nir_intrinsic_infos[intrin->intrinsic];
+
+   blob_write_uint32(ctx->blob, intrin->intrinsic);
+   blob_write_uint32(ctx->blob, intrin->num_components);
+   blob_write_bytes(ctx->blob, intrin->const_index,
+                    sizeof(intrin->const_index));
+
+   for (unsigned i = 0; i < info->num_variables; i++)
+      write_deref_chain(ctx, intrin->variables[i]);
+
+   for (unsigned i = 0; i < info->num_srcs; i++)
+      write_src(ctx, &intrin->src[i]);
+
+   if (info->has_dest)
+      write_dest(ctx, &intrin->dest);
+}
+
+static nir_intrinsic_instr *
+read_intrinsic(read_ctx *ctx)
+{
+   const nir_intrinsic_op op = blob_read_uint32(ctx->blob);
+   if (op >= nir_num_intrinsics) {
+      ctx->blob->overrun = true;
+      return NULL;
+   }
+
+   const nir_intrinsic_info *info = &nir_intrinsic_infos[op];
+   nir_intrinsic_instr *intrin = nir_intrinsic_instr_create(ctx->nir, op);
+
+   intrin->num_components = blob_read_uint32(ctx->blob);
+   blob_copy_bytes(ctx->blob, (uint8_t *) intrin->const_index,
+                   sizeof(intrin->const_index));
+
+   for (unsigned i = 0; i < info->num_variables; i++)
+      intrin->variables[i] = read_deref_chain(ctx, &intrin->instr);
+
+   for (unsigned i = 0; i < info->num_srcs; i++)
+      read_src(ctx, &intrin->src[i], &intrin->instr);
+
+   if (info->has_dest)
+      read_dest(ctx, &intrin->dest, &intrin->instr);
+
+   return intrin;
+}
+
+static void
+write_tex(write_ctx *ctx, const nir_tex_instr *tex)
+{
+   blob_write_uint32(ctx->blob, tex->num_srcs);
+   blob_write_uint32(ctx->blob, tex->op);
+   blob_write_uint32(ctx->blob, tex->sampler_dim);
+   blob_write_uint32(ctx->blob, tex->dest_type);
+   blob_write_uint32(ctx->blob, tex->coord_components);
+   blob_write_uint32(ctx->blob,
+                     tex->is_array | tex->is_shadow << 1 |
+                     tex->is_new_style_shadow << 2 | tex->component << 3);
+   blob_write_bytes(ctx->blob, tex->const_offset, sizeof(tex->const_offset));
+   blob_write_uint32(ctx->blob, tex->sampler_index);
+   blob_write_uint32(ctx->blob, tex->sampler_array_size);
+
+   write_dest(ctx, &tex->dest);
+   for (unsigned i = 0; i < tex->num_srcs; i++) {
+      blob_write_uint32(ctx->blob, tex->src[i].src_type);
+      write_src(ctx, &tex->src[i].src);
+   }
+
+   write_deref_chain(ctx, tex->sampler);
+}
+
+static nir_tex_instr *
+read_tex(read_ctx *ctx)
+{
+   nir_tex_instr *tex = nir_tex_instr_create(ctx->nir, read_count(ctx));
+
+   tex->op = blob_read_uint32(ctx->blob);
+   tex->sampler_dim = blob_read_uint32(ctx->blob);
+   tex->dest_type = blob_read_uint32(ctx->blob);
+   tex->coord_components = blob_read_uint32(ctx->blob);
+   const uint32_t flags = blob_read_uint32(ctx->blob);
+   tex->is_array = flags & 1;
+   tex->is_shadow = (flags >> 1) & 1;
+   tex->is_new_style_shadow = (flags >> 2) & 1;
+   tex->component = (flags >> 3) & 3;
+   blob_copy_bytes(ctx->blob, (uint8_t *) tex->const_offset,
+                   sizeof(tex->const_offset));
+   tex->sampler_index = blob_read_uint32(ctx->blob);
+   tex->sampler_array_size = blob_read_uint32(ctx->blob);
+
+   read_dest(ctx, &tex->dest, &tex->instr);
+   for (unsigned i = 0; i < tex->num_srcs; i++) {
+      tex->src[i].src_type = blob_read_uint32(ctx->blob);
+      read_src(ctx, &tex->src[i].src, &tex->instr);
+   }
+
+   tex->sampler = read_deref_chain(ctx, &tex->instr);
+
+   return tex;
+}
+
+static void
+write_phi(write_ctx *ctx, const nir_phi_instr *phi)
+{
+   write_dest(ctx, &phi->dest);
+
+   blob_write_uint32(ctx->blob, exec_list_length(&phi->srcs));
+   nir_foreach_phi_src(phi, src) {
+      /* Phis only exist while the shader is in SSA form. */
+      assert(src->src.is_ssa);
+      blob_write_uint32(ctx->blob, write_lookup_object(ctx, src->pred));
+      blob_write_uint32(ctx->blob, write_lookup_object(ctx, src->src.ssa));
+   }
+}
+
+/*
+ * The sources of a phi may be defined further down the function, so they are
+ * filled in and the phi added to its block by read_fixup_phis().
+ */
+static void
+read_phi(read_ctx *ctx, nir_block *block)
+{
+   nir_phi_instr *phi = nir_phi_instr_create(ctx->nir);
+
+   read_dest(ctx, &phi->dest, &phi->instr);
+
+   pending_phi pending;
+   pending.phi = phi;
+   pending.block = block;
+   pending.num_srcs = read_count(ctx);
+   pending.srcs = ralloc_array(ctx->phis.mem_ctx, uint32_t,
+                               2 * pending.num_srcs);
+   blob_copy_bytes(ctx->blob, (uint8_t *) pending.srcs,
+                   2 * pending.num_srcs * sizeof(uint32_t));
+
+   nir_array_add(&ctx->phis, pending_phi, pending);
+}
+
+static void
+read_fixup_phis(read_ctx *ctx)
+{
+   /* Walk backwards so that inserting each phi at the top of its block keeps
+    * the phis of a block in their original order.
+    */
+   pending_phi *phis = ctx->phis.data;
+   for (int i = ctx->phis.size / sizeof(pending_phi) - 1; i >= 0; i--) {
+      pending_phi *pending = &phis[i];
+
+      for (unsigned j = 0; j < pending->num_srcs; j++) {
+         const uint32_t pred = pending->srcs[2 * j];
+         const uint32_t ssa = pending->srcs[2 * j + 1];
+         if (pred >= ctx->num_blocks || ssa >= ctx->next_ssa) {
+            ctx->blob->overrun = true;
+            return;
+         }
+
+         nir_phi_src *src = ralloc(pending->phi, nir_phi_src);
+         src->pred = ctx->blocks[pred];
+         src->src = nir_src_for_ssa(ctx->ssa_defs[ssa]);
+         exec_list_push_tail(&pending->phi->srcs, &src->node);
+      }
+
+      nir_instr_insert_before_block(pending->block, &pending->phi->instr);
+   }
+}
+
+static void
+write_call(write_ctx *ctx, const nir_call_instr *call)
+{
+   blob_write_uint32(ctx->blob, write_lookup_object(ctx, call->callee));
+
+   for (unsigned i = 0; i < call->num_params; i++)
+      write_deref_chain(ctx, call->params[i]);
+
+   write_deref_chain(ctx, call->return_deref);
+}
+
+static nir_call_instr *
+read_call(read_ctx *ctx)
+{
+   nir_function_overload *callee =
+      read_lookup(ctx, &ctx->overloads, blob_read_uint32(ctx->blob));
+   if (callee == NULL)
+      return NULL;
+
+   nir_call_instr *call = nir_call_instr_create(ctx->nir, callee);
+
+   for (unsigned i = 0; i < call->num_params; i++)
+      call->params[i] = read_deref_chain(ctx, &call->instr);
+
+   call->return_deref = read_deref_chain(ctx, &call->instr);
+
+   return call;
+}
+
+static void
+write_parallel_copy(write_ctx *ctx, const nir_parallel_copy_instr *pc)
+{
+   blob_write_uint32(ctx->blob, exec_list_length(&pc->entries));
+   nir_foreach_parallel_copy_entry(pc, entry) {
+      write_src(ctx, &entry->src);
+      write_dest(ctx, &entry->dest);
+   }
+}
+
+static nir_parallel_copy_instr *
+read_parallel_copy(read_ctx *ctx)
+{
+   nir_parallel_copy_instr *pc = nir_parallel_copy_instr_create(ctx->nir);
+
+   const uint32_t num_entries = read_count(ctx);
+   for (unsigned i = 0; i < num_entries && !ctx->blob->overrun; i++) {
+      nir_parallel_copy_entry *entry = ralloc(pc, nir_parallel_copy_entry);
+      read_src(ctx, &entry->src, &pc->instr);
+      read_dest(ctx, &entry->dest, &pc->instr);
+      exec_list_push_tail(&pc->entries, &entry->node);
+   }
+
+   return pc;
+}
+
+static void
+write_instr(write_ctx *ctx, const nir_instr *instr)
+{
+   blob_write_uint32(ctx->blob, instr->type);
+
+   switch (instr->type) {
+   case nir_instr_type_alu:
+      write_alu(ctx, nir_instr_as_alu(instr));
+      break;
+   case nir_instr_type_intrinsic:
+      write_intrinsic(ctx, nir_instr_as_intrinsic(instr));
+      break;
+   case nir_instr_type_tex:
+      write_tex(ctx, nir_instr_as_tex(instr));
+      break;
+   case nir_instr_type_load_const: {
+      const nir_load_const_instr *lc = nir_instr_as_load_const(instr);
+      blob_write_uint32(ctx->blob, lc->def.num_components);
+      blob_write_bytes(ctx->blob, lc->value.u,
+                       lc->def.num_components * sizeof(uint32_t));
+      write_ssa_def(ctx, &lc->def);
+      break;
+   }
+   case nir_instr_type_ssa_undef: {
+      const nir_ssa_undef_instr *undef = nir_instr_as_ssa_undef(instr);
+      blob_write_uint32(ctx->blob, undef->def.num_components);
+      write_ssa_def(ctx, &undef->def);
+      break;
+   }
+   case nir_instr_type_phi:
+      write_phi(ctx, nir_instr_as_phi(instr));
+      break;
+   case nir_instr_type_jump:
+      blob_write_uint32(ctx->blob, nir_instr_as_jump(instr)->type);
+      break;
+   case nir_instr_type_call:
+      write_call(ctx, nir_instr_as_call(instr));
+      break;
+   case nir_instr_type_parallel_copy:
+      write_parallel_copy(ctx, nir_instr_as_parallel_copy(instr));
+      break;
+   default:
+      unreachable("Invalid instruction type");
+   }
+}
+
+static void
+read_instr(read_ctx *ctx, nir_block *block)
+{
+   nir_instr *instr = NULL;
+
+   switch (blob_read_uint32(ctx->blob)) {
+   case nir_instr_type_alu: {
+      nir_alu_instr *alu = read_alu(ctx);
+      instr = alu ? &alu->instr : NULL;
+      break;
+   }
+   case nir_instr_type_intrinsic: {
+      nir_intrinsic_instr *intrin = read_intrinsic(ctx);
+      instr = intrin ? &intrin->instr : NULL;
+      break;
+   }
+   case nir_instr_type_tex:
+      instr = &read_tex(ctx)->instr;
+      break;
+   case nir_instr_type_load_const: {
+      const unsigned num_components = blob_read_uint32(ctx->blob);
+      if (num_components == 0 || num_components > 4)
+         break;
+
+      nir_load_const_instr *lc =
+         nir_load_const_instr_create(ctx->nir, num_components);
+      blob_copy_bytes(ctx->blob, (uint8_t *) lc->value.u,
+                      num_components * sizeof(uint32_t));
+      read_ssa_def(ctx, &lc->def);
+      instr = &lc->instr;
+      break;
+   }
+   case nir_instr_type_ssa_undef: {
+      const unsigned num_components = blob_read_uint32(ctx->blob);
+      nir_ssa_undef_instr *undef =
+         nir_ssa_undef_instr_create(ctx->nir, num_components);
+      read_ssa_def(ctx, &undef->def);
+      instr = &undef->instr;
+      break;
+   }
+   case nir_instr_type_phi:
+      read_phi(ctx, block);
+      return;
+   case nir_instr_type_jump: {
+      const nir_jump_type type = blob_read_uint32(ctx->blob);
+      if (type <= nir_jump_continue)
+         instr = &nir_jump_instr_create(ctx->nir, type)->instr;
+      break;
+   }
+   case nir_instr_type_call: {
+      nir_call_instr *call = read_call(ctx);
+      instr = call ? &call->instr : NULL;
+      break;
+   }
+   case nir_instr_type_parallel_copy:
+      instr = &read_parallel_copy(ctx)->instr;
+      break;
+   }
+
+   /* Don't hook half-read instructions up to anything. */
+   if (instr == NULL || ctx->blob->overrun) {
+      ctx->blob->overrun = true;
+      return;
+   }
+
+   nir_instr_insert_after_block(block, instr);
+}
+
+static void write_cf_list(write_ctx *ctx, const struct exec_list *list);
+
+static void
+write_cf_list(write_ctx *ctx, const struct exec_list *list)
+{
+   blob_write_uint32(ctx->blob, exec_list_length(list));
+
+   foreach_list_typed(nir_cf_node, node, node, list) {
+      blob_write_uint32(ctx->blob, node->type);
+
+      switch (node->type) {
+      case nir_cf_node_block: {
+         nir_block *block = nir_cf_node_as_block(node);
+         blob_write_uint32(ctx->blob, exec_list_length(&block->instr_list));
+         nir_foreach_instr(block, instr)
+            write_instr(ctx, instr);
+         break;
+      }
+
+      case nir_cf_node_if: {
+         nir_if *if_stmt = nir_cf_node_as_if(node);
+         write_src(ctx, &if_stmt->condition);
+         write_cf_list(ctx, &if_stmt->then_list);
+         write_cf_list(ctx, &if_stmt->else_list);
+         break;
+      }
+
+      case nir_cf_node_loop:
+         write_cf_list(ctx, &nir_cf_node_as_loop(node)->body);
+         break;
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+}
+
+/*
+ * Fills in a control flow list.  Creating an if or a loop already puts a
+ * block in each of its lists and a block after it, so blocks are never
+ * created here; they are the ones at the end of the list at that point.
+ */
+static void
+read_cf_list(read_ctx *ctx, struct exec_list *list)
+{
+   const uint32_t num_nodes = read_count(ctx);
+
+   for (unsigned i = 0; i < num_nodes && !ctx->blob->overrun; i++) {
+      nir_cf_node *tail = exec_node_data(nir_cf_node,
+                                         exec_list_get_tail(list), node);
+
+      switch (blob_read_uint32(ctx->blob)) {
+      case nir_cf_node_block: {
+         if (tail->type != nir_cf_node_block ||
+             ctx->next_block >= ctx->num_blocks) {
+            ctx->blob->overrun = true;
+            return;
+         }
+
+         nir_block *block = nir_cf_node_as_block(tail);
+         ctx->blocks[ctx->next_block++] = block;
+
+         const uint32_t num_instrs = read_count(ctx);
+         for (unsigned j = 0; j < num_instrs && !ctx->blob->overrun; j++)
+            read_instr(ctx, block);
+         break;
+      }
+
+      case nir_cf_node_if: {
+         nir_if *if_stmt = nir_if_create(ctx->nir);
+         read_src(ctx, &if_stmt->condition, if_stmt);
+         if (ctx->blob->overrun)
+            return;
+
+         nir_cf_node_insert_end(list, &if_stmt->cf_node);
+         read_cf_list(ctx, &if_stmt->then_list);
+         read_cf_list(ctx, &if_stmt->else_list);
+         break;
+      }
+
+      case nir_cf_node_loop: {
+         nir_loop *loop = nir_loop_create(ctx->nir);
+         nir_cf_node_insert_end(list, &loop->cf_node);
+         read_cf_list(ctx, &loop->body);
+         break;
+      }
+
+      default:
+         ctx->blob->overrun = true;
+         return;
+      }
+   }
+}
+
+static bool
+write_index_block(nir_block *block, void *data)
+{
+   write_ctx *ctx = data;
+
+   write_add_object(ctx, block, ctx->next_block++);
+   return true;
+}
+
+static bool
+write_index_ssa_def(nir_ssa_def *def, void *data)
+{
+   write_ctx *ctx = data;
+
+   write_add_object(ctx, def, ctx->next_ssa++);
+   return true;
+}
+
+static bool
+write_index_ssa_defs_block(nir_block *block, void *data)
+{
+   nir_foreach_instr(block, instr)
+      nir_foreach_ssa_def(instr, write_index_ssa_def, data);
+
+   return true;
+}
+
+/*
+ * Parameters are normally among the locals, but the return value isn't, so
+ * either one may need to be written in full.
+ */
+static void
+write_impl_var(write_ctx *ctx, const nir_variable *var)
+{
+   if (var == NULL) {
+      blob_write_uint32(ctx->blob, IMPL_VAR_NULL);
+   } else if (_mesa_hash_table_search(ctx->remap_table, var)) {
+      blob_write_uint32(ctx->blob, IMPL_VAR_REF);
+      blob_write_uint32(ctx->blob, write_lookup_object(ctx, var));
+   } else {
+      blob_write_uint32(ctx->blob, IMPL_VAR_INLINE);
+      write_variable(ctx, var);
+   }
+}
+
+static nir_variable *
+read_impl_var(read_ctx *ctx)
+{
+   switch (blob_read_uint32(ctx->blob)) {
+   case IMPL_VAR_NULL:
+      return NULL;
+   case IMPL_VAR_REF:
+      return read_lookup(ctx, &ctx->vars, blob_read_uint32(ctx->blob));
+   case IMPL_VAR_INLINE:
+      return read_variable(ctx);
+   default:
+      ctx->blob->overrun = true;
+      return NULL;
+   }
+}
+
+static void
+write_impl(write_ctx *ctx, nir_function_impl *impl)
+{
+   ctx->next_reg = ctx->num_global_regs;
+   write_reg_list(ctx, &impl->registers);
+   blob_write_uint32(ctx->blob, impl->reg_alloc);
+
+   write_var_list(ctx, &impl->locals);
+
+   blob_write_uint32(ctx->blob, impl->num_params);
+   for (unsigned i = 0; i < impl->num_params; i++)
+      write_impl_var(ctx, impl->params[i]);
+   write_impl_var(ctx, impl->return_var);
+
+   ctx->next_block = 0;
+   nir_foreach_block(impl, write_index_block, ctx);
+   blob_write_uint32(ctx->blob, ctx->next_block);
+
+   ctx->next_ssa = 0;
+   nir_foreach_block(impl, write_index_ssa_defs_block, ctx);
+   blob_write_uint32(ctx->blob, ctx->next_ssa);
+
+   write_cf_list(ctx, &impl->body);
+   blob_write_uint32(ctx->blob, impl->ssa_alloc);
+}
+
+static void
+read_impl(read_ctx *ctx, nir_function_overload *overload)
+{
+   nir_function_impl *impl = nir_function_impl_create(overload);
+
+   ctx->regs.size = ctx->num_global_regs * sizeof(nir_register *);
+   const uint32_t num_regs = read_count(ctx);
+   for (unsigned i = 0; i < num_regs && !ctx->blob->overrun; i++)
+      read_register(ctx, nir_local_reg_create(impl));
+   impl->reg_alloc = blob_read_uint32(ctx->blob);
+
+   read_var_list(ctx, &impl->locals);
+
+   impl->num_params = read_count(ctx);
+   impl->params = ralloc_array(ctx->nir, nir_variable *, impl->num_params);
+   for (unsigned i = 0; i < impl->num_params; i++)
+      impl->params[i] = read_impl_var(ctx);
+   impl->return_var = read_impl_var(ctx);
+
+   ctx->num_blocks = read_count(ctx);
+   ctx->next_block = 0;
+   ctx->blocks = ralloc_array(NULL, nir_block *, ctx->num_blocks);
+
+   ctx->num_ssa_defs = read_count(ctx);
+   ctx->next_ssa = 0;
+   ctx->ssa_defs = ralloc_array(NULL, nir_ssa_def *, ctx->num_ssa_defs);
+
+   ctx->phis.size = 0;
+
+   if (!ctx->blob->overrun)
+      read_cf_list(ctx, &impl->body);
+
+   /* The end block is the last one nir_foreach_block() visits. */
+   if (ctx->next_block + 1 == ctx->num_blocks)
+      ctx->blocks[ctx->next_block++] = impl->end_block;
+   else
+      ctx->blob->overrun = true;
+
+   if (!ctx->blob->overrun)
+      read_fixup_phis(ctx);
+
+   impl->ssa_alloc = blob_read_uint32(ctx->blob);
+
+   ralloc_free(ctx->blocks);
+   ralloc_free(ctx->ssa_defs);
+}
+
+static void
+write_functions(write_ctx *ctx, nir_shader *shader)
+{
+   /* Write every signature before any code so that calls can always refer
+    * to their callee.
+    */
+   blob_write_uint32(ctx->blob, exec_list_length(&shader->functions));
+   foreach_list_typed(nir_function, func, node, &shader->functions) {
+      write_string(ctx, func->name);
+      blob_write_uint32(ctx->blob, exec_list_length(&func->overload_list));
+
+      foreach_list_typed(nir_function_overload, overload, node,
+                         &func->overload_list) {
+         write_add_object(ctx, overload, ctx->next_overload++);
+
+         blob_write_uint32(ctx->blob, overload->num_params);
+         for (unsigned i = 0; i < overload->num_params; i++) {
+            blob_write_uint32(ctx->blob, overload->params[i].param_type);
+            encode_type_to_blob(ctx->blob, overload->params[i].type);
+         }
+         encode_type_to_blob(ctx->blob, overload->return_type);
+         blob_write_uint32(ctx->blob, overload->impl != NULL);
+      }
+   }
+
+   nir_foreach_overload(shader, overload) {
+      if (overload->impl)
+         write_impl(ctx, overload->impl);
+   }
+}
+
+static void
+read_functions(read_ctx *ctx)
+{
+   nir_array has_impl;
+   nir_array_init(&has_impl, NULL);
+
+   const uint32_t num_functions = read_count(ctx);
+   for (unsigned i = 0; i < num_functions && !ctx->blob->overrun; i++) {
+      nir_function *func = nir_function_create(ctx->nir, read_string(ctx));
+
+      const uint32_t num_overloads = read_count(ctx);
+      for (unsigned j = 0; j < num_overloads && !ctx->blob->overrun; j++) {
+         nir_function_overload *overload = nir_function_overload_create(func);
+         nir_array_add(&ctx->overloads, nir_function_overload *, overload);
+
+         overload->num_params = read_count(ctx);
+         overload->params = ralloc_array(ctx->nir, nir_parameter,
+                                         overload->num_params);
+         for (unsigned k = 0; k < overload->num_params; k++) {
+            overload->params[k].param_type = blob_read_uint32(ctx->blob);
+            overload->params[k].type = decode_type_from_blob(ctx->blob);
+         }
+         overload->return_type = decode_type_from_blob(ctx->blob);
+
+         nir_array_add(&has_impl, bool, blob_read_uint32(ctx->blob) != 0);
+      }
+   }
+
+   nir_function_overload **overloads = ctx->overloads.data;
+   bool *impls = has_impl.data;
+   for (unsigned i = 0; i < has_impl.size / sizeof(bool); i++) {
+      if (impls[i] && !ctx->blob->overrun)
+         read_impl(ctx, overloads[i]);
+   }
+
+   nir_array_fini(&has_impl);
+}
+
+void
+nir_serialize(struct blob *blob, nir_shader *shader)
+{
+   write_ctx ctx;
+   ctx.blob = blob;
+   ctx.remap_table = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                                             _mesa_key_pointer_equal);
+   ctx.next_var = 0;
+   ctx.next_overload = 0;
+   ctx.next_reg = 0;
+
+   blob_write_uint32(blob, shader->stage);
+   blob_write_bytes(blob, &shader->info, sizeof(shader->info));
+   write_string(&ctx, shader->info.name);
+
+   write_var_list(&ctx, &shader->uniforms);
+   write_var_list(&ctx, &shader->inputs);
+   write_var_list(&ctx, &shader->outputs);
+   write_var_list(&ctx, &shader->globals);
+   write_var_list(&ctx, &shader->system_values);
+
+   write_reg_list(&ctx, &shader->registers);
+   ctx.num_global_regs = ctx.next_reg;
+   blob_write_uint32(blob, shader->reg_alloc);
+
+   blob_write_uint32(blob, shader->num_inputs);
+   blob_write_uint32(blob, shader->num_uniforms);
+   blob_write_uint32(blob, shader->num_outputs);
+
+   write_functions(&ctx, shader);
+
+   _mesa_hash_table_destroy(ctx.remap_table, NULL);
+}
+
+nir_shader *
+nir_deserialize(void *mem_ctx,
+                const struct nir_shader_compiler_options *options,
+                struct blob_reader *blob)
+{
+   read_ctx ctx;
+   ctx.blob = blob;
+
+   const gl_shader_stage stage = blob_read_uint32(blob);
+   if (stage > MESA_SHADER_COMPUTE)
+      return NULL;
+
+   ctx.nir = nir_shader_create(mem_ctx, stage, options);
+
+   void *tmp_ctx = ralloc_context(NULL);
+   nir_array_init(&ctx.vars, tmp_ctx);
+   nir_array_init(&ctx.overloads, tmp_ctx);
+   nir_array_init(&ctx.regs, tmp_ctx);
+   nir_array_init(&ctx.phis, tmp_ctx);
+
+   blob_copy_bytes(blob, (uint8_t *) &ctx.nir->info, sizeof(ctx.nir->info));
+   ctx.nir->info.name = read_string(&ctx);
+
+   read_var_list(&ctx, &ctx.nir->uniforms);
+   read_var_list(&ctx, &ctx.nir->inputs);
+   read_var_list(&ctx, &ctx.nir->outputs);
+   read_var_list(&ctx, &ctx.nir->globals);
+   read_var_list(&ctx, &ctx.nir->system_values);
+
+   const uint32_t num_regs = read_count(&ctx);
+   for (unsigned i = 0; i < num_regs && !blob->overrun; i++)
+      read_register(&ctx, nir_global_reg_create(ctx.nir));
+   ctx.num_global_regs = num_regs;
+   ctx.nir->reg_alloc = blob_read_uint32(blob);
+
+   ctx.nir->num_inputs = blob_read_uint32(blob);
+   ctx.nir->num_uniforms = blob_read_uint32(blob);
+   ctx.nir->num_outputs = blob_read_uint32(blob);
+
+   if (!blob->overrun)
+      read_functions(&ctx);
+
+   ralloc_free(tmp_ctx);
+
+   if (blob->overrun) {
+      ralloc_free(ctx.nir);
+      return NULL;
+   }
+
+   return ctx.nir;
+}
@@ -0,0 +1,417 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+
+class nir_loop_test : public ::testing::Test {
+protected:
+   nir_loop_test();
+   ~nir_loop_test();
+
+   nir_variable *create_variable(nir_variable_mode mode, const char *name);
+
+   nir_loop *build_counting_loop(nir_ssa_def *init, nir_op cmp,
+                                 nir_ssa_def *limit, nir_ssa_def *step,
+                                 nir_phi_instr **counter);
+
+   unsigned count_loops();
+   unsigned count_stores();
+
+   nir_builder b;
+   nir_shader *shader;
+   nir_function_impl *impl;
+   nir_variable *out;
+};
+
+nir_loop_test::nir_loop_test()
+{
+   static const nir_shader_compiler_options options = { };
+   shader = nir_shader_create(NULL, MESA_SHADER_VERTEX, &options);
+   nir_function *func = nir_function_create(shader, "main");
+   nir_function_overload *overload = nir_function_overload_create(func);
+   impl = nir_function_impl_create(overload);
+
+   nir_builder_init(&b, impl);
+   b.cursor = nir_after_cf_list(&impl->body);
+
+   out = create_variable(nir_var_shader_out, "out");
+}
+
+nir_loop_test::~nir_loop_test()
+{
+   ralloc_free(shader);
+}
+
+nir_variable *
+nir_loop_test::create_variable(nir_variable_mode mode, const char *name)
+{
+   nir_variable *var = rzalloc(shader, nir_variable);
+   var->type = glsl_float_type();
+   var->name = ralloc_strdup(var, name);
+   var->data.mode = mode;
+
+   if (mode == nir_var_uniform)
+      exec_list_push_tail(&shader->uniforms, &var->node);
+   else
+      exec_list_push_tail(&shader->outputs, &var->node);
+
+   return var;
+}
+
+/*
+ * Builds
+ *
+ * for (i = init; !(i cmp limit); i += step)
+ *    out = i;
+ *
+ * at the builder's cursor and leaves the cursor after the loop.
+ */
+nir_loop *
+nir_loop_test::build_counting_loop(nir_ssa_def *init, nir_op cmp,
+                                   nir_ssa_def *limit, nir_ssa_def *step,
+                                   nir_phi_instr **counter)
+{
+   nir_loop *loop = nir_loop_create(shader);
+   nir_builder_cf_insert(&b, &loop->cf_node);
+
+   nir_block *preheader =
+      nir_cf_node_as_block(nir_cf_node_prev(&loop->cf_node));
+
+   nir_block *header = nir_cf_node_as_block(nir_loop_first_cf_node(loop));
+   nir_phi_instr *phi = nir_phi_instr_create(shader);
+   nir_ssa_dest_init(&phi->instr, &phi->dest, 1, "i");
+
+   b.cursor = nir_after_cf_list(&loop->body);
+   nir_ssa_def *cond = nir_build_alu(&b, cmp, &phi->dest.ssa, limit,
+                                     NULL, NULL);
+
+   nir_if *nif = nir_if_create(shader);
+   nif->condition = nir_src_for_ssa(cond);
+   nir_builder_cf_insert(&b, &nif->cf_node);
+
+   b.cursor = nir_after_cf_list(&nif->then_list);
+   nir_jump_instr *jump = nir_jump_instr_create(shader, nir_jump_break);
+   nir_builder_instr_insert(&b, &jump->instr);
+
+   b.cursor = nir_after_cf_list(&loop->body);
+   nir_store_var(&b, out, &phi->dest.ssa);
+   nir_ssa_def *next = nir_iadd(&b, &phi->dest.ssa, step);
+
+   nir_phi_src *src = ralloc(phi, nir_phi_src);
+   src->pred = preheader;
+   src->src = nir_src_for_ssa(init);
+   exec_list_push_tail(&phi->srcs, &src->node);
+
+   src = ralloc(phi, nir_phi_src);
+   src->pred = nir_cf_node_as_block(nir_loop_last_cf_node(loop));
+   src->src = nir_src_for_ssa(next);
+   exec_list_push_tail(&phi->srcs, &src->node);
+
+   nir_instr_insert(nir_before_block(header), &phi->instr);
+
+   b.cursor = nir_after_cf_node(&loop->cf_node);
+
+   if (counter)
+      *counter = phi;
+
+   return loop;
+}
+
+static bool
+count_loops_in_list(struct exec_list *list, unsigned *count)
+{
+   foreach_list_typed(nir_cf_node, node, node, list) {
+      switch (node->type) {
+      case nir_cf_node_if:
+         count_loops_in_list(&nir_cf_node_as_if(node)->then_list, count);
+         count_loops_in_list(&nir_cf_node_as_if(node)->else_list, count);
+         break;
+      case nir_cf_node_loop:
+         (*count)++;
+         count_loops_in_list(&nir_cf_node_as_loop(node)->body, count);
+         break;
+      default:
+         break;
+      }
+   }
+
+   return true;
+}
+
+unsigned
+nir_loop_test::count_loops()
+{
+   unsigned count = 0;
+   count_loops_in_list(&impl->body, &count);
+   return count;
+}
+
+static bool
+count_stores_block(nir_block *block, void *state)
+{
+   unsigned *count = (unsigned *) state;
+
+   nir_foreach_instr(block, instr) {
+      if (instr->type == nir_instr_type_intrinsic &&
+          nir_instr_as_intrinsic(instr)->intrinsic == nir_intrinsic_store_var)
+         (*count)++;
+   }
+
+   return true;
+}
+
+unsigned
+nir_loop_test::count_stores()
+{
+   unsigned count = 0;
+   nir_foreach_block(impl, count_stores_block, &count);
+   return count;
+}
+
+TEST_F(nir_loop_test, analyze_counting_loop)
+{
+   nir_loop *loop = build_counting_loop(nir_imm_int(&b, 0), nir_op_ige,
+                                        nir_imm_int(&b, 4),
+                                        nir_imm_int(&b, 1), NULL);
+   nir_validate_shader(shader);
+
+   nir_metadata_require(impl, nir_metadata_loop_analysis);
+
+   ASSERT_TRUE(loop->info != NULL);
+   EXPECT_FALSE(loop->info->contains_loop);
+   EXPECT_TRUE(loop->info->terminator != NULL);
+   EXPECT_TRUE(loop->info->break_in_then);
+   EXPECT_EQ(4, loop->info->trip_count);
+   EXPECT_EQ(3u, loop->info->num_instructions);
+}
+
+TEST_F(nir_loop_test, analyze_counting_down)
+{
+   /* i = 10, 7, 4, 1 */
+   nir_loop *loop = build_counting_loop(nir_imm_int(&b, 10), nir_op_ilt,
+                                        nir_imm_int(&b, 3),
+                                        nir_imm_int(&b, -3), NULL);
+   nir_validate_shader(shader);
+
+   nir_metadata_require(impl, nir_metadata_loop_analysis);
+
+   EXPECT_EQ(3, loop->info->trip_count);
+}
+
+TEST_F(nir_loop_test, analyze_loop_that_never_runs)
+{
+   nir_loop *loop = build_counting_loop(nir_imm_int(&b, 8), nir_op_ige,
+                                        nir_imm_int(&b, 2),
+                                        nir_imm_int(&b, 1), NULL);
+   nir_validate_shader(shader);
+
+   nir_metadata_require(impl, nir_metadata_loop_analysis);
+
+   EXPECT_EQ(0, loop->info->trip_count);
+}
+
+TEST_F(nir_loop_test, analyze_unknown_limit)
+{
+   nir_variable *limit = create_variable(nir_var_uniform, "limit");
+   nir_loop *loop = build_counting_loop(nir_imm_int(&b, 0), nir_op_ige,
+                                        nir_load_var(&b, limit),
+                                        nir_imm_int(&b, 1), NULL);
+   nir_validate_shader(shader);
+
+   nir_metadata_require(impl, nir_metadata_loop_analysis);
+
+   EXPECT_TRUE(loop->info->terminator != NULL);
+   EXPECT_EQ(-1, loop->info->trip_count);
+}
+
+TEST_F(nir_loop_test, analyze_second_exit)
+{
+   nir_loop *loop = build_counting_loop(nir_imm_int(&b, 0), nir_op_ige,
+                                        nir_imm_int(&b, 4),
+                                        nir_imm_int(&b, 1), NULL);
+
+   /* Add a second break at the end of the loop body. */
+   b.cursor = nir_after_cf_list(&loop->body);
+   nir_jump_instr *jump = nir_jump_instr_create(shader, nir_jump_break);
+   nir_builder_instr_insert(&b, &jump->instr);
+
+   nir_metadata_require(impl, nir_metadata_loop_analysis);
+
+   EXPECT_TRUE(loop->info->terminator == NULL);
+   EXPECT_EQ(-1, loop->info->trip_count);
+}
+
+TEST_F(nir_loop_test, analysis_is_metadata)
+{
+   nir_loop *loop = build_counting_loop(nir_imm_int(&b, 0), nir_op_ige,
+                                        nir_imm_int(&b, 4),
+                                        nir_imm_int(&b, 1), NULL);
+
+   nir_metadata_require(impl, nir_metadata_loop_analysis);
+   nir_loop_info *info = loop->info;
+
+   /* Still valid, so nothing gets recomputed. */
+   nir_metadata_require(impl, nir_metadata_loop_analysis);
+   EXPECT_EQ(info, loop->info);
+
+   nir_metadata_preserve(impl, nir_metadata_none);
+   EXPECT_FALSE(impl->valid_metadata & nir_metadata_loop_analysis);
+}
+
+TEST_F(nir_loop_test, unroll_counting_loop)
+{
+   nir_phi_instr *counter;
+   build_counting_loop(nir_imm_int(&b, 0), nir_op_ige, nir_imm_int(&b, 4),
+                       nir_imm_int(&b, 1), &counter);
+
+   /* Use the counter after the loop too. */
+   nir_variable *after = create_variable(nir_var_shader_out, "after");
+   nir_store_var(&b, after, &counter->dest.ssa);
+   nir_validate_shader(shader);
+
+   EXPECT_TRUE(nir_opt_loop_unroll(shader));
+   nir_validate_shader(shader);
+
+   EXPECT_EQ(0u, count_loops());
+   EXPECT_EQ(5u, count_stores());
+
+   /* Everything folds down to constants: out = 0, 1, 2, 3 and after = 4. */
+   while (nir_opt_constant_folding(shader) || nir_copy_prop(shader))
+      ;
+   nir_validate_shader(shader);
+
+   nir_block *block = nir_start_block(impl);
+   int expected = 0;
+   nir_foreach_instr(block, instr) {
+      if (instr->type != nir_instr_type_intrinsic)
+         continue;
+
+      nir_intrinsic_instr *store = nir_instr_as_intrinsic(instr);
+      nir_const_value *value = nir_src_as_const_value(store->src[0]);
+      ASSERT_TRUE(value != NULL);
+      EXPECT_EQ(expected, value->i[0]);
+      EXPECT_EQ(expected < 4 ? out : after, store->variables[0]->var);
+      expected++;
+   }
+   EXPECT_EQ(5, expected);
+}
+
+TEST_F(nir_loop_test, unroll_loop_with_if)
+{
+   nir_phi_instr *counter;
+   nir_loop *loop = build_counting_loop(nir_imm_int(&b, 0), nir_op_ige,
+                                        nir_imm_int(&b, 3),
+                                        nir_imm_int(&b, 1), &counter);
+
+   /* Add "out2 = i == 1 ? 10 : 20" at the end of the loop body. */
+   b.cursor = nir_after_cf_list(&loop->body);
+   nir_if *nif = nir_if_create(shader);
+   nif->condition = nir_src_for_ssa(nir_ieq(&b, &counter->dest.ssa,
+                                            nir_imm_int(&b, 1)));
+   nir_builder_cf_insert(&b, &nif->cf_node);
+
+   b.cursor = nir_after_cf_list(&nif->then_list);
+   nir_ssa_def *then_value = nir_imm_int(&b, 10);
+   b.cursor = nir_after_cf_list(&nif->else_list);
+   nir_ssa_def *else_value = nir_imm_int(&b, 20);
+
+   nir_phi_instr *phi = nir_phi_instr_create(shader);
+   nir_ssa_dest_init(&phi->instr, &phi->dest, 1, NULL);
+
+   nir_phi_src *src = ralloc(phi, nir_phi_src);
+   src->pred = nir_cf_node_as_block(nir_if_last_then_node(nif));
+   src->src = nir_src_for_ssa(then_value);
+   exec_list_push_tail(&phi->srcs, &src->node);
+
+   src = ralloc(phi, nir_phi_src);
+   src->pred = nir_cf_node_as_block(nir_if_last_else_node(nif));
+   src->src = nir_src_for_ssa(else_value);
+   exec_list_push_tail(&phi->srcs, &src->node);
+
+   b.cursor = nir_after_cf_node(&nif->cf_node);
+   nir_builder_instr_insert(&b, &phi->instr);
+   nir_store_var(&b, create_variable(nir_var_shader_out, "out2"),
+                 &phi->dest.ssa);
+   nir_validate_shader(shader);
+
+   EXPECT_TRUE(nir_opt_loop_unroll(shader));
+   nir_validate_shader(shader);
+
+   EXPECT_EQ(0u, count_loops());
+   EXPECT_EQ(6u, count_stores());
+
+   /* The copies of the if have constant conditions now. */
+   while (nir_opt_constant_folding(shader) || nir_opt_dead_cf(shader) ||
+          nir_opt_remove_phis(shader) || nir_copy_prop(shader))
+      ;
+   nir_validate_shader(shader);
+
+   EXPECT_TRUE(nir_cf_node_is_last(&nir_start_block(impl)->cf_node));
+
+   static const int expected[] = { 0, 20, 1, 10, 2, 20 };
+   unsigned i = 0;
+   nir_foreach_instr(nir_start_block(impl), instr) {
+      if (instr->type != nir_instr_type_intrinsic)
+         continue;
+
+      nir_intrinsic_instr *store = nir_instr_as_intrinsic(instr);
+      nir_const_value *value = nir_src_as_const_value(store->src[0]);
+      ASSERT_TRUE(value != NULL);
+      ASSERT_LT(i, 6u);
+      EXPECT_EQ(expected[i], value->i[0]);
+      i++;
+   }
+   EXPECT_EQ(6u, i);
+}
+
+TEST_F(nir_loop_test, unroll_nested_loop)
+{
+   nir_loop *outer = nir_loop_create(shader);
+   nir_builder_cf_insert(&b, &outer->cf_node);
+
+   b.cursor = nir_after_cf_list(&outer->body);
+   build_counting_loop(nir_imm_int(&b, 0), nir_op_ige, nir_imm_int(&b, 2),
+                       nir_imm_int(&b, 1), NULL);
+
+   nir_jump_instr *jump = nir_jump_instr_create(shader, nir_jump_break);
+   nir_builder_instr_insert(&b, &jump->instr);
+   nir_validate_shader(shader);
+
+   /* The inner loop goes away; the outer one has no terminator. */
+   EXPECT_TRUE(nir_opt_loop_unroll(shader));
+   nir_validate_shader(shader);
+
+   EXPECT_EQ(1u, count_loops());
+   EXPECT_EQ(2u, count_stores());
+}
+
+TEST_F(nir_loop_test, dont_unroll_long_loop)
+{
+   build_counting_loop(nir_imm_int(&b, 0), nir_op_ige, nir_imm_int(&b, 100),
+                       nir_imm_int(&b, 1), NULL);
+   nir_validate_shader(shader);
+
+   EXPECT_FALSE(nir_opt_loop_unroll(shader));
+   EXPECT_EQ(1u, count_loops());
+}
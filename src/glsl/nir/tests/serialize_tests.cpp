@@ -0,0 +1,275 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_serialize.h"
+
+class nir_serialize_test : public ::testing::Test {
+protected:
+   nir_serialize_test();
+   ~nir_serialize_test();
+
+   nir_variable *create_variable(nir_variable_mode mode,
+                                 const struct glsl_type *type,
+                                 const char *name);
+   void build_loop();
+   char *print(nir_shader *nir);
+   nir_shader *round_trip();
+
+   nir_builder b;
+   nir_shader *shader;
+   nir_function_impl *impl;
+   void *mem_ctx;
+};
+
+static const nir_shader_compiler_options options = { };
+
+nir_serialize_test::nir_serialize_test()
+{
+   mem_ctx = ralloc_context(NULL);
+
+   shader = nir_shader_create(mem_ctx, MESA_SHADER_FRAGMENT, &options);
+   shader->info.name = ralloc_strdup(shader, "test");
+   nir_function *func = nir_function_create(shader, "main");
+   nir_function_overload *overload = nir_function_overload_create(func);
+   impl = nir_function_impl_create(overload);
+
+   nir_builder_init(&b, impl);
+   b.cursor = nir_after_cf_list(&impl->body);
+}
+
+nir_serialize_test::~nir_serialize_test()
+{
+   ralloc_free(mem_ctx);
+}
+
+nir_variable *
+nir_serialize_test::create_variable(nir_variable_mode mode,
+                                    const struct glsl_type *type,
+                                    const char *name)
+{
+   nir_variable *var = rzalloc(shader, nir_variable);
+   var->type = type;
+   var->name = ralloc_strdup(var, name);
+   var->data.mode = mode;
+
+   if (mode == nir_var_local)
+      exec_list_push_tail(&impl->locals, &var->node);
+   else
+      nir_shader_add_variable(shader, var);
+
+   return var;
+}
+
+/*
+ * Builds
+ *
+ * sum = 0.0;
+ * for (i = 0; i < limit; i++) {
+ *    if (i == 2)
+ *       sum += 1.0;
+ *    else
+ *       sum += texture(tex, vec2(sum)).x;
+ * }
+ * out = sum;
+ *
+ * with everything but the loop counter in variables, and then puts it into
+ * SSA form so that there are phis in the loop header and after the if.
+ */
+void
+nir_serialize_test::build_loop()
+{
+   nir_variable *limit =
+      create_variable(nir_var_uniform, glsl_uint_type(), "limit");
+   nir_variable *tex =
+      create_variable(nir_var_uniform,
+                      glsl_type::get_sampler_instance(GLSL_SAMPLER_DIM_2D,
+                                                      false, false,
+                                                      GLSL_TYPE_FLOAT),
+                      "tex");
+   nir_variable *out =
+      create_variable(nir_var_shader_out, glsl_vec4_type(), "out");
+   nir_variable *sum =
+      create_variable(nir_var_local, glsl_float_type(), "sum");
+   nir_variable *i =
+      create_variable(nir_var_local, glsl_uint_type(), "i");
+
+   nir_store_var(&b, sum, nir_imm_float(&b, 0.0f));
+   nir_store_var(&b, i, nir_imm_int(&b, 0));
+
+   nir_loop *loop = nir_loop_create(shader);
+   nir_builder_cf_insert(&b, &loop->cf_node);
+   b.cursor = nir_after_cf_list(&loop->body);
+
+   nir_if *exit = nir_if_create(shader);
+   exit->condition = nir_src_for_ssa(nir_uge(&b, nir_load_var(&b, i),
+                                             nir_load_var(&b, limit)));
+   nir_builder_cf_insert(&b, &exit->cf_node);
+   b.cursor = nir_after_cf_list(&exit->then_list);
+   nir_jump_instr *jump = nir_jump_instr_create(shader, nir_jump_break);
+   nir_builder_instr_insert(&b, &jump->instr);
+
+   b.cursor = nir_after_cf_list(&loop->body);
+   nir_if *nif = nir_if_create(shader);
+   nif->condition = nir_src_for_ssa(nir_ieq(&b, nir_load_var(&b, i),
+                                            nir_imm_int(&b, 2)));
+   nir_builder_cf_insert(&b, &nif->cf_node);
+
+   b.cursor = nir_after_cf_list(&nif->then_list);
+   nir_store_var(&b, sum, nir_fadd(&b, nir_load_var(&b, sum),
+                                   nir_imm_float(&b, 1.0f)));
+
+   b.cursor = nir_after_cf_list(&nif->else_list);
+   nir_tex_instr *tx = nir_tex_instr_create(shader, 1);
+   tx->op = nir_texop_tex;
+   tx->sampler_dim = GLSL_SAMPLER_DIM_2D;
+   tx->dest_type = nir_type_float;
+   tx->coord_components = 2;
+   tx->sampler = nir_deref_var_create(tx, tex);
+   tx->src[0].src_type = nir_tex_src_coord;
+   tx->src[0].src = nir_src_for_ssa(nir_vec2(&b, nir_load_var(&b, sum),
+                                             nir_load_var(&b, sum)));
+   nir_ssa_dest_init(&tx->instr, &tx->dest, 4, NULL);
+   nir_builder_instr_insert(&b, &tx->instr);
+   nir_store_var(&b, sum, nir_fadd(&b, nir_load_var(&b, sum),
+                                   nir_channel(&b, &tx->dest.ssa, 0)));
+
+   b.cursor = nir_after_cf_list(&loop->body);
+   nir_store_var(&b, i, nir_iadd(&b, nir_load_var(&b, i),
+                                 nir_imm_int(&b, 1)));
+
+   b.cursor = nir_after_cf_node(&loop->cf_node);
+   nir_store_var(&b, out, nir_vec4(&b, nir_load_var(&b, sum),
+                                   nir_imm_float(&b, 0.0f),
+                                   nir_imm_float(&b, 0.0f),
+                                   nir_imm_float(&b, 1.0f)));
+
+   nir_validate_shader(shader);
+   nir_lower_vars_to_ssa(shader);
+   nir_validate_shader(shader);
+}
+
+char *
+nir_serialize_test::print(nir_shader *nir)
+{
+   nir_foreach_overload(nir, overload) {
+      if (overload->impl)
+         nir_index_blocks(overload->impl);
+   }
+
+   char *str = NULL;
+   size_t size = 0;
+   FILE *fp = open_memstream(&str, &size);
+   nir_print_shader(nir, fp);
+   fclose(fp);
+
+   char *copy = ralloc_strdup(mem_ctx, str);
+   free(str);
+   return copy;
+}
+
+/*
+ * Serializes the shader, reads it back and checks that the copy is valid
+ * and prints the same as the original.
+ */
+nir_shader *
+nir_serialize_test::round_trip()
+{
+   struct blob *blob = blob_create(mem_ctx);
+   nir_serialize(blob, shader);
+
+   struct blob_reader reader;
+   blob_reader_init(&reader, blob->data, blob->size);
+   nir_shader *copy = nir_deserialize(mem_ctx, &options, &reader);
+
+   EXPECT_TRUE(copy != NULL);
+   if (copy == NULL)
+      return NULL;
+
+   EXPECT_EQ(reader.end, reader.current);
+   EXPECT_EQ(shader->options, copy->options);
+
+   nir_validate_shader(copy);
+   EXPECT_STREQ(print(shader), print(copy));
+
+   return copy;
+}
+
+TEST_F(nir_serialize_test, empty_shader)
+{
+   round_trip();
+}
+
+TEST_F(nir_serialize_test, ssa)
+{
+   build_loop();
+   EXPECT_TRUE(strstr(print(shader), "phi") != NULL);
+
+   round_trip();
+}
+
+TEST_F(nir_serialize_test, registers)
+{
+   build_loop();
+   nir_convert_from_ssa(shader, false);
+   nir_validate_shader(shader);
+
+   round_trip();
+}
+
+TEST_F(nir_serialize_test, variables)
+{
+   build_loop();
+   nir_shader *copy = round_trip();
+   ASSERT_TRUE(copy != NULL);
+
+   EXPECT_EQ(exec_list_length(&shader->uniforms),
+             exec_list_length(&copy->uniforms));
+   EXPECT_EQ(exec_list_length(&shader->outputs),
+             exec_list_length(&copy->outputs));
+
+   nir_variable *var = exec_node_data(nir_variable,
+                                      exec_list_get_head(&copy->uniforms),
+                                      node);
+   EXPECT_STREQ("limit", var->name);
+   EXPECT_EQ(glsl_uint_type(), var->type);
+   EXPECT_EQ(nir_var_uniform, var->data.mode);
+}
+
+TEST_F(nir_serialize_test, truncated)
+{
+   build_loop();
+
+   struct blob *blob = blob_create(mem_ctx);
+   nir_serialize(blob, shader);
+
+   /* Every prefix of the data must be rejected. */
+   for (size_t size = 0; size < blob->size; size++) {
+      struct blob_reader reader;
+      blob_reader_init(&reader, blob->data, size);
+      EXPECT_EQ(NULL, nir_deserialize(mem_ctx, &options, &reader));
+   }
+}
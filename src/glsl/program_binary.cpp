@@ -0,0 +1,1869 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file program_binary.cpp
+ *
+ * Serialization of linked GLSL programs, see program_binary.h.
+ *
+ * Everything is written in the order it is read back, with no tagging
+ * beyond what is needed to rebuild polymorphic IR nodes.  Variables and
+ * function signatures are referred to by the order in which they were
+ * first written, so the IR of every function body can only refer to
+ * variables declared before it, which is what ir_validate enforces anyway.
+ *
+ * Plain-old-data structures are copied as raw bytes, so a binary can only be
+ * read by the exact build that wrote it.  The header identifies that build
+ * and carries a checksum of the payload, and every index read back is
+ * checked against the array it refers to.
+ */
+
+#include "main/core.h"
+#include "main/shaderobj.h"
+#include "ir.h"
+#include "ir_uniform.h"
+#include "util/blob.h"
+#include "program_binary.h"
+#include "program/hash_table.h"
+#include "util/build_id.h"
+#include "util/hash_table.h"
+#include "util/ralloc.h"
+
+#define PROGRAM_BINARY_MAGIC   0x4d534c47 /* "GLSM" */
+#define PROGRAM_BINARY_VERSION 2
+
+/* Markers for NULL pointers in places where the IR allows them. */
+#define NULL_NODE_TAG   ir_type_max
+#define NO_INDEX        0xffffffffu
+
+/* Remap table entries. */
+#define REMAP_NULL      0
+#define REMAP_INACTIVE  1
+#define REMAP_FIRST     2
+
+/**
+ * Identity of the build and driver a binary was written by.
+ */
+extern "C" char *
+_mesa_glsl_program_binary_build_id(void *mem_ctx, struct gl_context *ctx)
+{
+   const GLubyte *renderer = NULL;
+   char *build = build_id_for_address(NULL, (const void *)
+                                      _mesa_glsl_program_binary_build_id);
+
+   if (build == NULL)
+      return NULL;
+
+   if (ctx->Driver.GetString)
+      renderer = ctx->Driver.GetString(ctx, GL_RENDERER);
+
+   char *id = ralloc_asprintf(mem_ctx, "%s\n%s\n%s\n%u %u %u %u", build,
+                              ctx->VersionString ? ctx->VersionString : "",
+                              renderer ? (const char *) renderer : "",
+                              (unsigned) ctx->API,
+                              ctx->Version,
+                              ctx->Const.UniformBooleanTrue,
+                              (unsigned) sizeof(void *));
+   ralloc_free(build);
+   return id;
+}
+
+namespace {
+
+static void
+split_blocks(void *mem_ctx, struct gl_uniform_block *blocks,
+             unsigned num_blocks,
+             struct gl_uniform_block ***ubos, unsigned *num_ubos,
+             struct gl_uniform_block ***ssbos, unsigned *num_ssbos)
+{
+   *ubos = ralloc_array(mem_ctx, gl_uniform_block *, num_blocks);
+   *ssbos = ralloc_array(mem_ctx, gl_uniform_block *, num_blocks);
+   *num_ubos = 0;
+   *num_ssbos = 0;
+
+   for (unsigned i = 0; i < num_blocks; i++) {
+      if (blocks[i].IsShaderStorage)
+         (*ssbos)[(*num_ssbos)++] = &blocks[i];
+      else
+         (*ubos)[(*num_ubos)++] = &blocks[i];
+   }
+}
+
+
+class program_writer {
+public:
+   program_writer(struct blob *blob)
+      : blob(blob), num_vars(0), num_sigs(0), error(false)
+   {
+      vars = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                                     _mesa_key_pointer_equal);
+      sigs = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                                     _mesa_key_pointer_equal);
+   }
+
+   ~program_writer()
+   {
+      _mesa_hash_table_destroy(vars, NULL);
+      _mesa_hash_table_destroy(sigs, NULL);
+   }
+
+   void write_program(struct gl_shader_program *prog);
+
+   struct blob *blob;
+
+   struct hash_table *vars;
+   struct hash_table *sigs;
+   unsigned num_vars;
+   unsigned num_sigs;
+
+   /** Set when something was found that can't be serialized. */
+   bool error;
+
+private:
+   void write_bytes(const void *data, size_t size)
+   {
+      blob_write_bytes(blob, data, size);
+   }
+
+   void write_uint(uint32_t value)
+   {
+      blob_write_uint32(blob, value);
+   }
+
+   void write_string(const char *str)
+   {
+      write_uint(str != NULL);
+      if (str)
+         blob_write_string(blob, str);
+   }
+
+   void write_type(const glsl_type *type);
+   void write_variable(ir_variable *var);
+   void write_variable_ref(ir_variable *var);
+   void write_rvalue(ir_rvalue *rv);
+   void write_instruction(ir_instruction *ir);
+   void write_instruction_list(exec_list *list);
+   void write_shader_ir(exec_list *ir);
+   void write_block(const struct gl_uniform_block *block);
+   void write_shader(struct gl_shader *sh);
+   void write_uniforms(struct gl_shader_program *prog);
+   void write_remap_entry(struct gl_shader_program *prog,
+                          struct gl_uniform_storage *entry);
+};
+
+
+void
+program_writer::write_type(const glsl_type *type)
+{
+   encode_type_to_blob(blob, type);
+}
+
+
+void
+program_writer::write_variable_ref(ir_variable *var)
+{
+   if (var == NULL) {
+      write_uint(NO_INDEX);
+      return;
+   }
+
+   struct hash_entry *entry = _mesa_hash_table_search(vars, var);
+   if (entry == NULL) {
+      error = true;
+      write_uint(NO_INDEX);
+      return;
+   }
+
+   write_uint((uint32_t) (uintptr_t) entry->data);
+}
+
+
+void
+program_writer::write_variable(ir_variable *var)
+{
+   _mesa_hash_table_insert(vars, var, (void *) (uintptr_t) num_vars++);
+
+   write_type(var->type);
+   write_string(var->is_name_ralloced() ? var->name : NULL);
+   write_bytes(&var->data, sizeof(var->data));
+
+   write_type(var->get_interface_type());
+   if (var->get_interface_type() != NULL && var->is_interface_instance()) {
+      const unsigned *max_access = var->get_max_ifc_array_access();
+
+      write_uint(max_access != NULL);
+      if (max_access != NULL) {
+         write_bytes(max_access,
+                     var->get_interface_type()->length * sizeof(unsigned));
+      }
+   } else {
+      const unsigned num_slots = var->get_num_state_slots();
+
+      write_uint(num_slots);
+      if (num_slots)
+         write_bytes(var->get_state_slots(), num_slots * sizeof(ir_state_slot));
+   }
+
+   write_rvalue(var->constant_value);
+   write_rvalue(var->constant_initializer);
+}
+
+
+void
+program_writer::write_rvalue(ir_rvalue *rv)
+{
+   if (rv == NULL) {
+      write_uint(NULL_NODE_TAG);
+      return;
+   }
+
+   write_uint(rv->ir_type);
+   write_type(rv->type);
+
+   switch (rv->ir_type) {
+   case ir_type_dereference_variable:
+      write_variable_ref(((ir_dereference_variable *) rv)->var);
+      break;
+
+   case ir_type_dereference_array: {
+      ir_dereference_array *deref = (ir_dereference_array *) rv;
+      write_rvalue(deref->array);
+      write_rvalue(deref->array_index);
+      break;
+   }
+
+   case ir_type_dereference_record: {
+      ir_dereference_record *deref = (ir_dereference_record *) rv;
+      write_rvalue(deref->record);
+      blob_write_string(blob, deref->field);
+      break;
+   }
+
+   case ir_type_constant: {
+      ir_constant *c = (ir_constant *) rv;
+
+      if (c->type->is_array()) {
+         for (unsigned i = 0; i < c->type->length; i++)
+            write_rvalue(c->array_elements[i]);
+      } else if (c->type->is_record()) {
+         foreach_in_list(ir_constant, field, &c->components)
+            write_rvalue(field);
+      } else {
+         write_bytes(&c->value, sizeof(c->value));
+      }
+      break;
+   }
+
+   case ir_type_expression: {
+      ir_expression *expr = (ir_expression *) rv;
+      write_uint(expr->operation);
+      for (unsigned i = 0; i < ARRAY_SIZE(expr->operands); i++)
+         write_rvalue(expr->operands[i]);
+      break;
+   }
+
+   case ir_type_swizzle: {
+      ir_swizzle *swiz = (ir_swizzle *) rv;
+      write_rvalue(swiz->val);
+      write_bytes(&swiz->mask, sizeof(swiz->mask));
+      break;
+   }
+
+   case ir_type_texture: {
+      ir_texture *tex = (ir_texture *) rv;
+      write_uint(tex->op);
+      write_rvalue(tex->sampler);
+      write_rvalue(tex->coordinate);
+      write_rvalue(tex->projector);
+      write_rvalue(tex->shadow_comparitor);
+      write_rvalue(tex->offset);
+
+      switch (tex->op) {
+      case ir_tex:
+      case ir_lod:
+      case ir_query_levels:
+      case ir_texture_samples:
+         break;
+      case ir_txb:
+         write_rvalue(tex->lod_info.bias);
+         break;
+      case ir_txl:
+      case ir_txf:
+      case ir_txs:
+         write_rvalue(tex->lod_info.lod);
+         break;
+      case ir_txf_ms:
+         write_rvalue(tex->lod_info.sample_index);
+         break;
+      case ir_txd:
+         write_rvalue(tex->lod_info.grad.dPdx);
+         write_rvalue(tex->lod_info.grad.dPdy);
+         break;
+      case ir_tg4:
+         write_rvalue(tex->lod_info.component);
+         break;
+      }
+      break;
+   }
+
+   default:
+      error = true;
+      break;
+   }
+}
+
+
+void
+program_writer::write_instruction_list(exec_list *list)
+{
+   write_uint(list->length());
+
+   foreach_in_list(ir_instruction, ir, list)
+      write_instruction(ir);
+}
+
+
+void
+program_writer::write_instruction(ir_instruction *ir)
+{
+   if (ir->is_rvalue()) {
+      /* Bare rvalues are legal, if useless, statements. */
+      write_rvalue((ir_rvalue *) ir);
+      return;
+   }
+
+   write_uint(ir->ir_type);
+
+   switch (ir->ir_type) {
+   case ir_type_variable:
+      write_variable((ir_variable *) ir);
+      break;
+
+   case ir_type_assignment: {
+      ir_assignment *assign = (ir_assignment *) ir;
+      write_rvalue(assign->lhs);
+      write_rvalue(assign->rhs);
+      write_rvalue(assign->condition);
+      write_uint(assign->write_mask);
+      break;
+   }
+
+   case ir_type_call: {
+      ir_call *call = (ir_call *) ir;
+      struct hash_entry *entry = _mesa_hash_table_search(sigs, call->callee);
+
+      if (entry == NULL) {
+         error = true;
+         return;
+      }
+
+      write_uint((uint32_t) (uintptr_t) entry->data);
+      write_rvalue(call->return_deref);
+      write_uint(call->actual_parameters.length());
+      foreach_in_list(ir_rvalue, param, &call->actual_parameters)
+         write_rvalue(param);
+      write_uint(call->use_builtin);
+      write_variable_ref(call->sub_var);
+      write_rvalue(call->array_idx);
+      break;
+   }
+
+   case ir_type_if: {
+      ir_if *iff = (ir_if *) ir;
+      write_rvalue(iff->condition);
+      write_instruction_list(&iff->then_instructions);
+      write_instruction_list(&iff->else_instructions);
+      break;
+   }
+
+   case ir_type_loop:
+      write_instruction_list(&((ir_loop *) ir)->body_instructions);
+      break;
+
+   case ir_type_loop_jump:
+      write_uint(((ir_loop_jump *) ir)->mode);
+      break;
+
+   case ir_type_return:
+      write_rvalue(((ir_return *) ir)->value);
+      break;
+
+   case ir_type_discard:
+      write_rvalue(((ir_discard *) ir)->condition);
+      break;
+
+   case ir_type_emit_vertex:
+      write_rvalue(((ir_emit_vertex *) ir)->stream);
+      break;
+
+   case ir_type_end_primitive:
+      write_rvalue(((ir_end_primitive *) ir)->stream);
+      break;
+
+   case ir_type_barrier:
+      break;
+
+   default:
+      /* Functions can only appear at the top level. */
+      error = true;
+      break;
+   }
+}
+
+
+/**
+ * Write the top-level IR of a linked shader.
+ *
+ * Calls may refer to functions defined later in the list, so all global
+ * variables and function prototypes are written first and the function
+ * bodies second.
+ */
+void
+program_writer::write_shader_ir(exec_list *ir)
+{
+   write_uint(ir->length());
+
+   foreach_in_list(ir_instruction, node, ir) {
+      write_uint(node->ir_type);
+
+      if (node->ir_type == ir_type_variable) {
+         write_variable((ir_variable *) node);
+         continue;
+      }
+
+      if (node->ir_type != ir_type_function) {
+         error = true;
+         return;
+      }
+
+      ir_function *f = (ir_function *) node;
+      blob_write_string(blob, f->name);
+      write_uint(f->is_subroutine);
+      write_uint(f->num_subroutine_types);
+      for (int i = 0; i < f->num_subroutine_types; i++)
+         write_type(f->subroutine_types[i]);
+
+      write_uint(f->signatures.length());
+      foreach_in_list(ir_function_signature, sig, &f->signatures) {
+         _mesa_hash_table_insert(sigs, sig, (void *) (uintptr_t) num_sigs++);
+
+         write_type(sig->return_type);
+         write_uint(sig->is_defined);
+         write_uint(sig->is_intrinsic);
+         write_uint(sig->parameters.length());
+         foreach_in_list(ir_variable, param, &sig->parameters)
+            write_variable(param);
+      }
+   }
+
+   foreach_in_list(ir_instruction, node, ir) {
+      if (node->ir_type != ir_type_function)
+         continue;
+
+      foreach_in_list(ir_function_signature, sig,
+                      &((ir_function *) node)->signatures)
+         write_instruction_list(&sig->body);
+   }
+}
+
+
+void
+program_writer::write_block(const struct gl_uniform_block *block)
+{
+   write_bytes(block, sizeof(*block));
+   blob_write_string(blob, block->Name);
+
+   for (unsigned i = 0; i < block->NumUniforms; i++) {
+      const struct gl_uniform_buffer_variable *var = &block->Uniforms[i];
+
+      write_bytes(var, sizeof(*var));
+      blob_write_string(blob, var->Name);
+      write_uint(var->IndexName == var->Name);
+      if (var->IndexName != var->Name)
+         blob_write_string(blob, var->IndexName);
+      write_type(var->Type);
+   }
+}
+
+
+void
+program_writer::write_shader(struct gl_shader *sh)
+{
+   write_uint(sh->Type);
+   write_uint(sh->Version);
+   write_uint(sh->IsES);
+
+   write_uint(sh->num_samplers);
+   write_uint(sh->active_samplers);
+   write_uint(sh->shadow_samplers);
+   write_bytes(sh->SamplerUnits, sizeof(sh->SamplerUnits));
+   write_bytes(sh->SamplerTargets, sizeof(sh->SamplerTargets));
+   write_uint(sh->num_uniform_components);
+   write_uint(sh->num_combined_uniform_components);
+
+   write_uint(sh->uses_gl_fragcoord);
+   write_uint(sh->redeclares_gl_fragcoord);
+   write_uint(sh->ARB_fragment_coord_conventions_enable);
+   write_uint(sh->origin_upper_left);
+   write_uint(sh->pixel_center_integer);
+
+   write_bytes(&sh->TessCtrl, sizeof(sh->TessCtrl));
+   write_bytes(&sh->TessEval, sizeof(sh->TessEval));
+   write_bytes(&sh->Geom, sizeof(sh->Geom));
+   write_bytes(&sh->Comp, sizeof(sh->Comp));
+   write_bytes(sh->ImageUnits, sizeof(sh->ImageUnits));
+   write_bytes(sh->ImageAccess, sizeof(sh->ImageAccess));
+   write_uint(sh->NumImages);
+   write_uint(sh->EarlyFragmentTests);
+
+   write_uint(sh->NumBufferInterfaceBlocks);
+   for (unsigned i = 0; i < sh->NumBufferInterfaceBlocks; i++)
+      write_block(&sh->BufferInterfaceBlocks[i]);
+
+   write_uint(sh->NumSubroutineUniformTypes);
+   write_uint(sh->NumSubroutineFunctions);
+   for (unsigned i = 0; i < sh->NumSubroutineFunctions; i++) {
+      struct gl_subroutine_function *fn = &sh->SubroutineFunctions[i];
+
+      blob_write_string(blob, fn->name);
+      write_uint(fn->num_compat_types);
+      for (int j = 0; j < fn->num_compat_types; j++)
+         write_type(fn->types[j]);
+   }
+
+   write_shader_ir(sh->ir);
+}
+
+
+void
+program_writer::write_remap_entry(struct gl_shader_program *prog,
+                                  struct gl_uniform_storage *entry)
+{
+   if (entry == NULL)
+      write_uint(REMAP_NULL);
+   else if (entry == INACTIVE_UNIFORM_EXPLICIT_LOCATION)
+      write_uint(REMAP_INACTIVE);
+   else
+      write_uint(REMAP_FIRST + (entry - prog->UniformStorage));
+}
+
+
+/**
+ * Number of gl_constant_value slots backing a uniform, mirroring what
+ * link_assign_uniform_locations allocates for it.
+ */
+static unsigned
+uniform_storage_slots(const struct gl_uniform_storage *uni)
+{
+   const unsigned elements = MAX2(1, uni->array_elements);
+
+   if (uni->type->is_sampler())
+      return elements;
+
+   return uni->type->component_slots() * elements;
+}
+
+
+void
+program_writer::write_uniforms(struct gl_shader_program *prog)
+{
+   union gl_constant_value *base = NULL;
+   unsigned num_slots = 0;
+
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      union gl_constant_value *storage = prog->UniformStorage[i].storage;
+
+      if (storage != NULL && (base == NULL || storage < base))
+         base = storage;
+   }
+
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      const struct gl_uniform_storage *uni = &prog->UniformStorage[i];
+
+      if (uni->storage != NULL) {
+         num_slots = MAX2(num_slots, (unsigned) (uni->storage - base) +
+                                     uniform_storage_slots(uni));
+      }
+   }
+
+   write_uint(prog->NumUniformStorage);
+   write_uint(prog->NumHiddenUniforms);
+   write_uint(num_slots);
+
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      const struct gl_uniform_storage *uni = &prog->UniformStorage[i];
+
+      write_bytes(uni, sizeof(*uni));
+      blob_write_string(blob, uni->name);
+      write_type(uni->type);
+      write_uint(uni->storage ? (uint32_t) (uni->storage - base) : NO_INDEX);
+   }
+
+   if (num_slots)
+      write_bytes(base, num_slots * sizeof(*base));
+
+   write_uint(prog->NumUniformRemapTable);
+   for (unsigned i = 0; i < prog->NumUniformRemapTable; i++)
+      write_remap_entry(prog, prog->UniformRemapTable[i]);
+}
+
+
+void
+program_writer::write_program(struct gl_shader_program *prog)
+{
+   write_uint(prog->Version);
+   write_uint(prog->IsES);
+   write_uint(prog->SeparateShader);
+   write_uint(prog->ARB_fragment_coord_conventions_enable);
+   write_uint(prog->FragDepthLayout);
+   write_uint(prog->LastClipDistanceArraySize);
+   write_bytes(&prog->TessCtrl, sizeof(prog->TessCtrl));
+   write_bytes(&prog->TessEval, sizeof(prog->TessEval));
+   write_bytes(&prog->Geom, sizeof(prog->Geom));
+   write_bytes(&prog->Vert, sizeof(prog->Vert));
+   write_bytes(&prog->Comp, sizeof(prog->Comp));
+
+   /* Transform feedback */
+   const struct gl_transform_feedback_info *xfb =
+      &prog->LinkedTransformFeedback;
+   write_bytes(xfb, sizeof(*xfb));
+   write_bytes(xfb->Outputs, xfb->NumOutputs * sizeof(xfb->Outputs[0]));
+   for (int i = 0; i < xfb->NumVarying; i++) {
+      blob_write_string(blob, xfb->Varyings[i].Name);
+      write_uint(xfb->Varyings[i].Type);
+      write_uint(xfb->Varyings[i].Size);
+   }
+
+   /* Linked shaders */
+   unsigned stages = 0;
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i] != NULL)
+         stages |= 1 << i;
+   }
+
+   write_uint(stages);
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i] != NULL)
+         write_shader(prog->_LinkedShaders[i]);
+   }
+
+   write_uniforms(prog);
+
+   /* Subroutine uniform locations point into the program's uniform storage,
+    * so they can only be restored after it.
+    */
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      struct gl_shader *sh = prog->_LinkedShaders[i];
+
+      if (sh == NULL)
+         continue;
+
+      write_uint(sh->NumSubroutineUniformRemapTable);
+      for (unsigned j = 0; j < sh->NumSubroutineUniformRemapTable; j++)
+         write_remap_entry(prog, sh->SubroutineUniformRemapTable[j]);
+   }
+
+   /* Program-wide uniform and shader storage blocks */
+   unsigned num_stage_blocks = 0;
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i])
+         num_stage_blocks += prog->_LinkedShaders[i]->NumBufferInterfaceBlocks;
+   }
+
+   write_uint(prog->NumBufferInterfaceBlocks);
+   for (unsigned i = 0; i < prog->NumBufferInterfaceBlocks; i++)
+      write_block(&prog->BufferInterfaceBlocks[i]);
+
+   write_uint(num_stage_blocks);
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      write_uint(prog->UniformBlockStageIndex[i] != NULL);
+      if (prog->UniformBlockStageIndex[i] != NULL) {
+         write_bytes(prog->UniformBlockStageIndex[i],
+                     num_stage_blocks * sizeof(int));
+      }
+   }
+
+   /* Atomic counter buffers */
+   write_uint(prog->NumAtomicBuffers);
+   for (unsigned i = 0; i < prog->NumAtomicBuffers; i++) {
+      const struct gl_active_atomic_buffer *ab = &prog->AtomicBuffers[i];
+
+      write_bytes(ab, sizeof(*ab));
+      write_bytes(ab->Uniforms, ab->NumUniforms * sizeof(ab->Uniforms[0]));
+   }
+}
+
+
+class program_reader {
+public:
+   program_reader(struct gl_context *ctx, const uint8_t *data, size_t size)
+      : ctx(ctx), mem_ctx(NULL), vars(NULL), num_vars(0), vars_size(0),
+        sigs(NULL), num_sigs(0), sigs_size(0), error(false)
+   {
+      blob_reader_init(&blob, (uint8_t *) data, size);
+      tmp_ctx = ralloc_context(NULL);
+   }
+
+   ~program_reader()
+   {
+      ralloc_free(tmp_ctx);
+   }
+
+   bool read_program(struct gl_shader_program *prog);
+
+   struct blob_reader blob;
+   struct gl_context *ctx;
+
+   /** Owner of IR nodes being read, the linked shader's IR list. */
+   void *mem_ctx;
+
+   /** Owner of scratch allocations. */
+   void *tmp_ctx;
+
+   ir_variable **vars;
+   unsigned num_vars;
+   unsigned vars_size;
+
+   ir_function_signature **sigs;
+   unsigned num_sigs;
+   unsigned sigs_size;
+
+   bool error;
+
+   bool failed()
+   {
+      return error || blob.overrun;
+   }
+
+   /** Bytes left, used to reject absurd counts before allocating. */
+   size_t remaining()
+   {
+      return blob.end - blob.current;
+   }
+
+   void read_bytes(void *dst, size_t size)
+   {
+      blob_copy_bytes(&blob, (uint8_t *) dst, size);
+   }
+
+   uint32_t read_uint()
+   {
+      return blob_read_uint32(&blob);
+   }
+
+   const char *read_string()
+   {
+      const char *str = blob_read_string(&blob);
+
+      if (str == NULL)
+         error = true;
+      return str;
+   }
+
+   const char *read_nullable_string()
+   {
+      return read_uint() ? read_string() : NULL;
+   }
+
+private:
+   const glsl_type *read_type();
+   ir_variable *read_variable();
+   ir_variable *read_variable_ref();
+   ir_rvalue *read_rvalue();
+   ir_rvalue *read_rvalue_body(unsigned tag);
+   ir_instruction *read_instruction();
+   bool read_instruction_list(exec_list *list);
+   bool read_shader_ir(exec_list *ir);
+   bool read_block(void *mem_ctx, struct gl_uniform_block *block);
+   struct gl_shader *read_shader();
+   bool read_uniforms(struct gl_shader_program *prog);
+   bool read_remap_entry(struct gl_shader_program *prog,
+                         struct gl_uniform_storage **entry);
+   bool validate_shader(const struct gl_shader *sh);
+   bool validate_program(const struct gl_shader_program *prog);
+};
+
+
+const glsl_type *
+program_reader::read_type()
+{
+   return decode_type_from_blob(&blob);
+}
+
+
+ir_variable *
+program_reader::read_variable_ref()
+{
+   const unsigned index = read_uint();
+
+   if (index == NO_INDEX)
+      return NULL;
+
+   if (index >= num_vars) {
+      error = true;
+      return NULL;
+   }
+
+   return vars[index];
+}
+
+
+ir_variable *
+program_reader::read_variable()
+{
+   const glsl_type *type = read_type();
+   const char *name = read_nullable_string();
+   ir_variable::ir_variable_data data;
+
+   read_bytes(&data, sizeof(data));
+   if (type == NULL || failed() || data.mode >= ir_var_mode_count)
+      return NULL;
+
+   ir_variable *var =
+      new(mem_ctx) ir_variable(type, name, (ir_variable_mode) data.mode);
+
+   /* The data copy includes the state slot count, which only stays valid
+    * once the slots themselves have been allocated below.
+    */
+   var->data = data;
+
+   const glsl_type *interface_type = read_type();
+   if (interface_type != NULL) {
+      if (var->get_interface_type() == NULL)
+         var->init_interface_type(interface_type);
+      else
+         var->change_interface_type(interface_type);
+   }
+
+   if (interface_type != NULL && var->is_interface_instance()) {
+      if (read_uint()) {
+         unsigned *max_access = var->get_max_ifc_array_access();
+
+         if (max_access == NULL) {
+            error = true;
+            return NULL;
+         }
+         read_bytes(max_access, interface_type->length * sizeof(unsigned));
+      }
+   } else {
+      const unsigned num_slots = read_uint();
+
+      if (num_slots) {
+         if (num_slots > remaining()) {
+            error = true;
+            return NULL;
+         }
+         read_bytes(var->allocate_state_slots(num_slots),
+                    num_slots * sizeof(ir_state_slot));
+      } else {
+         var->set_num_state_slots(0);
+      }
+   }
+
+   if (num_vars == vars_size) {
+      vars_size = MAX2(64, vars_size * 2);
+      vars = reralloc(tmp_ctx, vars, ir_variable *, vars_size);
+   }
+   vars[num_vars++] = var;
+
+   ir_rvalue *value = read_rvalue();
+   ir_rvalue *initializer = read_rvalue();
+   var->constant_value = value ? value->as_constant() : NULL;
+   var->constant_initializer = initializer ? initializer->as_constant() : NULL;
+
+   return failed() ? NULL : var;
+}
+
+
+ir_rvalue *
+program_reader::read_rvalue()
+{
+   const unsigned tag = read_uint();
+
+   if (tag == NULL_NODE_TAG || failed())
+      return NULL;
+
+   ir_rvalue *rv = read_rvalue_body(tag);
+
+   if (rv == NULL)
+      error = true;
+
+   return rv;
+}
+
+
+/**
+ * Read an rvalue whose tag has already been consumed.
+ */
+ir_rvalue *
+program_reader::read_rvalue_body(unsigned tag)
+{
+   const glsl_type *type = read_type();
+   ir_rvalue *rv = NULL;
+
+   if (type == NULL || failed())
+      return NULL;
+
+   switch (tag) {
+   case ir_type_dereference_variable: {
+      ir_variable *var = read_variable_ref();
+      if (var)
+         rv = new(mem_ctx) ir_dereference_variable(var);
+      break;
+   }
+
+   case ir_type_dereference_array: {
+      ir_rvalue *array = read_rvalue();
+      ir_rvalue *index = read_rvalue();
+      if (array && index)
+         rv = new(mem_ctx) ir_dereference_array(array, index);
+      break;
+   }
+
+   case ir_type_dereference_record: {
+      ir_rvalue *record = read_rvalue();
+      const char *field = read_string();
+      if (record && field)
+         rv = new(mem_ctx) ir_dereference_record(record, field);
+      break;
+   }
+
+   case ir_type_constant: {
+      if (type->is_array() || type->is_record()) {
+         exec_list values;
+
+         for (unsigned i = 0; i < type->length; i++) {
+            ir_rvalue *value = read_rvalue();
+            if (value == NULL || value->as_constant() == NULL)
+               return NULL;
+            values.push_tail(value);
+         }
+         rv = new(mem_ctx) ir_constant(type, &values);
+      } else {
+         ir_constant_data data;
+         read_bytes(&data, sizeof(data));
+         rv = new(mem_ctx) ir_constant(type, &data);
+      }
+      break;
+   }
+
+   case ir_type_expression: {
+      const unsigned op = read_uint();
+      ir_rvalue *operands[4];
+
+      for (unsigned i = 0; i < ARRAY_SIZE(operands); i++)
+         operands[i] = read_rvalue();
+
+      if (op > ir_last_opcode || operands[0] == NULL || failed())
+         return NULL;
+
+      rv = new(mem_ctx) ir_expression(op, type, operands[0], operands[1],
+                                      operands[2], operands[3]);
+      break;
+   }
+
+   case ir_type_swizzle: {
+      ir_rvalue *val = read_rvalue();
+      ir_swizzle_mask mask;
+      read_bytes(&mask, sizeof(mask));
+      if (val)
+         rv = new(mem_ctx) ir_swizzle(val, mask);
+      break;
+   }
+
+   case ir_type_texture: {
+      const unsigned op = read_uint();
+      ir_texture *tex = new(mem_ctx) ir_texture((ir_texture_opcode) op);
+      ir_rvalue *sampler = read_rvalue();
+
+      tex->sampler = sampler ? sampler->as_dereference() : NULL;
+      tex->coordinate = read_rvalue();
+      tex->projector = read_rvalue();
+      tex->shadow_comparitor = read_rvalue();
+      tex->offset = read_rvalue();
+
+      switch (tex->op) {
+      case ir_tex:
+      case ir_lod:
+      case ir_query_levels:
+      case ir_texture_samples:
+         break;
+      case ir_txb:
+         tex->lod_info.bias = read_rvalue();
+         break;
+      case ir_txl:
+      case ir_txf:
+      case ir_txs:
+         tex->lod_info.lod = read_rvalue();
+         break;
+      case ir_txf_ms:
+         tex->lod_info.sample_index = read_rvalue();
+         break;
+      case ir_txd:
+         tex->lod_info.grad.dPdx = read_rvalue();
+         tex->lod_info.grad.dPdy = read_rvalue();
+         break;
+      case ir_tg4:
+         tex->lod_info.component = read_rvalue();
+         break;
+      default:
+         return NULL;
+      }
+
+      if (tex->sampler != NULL)
+         rv = tex;
+      break;
+   }
+
+   default:
+      return NULL;
+   }
+
+   if (rv == NULL || failed())
+      return NULL;
+
+   rv->type = type;
+   return rv;
+}
+
+
+bool
+program_reader::read_instruction_list(exec_list *list)
+{
+   const unsigned length = read_uint();
+
+   if (length > remaining())
+      return false;
+
+   for (unsigned i = 0; i < length; i++) {
+      ir_instruction *ir = read_instruction();
+
+      if (ir == NULL)
+         return false;
+
+      list->push_tail(ir);
+   }
+
+   return !failed();
+}
+
+
+ir_instruction *
+program_reader::read_instruction()
+{
+   const unsigned tag = read_uint();
+
+   if (failed())
+      return NULL;
+
+   switch (tag) {
+   case ir_type_dereference_array:
+   case ir_type_dereference_record:
+   case ir_type_dereference_variable:
+   case ir_type_constant:
+   case ir_type_expression:
+   case ir_type_swizzle:
+   case ir_type_texture:
+      return read_rvalue_body(tag);
+
+   case ir_type_variable:
+      return read_variable();
+
+   case ir_type_assignment: {
+      ir_rvalue *lhs = read_rvalue();
+      ir_rvalue *rhs = read_rvalue();
+      ir_rvalue *condition = read_rvalue();
+      const unsigned write_mask = read_uint();
+
+      if (lhs == NULL || lhs->as_dereference() == NULL || rhs == NULL ||
+          failed())
+         return NULL;
+
+      return new(mem_ctx) ir_assignment(lhs->as_dereference(), rhs,
+                                        condition, write_mask);
+   }
+
+   case ir_type_call: {
+      const unsigned index = read_uint();
+      ir_rvalue *return_deref = read_rvalue();
+      const unsigned num_params = read_uint();
+      exec_list params;
+
+      if (index >= num_sigs || num_params > remaining())
+         return NULL;
+
+      for (unsigned i = 0; i < num_params; i++) {
+         ir_rvalue *param = read_rvalue();
+         if (param == NULL)
+            return NULL;
+         params.push_tail(param);
+      }
+
+      const bool use_builtin = read_uint();
+      ir_variable *sub_var = read_variable_ref();
+      ir_rvalue *array_idx = read_rvalue();
+
+      if (failed() || (return_deref != NULL &&
+                       return_deref->as_dereference_variable() == NULL))
+         return NULL;
+
+      ir_call *call =
+         new(mem_ctx) ir_call(sigs[index],
+                              return_deref ?
+                              return_deref->as_dereference_variable() : NULL,
+                              &params, sub_var, array_idx);
+      call->use_builtin = use_builtin;
+      return call;
+   }
+
+   case ir_type_if: {
+      ir_rvalue *condition = read_rvalue();
+
+      if (condition == NULL)
+         return NULL;
+
+      ir_if *iff = new(mem_ctx) ir_if(condition);
+      if (!read_instruction_list(&iff->then_instructions) ||
+          !read_instruction_list(&iff->else_instructions))
+         return NULL;
+      return iff;
+   }
+
+   case ir_type_loop: {
+      ir_loop *loop = new(mem_ctx) ir_loop();
+      if (!read_instruction_list(&loop->body_instructions))
+         return NULL;
+      return loop;
+   }
+
+   case ir_type_loop_jump: {
+      const unsigned mode = read_uint();
+      if (mode != ir_loop_jump::jump_break &&
+          mode != ir_loop_jump::jump_continue)
+         return NULL;
+      return new(mem_ctx) ir_loop_jump((ir_loop_jump::jump_mode) mode);
+   }
+
+   case ir_type_return:
+      return new(mem_ctx) ir_return(read_rvalue());
+
+   case ir_type_discard:
+      return new(mem_ctx) ir_discard(read_rvalue());
+
+   case ir_type_emit_vertex: {
+      ir_rvalue *stream = read_rvalue();
+      return stream ? new(mem_ctx) ir_emit_vertex(stream) : NULL;
+   }
+
+   case ir_type_end_primitive: {
+      ir_rvalue *stream = read_rvalue();
+      return stream ? new(mem_ctx) ir_end_primitive(stream) : NULL;
+   }
+
+   case ir_type_barrier:
+      return new(mem_ctx) ir_barrier();
+
+   default:
+      return NULL;
+   }
+}
+
+
+bool
+program_reader::read_shader_ir(exec_list *ir)
+{
+   const unsigned length = read_uint();
+
+   if (length > remaining())
+      return false;
+
+   for (unsigned i = 0; i < length; i++) {
+      const unsigned tag = read_uint();
+
+      if (tag == ir_type_variable) {
+         ir_variable *var = read_variable();
+         if (var == NULL)
+            return false;
+         ir->push_tail(var);
+         continue;
+      }
+
+      if (tag != ir_type_function)
+         return false;
+
+      const char *name = read_string();
+      if (name == NULL)
+         return false;
+
+      ir_function *f = new(mem_ctx) ir_function(name);
+      f->is_subroutine = read_uint();
+      f->num_subroutine_types = read_uint();
+      if (f->num_subroutine_types < 0 ||
+          f->num_subroutine_types > remaining())
+         return false;
+
+      f->subroutine_types = ralloc_array(f, const struct glsl_type *,
+                                         f->num_subroutine_types);
+      for (int j = 0; j < f->num_subroutine_types; j++)
+         f->subroutine_types[j] = read_type();
+
+      const unsigned num_signatures = read_uint();
+      if (num_signatures > remaining())
+         return false;
+
+      for (unsigned j = 0; j < num_signatures; j++) {
+         const glsl_type *return_type = read_type();
+
+         if (return_type == NULL)
+            return false;
+
+         ir_function_signature *sig =
+            new(mem_ctx) ir_function_signature(return_type);
+         sig->is_defined = read_uint();
+         sig->is_intrinsic = read_uint();
+
+         const unsigned num_params = read_uint();
+         if (num_params > remaining())
+            return false;
+
+         for (unsigned k = 0; k < num_params; k++) {
+            ir_variable *param = read_variable();
+            if (param == NULL)
+               return false;
+            sig->parameters.push_tail(param);
+         }
+
+         f->add_signature(sig);
+
+         if (num_sigs == sigs_size) {
+            sigs_size = MAX2(16, sigs_size * 2);
+            sigs = reralloc(tmp_ctx, sigs, ir_function_signature *, sigs_size);
+         }
+         sigs[num_sigs++] = sig;
+      }
+
+      ir->push_tail(f);
+   }
+
+   foreach_in_list(ir_instruction, node, ir) {
+      if (node->ir_type != ir_type_function)
+         continue;
+
+      foreach_in_list(ir_function_signature, sig,
+                      &((ir_function *) node)->signatures) {
+         if (!read_instruction_list(&sig->body))
+            return false;
+      }
+   }
+
+   return !failed();
+}
+
+
+bool
+program_reader::read_block(void *mem_ctx, struct gl_uniform_block *block)
+{
+   read_bytes(block, sizeof(*block));
+   block->Name = ralloc_strdup(mem_ctx, read_string());
+
+   if (failed() || block->NumUniforms > remaining()) {
+      block->NumUniforms = 0;
+      block->Uniforms = NULL;
+      return false;
+   }
+
+   block->Uniforms = ralloc_array(mem_ctx, gl_uniform_buffer_variable,
+                                  block->NumUniforms);
+
+   for (unsigned i = 0; i < block->NumUniforms; i++) {
+      struct gl_uniform_buffer_variable *var = &block->Uniforms[i];
+
+      read_bytes(var, sizeof(*var));
+      var->Name = ralloc_strdup(mem_ctx, read_string());
+      if (read_uint())
+         var->IndexName = var->Name;
+      else
+         var->IndexName = ralloc_strdup(mem_ctx, read_string());
+      var->Type = read_type();
+
+      if (var->Type == NULL || failed())
+         return false;
+   }
+
+   return true;
+}
+
+
+struct gl_shader *
+program_reader::read_shader()
+{
+   const GLenum type = read_uint();
+
+   switch (type) {
+   case GL_VERTEX_SHADER:
+   case GL_TESS_CONTROL_SHADER:
+   case GL_TESS_EVALUATION_SHADER:
+   case GL_GEOMETRY_SHADER:
+   case GL_FRAGMENT_SHADER:
+   case GL_COMPUTE_SHADER:
+      break;
+   default:
+      return NULL;
+   }
+
+   if (failed())
+      return NULL;
+
+   struct gl_shader *sh = ctx->Driver.NewShader(NULL, 0, type);
+   if (sh == NULL)
+      return NULL;
+
+   sh->Version = read_uint();
+   sh->IsES = read_uint();
+
+   sh->num_samplers = read_uint();
+   sh->active_samplers = read_uint();
+   sh->shadow_samplers = read_uint();
+   read_bytes(sh->SamplerUnits, sizeof(sh->SamplerUnits));
+   read_bytes(sh->SamplerTargets, sizeof(sh->SamplerTargets));
+   sh->num_uniform_components = read_uint();
+   sh->num_combined_uniform_components = read_uint();
+
+   sh->uses_gl_fragcoord = read_uint();
+   sh->redeclares_gl_fragcoord = read_uint();
+   sh->ARB_fragment_coord_conventions_enable = read_uint();
+   sh->origin_upper_left = read_uint();
+   sh->pixel_center_integer = read_uint();
+
+   read_bytes(&sh->TessCtrl, sizeof(sh->TessCtrl));
+   read_bytes(&sh->TessEval, sizeof(sh->TessEval));
+   read_bytes(&sh->Geom, sizeof(sh->Geom));
+   read_bytes(&sh->Comp, sizeof(sh->Comp));
+   read_bytes(sh->ImageUnits, sizeof(sh->ImageUnits));
+   read_bytes(sh->ImageAccess, sizeof(sh->ImageAccess));
+   sh->NumImages = read_uint();
+   sh->EarlyFragmentTests = read_uint();
+
+   const unsigned num_blocks = read_uint();
+   if (failed() || num_blocks > remaining())
+      goto fail;
+
+   sh->BufferInterfaceBlocks =
+      rzalloc_array(sh, gl_uniform_block, num_blocks);
+   sh->NumBufferInterfaceBlocks = num_blocks;
+   for (unsigned i = 0; i < num_blocks; i++) {
+      if (!read_block(sh->BufferInterfaceBlocks,
+                      &sh->BufferInterfaceBlocks[i]))
+         goto fail;
+   }
+
+   split_blocks(sh, sh->BufferInterfaceBlocks, sh->NumBufferInterfaceBlocks,
+                &sh->UniformBlocks, &sh->NumUniformBlocks,
+                &sh->ShaderStorageBlocks, &sh->NumShaderStorageBlocks);
+
+   sh->NumSubroutineUniformTypes = read_uint();
+   sh->NumSubroutineFunctions = read_uint();
+   if (failed() || sh->NumSubroutineFunctions > remaining()) {
+      sh->NumSubroutineFunctions = 0;
+      goto fail;
+   }
+
+   sh->SubroutineFunctions = rzalloc_array(sh, gl_subroutine_function,
+                                           sh->NumSubroutineFunctions);
+   for (unsigned i = 0; i < sh->NumSubroutineFunctions; i++) {
+      struct gl_subroutine_function *fn = &sh->SubroutineFunctions[i];
+
+      fn->name = ralloc_strdup(sh, read_string());
+      fn->num_compat_types = read_uint();
+      if (failed() || fn->num_compat_types < 0 ||
+          fn->num_compat_types > remaining()) {
+         fn->num_compat_types = 0;
+         goto fail;
+      }
+
+      fn->types = ralloc_array(sh, const struct glsl_type *,
+                               fn->num_compat_types);
+      for (int j = 0; j < fn->num_compat_types; j++)
+         fn->types[j] = read_type();
+   }
+
+   sh->ir = new(sh) exec_list;
+   mem_ctx = sh->ir;
+   num_vars = 0;
+   num_sigs = 0;
+
+   if (!read_shader_ir(sh->ir))
+      goto fail;
+
+   return sh;
+
+fail:
+   _mesa_delete_shader(ctx, sh);
+   return NULL;
+}
+
+
+bool
+program_reader::read_remap_entry(struct gl_shader_program *prog,
+                                 struct gl_uniform_storage **entry)
+{
+   const unsigned value = read_uint();
+
+   if (value == REMAP_NULL) {
+      *entry = NULL;
+   } else if (value == REMAP_INACTIVE) {
+      *entry = INACTIVE_UNIFORM_EXPLICIT_LOCATION;
+   } else if (value - REMAP_FIRST < prog->NumUniformStorage) {
+      *entry = &prog->UniformStorage[value - REMAP_FIRST];
+   } else {
+      return false;
+   }
+
+   return !failed();
+}
+
+
+bool
+program_reader::read_uniforms(struct gl_shader_program *prog)
+{
+   const unsigned num_uniforms = read_uint();
+   const unsigned num_hidden = read_uint();
+   const unsigned num_slots = read_uint();
+
+   if (failed() || num_uniforms > remaining() ||
+       num_slots > (remaining()) / sizeof(gl_constant_value))
+      return false;
+
+   prog->UniformHash = new string_to_uint_map;
+
+   if (num_uniforms == 0)
+      return true;
+
+   struct gl_uniform_storage *uniforms =
+      rzalloc_array(prog, struct gl_uniform_storage, num_uniforms);
+   union gl_constant_value *data =
+      rzalloc_array(uniforms, union gl_constant_value, num_slots);
+
+   prog->UniformStorage = uniforms;
+
+   for (unsigned i = 0; i < num_uniforms; i++) {
+      struct gl_uniform_storage *uni = &uniforms[i];
+
+      read_bytes(uni, sizeof(*uni));
+      uni->name = ralloc_strdup(uniforms, read_string());
+      uni->type = read_type();
+      uni->num_driver_storage = 0;
+      uni->driver_storage = NULL;
+
+      const unsigned offset = read_uint();
+      uni->storage = NULL;
+
+      /* Only count the uniform once it is fully valid, so that the driver
+       * storage detach in _mesa_clear_shader_program_data never sees
+       * garbage.
+       */
+      if (uni->name == NULL || uni->type == NULL || failed())
+         return false;
+
+      if (offset != NO_INDEX) {
+         if (offset > num_slots ||
+             uniform_storage_slots(uni) > num_slots - offset)
+            return false;
+         uni->storage = &data[offset];
+      }
+
+      prog->NumUniformStorage = i + 1;
+      prog->UniformHash->put(i, uni->name);
+   }
+
+   prog->NumHiddenUniforms = num_hidden;
+   read_bytes(data, num_slots * sizeof(*data));
+
+   const unsigned num_remap = read_uint();
+   if (failed() || num_remap > remaining())
+      return false;
+
+   prog->UniformRemapTable =
+      rzalloc_array(prog, struct gl_uniform_storage *, num_remap);
+   prog->NumUniformRemapTable = num_remap;
+   for (unsigned i = 0; i < num_remap; i++) {
+      if (!read_remap_entry(prog, &prog->UniformRemapTable[i]))
+         return false;
+   }
+
+   return !failed();
+}
+
+
+bool
+program_reader::read_program(struct gl_shader_program *prog)
+{
+   prog->Version = read_uint();
+   prog->IsES = read_uint();
+   prog->SeparateShader = read_uint();
+   prog->ARB_fragment_coord_conventions_enable = read_uint();
+   prog->FragDepthLayout = (gl_frag_depth_layout) read_uint();
+   prog->LastClipDistanceArraySize = read_uint();
+   read_bytes(&prog->TessCtrl, sizeof(prog->TessCtrl));
+   read_bytes(&prog->TessEval, sizeof(prog->TessEval));
+   read_bytes(&prog->Geom, sizeof(prog->Geom));
+   read_bytes(&prog->Vert, sizeof(prog->Vert));
+   read_bytes(&prog->Comp, sizeof(prog->Comp));
+
+   /* Transform feedback */
+   struct gl_transform_feedback_info *xfb = &prog->LinkedTransformFeedback;
+   ralloc_free(xfb->Varyings);
+   ralloc_free(xfb->Outputs);
+   read_bytes(xfb, sizeof(*xfb));
+   xfb->Outputs = NULL;
+   xfb->Varyings = NULL;
+
+   if (failed() || xfb->NumOutputs > remaining() ||
+       xfb->NumVarying < 0 || xfb->NumVarying > remaining()) {
+      memset(xfb, 0, sizeof(*xfb));
+      return false;
+   }
+
+   xfb->Outputs = ralloc_array(prog, struct gl_transform_feedback_output,
+                               xfb->NumOutputs);
+   read_bytes(xfb->Outputs, xfb->NumOutputs * sizeof(xfb->Outputs[0]));
+   xfb->Varyings = ralloc_array(prog, struct gl_transform_feedback_varying_info,
+                                xfb->NumVarying);
+   for (int i = 0; i < xfb->NumVarying; i++) {
+      xfb->Varyings[i].Name = ralloc_strdup(prog, read_string());
+      xfb->Varyings[i].Type = read_uint();
+      xfb->Varyings[i].Size = read_uint();
+   }
+
+   /* Linked shaders */
+   const unsigned stages = read_uint();
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (!(stages & (1 << i)))
+         continue;
+
+      struct gl_shader *sh = read_shader();
+      if (sh == NULL || sh->Stage != i) {
+         if (sh)
+            _mesa_delete_shader(ctx, sh);
+         return false;
+      }
+
+      prog->_LinkedShaders[i] = sh;
+   }
+
+   if (!read_uniforms(prog))
+      return false;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      struct gl_shader *sh = prog->_LinkedShaders[i];
+
+      if (sh == NULL)
+         continue;
+
+      const unsigned num_remap = read_uint();
+      if (failed() || num_remap > remaining())
+         return false;
+
+      sh->SubroutineUniformRemapTable =
+         rzalloc_array(sh, struct gl_uniform_storage *, num_remap);
+      sh->NumSubroutineUniformRemapTable = num_remap;
+      for (unsigned j = 0; j < num_remap; j++) {
+         if (!read_remap_entry(prog, &sh->SubroutineUniformRemapTable[j]))
+            return false;
+      }
+   }
+
+   /* Program-wide uniform and shader storage blocks */
+   const unsigned num_blocks = read_uint();
+   if (failed() || num_blocks > remaining())
+      return false;
+
+   prog->BufferInterfaceBlocks =
+      rzalloc_array(prog, struct gl_uniform_block, num_blocks);
+   prog->NumBufferInterfaceBlocks = num_blocks;
+   for (unsigned i = 0; i < num_blocks; i++) {
+      if (!read_block(prog->BufferInterfaceBlocks,
+                      &prog->BufferInterfaceBlocks[i]))
+         return false;
+   }
+
+   split_blocks(prog, prog->BufferInterfaceBlocks,
+                prog->NumBufferInterfaceBlocks,
+                &prog->UniformBlocks, &prog->NumUniformBlocks,
+                &prog->ShaderStorageBlocks, &prog->NumShaderStorageBlocks);
+
+   const unsigned num_stage_blocks = read_uint();
+   if (failed() || num_stage_blocks < prog->NumBufferInterfaceBlocks ||
+       num_stage_blocks > (remaining()) / sizeof(int))
+      return false;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (!read_uint())
+         continue;
+
+      prog->UniformBlockStageIndex[i] =
+         ralloc_array(prog, int, num_stage_blocks);
+      read_bytes(prog->UniformBlockStageIndex[i],
+                 num_stage_blocks * sizeof(int));
+   }
+
+   /* Atomic counter buffers */
+   const unsigned num_atomic_buffers = read_uint();
+   if (failed() || num_atomic_buffers > remaining())
+      return false;
+
+   prog->AtomicBuffers = rzalloc_array(prog, gl_active_atomic_buffer,
+                                       num_atomic_buffers);
+   prog->NumAtomicBuffers = num_atomic_buffers;
+   for (unsigned i = 0; i < num_atomic_buffers; i++) {
+      struct gl_active_atomic_buffer *ab = &prog->AtomicBuffers[i];
+
+      read_bytes(ab, sizeof(*ab));
+      if (failed() ||
+          ab->NumUniforms > (remaining()) / sizeof(GLuint)) {
+         ab->NumUniforms = 0;
+         ab->Uniforms = NULL;
+         return false;
+      }
+
+      ab->Uniforms = ralloc_array(prog->AtomicBuffers, GLuint,
+                                  ab->NumUniforms);
+      read_bytes(ab->Uniforms, ab->NumUniforms * sizeof(GLuint));
+   }
+
+   return !failed() && blob.current == blob.end && validate_program(prog);
+}
+
+
+/**
+ * Check the indices a linked shader stores in its raw structures, which
+ * drivers use without further checks.
+ */
+bool
+program_reader::validate_shader(const struct gl_shader *sh)
+{
+   if (sh->num_samplers > MAX_SAMPLERS || sh->NumImages > MAX_IMAGE_UNIFORMS)
+      return false;
+
+   for (unsigned i = 0; i < MAX_SAMPLERS; i++) {
+      if (sh->SamplerUnits[i] >= MAX_COMBINED_TEXTURE_IMAGE_UNITS ||
+          (unsigned) sh->SamplerTargets[i] >= NUM_TEXTURE_TARGETS)
+         return false;
+   }
+
+   for (unsigned i = 0; i < sh->NumImages; i++) {
+      if (sh->ImageUnits[i] >= MAX_IMAGE_UNITS)
+         return false;
+   }
+
+   return true;
+}
+
+
+/**
+ * Check every index read back against the array it refers to.
+ */
+bool
+program_reader::validate_program(const struct gl_shader_program *prog)
+{
+   const struct gl_transform_feedback_info *xfb =
+      &prog->LinkedTransformFeedback;
+
+   if (xfb->NumBuffers > MAX_FEEDBACK_BUFFERS)
+      return false;
+
+   for (unsigned i = 0; i < xfb->NumOutputs; i++) {
+      const struct gl_transform_feedback_output *out = &xfb->Outputs[i];
+
+      if (out->OutputRegister >= VARYING_SLOT_MAX ||
+          out->OutputBuffer >= MAX_FEEDBACK_BUFFERS ||
+          out->StreamId >= MAX_VERTEX_STREAMS ||
+          out->NumComponents > 4 ||
+          out->ComponentOffset > 4 - out->NumComponents)
+         return false;
+   }
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i] != NULL &&
+          !validate_shader(prog->_LinkedShaders[i]))
+         return false;
+   }
+
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      const struct gl_uniform_storage *uni = &prog->UniformStorage[i];
+      const glsl_type *base = uni->type->without_array();
+      const unsigned count = MAX2(1, uni->array_elements);
+
+      if ((uni->block_index != -1 &&
+           (unsigned) uni->block_index >= prog->NumBufferInterfaceBlocks) ||
+          (uni->atomic_buffer_index != -1 &&
+           (unsigned) uni->atomic_buffer_index >= prog->NumAtomicBuffers) ||
+          (!base->is_subroutine() && uni->remap_location != ~0u &&
+           (uni->remap_location >= prog->NumUniformRemapTable ||
+            count > prog->NumUniformRemapTable - uni->remap_location)))
+         return false;
+
+      for (unsigned j = 0; j < MESA_SHADER_STAGES; j++) {
+         const struct gl_shader *sh = prog->_LinkedShaders[j];
+         unsigned limit;
+
+         if (!uni->opaque[j].active)
+            continue;
+
+         if (sh == NULL)
+            return false;
+
+         if (base->is_sampler())
+            limit = MAX_SAMPLERS;
+         else if (base->is_image())
+            limit = MAX_IMAGE_UNIFORMS;
+         else if (base->is_subroutine())
+            limit = sh->NumSubroutineUniformRemapTable;
+         else
+            return false;
+
+         if (uni->opaque[j].index >= limit ||
+             count > limit - uni->opaque[j].index)
+            return false;
+      }
+   }
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      const struct gl_shader *sh = prog->_LinkedShaders[i];
+      const int *stage_index = prog->UniformBlockStageIndex[i];
+
+      if (stage_index == NULL)
+         continue;
+
+      for (unsigned j = 0; j < prog->NumBufferInterfaceBlocks; j++) {
+         if (stage_index[j] != -1 &&
+             (sh == NULL || stage_index[j] < 0 ||
+              (unsigned) stage_index[j] >= sh->NumBufferInterfaceBlocks))
+            return false;
+      }
+   }
+
+   for (unsigned i = 0; i < prog->NumAtomicBuffers; i++) {
+      const struct gl_active_atomic_buffer *ab = &prog->AtomicBuffers[i];
+
+      if (ab->Binding >= ctx->Const.MaxAtomicBufferBindings)
+         return false;
+
+      for (unsigned j = 0; j < ab->NumUniforms; j++) {
+         if (ab->Uniforms[j] >= prog->NumUniformStorage)
+            return false;
+      }
+   }
+
+   return true;
+}
+
+} /* anonymous namespace */
+
+
+extern "C" uint8_t *
+_mesa_glsl_serialize_program(void *mem_ctx, struct gl_context *ctx,
+                             struct gl_shader_program *prog, size_t *size)
+{
+   struct blob *blob = blob_create(NULL);
+   uint8_t *result = NULL;
+
+   if (blob == NULL)
+      return NULL;
+
+   const char *build_id = _mesa_glsl_program_binary_build_id(blob, ctx);
+   if (build_id == NULL) {
+      ralloc_free(blob);
+      return NULL;
+   }
+
+   blob_write_uint32(blob, PROGRAM_BINARY_MAGIC);
+   blob_write_uint32(blob, PROGRAM_BINARY_VERSION);
+   blob_write_string(blob, build_id);
+
+   /* Payload size and checksum, filled in once the payload is written. */
+   blob_write_uint32(blob, 0);
+   const size_t size_offset = blob->size - sizeof(uint32_t);
+   blob_write_uint32(blob, 0);
+   const size_t payload_start = blob->size;
+
+   program_writer writer(blob);
+   writer.write_program(prog);
+
+   if (!writer.error && blob->size - payload_start <= UINT32_MAX) {
+      const size_t payload_size = blob->size - payload_start;
+
+      blob_overwrite_uint32(blob, size_offset, payload_size);
+      blob_overwrite_uint32(blob, size_offset + sizeof(uint32_t),
+                            _mesa_hash_data(blob->data + payload_start,
+                                            payload_size));
+
+      result = (uint8_t *) ralloc_size(mem_ctx, blob->size);
+      if (result) {
+         memcpy(result, blob->data, blob->size);
+         *size = blob->size;
+      }
+   }
+
+   ralloc_free(blob);
+   return result;
+}
+
+
+extern "C" bool
+_mesa_glsl_deserialize_program(struct gl_context *ctx,
+                               struct gl_shader_program *prog,
+                               const uint8_t *data, size_t size)
+{
+   program_reader reader(ctx, data, size);
+
+   if (reader.read_uint() != PROGRAM_BINARY_MAGIC ||
+       reader.read_uint() != PROGRAM_BINARY_VERSION)
+      return false;
+
+   const char *build_id = reader.read_string();
+   const char *our_build_id =
+      _mesa_glsl_program_binary_build_id(reader.tmp_ctx, ctx);
+   if (build_id == NULL || our_build_id == NULL ||
+       strcmp(build_id, our_build_id) != 0)
+      return false;
+
+   const uint32_t payload_size = reader.read_uint();
+   const uint32_t checksum = reader.read_uint();
+   if (reader.failed() || payload_size != reader.remaining() ||
+       _mesa_hash_data(reader.blob.current, payload_size) != checksum)
+      return false;
+
+   if (reader.read_program(prog))
+      return true;
+
+   _mesa_clear_shader_program_data(prog);
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i] != NULL)
+         _mesa_delete_shader(ctx, prog->_LinkedShaders[i]);
+      prog->_LinkedShaders[i] = NULL;
+   }
+
+   return false;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef GLSL_PROGRAM_BINARY_H
+#define GLSL_PROGRAM_BINARY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \file program_binary.h
+ *
+ * Serialization of linked GLSL programs.
+ *
+ * The serialized form captures everything link_shaders() produces: the
+ * linked IR of every stage, the uniform storage and remap tables, uniform
+ * and shader storage blocks, atomic counter buffers, transform feedback
+ * outputs and subroutine tables.  Restoring it and running the driver's
+ * LinkShader hook yields the same program as a full compile and link.
+ *
+ * The format is private to one build of Mesa running on one driver.  The
+ * header records the build id of the driver binary, the context's version
+ * string and renderer, and a checksum of the payload.  Deserialization
+ * refuses data written by anything else.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct gl_context;
+struct gl_shader_program;
+
+/**
+ * Serialize the linked state of \c prog.
+ *
+ * Must be called after a successful link_shaders() and before
+ * ctx->Driver.LinkShader, which lowers the IR in driver-specific ways.
+ *
+ * \return A buffer allocated with ralloc against \c mem_ctx, with its size in
+ *         \c size, or NULL if \c prog contains something that cannot be
+ *         serialized or the build can't be identified.
+ */
+uint8_t *
+_mesa_glsl_serialize_program(void *mem_ctx, struct gl_context *ctx,
+                             struct gl_shader_program *prog, size_t *size);
+
+/**
+ * Describe the Mesa build and driver behind \c ctx.  Binaries are only
+ * accepted by contexts with the same identity.
+ *
+ * \return A string allocated with ralloc against \c mem_ctx, or NULL if the
+ *         build can't be identified, in which case no binaries are written.
+ */
+char *
+_mesa_glsl_program_binary_build_id(void *mem_ctx, struct gl_context *ctx);
+
+/**
+ * Restore the linked state of \c prog from a buffer returned by
+ * _mesa_glsl_serialize_program().
+ *
+ * \c prog must not have any linked shaders or link-time data.  On failure
+ * everything that was created is freed again and \c prog is left unlinked.
+ */
+bool
+_mesa_glsl_deserialize_program(struct gl_context *ctx,
+                               struct gl_shader_program *prog,
+                               const uint8_t *data, size_t size);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* GLSL_PROGRAM_BINARY_H */
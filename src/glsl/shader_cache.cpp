@@ -0,0 +1,396 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "main/core.h"
+#include "shader_cache.h"
+
+#ifdef ENABLE_SHADER_CACHE
+
+#include "main/shaderobj.h"
+#include "ir.h"
+#include "program.h"
+#include "program_binary.h"
+#include "program/hash_table.h"
+#include "util/build_id.h"
+#include "util/cache.h"
+#include "util/mesa-sha1.h"
+#include "util/ralloc.h"
+
+static bool
+cache_usable(struct gl_context *ctx)
+{
+   /* MESA_GLSL=dump and =log want to see the compiler at work. */
+   return ctx->ShaderCache != NULL &&
+          !(ctx->_Shader->Flags & (GLSL_DUMP | GLSL_LOG));
+}
+
+static bool
+key_is_set(const unsigned char key[20])
+{
+   for (unsigned i = 0; i < 20; i++) {
+      if (key[i] != 0)
+         return true;
+   }
+
+   return false;
+}
+
+/**
+ * Hash everything outside the shader source that affects compilation.
+ *
+ * This is computed on first use rather than at context creation because
+ * drivers only finish filling in ctx->Const after the core has initialized.
+ *
+ * Cache entries hold raw copies of Mesa's structures, so they are keyed on
+ * the build of the binary this code was linked into.  Two builds with the
+ * same version string can still lay those structures out differently.  If
+ * the build can't be identified, the cache isn't used at all.
+ */
+static const unsigned char *
+context_key(struct gl_context *ctx)
+{
+   if (ctx->ShaderCacheKeyValid)
+      return ctx->ShaderCacheKey;
+
+   char *driver_id = build_id_for_address(NULL, (const void *) context_key);
+   if (driver_id == NULL)
+      return NULL;
+
+   struct mesa_sha1 *sha = _mesa_sha1_init();
+   if (sha == NULL) {
+      ralloc_free(driver_id);
+      return NULL;
+   }
+
+   _mesa_sha1_update(sha, driver_id, strlen(driver_id) + 1);
+   ralloc_free(driver_id);
+
+   char *build_id = _mesa_glsl_program_binary_build_id(NULL, ctx);
+   if (build_id == NULL) {
+      _mesa_sha1_final(sha, ctx->ShaderCacheKey);
+      return NULL;
+   }
+   _mesa_sha1_update(sha, build_id, strlen(build_id) + 1);
+   ralloc_free(build_id);
+
+   /* gl_extensions ends in the extension string pointer. */
+   _mesa_sha1_update(sha, &ctx->Extensions,
+                     offsetof(struct gl_extensions, String));
+
+   /* Only the NIR options pointer in gl_constants changes between runs. */
+   struct gl_constants *consts =
+      (struct gl_constants *) malloc(sizeof(*consts));
+   if (consts == NULL) {
+      _mesa_sha1_final(sha, ctx->ShaderCacheKey);
+      return NULL;
+   }
+   memcpy(consts, &ctx->Const, sizeof(*consts));
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++)
+      consts->ShaderCompilerOptions[i].NirOptions = NULL;
+   _mesa_sha1_update(sha, consts, sizeof(*consts));
+   free(consts);
+
+   _mesa_sha1_update(sha, &ctx->Shader.Flags, sizeof(ctx->Shader.Flags));
+
+   _mesa_sha1_final(sha, ctx->ShaderCacheKey);
+   ctx->ShaderCacheKeyValid = true;
+
+   return ctx->ShaderCacheKey;
+}
+
+static bool
+compute_shader_key(struct gl_context *ctx, const struct gl_shader *sh,
+                   unsigned char key[20])
+{
+   const unsigned char *ctx_key = context_key(ctx);
+   const char tag = 'S';
+
+   if (ctx_key == NULL)
+      return false;
+
+   struct mesa_sha1 *sha = _mesa_sha1_init();
+   if (sha == NULL)
+      return false;
+
+   _mesa_sha1_update(sha, &tag, 1);
+   _mesa_sha1_update(sha, ctx_key, 20);
+   _mesa_sha1_update(sha, &sh->Stage, sizeof(sh->Stage));
+   _mesa_sha1_update(sha, sh->Source, strlen(sh->Source));
+
+   return _mesa_sha1_final(sha, key) != 0;
+}
+
+static void
+hash_binding(const char *name, unsigned value, void *closure)
+{
+   struct mesa_sha1 *sha = (struct mesa_sha1 *) closure;
+
+   _mesa_sha1_update(sha, name, strlen(name) + 1);
+   _mesa_sha1_update(sha, &value, sizeof(value));
+}
+
+static void
+hash_bindings(struct mesa_sha1 *sha, struct string_to_uint_map *map)
+{
+   const char separator = '\0';
+
+   if (map != NULL)
+      map->iterate(hash_binding, sha);
+
+   _mesa_sha1_update(sha, &separator, 1);
+}
+
+/**
+ * Hash the attached shaders together with the program state that
+ * glLinkProgram consumes.
+ */
+static bool
+compute_program_key(struct gl_context *ctx,
+                    const struct gl_shader_program *prog,
+                    unsigned char key[20])
+{
+   const unsigned char *ctx_key = context_key(ctx);
+   const char tag = 'P';
+
+   if (ctx_key == NULL)
+      return false;
+
+   for (unsigned i = 0; i < prog->NumShaders; i++) {
+      if (!key_is_set(prog->Shaders[i]->sha1))
+         return false;
+   }
+
+   struct mesa_sha1 *sha = _mesa_sha1_init();
+   if (sha == NULL)
+      return false;
+
+   _mesa_sha1_update(sha, &tag, 1);
+   _mesa_sha1_update(sha, ctx_key, 20);
+
+   _mesa_sha1_update(sha, &prog->NumShaders, sizeof(prog->NumShaders));
+   for (unsigned i = 0; i < prog->NumShaders; i++)
+      _mesa_sha1_update(sha, prog->Shaders[i]->sha1, 20);
+
+   _mesa_sha1_update(sha, &prog->SeparateShader,
+                     sizeof(prog->SeparateShader));
+
+   hash_bindings(sha, prog->AttributeBindings);
+   hash_bindings(sha, prog->FragDataBindings);
+   hash_bindings(sha, prog->FragDataIndexBindings);
+
+   _mesa_sha1_update(sha, &prog->TransformFeedback.BufferMode,
+                     sizeof(prog->TransformFeedback.BufferMode));
+   _mesa_sha1_update(sha, &prog->TransformFeedback.NumVarying,
+                     sizeof(prog->TransformFeedback.NumVarying));
+   for (unsigned i = 0; i < prog->TransformFeedback.NumVarying; i++) {
+      const char *name = prog->TransformFeedback.VaryingNames[i];
+      _mesa_sha1_update(sha, name, strlen(name) + 1);
+   }
+
+   return _mesa_sha1_final(sha, key) != 0;
+}
+
+extern "C" bool
+shader_cache_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
+{
+   memset(sh->sha1, 0, sizeof(sh->sha1));
+   sh->CompileDeferred = false;
+
+   if (!cache_usable(ctx) || sh->Source == NULL ||
+       !compute_shader_key(ctx, sh, sh->sha1))
+      return false;
+
+   /* The entry holds the info log of the compile that created it. */
+   size_t size;
+   char *log = (char *) cache_get(ctx->ShaderCache, sh->sha1, &size);
+   if (log == NULL)
+      return false;
+
+   ralloc_free(sh->InfoLog);
+   sh->InfoLog = ralloc_strndup(sh, log, size);
+   free(log);
+
+   /* The symbol table lives in the IR's memory context. */
+   ralloc_free(sh->ir);
+   sh->ir = NULL;
+   sh->symbols = NULL;
+
+   sh->CompileStatus = GL_TRUE;
+   sh->CompileDeferred = true;
+
+   return true;
+}
+
+extern "C" void
+shader_cache_store_shader(struct gl_context *ctx, struct gl_shader *sh)
+{
+   if (!cache_usable(ctx) || !sh->CompileStatus || !key_is_set(sh->sha1))
+      return;
+
+   const char *log = sh->InfoLog ? sh->InfoLog : "";
+   cache_put(ctx->ShaderCache, sh->sha1, log, strlen(log));
+}
+
+extern "C" void
+shader_cache_compile_deferred(struct gl_context *ctx,
+                              struct gl_shader_program *prog)
+{
+   for (unsigned i = 0; i < prog->NumShaders; i++) {
+      struct gl_shader *sh = prog->Shaders[i];
+
+      if (!sh->CompileDeferred)
+         continue;
+
+      _mesa_glsl_compile_shader(ctx, sh, false, false);
+      sh->CompileDeferred = false;
+
+      if (!sh->CompileStatus) {
+         linker_error(prog, "cached shader %u failed to compile:\n%s",
+                      sh->Name, sh->InfoLog);
+      }
+   }
+}
+
+extern "C" bool
+shader_cache_load_program(struct gl_context *ctx,
+                          struct gl_shader_program *prog)
+{
+   unsigned char key[20];
+
+   if (!cache_usable(ctx) || !compute_program_key(ctx, prog, key))
+      return false;
+
+   size_t size;
+   uint8_t *data = (uint8_t *) cache_get(ctx->ShaderCache, key, &size);
+   if (data == NULL)
+      return false;
+
+   /* The entry is the link's info log followed by the program binary. */
+   uint32_t log_size;
+   if (size < sizeof(log_size)) {
+      free(data);
+      return false;
+   }
+   memcpy(&log_size, data, sizeof(log_size));
+   if (log_size > size - sizeof(log_size)) {
+      free(data);
+      return false;
+   }
+
+   const char *log = (const char *) data + sizeof(log_size);
+   const uint8_t *binary = data + sizeof(log_size) + log_size;
+   const size_t binary_size = size - sizeof(log_size) - log_size;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i] != NULL)
+         _mesa_delete_shader(ctx, prog->_LinkedShaders[i]);
+      prog->_LinkedShaders[i] = NULL;
+   }
+
+   if (!_mesa_glsl_deserialize_program(ctx, prog, binary, binary_size)) {
+      free(data);
+      return false;
+   }
+
+   ralloc_strncat(&prog->InfoLog, log, log_size);
+
+   prog->Binary = (GLubyte *) ralloc_size(prog, binary_size);
+   if (prog->Binary != NULL) {
+      memcpy(prog->Binary, binary, binary_size);
+      prog->BinarySize = binary_size;
+   }
+
+   free(data);
+   return true;
+}
+
+extern "C" void
+shader_cache_store_program(struct gl_context *ctx,
+                           struct gl_shader_program *prog)
+{
+   unsigned char key[20];
+
+   if (!cache_usable(ctx) || !compute_program_key(ctx, prog, key))
+      return;
+
+   /* Unless the application asked for it, the program hasn't been
+    * serialized yet.  Keep the result for glGetProgramBinary().
+    */
+   if (prog->Binary == NULL) {
+      size_t binary_size = 0;
+
+      prog->Binary = _mesa_glsl_serialize_program(prog, ctx, prog,
+                                                  &binary_size);
+      if (prog->Binary == NULL)
+         return;
+      prog->BinarySize = binary_size;
+   }
+
+   const uint32_t log_size = prog->InfoLog ? strlen(prog->InfoLog) : 0;
+   const size_t size = sizeof(log_size) + log_size + prog->BinarySize;
+   uint8_t *data = (uint8_t *) malloc(size);
+   if (data == NULL)
+      return;
+
+   memcpy(data, &log_size, sizeof(log_size));
+   memcpy(data + sizeof(log_size), prog->InfoLog, log_size);
+   memcpy(data + sizeof(log_size) + log_size, prog->Binary,
+          prog->BinarySize);
+
+   cache_put(ctx->ShaderCache, key, data, size);
+   free(data);
+}
+
+#else /* ENABLE_SHADER_CACHE */
+
+extern "C" bool
+shader_cache_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
+{
+   return false;
+}
+
+extern "C" void
+shader_cache_store_shader(struct gl_context *ctx, struct gl_shader *sh)
+{
+}
+
+extern "C" void
+shader_cache_compile_deferred(struct gl_context *ctx,
+                              struct gl_shader_program *prog)
+{
+}
+
+extern "C" bool
+shader_cache_load_program(struct gl_context *ctx,
+                          struct gl_shader_program *prog)
+{
+   return false;
+}
+
+extern "C" void
+shader_cache_store_program(struct gl_context *ctx,
+                           struct gl_shader_program *prog)
+{
+}
+
+#endif /* ENABLE_SHADER_CACHE */
@@ -0,0 +1,97 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef GLSL_SHADER_CACHE_H
+#define GLSL_SHADER_CACHE_H
+
+#include <stdbool.h>
+
+/**
+ * \file shader_cache.h
+ *
+ * Glue between the GLSL compiler and the on-disk cache in util/cache.h.
+ *
+ * Compiling a shader only records the SHA-1 of its source (plus the context
+ * state the compiler depends on).  If that source compiled before, the real
+ * compile is skipped and the shader is marked \c CompileDeferred.  Linking
+ * hashes the attached shaders together with the link-time program state and
+ * restores the serialized program on a hit.  On a miss, deferred shaders are
+ * compiled, the program is linked normally and the result is stored.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct gl_context;
+struct gl_shader;
+struct gl_shader_program;
+
+/**
+ * Try to satisfy a compile of \c sh from the cache.
+ *
+ * \return true if compilation was skipped.  Otherwise the caller compiles
+ *         the shader and calls shader_cache_store_shader().
+ */
+bool
+shader_cache_compile_shader(struct gl_context *ctx, struct gl_shader *sh);
+
+/**
+ * Remember that \c sh compiled successfully.
+ */
+void
+shader_cache_store_shader(struct gl_context *ctx, struct gl_shader *sh);
+
+/**
+ * Try to restore the linked state of \c prog from the cache.
+ *
+ * \return true on a hit, in which case link_shaders() must not be called.
+ */
+bool
+shader_cache_load_program(struct gl_context *ctx,
+                          struct gl_shader_program *prog);
+
+/**
+ * Compile the shaders of \c prog whose compilation was skipped, reporting
+ * any failure as a link error.
+ */
+void
+shader_cache_compile_deferred(struct gl_context *ctx,
+                              struct gl_shader_program *prog);
+
+/**
+ * Store the binary of the freshly linked \c prog, serializing it into
+ * \c prog->Binary first if that hasn't been done yet.
+ *
+ * Must be called before ctx->Driver.LinkShader lowers the linked IR.
+ */
+void
+shader_cache_store_program(struct gl_context *ctx,
+                           struct gl_shader_program *prog);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* GLSL_SHADER_CACHE_H */
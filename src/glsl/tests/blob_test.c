@@ -29,7 +29,7 @@
 #include <string.h>
 
 #include "util/ralloc.h"
-#include "blob.h"
+#include "util/blob.h"
 
 #define bytes_test_str     "bytes_test"
 #define reserve_test_str   "reserve_test"
@@ -264,6 +264,27 @@ test_overrun(void)
    ralloc_free(ctx);
 }
 
+/* Test that writing nothing from a NULL pointer leaves the blob alone. */
+static void
+test_empty_write(void)
+{
+   void *ctx = ralloc_context(NULL);
+   struct blob *blob;
+
+   blob = blob_create(ctx);
+
+   expect_equal(true, blob_write_bytes(blob, NULL, 0), "empty write");
+   expect_equal(0, blob->size, "size after empty write");
+
+   blob_write_uint32(blob, 1);
+   expect_equal(true, blob_write_bytes(blob, NULL, 0),
+                "empty write after data");
+   expect_equal(sizeof(uint32_t), blob->size,
+                "size after empty write after data");
+
+   ralloc_free(ctx);
+}
+
 /* Test that we can read and write some large objects, (exercising the code in
  * the blob_write functions to realloc blob->data.
  */
@@ -314,6 +335,7 @@ main (void)
    test_write_and_read_functions ();
    test_alignment ();
    test_overrun ();
+   test_empty_write ();
    test_big_objects ();
 
    return error ? 1 : 0;
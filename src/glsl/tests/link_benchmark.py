@@ -0,0 +1,132 @@
+# coding=utf-8
+#
+# Copyright © 2015 Intel Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+
+# Times glsl_compiler --link on generated programs with very large
+# interfaces, to check that linking scales linearly with the number of
+# uniform block members, structure members and uniform blocks.
+#
+# Usage: python link_benchmark.py [path/to/glsl_compiler] [sizes...]
+#
+# For each size the time per interface member is printed; it should stay
+# roughly constant as the size doubles.
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def block_members(n):
+    members = '\n'.join('   vec4 m{0};'.format(i) for i in range(n))
+    uses = ' +\n      '.join('m{0}'.format(i) for i in range(n))
+    return """#version 140
+uniform Block {{
+{0}
+}};
+
+void main()
+{{
+   gl_Position = {1};
+}}
+""".format(members, uses)
+
+
+def block_records(n):
+    members = '\n'.join('   S s{0};'.format(i) for i in range(n))
+    uses = ' +\n      '.join('s{0}.v'.format(i) for i in range(n))
+    return """#version 140
+struct S {{
+   vec4 v;
+}};
+
+uniform Block {{
+{0}
+}};
+
+void main()
+{{
+   gl_Position = {1};
+}}
+""".format(members, uses)
+
+
+def many_blocks(n):
+    blocks = '\n'.join('uniform B{0} {{ vec4 b{0}; }};'.format(i)
+                       for i in range(n))
+    uses = ' +\n      '.join('b{0}'.format(i) for i in range(n))
+    return """#version 140
+{0}
+
+void main()
+{{
+   gl_Position = {1};
+}}
+""".format(blocks, uses)
+
+
+FRAGMENT = """#version 140
+void main()
+{
+   gl_FragColor = vec4(1.0);
+}
+"""
+
+
+def time_link(compiler, directory, source):
+    vert = os.path.join(directory, 'bench.vert')
+    frag = os.path.join(directory, 'bench.frag')
+    with open(vert, 'w') as f:
+        f.write(source)
+    with open(frag, 'w') as f:
+        f.write(FRAGMENT)
+
+    start = time.time()
+    # Link errors about resource limits are expected; only the time matters.
+    with open(os.devnull, 'w') as null:
+        subprocess.call([compiler, '--version', '140', '--link', vert, frag],
+                        stdout=null, stderr=null)
+    return time.time() - start
+
+
+def main():
+    compiler = sys.argv[1] if len(sys.argv) > 1 else './glsl_compiler'
+    sizes = [int(s) for s in sys.argv[2:]] or [1000, 2000, 4000, 8000]
+    directory = tempfile.mkdtemp()
+
+    try:
+        for name, generate in [('block members', block_members),
+                               ('record members', block_records),
+                               ('uniform blocks', many_blocks)]:
+            print(name)
+            for n in sizes:
+                seconds = time_link(compiler, directory, generate(n))
+                print('   {0:6d}: {1:8.3f} s  {2:8.2f} us/member'.format(
+                    n, seconds, seconds * 1e6 / n))
+    finally:
+        shutil.rmtree(directory)
+
+
+if __name__ == '__main__':
+    main()
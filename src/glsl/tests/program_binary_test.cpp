@@ -0,0 +1,312 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <gtest/gtest.h>
+#include "main/compiler.h"
+#include "main/mtypes.h"
+#include "main/macros.h"
+#include "util/ralloc.h"
+#include "ir.h"
+#include "ir_uniform.h"
+#include "program.h"
+#include "program_binary.h"
+#include "program/hash_table.h"
+#include "standalone_scaffolding.h"
+
+static const char vs_source[] =
+   "uniform mat4 mvp;\n"
+   "uniform vec4 offsets[3];\n"
+   "attribute vec4 pos;\n"
+   "varying vec4 color;\n"
+   "\n"
+   "void main()\n"
+   "{\n"
+   "   gl_Position = mvp * pos + offsets[1];\n"
+   "   color = offsets[2];\n"
+   "}\n";
+
+static const char fs_source[] =
+   "uniform sampler2D tex;\n"
+   "uniform float scale;\n"
+   "varying vec4 color;\n"
+   "\n"
+   "void main()\n"
+   "{\n"
+   "   gl_FragColor = texture2D(tex, color.xy) * scale + color;\n"
+   "}\n";
+
+class program_binary_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   struct gl_shader_program *create_program();
+   void destroy_program(struct gl_shader_program *p);
+   void add_shader(GLenum type, const char *source);
+   char *print(struct gl_shader *sh);
+   uint8_t *serialize(size_t *size);
+   struct gl_shader_program *deserialize(const uint8_t *data, size_t size);
+
+   struct gl_context local_ctx;
+   struct gl_context *ctx;
+   void *mem_ctx;
+   struct gl_shader_program *prog;
+};
+
+void
+program_binary_test::SetUp()
+{
+   ctx = &local_ctx;
+   initialize_context_to_defaults(ctx, API_OPENGL_COMPAT);
+   ctx->Driver.NewShader = _mesa_new_shader;
+
+   mem_ctx = ralloc_context(NULL);
+
+   prog = create_program();
+   add_shader(GL_VERTEX_SHADER, vs_source);
+   add_shader(GL_FRAGMENT_SHADER, fs_source);
+
+   link_shaders(ctx, prog);
+   ASSERT_TRUE(prog->LinkStatus) << prog->InfoLog;
+}
+
+void
+program_binary_test::TearDown()
+{
+   destroy_program(prog);
+   ralloc_free(mem_ctx);
+   mem_ctx = NULL;
+}
+
+struct gl_shader_program *
+program_binary_test::create_program()
+{
+   struct gl_shader_program *p = rzalloc(mem_ctx, struct gl_shader_program);
+
+   p->InfoLog = ralloc_strdup(p, "");
+   p->AttributeBindings = new string_to_uint_map;
+   p->FragDataBindings = new string_to_uint_map;
+   p->FragDataIndexBindings = new string_to_uint_map;
+
+   return p;
+}
+
+/**
+ * Programs are children of mem_ctx, but their linked shaders and maps
+ * aren't.
+ */
+void
+program_binary_test::destroy_program(struct gl_shader_program *p)
+{
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++)
+      ralloc_free(p->_LinkedShaders[i]);
+
+   delete p->AttributeBindings;
+   delete p->FragDataBindings;
+   delete p->FragDataIndexBindings;
+   delete p->UniformHash;
+
+   ralloc_free(p);
+}
+
+void
+program_binary_test::add_shader(GLenum type, const char *source)
+{
+   struct gl_shader *sh = rzalloc(prog, struct gl_shader);
+
+   sh->Type = type;
+   sh->Stage = _mesa_shader_enum_to_shader_stage(type);
+   sh->Source = ralloc_strdup(sh, source);
+
+   _mesa_glsl_compile_shader(ctx, sh, false, false);
+   ASSERT_TRUE(sh->CompileStatus) << sh->InfoLog;
+
+   prog->Shaders = reralloc(prog, prog->Shaders, struct gl_shader *,
+                            prog->NumShaders + 1);
+   prog->Shaders[prog->NumShaders++] = sh;
+}
+
+char *
+program_binary_test::print(struct gl_shader *sh)
+{
+   char *str = NULL;
+   size_t size = 0;
+   FILE *fp = open_memstream(&str, &size);
+   _mesa_print_ir(fp, sh->ir, NULL);
+   fclose(fp);
+
+   char *copy = ralloc_strdup(mem_ctx, str);
+   free(str);
+   return copy;
+}
+
+uint8_t *
+program_binary_test::serialize(size_t *size)
+{
+   uint8_t *data = _mesa_glsl_serialize_program(mem_ctx, ctx, prog, size);
+   EXPECT_TRUE(data != NULL);
+   return data;
+}
+
+/**
+ * Reads the data into a new program, which the caller has to destroy.
+ * Returns NULL if the data is rejected.
+ */
+struct gl_shader_program *
+program_binary_test::deserialize(const uint8_t *data, size_t size)
+{
+   struct gl_shader_program *copy = create_program();
+
+   if (_mesa_glsl_deserialize_program(ctx, copy, data, size))
+      return copy;
+
+   /* A failed read must not leave anything behind. */
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++)
+      EXPECT_EQ(NULL, copy->_LinkedShaders[i]);
+   EXPECT_EQ(0u, copy->NumUniformStorage);
+
+   destroy_program(copy);
+   return NULL;
+}
+
+TEST_F(program_binary_test, round_trip)
+{
+   size_t size;
+   uint8_t *data = serialize(&size);
+   ASSERT_TRUE(data != NULL);
+
+   struct gl_shader_program *copy = deserialize(data, size);
+   ASSERT_TRUE(copy != NULL);
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      struct gl_shader *a = prog->_LinkedShaders[i];
+      struct gl_shader *b = copy->_LinkedShaders[i];
+
+      ASSERT_EQ(a == NULL, b == NULL);
+      if (a == NULL)
+         continue;
+
+      EXPECT_EQ(a->Stage, b->Stage);
+      EXPECT_EQ(a->Version, b->Version);
+      EXPECT_EQ(a->num_samplers, b->num_samplers);
+      EXPECT_EQ(a->num_uniform_components, b->num_uniform_components);
+      EXPECT_STREQ(print(a), print(b));
+   }
+
+   EXPECT_EQ(prog->Version, copy->Version);
+
+   ASSERT_EQ(prog->NumUniformStorage, copy->NumUniformStorage);
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      const struct gl_uniform_storage *a = &prog->UniformStorage[i];
+      const struct gl_uniform_storage *b = &copy->UniformStorage[i];
+
+      EXPECT_STREQ(a->name, b->name);
+      EXPECT_EQ(a->type, b->type);
+      EXPECT_EQ(a->array_elements, b->array_elements);
+      EXPECT_EQ(a->storage - prog->UniformStorage[0].storage,
+                b->storage - copy->UniformStorage[0].storage);
+      EXPECT_EQ(a->remap_location, b->remap_location);
+
+      for (unsigned j = 0; j < MESA_SHADER_STAGES; j++) {
+         EXPECT_EQ(a->opaque[j].active, b->opaque[j].active);
+         EXPECT_EQ(a->opaque[j].index, b->opaque[j].index);
+      }
+
+      unsigned index;
+      EXPECT_TRUE(copy->UniformHash->get(index, a->name));
+      EXPECT_EQ(i, index);
+   }
+
+   ASSERT_EQ(prog->NumUniformRemapTable, copy->NumUniformRemapTable);
+   for (unsigned i = 0; i < prog->NumUniformRemapTable; i++) {
+      EXPECT_EQ(prog->UniformRemapTable[i] - prog->UniformStorage,
+                copy->UniformRemapTable[i] - copy->UniformStorage);
+   }
+
+   destroy_program(copy);
+}
+
+TEST_F(program_binary_test, truncated)
+{
+   size_t size;
+   uint8_t *data = serialize(&size);
+   ASSERT_TRUE(data != NULL);
+
+   /* Every prefix of the data must be rejected. */
+   for (size_t len = 0; len < size; len++) {
+      EXPECT_EQ(NULL, deserialize(data, len))
+         << "accepted " << len << " of " << size << " bytes";
+   }
+}
+
+TEST_F(program_binary_test, wrong_build_id)
+{
+   size_t size;
+   uint8_t *data = serialize(&size);
+   ASSERT_TRUE(data != NULL);
+
+   /* Data written by a context with different constants is refused. */
+   ctx->Const.UniformBooleanTrue = ~ctx->Const.UniformBooleanTrue;
+
+   EXPECT_EQ(NULL, deserialize(data, size));
+}
+
+TEST_F(program_binary_test, bad_magic)
+{
+   size_t size;
+   uint8_t *data = serialize(&size);
+   ASSERT_TRUE(data != NULL);
+
+   data[0] ^= 0xff;
+
+   EXPECT_EQ(NULL, deserialize(data, size));
+}
+
+TEST_F(program_binary_test, bad_checksum)
+{
+   size_t size;
+   uint8_t *data = serialize(&size);
+   ASSERT_TRUE(data != NULL);
+
+   /* The last byte belongs to the payload, not the header. */
+   data[size - 1] ^= 0x01;
+
+   EXPECT_EQ(NULL, deserialize(data, size));
+}
+
+TEST_F(program_binary_test, bad_index)
+{
+   ASSERT_EQ(0u, prog->NumBufferInterfaceBlocks);
+   ASSERT_EQ(-1, prog->UniformStorage[0].block_index);
+
+   /* The checksum is right, but the uniform refers to a missing block. */
+   prog->UniformStorage[0].block_index = 1;
+
+   size_t size;
+   uint8_t *data = serialize(&size);
+   prog->UniformStorage[0].block_index = -1;
+   ASSERT_TRUE(data != NULL);
+
+   EXPECT_EQ(NULL, deserialize(data, size));
+}
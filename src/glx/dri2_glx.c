@@ -1101,6 +1101,7 @@ dri2BindExtensions(struct dri2_screen *psc, struct glx_display * priv,
 
       __glXEnableDirectExtension(&psc->base, "GLX_ARB_create_context");
       __glXEnableDirectExtension(&psc->base, "GLX_ARB_create_context_profile");
+      __glXEnableDirectExtension(&psc->base, "GLX_ARB_create_context_no_error");
 
       if ((mask & (1 << __DRI_API_GLES2)) != 0)
 	 __glXEnableDirectExtension(&psc->base,
@@ -469,6 +469,7 @@ dri2_convert_glx_attribs(unsigned num_attribs, const uint32_t *attribs,
 {
    unsigned i;
    bool got_profile = false;
+   bool no_error = false;
    uint32_t profile;
 
    *major_ver = 1;
@@ -507,6 +508,9 @@ dri2_convert_glx_attribs(unsigned num_attribs, const uint32_t *attribs,
       case GLX_RENDER_TYPE:
          *render_type = attribs[i * 2 + 1];
 	 break;
+      case GLX_CONTEXT_OPENGL_NO_ERROR_ARB:
+         no_error = attribs[i * 2 + 1];
+         break;
       case GLX_CONTEXT_RESET_NOTIFICATION_STRATEGY_ARB:
          switch (attribs[i * 2 + 1]) {
          case GLX_NO_RESET_NOTIFICATION_ARB:
@@ -564,6 +568,19 @@ dri2_convert_glx_attribs(unsigned num_attribs, const uint32_t *attribs,
       return false;
    }
 
+   /* GLX_ARB_create_context_no_error makes no-error contexts with the debug
+    * or robust access flags a BadMatch.
+    */
+   if (no_error) {
+      if (*flags & (__DRI_CTX_FLAG_DEBUG
+                    | __DRI_CTX_FLAG_ROBUST_BUFFER_ACCESS)) {
+         *error = __DRI_CTX_ERROR_BAD_FLAG;
+         return false;
+      }
+
+      *flags |= __DRI_CTX_FLAG_NO_ERROR;
+   }
+
    /* There are no forward-compatible contexts before OpenGL 3.0.  The
     * GLX_ARB_create_context spec says:
     *
@@ -34,6 +34,7 @@
 enum
 {
    ARB_create_context_bit = 0,
+   ARB_create_context_no_error_bit,
    ARB_create_context_profile_bit,
    ARB_create_context_robustness_bit,
    ARB_fbconfig_float_bit,
@@ -0,0 +1,365 @@
+#!/usr/bin/env python
+
+# Copyright (C) 2015 Intel Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+# This script generates the file marshal_generated.c, which contains the
+# glthread marshalling functions: for each GL function, a
+# _mesa_marshal_*() entry point that the application thread calls through
+# the marshal dispatch table, and, for the functions that can run
+# asynchronously, the command structure and the _mesa_unmarshal_*()
+# function that replays it on the glthread.
+
+import argparse
+import license
+import gl_XML
+import marshal_XML
+
+
+header = """
+#include "api_exec.h"
+#include "context.h"
+#include "dispatch.h"
+#include "glthread.h"
+#include "macros.h"
+#include "marshal.h"
+#include "marshal_generated.h"
+"""
+
+
+current_indent = 0
+
+
+def out(str):
+    if str:
+        print ' ' * current_indent + str
+    else:
+        print ''
+
+
+class indent(object):
+    def __init__(self, delta = 3):
+        self.delta = delta
+
+    def __enter__(self):
+        global current_indent
+        current_indent += self.delta
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        global current_indent
+        current_indent -= self.delta
+
+
+def fixed_param_type(p):
+    """Base type to store a fixed-size array parameter as."""
+    base = p.get_base_type_string()
+    if base == 'GLvoid':
+        return 'GLubyte'
+    return base
+
+
+class PrintCode(gl_XML.gl_print_base):
+    def __init__(self):
+        gl_XML.gl_print_base.__init__(self)
+
+        self.name = 'gl_marshal.py'
+        self.license = license.bsd_license_template % (
+            'Copyright (C) 2015 Intel Corporation', 'INTEL CORPORATION')
+
+    def printRealHeader(self):
+        print header
+
+    def printRealFooter(self):
+        pass
+
+    def print_sync_call(self, func):
+        call = 'CALL_{0}(ctx->CurrentDispatch, ({1}))'.format(
+            func.name, func.get_called_parameter_string())
+        if func.return_type == 'void':
+            out('{0};'.format(call))
+            self.print_call_after(func)
+        else:
+            out('{0} result = {1};'.format(func.return_type, call))
+            self.print_call_after(func)
+            out('return result;')
+
+    def print_call_after(self, func):
+        if func.marshal_call_after:
+            out('{0};'.format(func.marshal_call_after))
+
+    def print_sync_dispatch(self, func):
+        out('_mesa_glthread_finish(ctx);')
+        out('debug_print_sync_fallback("{0}");'.format(func.name))
+        self.print_sync_call(func)
+
+    def print_sync_body(self, func):
+        out('/* {0}: marshalled synchronously */'.format(func.name))
+        out('static {0} GLAPIENTRY'.format(func.return_type))
+        out('_mesa_marshal_{0}({1})'.format(
+            func.name, func.get_parameter_string()))
+        out('{')
+        with indent():
+            out('GET_CURRENT_CONTEXT(ctx);')
+            out('_mesa_glthread_finish(ctx);')
+            out('debug_print_sync("{0}");'.format(func.name))
+            self.print_sync_call(func)
+        out('}')
+        out('')
+
+    def print_async_struct(self, func):
+        out('struct marshal_cmd_{0}'.format(func.name))
+        out('{')
+        with indent():
+            out('struct marshal_cmd_base cmd_base;')
+            for p in func.fixed_params:
+                if p.count:
+                    out('{0} {1}[{2}];'.format(
+                        fixed_param_type(p), p.name, p.get_element_count()))
+                else:
+                    out('{0} {1};'.format(p.type_string(), p.name))
+
+            for p in func.variable_params:
+                if p.img_null_flag:
+                    out('bool {0}_null; /* If set, no data follows '
+                        'for "{0}" */'.format(p.name))
+
+            for p in func.variable_params:
+                if p.count_scale != 1:
+                    out('/* Next {0} * {1} bytes are {2} {3}[{4}][{5}] */'
+                        .format(p.counter, p.size(), p.get_base_type_string(),
+                                p.name, p.counter, p.count_scale))
+                else:
+                    out('/* Next {0} * {1} bytes are {2} {3}[{4}] */'
+                        .format(p.counter, p.size(), p.get_base_type_string(),
+                                p.name, p.counter))
+        out('};')
+
+    def print_async_unmarshal(self, func):
+        out('static inline void')
+        out(('_mesa_unmarshal_{0}(struct gl_context *ctx, '
+             'const struct marshal_cmd_{0} *cmd)').format(func.name))
+        out('{')
+        with indent():
+            for p in func.fixed_params:
+                if p.count:
+                    out('const {0} * {1} = cmd->{1};'.format(
+                        fixed_param_type(p), p.name))
+                else:
+                    out('{0} {1} = cmd->{1};'.format(p.type_string(), p.name))
+            if func.variable_params:
+                for p in func.variable_params:
+                    out('{0} {1};'.format(p.type_string(), p.name))
+                out(('const char *variable_data = (const char *) cmd + '
+                     'ALIGN(sizeof(*cmd), 8);'))
+                for p in func.variable_params:
+                    if p.img_null_flag:
+                        out('if (cmd->{0}_null)'.format(p.name))
+                        with indent():
+                            out('{0} = NULL;'.format(p.name))
+                        out('else')
+                        with indent():
+                            out('{0} = ({1}) variable_data;'.format(
+                                p.name, p.type_string()))
+                    else:
+                        out('{0} = ({1}) variable_data;'.format(
+                            p.name, p.type_string()))
+                    out('variable_data += ALIGN({0} * {1}, 8);'.format(
+                        p.counter, p.size()))
+
+            out('CALL_{0}(ctx->CurrentDispatch, ({1}));'.format(
+                func.name, func.get_called_parameter_string()))
+        out('}')
+
+    def print_async_marshal(self, func):
+        needs_fallback = func.marshal_sync or func.variable_params
+
+        out('static void GLAPIENTRY')
+        out('_mesa_marshal_{0}({1})'.format(
+            func.name, func.get_parameter_string()))
+        out('{')
+        with indent():
+            out('GET_CURRENT_CONTEXT(ctx);')
+            for p in func.variable_params:
+                out('size_t {0}_size;'.format(p.name))
+            out('size_t cmd_size = ALIGN(sizeof(struct marshal_cmd_{0}), 8);'
+                .format(func.name))
+            if func.fixed_params or func.variable_params:
+                out('struct marshal_cmd_{0} *cmd;'.format(func.name))
+            if func.variable_params:
+                out('char *variable_data;')
+            out('')
+
+            if func.marshal_sync:
+                out('if ({0})'.format(func.marshal_sync))
+                with indent():
+                    out('goto fallback_to_sync;')
+                out('')
+
+            for p in func.variable_params:
+                out('if (unlikely({0} < 0 || {0} > MARSHAL_MAX_CMD_SIZE))'
+                    .format(p.counter))
+                with indent():
+                    out('goto fallback_to_sync;')
+                out('{0}_size = {1} * {2};'.format(
+                    p.name, p.counter, p.size()))
+                if not p.img_null_flag:
+                    out('if (unlikely({0}_size > 0 && !{0}))'.format(p.name))
+                    with indent():
+                        out('goto fallback_to_sync;')
+                out('cmd_size += ALIGN({0}_size, 8);'.format(p.name))
+                out('')
+
+            if func.variable_params:
+                out('if (unlikely(cmd_size > MARSHAL_MAX_CMD_SIZE))')
+                with indent():
+                    out('goto fallback_to_sync;')
+                out('')
+
+            if func.fixed_params or func.variable_params:
+                out(('cmd = _mesa_glthread_allocate_command(ctx, '
+                     'DISPATCH_CMD_{0}, cmd_size);').format(func.name))
+            else:
+                out(('_mesa_glthread_allocate_command(ctx, '
+                     'DISPATCH_CMD_{0}, cmd_size);').format(func.name))
+            for p in func.fixed_params:
+                if p.count:
+                    out('memcpy(cmd->{0}, {0}, {1});'.format(
+                        p.name, p.size()))
+                else:
+                    out('cmd->{0} = {0};'.format(p.name))
+            if func.variable_params:
+                out(('variable_data = (char *) cmd + '
+                     'ALIGN(sizeof(*cmd), 8);'))
+                for p in func.variable_params:
+                    if p.img_null_flag:
+                        out('cmd->{0}_null = !{0};'.format(p.name))
+                    out('if ({0}_size)'.format(p.name))
+                    with indent():
+                        out('memcpy(variable_data, {0}, {0}_size);'.format(
+                            p.name))
+                    out('variable_data += ALIGN({0}_size, 8);'.format(p.name))
+            self.print_call_after(func)
+
+            if needs_fallback:
+                out('return;')
+                out('')
+                print 'fallback_to_sync:'
+                self.print_sync_dispatch(func)
+        out('}')
+
+    def print_async_body(self, func):
+        out('/* {0}: marshalled asynchronously */'.format(func.name))
+        self.print_async_struct(func)
+        self.print_async_unmarshal(func)
+        self.print_async_marshal(func)
+        out('')
+        out('')
+
+    def print_unmarshal_dispatch_cmd(self, api):
+        out('size_t')
+        out('_mesa_unmarshal_dispatch_cmd(struct gl_context *ctx, '
+            'const void *cmd)')
+        out('{')
+        with indent():
+            out('const struct marshal_cmd_base *cmd_base = cmd;')
+            out('switch (cmd_base->cmd_id) {')
+            for func in api.functionIterateByOffset():
+                flavor = func.marshal_flavor()
+                if flavor != 'async':
+                    continue
+                out('case DISPATCH_CMD_{0}:'.format(func.name))
+                with indent():
+                    out('debug_print_unmarshal("{0}");'.format(func.name))
+                    out(('_mesa_unmarshal_{0}(ctx, (const struct '
+                         'marshal_cmd_{0} *) cmd);').format(func.name))
+                    out('break;')
+            out('default:')
+            with indent():
+                out('assert(!"Unrecognized command ID");')
+                out('break;')
+            out('}')
+            out('')
+            out('return cmd_base->cmd_size;')
+        out('}')
+        out('')
+        out('')
+
+    def print_create_marshal_table(self, api):
+        out('struct _glapi_table *')
+        out('_mesa_create_marshal_table(const struct gl_context *ctx)')
+        out('{')
+        with indent():
+            out('struct _glapi_table *table;')
+            out('')
+            out('table = _mesa_alloc_dispatch_table();')
+            out('if (table == NULL)')
+            with indent():
+                out('return NULL;')
+            out('')
+            for func in api.functionIterateByOffset():
+                if func.marshal_flavor() == 'skip':
+                    continue
+                out('SET_{0}(table, _mesa_marshal_{0});'.format(func.name))
+            out('')
+            out('return table;')
+        out('}')
+        out('')
+        out('')
+
+    def printBody(self, api):
+        async_funcs = []
+        for func in api.functionIterateByOffset():
+            flavor = func.marshal_flavor()
+            if flavor == 'skip':
+                continue
+            elif flavor == 'async':
+                self.print_async_body(func)
+                async_funcs.append(func)
+            elif flavor == 'sync':
+                self.print_sync_body(func)
+            else:
+                raise Exception(
+                    'Unrecognized marshal flavor {0!r} for {1}'.format(
+                        flavor, func.name))
+        self.print_unmarshal_dispatch_cmd(api)
+        self.print_create_marshal_table(api)
+
+
+def _parser():
+    """Parse arguments and return namespace."""
+    parser = argparse.ArgumentParser()
+    parser.add_argument('-f',
+                        dest='filename',
+                        default='gl_and_es_API.xml',
+                        help='an xml file describing an API')
+    return parser.parse_args()
+
+
+def main():
+    """Main function."""
+    args = _parser()
+    printer = PrintCode()
+    api = gl_XML.parse_GL_API(args.filename, marshal_XML.marshal_item_factory())
+    printer.Print(api)
+
+
+if __name__ == '__main__':
+    main()
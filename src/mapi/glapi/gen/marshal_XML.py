@@ -0,0 +1,114 @@
+#!/usr/bin/env python
+
+# Copyright (C) 2015 Intel Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+# Extends gl_XML with what the glthread marshalling code generators need
+# to know about each function.
+
+import gl_XML
+
+
+class marshal_item_factory(gl_XML.gl_item_factory):
+    """Factory to create objects derived from gl_item containing
+    information necessary to generate marshalling code."""
+
+    def create_function(self, element, context):
+        return marshal_function(element, context)
+
+
+class marshal_function(gl_XML.gl_function):
+    def __init__(self, element, context):
+        self.marshal = None
+        self.marshal_sync = None
+        self.marshal_call_after = None
+        gl_XML.gl_function.__init__(self, element, context)
+
+    def process_element(self, element):
+        # Do normal processing.
+        gl_XML.gl_function.process_element(self, element)
+
+        # Only do further processing when we see the canonical
+        # function name.
+        if element.get('name') != self.name:
+            return
+
+        # Classify fixed and variable parameters.
+        self.fixed_params = []
+        self.variable_params = []
+        for p in self.parameters:
+            if p.is_padding:
+                continue
+            if p.is_variable_length():
+                self.variable_params.append(p)
+            else:
+                self.fixed_params.append(p)
+
+        # Store the marshalling attributes, if present.
+        self.marshal = element.get('marshal')
+        self.marshal_sync = element.get('marshal_sync')
+        self.marshal_call_after = element.get('marshal_call_after')
+
+    def pointers_by_value(self):
+        """Whether pointer parameters without a count are addresses that
+        the function doesn't read from at call time (buffer offsets, or
+        client arrays that get read later), and can be copied as is."""
+        return self.marshal == 'async' or self.marshal_sync is not None
+
+    def is_counter(self, name):
+        """Whether name is a scalar parameter that a count can refer to."""
+        for p in self.parameters:
+            if p.name == name:
+                return not p.is_pointer()
+        return False
+
+    def marshal_flavor(self):
+        """Find out how this function should be marshalled between
+        client and server threads."""
+        # If a "marshal" attribute was present, that overrides any
+        # determination that would otherwise be made by this function.
+        if self.marshal is not None:
+            return self.marshal
+
+        if self.exec_flavor == 'skip':
+            # Functions marked exec="skip" are not implemented in Mesa,
+            # so don't bother trying to marshal them.
+            return 'skip'
+
+        if self.return_type != 'void':
+            return 'sync'
+
+        for p in self.parameters:
+            if p.is_padding or not p.is_pointer():
+                continue
+            if p.is_output or 'const' not in p.type_string():
+                return 'sync'
+            if p.count_parameter_list or p.is_image():
+                # The size depends on enums or on the pixel unpacking
+                # state; haven't written logic to handle this.
+                return 'sync'
+            if p.counter:
+                if not self.is_counter(p.counter):
+                    return 'sync'
+            elif not p.count and not self.pointers_by_value():
+                return 'sync'
+
+        return 'async'
@@ -111,6 +111,10 @@ _mesa_init_driver_functions(struct dd_function_table *driver)
    driver->UnmapTextureImage = _swrast_unmap_teximage;
    driver->DrawTex = _mesa_meta_DrawTex;
 
+   /* Vertex array objects */
+   driver->NewArrayObject = _mesa_new_vao;
+   driver->DeleteArrayObject = _mesa_delete_vao;
+
    /* Vertex/fragment programs */
    driver->BindProgram = NULL;
    driver->NewProgram = _mesa_new_program;
@@ -324,6 +324,9 @@ brw_initialize_context_constants(struct brw_context *brw)
 
    ctx->Const.StripTextureBorder = true;
 
+   /* intel_dri2_flush_with_flags() finishes the glthread worker. */
+   ctx->Const.GLThreadSupported = true;
+
    ctx->Const.MaxUniformBlockSize = 65536;
    for (int i = 0; i < MESA_SHADER_STAGES; i++) {
       struct gl_program_constants *prog = &ctx->Const.Program[i];
@@ -733,7 +736,8 @@ brwCreateContext(gl_api api,
     * provides us with context reset notifications.
     */
    uint32_t allowed_flags = __DRI_CTX_FLAG_DEBUG
-      | __DRI_CTX_FLAG_FORWARD_COMPATIBLE;
+      | __DRI_CTX_FLAG_FORWARD_COMPATIBLE
+      | __DRI_CTX_FLAG_NO_ERROR;
 
    if (screen->has_context_reset_notification)
       allowed_flags |= __DRI_CTX_FLAG_ROBUST_BUFFER_ACCESS;
@@ -33,6 +33,7 @@
 #include "main/mtypes.h"
 #include "main/macros.h"
 #include "main/bufferobj.h"
+#include "vbo/vbo.h"
 
 #include "brw_context.h"
 #include "intel_blit.h"
@@ -165,6 +166,7 @@ brw_delete_buffer(struct gl_context * ctx, struct gl_buffer_object *obj)
     * (though it does if you call glDeleteBuffers)
     */
    _mesa_buffer_unmap_all_mappings(ctx, obj);
+   vbo_delete_minmax_cache(obj);
 
    drm_intel_bo_unreference(intel_obj->buffer);
    free(intel_obj);
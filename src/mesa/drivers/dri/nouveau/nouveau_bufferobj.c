@@ -29,6 +29,7 @@
 #include "nouveau_context.h"
 
 #include "main/bufferobj.h"
+#include "vbo/vbo.h"
 
 static inline char *
 get_bufferobj_map(struct gl_context *ctx, struct gl_buffer_object *obj,
@@ -66,6 +67,7 @@ nouveau_bufferobj_del(struct gl_context *ctx, struct gl_buffer_object *obj)
 {
 	struct nouveau_bufferobj *nbo = to_nouveau_bufferobj(obj);
 
+	vbo_delete_minmax_cache(obj);
 	nouveau_bo_ref(NULL, &nbo->bo);
 	free(nbo->sys);
 	free(nbo);
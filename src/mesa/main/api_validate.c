@@ -32,19 +32,19 @@
 #include "enums.h"
 #include "vbo/vbo.h"
 #include "transformfeedback.h"
+#include "pipelineobj.h"
+#include "shaderqueue.h"
+#include "state.h"
 #include <stdbool.h>
 
 
 /**
- * Check if OK to draw arrays/elements.
+ * Whether a valid draw call has anything to draw.  Drawing without the
+ * vertex state listed here is legal, it just doesn't produce anything.
  */
 static bool
-check_valid_to_render(struct gl_context *ctx, const char *function)
+have_vertex_input(const struct gl_context *ctx)
 {
-   if (!_mesa_valid_to_render(ctx, function)) {
-      return false;
-   }
-
    switch (ctx->API) {
    case API_OPENGLES2:
       /* For ES2, we can draw if we have a vertex program/shader). */
@@ -53,11 +53,52 @@ check_valid_to_render(struct gl_context *ctx, const char *function)
    case API_OPENGLES:
       /* For OpenGL ES, only draw if we have vertex positions
        */
-      if (!ctx->Array.VAO->VertexAttrib[VERT_ATTRIB_POS].Enabled)
-	 return false;
-      break;
+      return ctx->Array.VAO->VertexAttrib[VERT_ATTRIB_POS].Enabled;
 
    case API_OPENGL_CORE:
+      /* Section 7.3 (Program Objects) of the OpenGL 4.5 Core Profile spec
+       * says:
+       *
+       *     "If there is no active program for the vertex or fragment shader
+       *     stages, the results of vertex and/or fragment processing will be
+       *     undefined. However, this is not an error."
+       *
+       * The fragment shader is not tested here because other state (e.g.,
+       * GL_RASTERIZER_DISCARD) affects whether or not we actually care.
+       */
+      return ctx->VertexProgram._Current != NULL;
+
+   case API_OPENGL_COMPAT:
+      if (ctx->VertexProgram._Current != NULL) {
+         /* Draw regardless of whether or not we have any vertex arrays.
+          * (Ex: could draw a point using a constant vertex pos)
+          */
+         return true;
+      } else {
+         /* Draw if we have vertex positions (GL_VERTEX_ARRAY or generic
+          * array [0]).
+          */
+         return (ctx->Array.VAO->VertexAttrib[VERT_ATTRIB_POS].Enabled ||
+                 ctx->Array.VAO->VertexAttrib[VERT_ATTRIB_GENERIC0].Enabled);
+      }
+
+   default:
+      unreachable("Invalid API value in have_vertex_input()");
+   }
+}
+
+
+/**
+ * Check if OK to draw arrays/elements.
+ */
+static bool
+check_valid_to_render(struct gl_context *ctx, const char *function)
+{
+   if (!_mesa_valid_to_render(ctx, function)) {
+      return false;
+   }
+
+   if (ctx->API == API_OPENGL_CORE) {
       /* Section 10.4 (Drawing Commands Using Vertex Arrays) of the OpenGL 4.5
        * Core Profile spec says:
        *
@@ -87,39 +128,36 @@ check_valid_to_render(struct gl_context *ctx, const char *function)
                      "%s(tess eval shader is missing)", function);
          return false;
       }
+   }
 
-      /* Section 7.3 (Program Objects) of the OpenGL 4.5 Core Profile spec
-       * says:
-       *
-       *     "If there is no active program for the vertex or fragment shader
-       *     stages, the results of vertex and/or fragment processing will be
-       *     undefined. However, this is not an error."
-       *
-       * The fragment shader is not tested here because other state (e.g.,
-       * GL_RASTERIZER_DISCARD) affects whether or not we actually care.
-       */
-      return ctx->VertexProgram._Current != NULL;
+   return have_vertex_input(ctx);
+}
 
-   case API_OPENGL_COMPAT:
-      if (ctx->VertexProgram._Current != NULL) {
-         /* Draw regardless of whether or not we have any vertex arrays.
-          * (Ex: could draw a point using a constant vertex pos)
-          */
-         return true;
-      } else {
-         /* Draw if we have vertex positions (GL_VERTEX_ARRAY or generic
-          * array [0]).
-          */
-         return (ctx->Array.VAO->VertexAttrib[VERT_ATTRIB_POS].Enabled ||
-                 ctx->Array.VAO->VertexAttrib[VERT_ATTRIB_GENERIC0].Enabled);
-      }
-      break;
 
-   default:
-      unreachable("Invalid API value in check_valid_to_render()");
-   }
+/**
+ * Prepares for a draw in a KHR_no_error context.
+ *
+ * The application promises that the draw is valid, so this only does what
+ * check_valid_to_render() does besides checking for errors: waiting for
+ * background links, updating derived state, validating a newly bound
+ * pipeline object and skipping draws that have nothing to draw.
+ *
+ * \return true if the draw should go ahead.
+ */
+bool
+_mesa_prepare_draw_no_error(struct gl_context *ctx)
+{
+   FLUSH_CURRENT(ctx, 0);
 
-   return true;
+   _mesa_wait_pipeline(ctx, ctx->_Shader);
+
+   if (ctx->NewState)
+      _mesa_update_state(ctx);
+
+   if (ctx->_Shader->Name && !ctx->_Shader->Validated)
+      _mesa_validate_program_pipeline(ctx, ctx->_Shader, GL_TRUE);
+
+   return have_vertex_input(ctx);
 }
 
 
@@ -165,6 +203,9 @@ _mesa_valid_prim_mode(struct gl_context *ctx, GLenum mode, const char *name)
 {
    bool valid_enum = _mesa_is_valid_prim_mode(ctx, mode);
 
+   /* The checks below look at the linked programs. */
+   _mesa_wait_pipeline(ctx, ctx->_Shader);
+
    if (!valid_enum) {
       _mesa_error(ctx, GL_INVALID_ENUM, "%s(mode=%x)", name, mode);
       return GL_FALSE;
@@ -896,6 +937,7 @@ check_valid_to_compute(struct gl_context *ctx, const char *function)
    }
 
    prog = ctx->Shader.CurrentProgram[MESA_SHADER_COMPUTE];
+   _mesa_wait_shader_program(ctx, prog);
    if (prog == NULL || prog->_LinkedShaders[MESA_SHADER_COMPUTE] == NULL) {
       _mesa_error(ctx, GL_INVALID_OPERATION,
                   "%s(no active compute shader)",
@@ -42,6 +42,9 @@ extern GLboolean
 _mesa_valid_prim_mode(struct gl_context *ctx, GLenum mode, const char *name);
 
 
+extern bool
+_mesa_prepare_draw_no_error(struct gl_context *ctx);
+
 extern GLboolean
 _mesa_validate_DrawArrays(struct gl_context *ctx, GLenum mode, GLsizei count);
 
@@ -151,6 +151,7 @@ unbind_array_object_vbos(struct gl_context *ctx, struct gl_vertex_array_object *
  * Allocate and initialize a new vertex array object.
  *
  * This function is intended to be called via
+ * \c dd_function_table::NewArrayObject.
  */
 struct gl_vertex_array_object *
 _mesa_new_vao(struct gl_context *ctx, GLuint name)
@@ -203,7 +204,7 @@ _mesa_reference_vao_(struct gl_context *ctx,
       mtx_unlock(&oldObj->Mutex);
 
       if (deleteFlag)
-         _mesa_delete_vao(ctx, oldObj);
+         ctx->Driver.DeleteArrayObject(ctx, oldObj);
 
       *ptr = NULL;
    }
@@ -346,6 +347,9 @@ _mesa_update_vao_client_arrays(struct gl_context *ctx,
 {
    GLbitfield64 arrays = vao->NewArrays;
 
+   if (arrays)
+      vao->Generation++;
+
    while (arrays) {
       struct gl_client_array *client_array;
       struct gl_vertex_attrib_array *attrib_array;
@@ -405,7 +409,7 @@ bind_vertex_array(struct gl_context *ctx, GLuint id, GLboolean genRequired)
          }
 
          /* For APPLE version, generate a new array object now */
-	 newObj = _mesa_new_vao(ctx, id);
+	 newObj = ctx->Driver.NewArrayObject(ctx, id);
          if (!newObj) {
             _mesa_error(ctx, GL_OUT_OF_MEMORY, "glBindVertexArrayAPPLE");
             return;
@@ -558,7 +562,7 @@ gen_vertex_arrays(struct gl_context *ctx, GLsizei n, GLuint *arrays,
       struct gl_vertex_array_object *obj;
       GLuint name = first + i;
 
-      obj = _mesa_new_vao(ctx, name);
+      obj = ctx->Driver.NewArrayObject(ctx, name);
       if (!obj) {
          _mesa_error(ctx, GL_OUT_OF_MEMORY, "%s", func);
          return;
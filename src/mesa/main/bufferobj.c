@@ -43,6 +43,7 @@
 #include "glformats.h"
 #include "texstore.h"
 #include "transformfeedback.h"
+#include "vbo/vbo.h"
 
 
 /* Debug flags */
@@ -419,6 +420,7 @@ _mesa_delete_buffer_object(struct gl_context *ctx,
 {
    (void) ctx;
 
+   vbo_delete_minmax_cache(bufObj);
    _mesa_align_free(bufObj->Data);
 
    /* assign strange values here to help w/ debugging */
@@ -490,6 +492,7 @@ _mesa_initialize_buffer_object(struct gl_context *ctx,
 {
    memset(obj, 0, sizeof(struct gl_buffer_object));
    mtx_init(&obj->Mutex, mtx_plain);
+   mtx_init(&obj->MinMaxCacheMutex, mtx_plain);
    obj->RefCount = 1;
    obj->Name = name;
    obj->Usage = GL_STATIC_DRAW_ARB;
@@ -968,6 +971,10 @@ bind_buffer_object(struct gl_context *ctx, GLenum target, GLuint buffer)
       if (!_mesa_handle_bind_buffer_gen(ctx, buffer,
                                         &newBufObj, "glBindBuffer"))
          return;
+
+      /* Pixel pack operations write the buffer on the GPU. */
+      if (target == GL_PIXEL_PACK_BUFFER)
+         newBufObj->UsageHistory |= USAGE_PIXEL_PACK_BUFFER;
    }
 
    /* bind new buffer */
@@ -1468,6 +1475,7 @@ _mesa_buffer_storage(struct gl_context *ctx, struct gl_buffer_object *bufObj,
    FLUSH_VERTICES(ctx, _NEW_BUFFER_OBJECT);
 
    bufObj->Written = GL_TRUE;
+   bufObj->MinMaxCacheDirty = true;
    bufObj->Immutable = GL_TRUE;
 
    assert(ctx->Driver.BufferData);
@@ -1581,6 +1589,7 @@ _mesa_buffer_data(struct gl_context *ctx, struct gl_buffer_object *bufObj,
    FLUSH_VERTICES(ctx, _NEW_BUFFER_OBJECT);
 
    bufObj->Written = GL_TRUE;
+   bufObj->MinMaxCacheDirty = true;
 
 #ifdef VBO_DEBUG
    printf("glBufferDataARB(%u, sz %ld, from %p, usage 0x%x)\n",
@@ -1646,6 +1655,24 @@ _mesa_NamedBufferData(GLuint buffer, GLsizeiptr size, const GLvoid *data,
 }
 
 
+/**
+ * Uploads data to a range of a buffer object that is known to be valid.
+ */
+static void
+buffer_sub_data(struct gl_context *ctx, struct gl_buffer_object *bufObj,
+                GLintptr offset, GLsizeiptr size, const GLvoid *data)
+{
+   if (size == 0)
+      return;
+
+   bufObj->Written = GL_TRUE;
+   bufObj->MinMaxCacheDirty = true;
+
+   assert(ctx->Driver.BufferSubData);
+   ctx->Driver.BufferSubData(ctx, offset, size, data, bufObj);
+}
+
+
 /**
  * Implementation for glBufferSubData and glNamedBufferSubData.
  *
@@ -1674,13 +1701,7 @@ _mesa_buffer_sub_data(struct gl_context *ctx, struct gl_buffer_object *bufObj,
       return;
    }
 
-   if (size == 0)
-      return;
-
-   bufObj->Written = GL_TRUE;
-
-   assert(ctx->Driver.BufferSubData);
-   ctx->Driver.BufferSubData(ctx, offset, size, data, bufObj);
+   buffer_sub_data(ctx, bufObj, offset, size, data);
 }
 
 void GLAPIENTRY
@@ -1697,6 +1718,20 @@ _mesa_BufferSubData(GLenum target, GLintptr offset,
    _mesa_buffer_sub_data(ctx, bufObj, offset, size, data, "glBufferSubData");
 }
 
+/**
+ * glBufferSubData for KHR_no_error contexts, where the target is known to
+ * have a buffer bound and the range to be valid.
+ */
+void GLAPIENTRY
+_mesa_BufferSubData_no_error(GLenum target, GLintptr offset,
+                             GLsizeiptr size, const GLvoid *data)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct gl_buffer_object **bufObj = get_buffer_target(ctx, target);
+
+   buffer_sub_data(ctx, *bufObj, offset, size, data);
+}
+
 void GLAPIENTRY
 _mesa_NamedBufferSubData(GLuint buffer, GLintptr offset,
                          GLsizeiptr size, const GLvoid *data)
@@ -1793,6 +1828,8 @@ _mesa_clear_buffer_sub_data(struct gl_context *ctx,
       return;
    }
 
+   bufObj->MinMaxCacheDirty = true;
+
    if (data == NULL) {
       /* clear to zeros, per the spec */
       if (size > 0) {
@@ -2210,6 +2247,8 @@ _mesa_copy_buffer_sub_data(struct gl_context *ctx,
       }
    }
 
+   dst->MinMaxCacheDirty = true;
+
    ctx->Driver.CopyBufferSubData(ctx, src, dst, readOffset, writeOffset, size);
 }
 
@@ -2402,8 +2441,10 @@ _mesa_map_buffer_range(struct gl_context *ctx,
       assert(bufObj->Mappings[MAP_USER].AccessFlags == access);
    }
 
-   if (access & GL_MAP_WRITE_BIT)
+   if (access & GL_MAP_WRITE_BIT) {
       bufObj->Written = GL_TRUE;
+      bufObj->MinMaxCacheDirty = true;
+   }
 
 #ifdef VBO_DEBUG
    if (strstr(func, "Range") == NULL) { /* If not MapRange */
@@ -98,6 +98,7 @@
 #include "fog.h"
 #include "formats.h"
 #include "framebuffer.h"
+#include "glthread.h"
 #include "hint.h"
 #include "hash.h"
 #include "light.h"
@@ -118,6 +119,7 @@
 #include "scissor.h"
 #include "shared.h"
 #include "shaderobj.h"
+#include "shaderqueue.h"
 #include "shaderimage.h"
 #include "util/simple_list.h"
 #include "util/strtod.h"
@@ -984,8 +986,8 @@ _mesa_new_nop_table(unsigned numEntries)
  * populated with pointers to "no-op" functions.  In turn, the no-op
  * functions will call nop_handler() above.
  */
-static struct _glapi_table *
-alloc_dispatch_table(void)
+struct _glapi_table *
+_mesa_alloc_dispatch_table(void)
 {
    /* Find the larger of Mesa's dispatch table and libGL's dispatch table.
     * In practice, this'll be the same for stand-alone Mesa.  But for DRI
@@ -1057,7 +1059,7 @@ create_beginend_table(const struct gl_context *ctx)
 {
    struct _glapi_table *table;
 
-   table = alloc_dispatch_table();
+   table = _mesa_alloc_dispatch_table();
    if (!table)
       return NULL;
 
@@ -1100,9 +1102,30 @@ create_beginend_table(const struct gl_context *ctx)
    return table;
 }
 
+/**
+ * Whether an environment variable turning on an option is set to something
+ * other than "0" or "false".
+ */
+static bool
+env_var_enabled(const char *name)
+{
+   const char *env = getenv(name);
+
+   return env && strcmp(env, "0") != 0 && strcmp(env, "false") != 0;
+}
+
 void
 _mesa_initialize_dispatch_tables(struct gl_context *ctx)
 {
+   /* Let known-correct applications skip API validation.  Drivers set the
+    * context flags before getting here, and debug and robust contexts have
+    * to keep reporting errors.
+    */
+   if (env_var_enabled("MESA_NO_ERROR") &&
+       !(ctx->Const.ContextFlags & (GL_CONTEXT_FLAG_DEBUG_BIT |
+                                    GL_CONTEXT_FLAG_ROBUST_ACCESS_BIT_ARB)))
+      ctx->Const.ContextFlags |= GL_CONTEXT_FLAG_NO_ERROR_BIT_KHR;
+
    /* Do the code-generated setup of the exec table in api_exec.c. */
    _mesa_initialize_exec_table(ctx);
 
@@ -1194,7 +1217,7 @@ _mesa_initialize_context(struct gl_context *ctx,
       goto fail;
 
    /* setup the API dispatch tables with all nop functions */
-   ctx->OutsideBeginEnd = alloc_dispatch_table();
+   ctx->OutsideBeginEnd = _mesa_alloc_dispatch_table();
    if (!ctx->OutsideBeginEnd)
       goto fail;
    ctx->Exec = ctx->OutsideBeginEnd;
@@ -1221,7 +1244,7 @@ _mesa_initialize_context(struct gl_context *ctx,
    switch (ctx->API) {
    case API_OPENGL_COMPAT:
       ctx->BeginEnd = create_beginend_table(ctx);
-      ctx->Save = alloc_dispatch_table();
+      ctx->Save = _mesa_alloc_dispatch_table();
       if (!ctx->BeginEnd || !ctx->Save)
          goto fail;
 
@@ -1310,6 +1333,8 @@ _mesa_create_context(gl_api api,
 void
 _mesa_free_context_data( struct gl_context *ctx )
 {
+   _mesa_glthread_destroy(ctx);
+
    if (!_mesa_get_current_context()){
       /* No current context, but we may need one in order to delete
        * texture objs, etc.  So temporarily bind the context now.
@@ -1687,6 +1712,10 @@ _mesa_make_current( struct gl_context *newCtx,
       }
    }
 
+   /* The worker thread must be done with the context before we touch it. */
+   if (curCtx)
+      _mesa_glthread_finish(curCtx);
+
    if (curCtx && 
        (curCtx->WinSysDrawBuffer || curCtx->WinSysReadBuffer) &&
        /* make sure this context is valid for flushing */
@@ -1703,7 +1732,20 @@ _mesa_make_current( struct gl_context *newCtx,
       _glapi_set_dispatch(NULL);  /* none current */
    }
    else {
-      _glapi_set_dispatch(newCtx->CurrentDispatch);
+      /* Only contexts bound to a drawable get a worker thread: that also
+       * keeps _mesa_free_context_data() from starting one again.  Drivers
+       * that don't finish the worker before flushing or swapping would
+       * race with it, so they never get one.
+       */
+      if (!newCtx->GLThread && drawBuffer && readBuffer &&
+          newCtx->Const.GLThreadSupported &&
+          env_var_enabled("MESA_GLTHREAD"))
+         _mesa_glthread_init(newCtx);
+
+      if (newCtx->GLThread)
+         _glapi_set_dispatch(newCtx->MarshalExec);
+      else
+         _glapi_set_dispatch(newCtx->CurrentDispatch);
 
       if (drawBuffer && readBuffer) {
          assert(_mesa_is_winsys_fbo(drawBuffer));
@@ -1966,6 +2008,9 @@ _mesa_valid_to_render(struct gl_context *ctx, const char *where)
 {
    unsigned i;
 
+   /* Finish background links of the bound programs first. */
+   _mesa_wait_pipeline(ctx, ctx->_Shader);
+
    /* This depends on having up to date derived state (shaders) */
    if (ctx->NewState)
       _mesa_update_state(ctx);
@@ -154,6 +154,9 @@ extern void
 _mesa_notifySwapBuffers(struct gl_context *gc);
 
 
+extern struct _glapi_table *
+_mesa_alloc_dispatch_table(void);
+
 extern struct _glapi_table *
 _mesa_get_dispatch(struct gl_context *ctx);
 
@@ -365,6 +368,18 @@ _mesa_has_tessellation(const struct gl_context *ctx)
 }
 
 
+/**
+ * Checks if the context was created with KHR_no_error, in which case the
+ * application promises not to generate GL errors and API validation can be
+ * skipped.
+ */
+static inline bool
+_mesa_is_no_error_enabled(const struct gl_context *ctx)
+{
+   return ctx->Const.ContextFlags & GL_CONTEXT_FLAG_NO_ERROR_BIT_KHR;
+}
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -652,6 +652,16 @@ struct dd_function_table {
                              gl_map_buffer_index index);
    /*@}*/
 
+   /**
+    * \name Vertex array object functions
+    */
+   /*@{*/
+   struct gl_vertex_array_object * (*NewArrayObject)(struct gl_context *ctx,
+                                                     GLuint name);
+   void (*DeleteArrayObject)(struct gl_context *ctx,
+                             struct gl_vertex_array_object *obj);
+   /*@}*/
+
    /**
     * \name Functions for GL_APPLE_object_purgeable
     */
@@ -751,6 +761,11 @@ struct dd_function_table {
     * \name GLSL-related functions (ARB extensions and OpenGL 2.x)
     */
    /*@{*/
+   /**
+    * Allocate a shader object.  The linker calls this for the linked
+    * shaders, possibly on a background thread, so it must not touch any
+    * context state.
+    */
    struct gl_shader *(*NewShader)(struct gl_context *ctx,
                                   GLuint name, GLenum type);
    void (*UseProgram)(struct gl_context *ctx, struct gl_shader_program *shProg);
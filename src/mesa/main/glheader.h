@@ -135,6 +135,16 @@ typedef void *GLeglImageOES;
 #define GL_SHADER_PROGRAM_MESA 0x9999
 
 
+/**
+ * The single program binary format reported by GL_PROGRAM_BINARY_FORMATS.
+ * Binaries in this format are only valid for the Mesa build and driver that
+ * produced them.
+ */
+#ifndef GL_PROGRAM_BINARY_FORMAT_MESA
+#define GL_PROGRAM_BINARY_FORMAT_MESA 0x875F
+#endif
+
+
 /* Several fields of struct gl_config can take these as values.  Since
  * GLX header files may not be available everywhere they need to be used,
  * redefine them here.
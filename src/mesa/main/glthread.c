@@ -0,0 +1,383 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file glthread.c
+ *
+ * Support functions for the glthread feature of Mesa.
+ *
+ * In multicore systems, many applications end up CPU-bound with about half
+ * their time spent inside their rendering thread and half inside Mesa.  To
+ * alleviate this, we put a shim layer in Mesa at the GL dispatch level that
+ * quickly logs the GL commands to a buffer to be processed by a worker
+ * thread.
+ */
+
+#include <stdlib.h>
+
+#include "main/glthread.h"
+#include "main/mtypes.h"
+#include "main/hash.h"
+#include "main/marshal.h"
+
+
+static void
+glthread_unmarshal_batch(void *job, int thread_index)
+{
+   struct glthread_batch *batch = (struct glthread_batch *) job;
+   struct gl_context *ctx = batch->ctx;
+   size_t pos = 0;
+
+   while (pos < batch->used)
+      pos += _mesa_unmarshal_dispatch_cmd(ctx, (uint8_t *) batch->buffer + pos);
+
+   assert(pos == batch->used);
+   batch->used = 0;
+}
+
+
+/**
+ * Makes the context current on the worker thread.  This is the first job
+ * of the queue.
+ */
+static void
+glthread_thread_initialization(void *job, int thread_index)
+{
+   struct gl_context *ctx = (struct gl_context *) job;
+
+   _glapi_check_multithread();
+   _glapi_set_context(ctx);
+   _glapi_set_dispatch(ctx->CurrentDispatch);
+}
+
+
+/**
+ * Starts the worker thread for the context, and creates the dispatch table
+ * to install on the application thread.  Leaves ctx->GLThread NULL if
+ * anything fails, in which case GL calls keep being executed directly.
+ */
+void
+_mesa_glthread_init(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = calloc(1, sizeof(*glthread));
+   unsigned i;
+
+   if (!glthread)
+      return;
+
+   glthread->VAOs = _mesa_NewHashTable();
+   if (!glthread->VAOs)
+      goto fail;
+
+   ctx->MarshalExec = _mesa_create_marshal_table(ctx);
+   if (!ctx->MarshalExec)
+      goto fail;
+
+   if (!util_queue_init(&glthread->queue, "glthread", MARSHAL_MAX_BATCHES, 1))
+      goto fail;
+
+   for (i = 0; i < MARSHAL_MAX_BATCHES; i++) {
+      glthread->batches[i].ctx = ctx;
+      util_queue_fence_init(&glthread->batches[i].fence);
+   }
+
+   glthread->CurrentVAO = &glthread->DefaultVAO;
+   glthread->UnknownVAO.HasUserPointer = true;
+
+   ctx->GLThread = glthread;
+
+   _glapi_check_multithread();
+   util_queue_add_job(&glthread->queue, ctx, NULL,
+                      glthread_thread_initialization,
+                      UTIL_QUEUE_PRIORITY_NORMAL);
+   return;
+
+fail:
+   free(ctx->MarshalExec);
+   ctx->MarshalExec = NULL;
+   if (glthread->VAOs)
+      _mesa_DeleteHashTable(glthread->VAOs);
+   free(glthread);
+}
+
+
+static void
+free_vao(GLuint key, void *data, void *userData)
+{
+   free(data);
+}
+
+
+/**
+ * Executes the pending calls, stops the worker thread and puts the real
+ * dispatch table back if the context is current.
+ */
+void
+_mesa_glthread_destroy(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   unsigned i;
+
+   if (!glthread)
+      return;
+
+   _mesa_glthread_finish(ctx);
+   util_queue_destroy(&glthread->queue);
+
+   for (i = 0; i < MARSHAL_MAX_BATCHES; i++)
+      util_queue_fence_destroy(&glthread->batches[i].fence);
+
+   _mesa_HashDeleteAll(glthread->VAOs, free_vao, NULL);
+   _mesa_DeleteHashTable(glthread->VAOs);
+
+   free(glthread);
+   ctx->GLThread = NULL;
+
+   if (_mesa_get_current_context() == ctx)
+      _glapi_set_dispatch(ctx->CurrentDispatch);
+
+   free(ctx->MarshalExec);
+   ctx->MarshalExec = NULL;
+}
+
+
+/**
+ * Puts the marshalling dispatch table back on the application thread after
+ * a call executed synchronously may have installed another one.
+ */
+void
+_mesa_glthread_restore_dispatch(struct gl_context *ctx)
+{
+   if (ctx->GLThread && GET_DISPATCH() != ctx->MarshalExec)
+      _glapi_set_dispatch(ctx->MarshalExec);
+}
+
+
+/**
+ * Hands the batch being filled to the worker thread, and waits until the
+ * next one is free to be filled.
+ */
+void
+_mesa_glthread_flush_batch(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_batch *next;
+
+   if (!glthread)
+      return;
+
+   next = &glthread->batches[glthread->next];
+   if (!next->used)
+      return;
+
+   util_queue_add_job(&glthread->queue, next, &next->fence,
+                      glthread_unmarshal_batch, UTIL_QUEUE_PRIORITY_NORMAL);
+   glthread->last = glthread->next;
+   glthread->next = (glthread->next + 1) % MARSHAL_MAX_BATCHES;
+
+   util_queue_fence_wait(&glthread->batches[glthread->next].fence);
+}
+
+
+/**
+ * Waits until all pending batches have been executed.
+ *
+ * The application thread calls this before accessing the context itself,
+ * since the worker thread is idle afterwards.
+ */
+void
+_mesa_glthread_finish(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!glthread)
+      return;
+
+   /* The worker thread calls into the driver, which may want to finish the
+    * context (for example when flushing): there is nothing to wait for.
+    */
+   if (thrd_equal(glthread->queue.threads[0], thrd_current()))
+      return;
+
+   _mesa_glthread_flush_batch(ctx);
+   util_queue_fence_wait(&glthread->batches[glthread->last].fence);
+}
+
+
+static struct glthread_vao *
+lookup_vao(struct glthread_state *glthread, GLuint id)
+{
+   struct glthread_vao *vao;
+
+   if (id == 0)
+      return &glthread->DefaultVAO;
+
+   vao = _mesa_HashLookup(glthread->VAOs, id);
+   if (!vao) {
+      /* The name may not have been generated yet (APPLE_vertex_array_object
+       * creates the object on bind), or may be invalid, in which case the
+       * call fails and there's no harm in tracking it anyway.
+       */
+      vao = calloc(1, sizeof(*vao));
+      if (!vao)
+         return &glthread->UnknownVAO;
+
+      vao->Name = id;
+      _mesa_HashInsert(glthread->VAOs, id, vao);
+   }
+
+   return vao;
+}
+
+
+void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   switch (target) {
+   case GL_ARRAY_BUFFER:
+      glthread->CurrentArrayBuffer = buffer;
+      break;
+   case GL_ELEMENT_ARRAY_BUFFER:
+      glthread->CurrentVAO->IndexBuffer = buffer;
+      break;
+   }
+}
+
+
+void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   GLsizei i;
+
+   if (n < 0 || !buffers)
+      return;
+
+   /* Deleting a buffer unbinds it from the context and the current VAO. */
+   for (i = 0; i < n; i++) {
+      if (buffers[i] == 0)
+         continue;
+
+      if (buffers[i] == glthread->CurrentArrayBuffer)
+         glthread->CurrentArrayBuffer = 0;
+      if (buffers[i] == glthread->CurrentVAO->IndexBuffer)
+         glthread->CurrentVAO->IndexBuffer = 0;
+   }
+}
+
+
+void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint id)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   glthread->CurrentVAO = lookup_vao(glthread, id);
+}
+
+
+void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx,
+                                  GLsizei n, const GLuint *ids)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   GLsizei i;
+
+   if (n < 0 || !ids)
+      return;
+
+   for (i = 0; i < n; i++) {
+      struct glthread_vao *vao;
+
+      if (ids[i] == 0)
+         continue;
+
+      vao = _mesa_HashLookup(glthread->VAOs, ids[i]);
+      if (!vao)
+         continue;
+
+      /* Deleting the bound VAO binds the default one. */
+      if (glthread->CurrentVAO == vao)
+         glthread->CurrentVAO = &glthread->DefaultVAO;
+
+      _mesa_HashRemove(glthread->VAOs, ids[i]);
+      free(vao);
+   }
+}
+
+
+void
+_mesa_glthread_VertexArrayElementBuffer(struct gl_context *ctx,
+                                        GLuint vaobj, GLuint buffer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (vaobj != 0)
+      lookup_vao(glthread, vaobj)->IndexBuffer = buffer;
+}
+
+
+/**
+ * Called after any of the gl*Pointer functions.
+ */
+void
+_mesa_glthread_AttribPointer(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (glthread->CurrentArrayBuffer == 0)
+      glthread->CurrentVAO->HasUserPointer = true;
+}
+
+
+/**
+ * glPopClientAttrib restores bindings we haven't kept a copy of, so give up
+ * on knowing what the current VAO uses until the next glBindVertexArray.
+ */
+void
+_mesa_glthread_PopClientAttrib(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   glthread->UnknownVAO.IndexBuffer = 0;
+   glthread->CurrentVAO = &glthread->UnknownVAO;
+   glthread->CurrentArrayBuffer = 0;
+}
+
+
+bool
+_mesa_glthread_has_user_arrays(const struct gl_context *ctx)
+{
+   return ctx->GLThread->CurrentVAO->HasUserPointer;
+}
+
+
+bool
+_mesa_glthread_has_user_indices(const struct gl_context *ctx)
+{
+   const struct glthread_vao *vao = ctx->GLThread->CurrentVAO;
+
+   return vao->HasUserPointer || vao->IndexBuffer == 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** \file glthread.h
+ *
+ * Executing GL calls on a separate thread.
+ *
+ * When MESA_GLTHREAD is set and the driver sets Const.GLThreadSupported,
+ * the application thread gets a dispatch table of marshalling functions
+ * (generated by gl_marshal.py) instead of the real implementation.  Calls that don't return anything and whose
+ * arguments can be copied are recorded into a batch, and full batches are
+ * executed by a worker thread, so that the cost of state validation and
+ * driver work moves off the application thread.  Every other call waits
+ * for the worker to run out of work and then executes directly on the
+ * application thread.
+ *
+ * Draw calls read vertex arrays and index buffers from client memory when
+ * no buffer object is bound, which can change as soon as the call returns.
+ * The bindings that decide this are shadowed on the application thread,
+ * and draw calls that may use client memory are executed synchronously.
+ */
+
+#ifndef _GLTHREAD_H
+#define _GLTHREAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "main/glheader.h"
+#include "util/u_queue.h"
+
+struct gl_context;
+struct _mesa_HashTable;
+
+/** Size of a batch, which is also the largest command that can be queued. */
+#define MARSHAL_MAX_CMD_SIZE (8 * 1024)
+
+/** Number of batches, including the one being filled. */
+#define MARSHAL_MAX_BATCHES 4
+
+struct glthread_batch
+{
+   /** The context to execute the commands with. */
+   struct gl_context *ctx;
+
+   /** Signalled once the worker has executed the batch. */
+   struct util_queue_fence fence;
+
+   /** Number of bytes of the buffer in use. */
+   size_t used;
+
+   /** Commands, each aligned to 8 bytes. */
+   uint64_t buffer[MARSHAL_MAX_CMD_SIZE / 8];
+};
+
+/**
+ * What the application thread knows about a vertex array object.
+ */
+struct glthread_vao
+{
+   GLuint Name;
+
+   /** The element array buffer bound to the VAO, 0 for none. */
+   GLuint IndexBuffer;
+
+   /**
+    * Whether an attribute pointer was ever set without an array buffer
+    * bound, in which case it may point to client memory.
+    */
+   bool HasUserPointer;
+};
+
+struct glthread_state
+{
+   /** The worker thread executing batches. */
+   struct util_queue queue;
+
+   struct glthread_batch batches[MARSHAL_MAX_BATCHES];
+
+   /** Index of the batch being filled. */
+   unsigned next;
+
+   /** Index of the batch that was queued last. */
+   unsigned last;
+
+   /** Shadow of the vertex array object bindings, see glthread_vao. */
+   struct _mesa_HashTable *VAOs;
+   struct glthread_vao DefaultVAO;
+   struct glthread_vao *CurrentVAO;
+
+   /**
+    * Stands for a VAO binding that couldn't be tracked (after
+    * glPopClientAttrib), and always looks like it uses client memory.
+    */
+   struct glthread_vao UnknownVAO;
+
+   /** The buffer bound to GL_ARRAY_BUFFER. */
+   GLuint CurrentArrayBuffer;
+};
+
+extern void
+_mesa_glthread_init(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_destroy(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_restore_dispatch(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_flush_batch(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_finish(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer);
+
+extern void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers);
+
+extern void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint id);
+
+extern void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx,
+                                  GLsizei n, const GLuint *ids);
+
+extern void
+_mesa_glthread_VertexArrayElementBuffer(struct gl_context *ctx,
+                                        GLuint vaobj, GLuint buffer);
+
+extern void
+_mesa_glthread_AttribPointer(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_PopClientAttrib(struct gl_context *ctx);
+
+extern bool
+_mesa_glthread_has_user_arrays(const struct gl_context *ctx);
+
+extern bool
+_mesa_glthread_has_user_indices(const struct gl_context *ctx);
+
+#endif /* _GLTHREAD_H */
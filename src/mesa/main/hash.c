@@ -4,6 +4,11 @@
  *
  * Used for display lists, texture objects, vertex/fragment programs,
  * buffer objects, etc.  The hash functions are thread-safe.
+ *
+ * Objects with small keys, which is what glGen*() hands out, are kept in a
+ * plain array that _mesa_HashLookup() reads without taking the mutex.
+ * Larger keys go in a struct hash_table that is only accessed with the
+ * mutex held.  Inserting and removing always takes the mutex.
  * 
  * \note key=0 is illegal.
  *
@@ -38,31 +43,52 @@
 #include "imports.h"
 #include "hash.h"
 #include "util/hash_table.h"
+#include "util/u_atomic.h"
 
 /**
- * Magic GLuint object name that gets stored outside of the struct hash_table.
+ * Magic GLuint object name used as the deleted key of the struct hash_table.
  *
  * The hash table needs a particular pointer to be the marker for a key that
  * was deleted from the table, along with NULL for the "never allocated in the
  * table" marker.  Legacy GL allows any GLuint to be used as a GL object name,
- * and we use a 1:1 mapping from GLuints to key pointers, so we need to be
- * able to track a GLuint that happens to match the deleted key outside of
- * struct hash_table.  We tell the hash table to use "1" as the deleted key
- * value, so that we test the deleted-key-in-the-table path as best we can.
+ * and we use a 1:1 mapping from GLuints to key pointers.  Keys below
+ * DENSE_MIN_SIZE always live in the dense array, so the struct hash_table
+ * never sees this one.
  */
 #define DELETED_KEY_VALUE 1
 
+/** Size of the dense array of a new table. */
+#define DENSE_MIN_SIZE 64
+
+/** Keys from this one on always go in the struct hash_table. */
+#define DENSE_MAX_SIZE (1 << 20)
+
+/**
+ * Data of the keys below Size, indexed by key, with NULL for missing keys.
+ *
+ * The array is replaced by a larger one when it grows, but the old one is
+ * only freed with the table, as lock-free readers may still be looking at
+ * it.  Sizes at least double each time, so the old arrays never take more
+ * memory than the current one.
+ */
+struct _mesa_HashDense {
+   GLuint Size;
+   struct _mesa_HashDense *Retired;      /**< the array this one replaced */
+   void **Data;
+};
+
 /**
  * The hash table data structure.  
  */
 struct _mesa_HashTable {
-   struct hash_table *ht;
+   struct _mesa_HashDense *Dense;        /**< keys below Dense->Size */
+   GLuint NumDense;                      /**< non-NULL entries in Dense */
+   struct hash_table *ht;                /**< all other keys */
    GLuint MaxKey;                        /**< highest key inserted so far */
    mtx_t Mutex;                /**< mutual exclusion lock */
    mtx_t WalkMutex;            /**< for _mesa_HashWalk() */
    GLboolean InDeleteAll;                /**< Debug check */
-   /** Value that would be in the table for DELETED_KEY_VALUE. */
-   void *deleted_key_data;
+   GLboolean InWalk;                     /**< _mesa_HashWalk() is on ht */
 };
 
 /** @{
@@ -109,6 +135,78 @@ uint_key(GLuint id)
 }
 /** @} */
 
+static struct _mesa_HashDense *
+dense_create(GLuint size)
+{
+   struct _mesa_HashDense *dense =
+      calloc(1, sizeof(*dense) + size * sizeof(void *));
+
+   if (dense) {
+      dense->Size = size;
+      dense->Data = (void **) (dense + 1);
+   }
+
+   return dense;
+}
+
+/**
+ * Store into the dense array, with a full barrier so that lock-free readers
+ * that see the pointer also see the object it points to.
+ */
+static inline void
+dense_store(void **slot, void *data)
+{
+   (void) p_atomic_cmpxchg(slot, *slot, data);
+}
+
+/**
+ * Replace the dense array with one that covers key, unless the new array
+ * would be less than a quarter full.  Entries of the struct hash_table
+ * that fall within the new array are moved into it.
+ *
+ * \return GL_TRUE if key is now below table->Dense->Size.
+ */
+static GLboolean
+dense_grow(struct _mesa_HashTable *table, GLuint key)
+{
+   struct _mesa_HashDense *old = table->Dense;
+   struct _mesa_HashDense *dense;
+   struct hash_entry *entry;
+   GLuint entries, size;
+
+   /* Moving entries out of ht would make _mesa_HashWalk() miss them. */
+   if (key >= DENSE_MAX_SIZE || table->InWalk)
+      return GL_FALSE;
+
+   size = _mesa_next_pow_two_32(key + 1);
+   entries = table->NumDense + table->ht->entries + 1;
+   if (size / 4 > entries)
+      return GL_FALSE;
+
+   dense = dense_create(size);
+   if (!dense)
+      return GL_FALSE;
+
+   memcpy(dense->Data, old->Data, old->Size * sizeof(void *));
+   hash_table_foreach(table->ht, entry) {
+      GLuint k = (uintptr_t) entry->key;
+
+      if (k < size) {
+         dense->Data[k] = entry->data;
+         table->NumDense++;
+         _mesa_hash_table_remove(table->ht, entry);
+      }
+   }
+
+   /* Publish the filled array.  Readers that still see the old one take
+    * the mutex for the keys it doesn't cover, and then see this one.
+    */
+   dense->Retired = old;
+   (void) p_atomic_cmpxchg(&table->Dense, old, dense);
+
+   return GL_TRUE;
+}
+
 /**
  * Create a new hash table.
  * 
@@ -128,6 +226,14 @@ _mesa_NewHashTable(void)
          return NULL;
       }
 
+      table->Dense = dense_create(DENSE_MIN_SIZE);
+      if (table->Dense == NULL) {
+         _mesa_hash_table_destroy(table->ht, NULL);
+         free(table);
+         _mesa_error_no_memory(__func__);
+         return NULL;
+      }
+
       _mesa_hash_table_set_deleted_key(table->ht, uint_key(DELETED_KEY_VALUE));
       mtx_init(&table->Mutex, mtx_plain);
       mtx_init(&table->WalkMutex, mtx_plain);
@@ -152,14 +258,22 @@ _mesa_NewHashTable(void)
 void
 _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 {
+   struct _mesa_HashDense *dense, *retired;
+
    assert(table);
 
-   if (_mesa_hash_table_next_entry(table->ht, NULL) != NULL) {
+   if (table->NumDense ||
+       _mesa_hash_table_next_entry(table->ht, NULL) != NULL) {
       _mesa_problem(NULL, "In _mesa_DeleteHashTable, found non-freed data");
    }
 
    _mesa_hash_table_destroy(table->ht, NULL);
 
+   for (dense = table->Dense; dense; dense = retired) {
+      retired = dense->Retired;
+      free(dense);
+   }
+
    mtx_destroy(&table->Mutex);
    mtx_destroy(&table->WalkMutex);
    free(table);
@@ -179,8 +293,8 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
    assert(table);
    assert(key);
 
-   if (key == DELETED_KEY_VALUE)
-      return table->deleted_key_data;
+   if (key < table->Dense->Size)
+      return table->Dense->Data[key];
 
    entry = _mesa_hash_table_search(table->ht, uint_key(key));
    if (!entry)
@@ -192,6 +306,8 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 
 /**
  * Lookup an entry in the hash table.
+ *
+ * Keys covered by the dense array are looked up without locking.
  * 
  * \param table the hash table.
  * \param key the key.
@@ -201,8 +317,15 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 void *
 _mesa_HashLookup(struct _mesa_HashTable *table, GLuint key)
 {
+   const struct _mesa_HashDense *dense;
    void *res;
    assert(table);
+   assert(key);
+
+   dense = p_atomic_read(&table->Dense);
+   if (key < dense->Size)
+      return p_atomic_read(&dense->Data[key]);
+
    mtx_lock(&table->Mutex);
    res = _mesa_HashLookup_unlocked(table, key);
    mtx_unlock(&table->Mutex);
@@ -270,8 +393,11 @@ _mesa_HashInsert_unlocked(struct _mesa_HashTable *table, GLuint key, void *data)
    if (key > table->MaxKey)
       table->MaxKey = key;
 
-   if (key == DELETED_KEY_VALUE) {
-      table->deleted_key_data = data;
+   if (key < table->Dense->Size || dense_grow(table, key)) {
+      void **slot = &table->Dense->Data[key];
+
+      table->NumDense += (data != NULL) - (*slot != NULL);
+      dense_store(slot, data);
    } else {
       entry = _mesa_hash_table_search_pre_hashed(table->ht, hash, uint_key(key));
       if (entry) {
@@ -344,8 +470,13 @@ _mesa_HashRemove(struct _mesa_HashTable *table, GLuint key)
    }
 
    mtx_lock(&table->Mutex);
-   if (key == DELETED_KEY_VALUE) {
-      table->deleted_key_data = NULL;
+   if (key < table->Dense->Size) {
+      void **slot = &table->Dense->Data[key];
+
+      if (*slot) {
+         table->NumDense--;
+         dense_store(slot, NULL);
+      }
    } else {
       entry = _mesa_hash_table_search(table->ht, uint_key(key));
       _mesa_hash_table_remove(table->ht, entry);
@@ -369,20 +500,26 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
                     void (*callback)(GLuint key, void *data, void *userData),
                     void *userData)
 {
+   struct _mesa_HashDense *dense;
    struct hash_entry *entry;
+   GLuint key;
 
    assert(table);
    assert(callback);
    mtx_lock(&table->Mutex);
    table->InDeleteAll = GL_TRUE;
+   dense = table->Dense;
+   for (key = 1; key < dense->Size; key++) {
+      if (dense->Data[key]) {
+         callback(key, dense->Data[key], userData);
+         dense_store(&dense->Data[key], NULL);
+      }
+   }
+   table->NumDense = 0;
    hash_table_foreach(table->ht, entry) {
       callback((uintptr_t)entry->key, entry->data, userData);
       _mesa_hash_table_remove(table->ht, entry);
    }
-   if (table->deleted_key_data) {
-      callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
-      table->deleted_key_data = NULL;
-   }
    table->InDeleteAll = GL_FALSE;
    mtx_unlock(&table->Mutex);
 }
@@ -407,16 +544,41 @@ _mesa_HashWalk(const struct _mesa_HashTable *table,
 {
    /* cast-away const */
    struct _mesa_HashTable *table2 = (struct _mesa_HashTable *) table;
+   const struct _mesa_HashDense *dense;
    struct hash_entry *entry;
+   GLuint key = 1;
 
    assert(table);
    assert(callback);
    mtx_lock(&table2->WalkMutex);
+   /* The array can't be freed under us if the callback makes it grow, but
+    * growing moves entries from ht into the part it gained, so visit that
+    * part too until the array stops changing.
+    */
+   for (dense = p_atomic_read(&table->Dense); key < dense->Size;
+        dense = p_atomic_read(&table->Dense)) {
+      for (; key < dense->Size; key++) {
+         void *data = p_atomic_read(&dense->Data[key]);
+
+         if (data)
+            callback(key, data, userData);
+      }
+   }
+
+   /* From here on, growing would mix entries we've seen with ones we
+    * haven't, so inserts stay in ht until we're done.
+    */
+   mtx_lock(&table2->Mutex);
+   table2->InWalk = GL_TRUE;
+   mtx_unlock(&table2->Mutex);
+
    hash_table_foreach(table->ht, entry) {
       callback((uintptr_t)entry->key, entry->data, userData);
    }
-   if (table->deleted_key_data)
-      callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
+
+   mtx_lock(&table2->Mutex);
+   table2->InWalk = GL_FALSE;
+   mtx_unlock(&table2->Mutex);
    mtx_unlock(&table2->WalkMutex);
 }
 
@@ -434,8 +596,6 @@ debug_print_entry(GLuint key, void *data, void *userData)
 void
 _mesa_HashPrint(const struct _mesa_HashTable *table)
 {
-   if (table->deleted_key_data)
-      debug_print_entry(DELETED_KEY_VALUE, table->deleted_key_data, NULL);
    _mesa_HashWalk(table, debug_print_entry, NULL);
 }
 
@@ -496,14 +656,5 @@ _mesa_HashFindFreeKeyBlock(struct _mesa_HashTable *table, GLuint numKeys)
 GLuint
 _mesa_HashNumEntries(const struct _mesa_HashTable *table)
 {
-   struct hash_entry *entry;
-   GLuint count = 0;
-
-   if (table->deleted_key_data)
-      count++;
-
-   hash_table_foreach(table->ht, entry)
-      count++;
-
-   return count;
+   return table->NumDense + table->ht->entries;
 }
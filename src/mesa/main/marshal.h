@@ -0,0 +1,126 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** \file marshal.h
+ *
+ * Declarations of functions related to marshalling GL calls from a client
+ * thread to a server thread.
+ */
+
+#ifndef MARSHAL_H
+#define MARSHAL_H
+
+#include <stdint.h>
+
+#include "main/glthread.h"
+#include "main/context.h"
+#include "main/macros.h"
+
+/**
+ * Header of every command in a batch.  The command structures generated
+ * by gl_marshal.py start with it.
+ */
+struct marshal_cmd_base
+{
+   /**
+    * Type of command.  See enum marshal_dispatch_cmd_id.
+    */
+   uint16_t cmd_id;
+
+   /**
+    * Size of command, in bytes, including the header.
+    */
+   uint16_t cmd_size;
+};
+
+/**
+ * Reserves size bytes for a command in the current batch, flushing the
+ * batch first if it doesn't have room for them.  size must be a multiple
+ * of 8 and at most MARSHAL_MAX_CMD_SIZE.
+ */
+static inline void *
+_mesa_glthread_allocate_command(struct gl_context *ctx,
+                                uint16_t cmd_id,
+                                size_t size)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_batch *next = &glthread->batches[glthread->next];
+   struct marshal_cmd_base *cmd_base;
+
+   assert(size % 8 == 0 && size <= MARSHAL_MAX_CMD_SIZE);
+
+   if (unlikely(next->used + size > MARSHAL_MAX_CMD_SIZE)) {
+      _mesa_glthread_flush_batch(ctx);
+      next = &glthread->batches[glthread->next];
+   }
+
+   cmd_base = (struct marshal_cmd_base *)
+      ((uint8_t *) next->buffer + next->used);
+   next->used += size;
+   cmd_base->cmd_id = cmd_id;
+   cmd_base->cmd_size = size;
+   return cmd_base;
+}
+
+#ifdef DEBUG_MARSHAL_PRINT_CALLS
+static inline void
+debug_print_sync(const char *func)
+{
+   printf("sync: %s\n", func);
+}
+
+static inline void
+debug_print_sync_fallback(const char *func)
+{
+   printf("fallback to sync: %s\n", func);
+}
+
+static inline void
+debug_print_unmarshal(const char *func)
+{
+   printf("unmarshal: %s\n", func);
+}
+#else
+static inline void
+debug_print_sync(const char *func)
+{
+}
+
+static inline void
+debug_print_sync_fallback(const char *func)
+{
+}
+
+static inline void
+debug_print_unmarshal(const char *func)
+{
+}
+#endif
+
+struct _glapi_table *
+_mesa_create_marshal_table(const struct gl_context *ctx);
+
+size_t
+_mesa_unmarshal_dispatch_cmd(struct gl_context *ctx, const void *cmd);
+
+#endif /* MARSHAL_H */
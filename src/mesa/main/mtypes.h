@@ -79,6 +79,8 @@ struct gl_program_cache;
 struct gl_texture_object;
 struct gl_debug_state;
 struct gl_context;
+struct disk_cache;
+struct gl_shader_queue;
 struct st_context;
 struct gl_uniform_storage;
 struct prog_instruction;
@@ -1253,6 +1255,9 @@ typedef enum {
    USAGE_TEXTURE_BUFFER = 0x2,
    USAGE_ATOMIC_COUNTER_BUFFER = 0x4,
    USAGE_SHADER_STORAGE_BUFFER = 0x8,
+   USAGE_TRANSFORM_FEEDBACK_BUFFER = 0x10,
+   USAGE_PIXEL_PACK_BUFFER = 0x20,
+   USAGE_DISABLE_MINMAX_CACHE = 0x40,
 } gl_buffer_usage;
 
 
@@ -1275,6 +1280,13 @@ struct gl_buffer_object
    GLboolean Immutable; /**< GL_ARB_buffer_storage */
    gl_buffer_usage UsageHistory; /**< How has this buffer been used so far? */
 
+   /** Memory of index ranges scanned by vbo_get_minmax_indices() */
+   mtx_t MinMaxCacheMutex;
+   struct hash_table *MinMaxCache;
+   unsigned MinMaxCacheHitIndices;
+   unsigned MinMaxCacheMissIndices;
+   bool MinMaxCacheDirty;
+
    struct gl_buffer_mapping Mappings[MAP_COUNT];
 };
 
@@ -1425,6 +1437,12 @@ struct gl_vertex_array_object
    /** Mask of VERT_BIT_* values indicating changed/dirty arrays */
    GLbitfield64 NewArrays;
 
+   /**
+    * Incremented each time the derived _VertexAttrib arrays change, so that
+    * drivers can tell whether state they built from them is still valid.
+    */
+   GLuint Generation;
+
    /** The index buffer (also known as the element array buffer in OpenGL). */
    struct gl_buffer_object *IndexBufferObj;
 };
@@ -2233,6 +2251,21 @@ struct gl_shader
    GLboolean CompileStatus;
    bool IsES;              /**< True if this shader uses GLSL ES */
 
+   /**
+    * Compilation was skipped because the shader cache has seen this source
+    * compile successfully before.  The shader has no IR until a link misses
+    * the cache and compiles it for real.
+    */
+   bool CompileDeferred;
+   unsigned char sha1[20]; /**< Shader cache key, set by glCompileShader */
+
+   /**
+    * Background compile and link jobs still using this shader, and whether
+    * one of them is compiling it.  Protected by the lock in shaderqueue.c.
+    */
+   unsigned BusyJobs;
+   bool CompilePending;
+
    GLuint SourceChecksum;       /**< for debug/logging purposes */
    const GLchar *Source;  /**< Source code string */
 
@@ -2755,6 +2788,9 @@ struct gl_shader_program
    unsigned NumAtomicBuffers;
 
    GLboolean LinkStatus;   /**< GL_LINK_STATUS */
+   GLboolean LinkPending;  /**< Linking on a worker thread, see shaderqueue.c */
+   GLboolean LinkFinishing; /**< A thread is running the end of the link */
+   unsigned BusyJobs;      /**< Background jobs still using this program */
    GLboolean Validated;
    GLboolean _Used;        /**< Ever used for drawing? */
    GLboolean SamplersValidated; /**< Samplers validated against texture units? */
@@ -2776,6 +2812,16 @@ struct gl_shader_program
    struct gl_program_resource *ProgramResourceList;
    unsigned NumProgramResourceList;
 
+   /**
+    * Serialized linked program returned by glGetProgramBinary, in the
+    * GL_PROGRAM_BINARY_FORMAT_MESA format.  NULL if the program isn't linked
+    * or couldn't be serialized, and if it was linked without
+    * GL_PROGRAM_BINARY_RETRIEVABLE_HINT and didn't go through the shader
+    * cache.
+    */
+   GLubyte *Binary;
+   GLuint BinarySize;
+
    /* True if any of the fragment shaders attached to this program use:
     * #extension ARB_fragment_coord_conventions: enable
     */
@@ -2793,6 +2839,7 @@ struct gl_shader_program
 #define GLSL_USE_PROG 0x80  /**< Log glUseProgram calls */
 #define GLSL_REPORT_ERRORS 0x100  /**< Print compilation errors */
 #define GLSL_DUMP_ON_ERROR 0x200 /**< Dump shaders to stderr on compile error */
+#define GLSL_STATS   0x400 /**< Print compiler statistics */
 
 
 /**
@@ -3630,6 +3677,12 @@ struct gl_constants
    /** GL_KHR_context_flush_control */
    GLenum ContextReleaseBehavior;
 
+   /**
+    * Whether every flush and swap path of the driver waits for the glthread
+    * worker with _mesa_glthread_finish(), which MESA_GLTHREAD relies on.
+    */
+   GLboolean GLThreadSupported;
+
    struct gl_shader_compiler_options ShaderCompilerOptions[MESA_SHADER_STAGES];
 
    /** GL_ARB_tessellation_shader */
@@ -4190,8 +4243,16 @@ struct gl_context
     * re-set on glXMakeCurrent().
     */
    struct _glapi_table *CurrentDispatch;
+   /**
+    * The dispatch table installed on the application thread when GL calls
+    * are marshalled to a worker thread (see glthread.h).
+    */
+   struct _glapi_table *MarshalExec;
    /*@}*/
 
+   /** State of the thread executing marshalled GL calls, if there is one */
+   struct glthread_state *GLThread;
+
    struct gl_config Visual;
    struct gl_framebuffer *DrawBuffer;	/**< buffer for writing */
    struct gl_framebuffer *ReadBuffer;	/**< buffer for reading */
@@ -4318,6 +4379,15 @@ struct gl_context
     */
    struct gl_pipeline_object *_Shader;
 
+   /** On-disk cache of compiled and linked GLSL programs, or NULL */
+   struct disk_cache *ShaderCache;
+   unsigned char ShaderCacheKey[20]; /**< Hash of state affecting the GLSL compiler */
+   bool ShaderCacheKeyValid;
+
+   /** Worker threads compiling and linking GLSL, started on first use */
+   struct gl_shader_queue *ShaderQueue;
+   GLboolean ShaderQueueDisabled;
+
    struct gl_query_state Query;  /**< occlusion, timer queries */
 
    struct gl_transform_feedback_state TransformFeedback;
@@ -47,18 +47,22 @@
 #include "main/pipelineobj.h"
 #include "main/shaderapi.h"
 #include "main/shaderobj.h"
+#include "main/shaderqueue.h"
 #include "main/transformfeedback.h"
 #include "main/uniforms.h"
 #include "glsl/glsl_parser_extras.h"
 #include "glsl/ir.h"
 #include "glsl/ir_uniform.h"
 #include "glsl/program.h"
+#include "glsl/shader_cache.h"
 #include "program/program.h"
 #include "program/prog_print.h"
 #include "program/prog_parameter.h"
+#include "program/ir_to_mesa.h"
 #include "util/ralloc.h"
 #include "util/hash_table.h"
 #include "util/mesa-sha1.h"
+#include "util/cache.h"
 
 
 /**
@@ -91,6 +95,8 @@ _mesa_get_shader_flags(void)
          flags |= GLSL_USE_PROG;
       if (strstr(env, "errors"))
          flags |= GLSL_REPORT_ERRORS;
+      if (strstr(env, "stats"))
+         flags |= GLSL_STATS;
    }
 
    return flags;
@@ -126,6 +132,8 @@ _mesa_init_shader_state(struct gl_context *ctx)
    ctx->Shader.RefCount = 1;
    mtx_init(&ctx->Shader.Mutex, mtx_plain);
 
+   ctx->ShaderCache = cache_create();
+
    ctx->TessCtrlProgram.patch_vertices = 3;
    for (i = 0; i < 4; ++i)
       ctx->TessCtrlProgram.patch_default_outer_level[i] = 1.0;
@@ -141,6 +149,9 @@ void
 _mesa_free_shader_state(struct gl_context *ctx)
 {
    int i;
+
+   _mesa_free_shader_queue(ctx);
+
    for (i = 0; i < MESA_SHADER_STAGES; i++) {
       _mesa_reference_shader_program(ctx, &ctx->Shader.CurrentProgram[i],
                                      NULL);
@@ -154,6 +165,9 @@ _mesa_free_shader_state(struct gl_context *ctx)
 
    assert(ctx->Shader.RefCount == 1);
    mtx_destroy(&ctx->Shader.Mutex);
+
+   cache_destroy(ctx->ShaderCache);
+   ctx->ShaderCache = NULL;
 }
 
 
@@ -748,7 +762,7 @@ get_programiv(struct gl_context *ctx, GLuint program, GLenum pname,
       *params = shProg->BinaryRetreivableHint;
       return;
    case GL_PROGRAM_BINARY_LENGTH:
-      *params = 0;
+      *params = shProg->LinkStatus ? shProg->BinarySize : 0;
       return;
    case GL_ACTIVE_ATOMIC_COUNTER_BUFFERS:
       if (!ctx->Extensions.ARB_shader_atomic_counters)
@@ -832,6 +846,8 @@ get_shaderiv(struct gl_context *ctx, GLuint name, GLenum pname, GLint *params)
       return;
    }
 
+   _mesa_wait_shader(shader);
+
    switch (pname) {
    case GL_SHADER_TYPE:
       *params = shader->Type;
@@ -904,6 +920,8 @@ get_shader_info_log(struct gl_context *ctx, GLuint shader, GLsizei bufSize,
       return;
    }
 
+   _mesa_wait_shader(sh);
+
    _mesa_copy_string(infoLog, bufSize, length, sh->InfoLog);
 }
 
@@ -939,10 +957,14 @@ shader_source(struct gl_shader *sh, const GLchar *source)
 {
    assert(sh);
 
+   /* a background compile may still be reading the old source */
+   _mesa_wait_shader(sh);
+
    /* free old shader source string and install new one */
    free((void *)sh->Source);
    sh->Source = source;
    sh->CompileStatus = GL_FALSE;
+   sh->CompileDeferred = false;
 #ifdef DEBUG
    sh->SourceChecksum = _mesa_str_checksum(sh->Source);
 #endif
@@ -961,6 +983,8 @@ compile_shader(struct gl_context *ctx, GLuint shaderObj)
    if (!sh)
       return;
 
+   _mesa_wait_shader(sh);
+
    if (!sh->Source) {
       /* If the user called glCompileShader without first calling
        * glShaderSource, we should fail to compile, but not raise a GL_ERROR.
@@ -974,9 +998,16 @@ compile_shader(struct gl_context *ctx, GLuint shaderObj)
       }
 
       /* this call will set the shader->CompileStatus field to indicate if
-       * compilation was successful.
+       * compilation was successful.  Shaders the cache has seen compile
+       * before are only compiled if a later link misses the cache.  Other
+       * shaders are compiled on a worker thread if possible, and the
+       * status is waited for when it is queried.
        */
-      _mesa_glsl_compile_shader(ctx, sh, false, false);
+      if (!shader_cache_compile_shader(ctx, sh) &&
+          !_mesa_queue_compile_shader(ctx, sh)) {
+         _mesa_glsl_compile_shader(ctx, sh, false, false);
+         shader_cache_store_shader(ctx, sh);
+      }
 
       if (ctx->_Shader->Flags & GLSL_LOG) {
          _mesa_write_shader_to_file(sh);
@@ -1038,7 +1069,16 @@ link_program(struct gl_context *ctx, GLuint program)
 
    FLUSH_VERTICES(ctx, _NEW_PROGRAM);
 
-   _mesa_glsl_link_shader(ctx, shProg);
+   /* The link finishes when the program is next looked up or used. */
+   if (!_mesa_queue_link_program(ctx, shProg)) {
+      GLuint i;
+
+      /* The shaders may have been compiled by another context's queue. */
+      for (i = 0; i < shProg->NumShaders; i++)
+         _mesa_wait_shader(shProg->Shaders[i]);
+
+      _mesa_glsl_link_shader(ctx, shProg);
+   }
 
    if (shProg->LinkStatus == GL_FALSE &&
        (ctx->_Shader->Flags & GLSL_REPORT_ERRORS)) {
@@ -1921,12 +1961,29 @@ _mesa_GetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length,
       return;
    }
 
-   *length = 0;
-   _mesa_error(ctx, GL_INVALID_OPERATION,
-               "glGetProgramBinary(driver supports zero binary formats)");
+   if (shProg->Binary == NULL) {
+      _mesa_error(ctx, GL_INVALID_OPERATION,
+                  "glGetProgramBinary(binary not available)");
+      *length = 0;
+      return;
+   }
 
-   (void) binaryFormat;
-   (void) binary;
+   /* The ARB_get_program_binary spec says:
+    *
+    *     "If <bufSize> is less than the number of bytes in the program
+    *     binary, then 0 is returned in <length>, and an INVALID_OPERATION
+    *     error is thrown."
+    */
+   if ((GLuint) bufSize < shProg->BinarySize) {
+      _mesa_error(ctx, GL_INVALID_OPERATION,
+                  "glGetProgramBinary(bufSize too small)");
+      *length = 0;
+      return;
+   }
+
+   memcpy(binary, shProg->Binary, shProg->BinarySize);
+   *length = shProg->BinarySize;
+   *binaryFormat = GL_PROGRAM_BINARY_FORMAT_MESA;
 }
 
 void GLAPIENTRY
@@ -1940,9 +1997,6 @@ _mesa_ProgramBinary(GLuint program, GLenum binaryFormat,
    if (!shProg)
       return;
 
-   (void) binaryFormat;
-   (void) binary;
-
    /* Section 2.3.1 (Errors) of the OpenGL 4.5 spec says:
     *
     *     "If a negative number is provided where an argument of type sizei or
@@ -1962,11 +2016,33 @@ _mesa_ProgramBinary(GLuint program, GLenum binaryFormat,
     *     setting the LINK_STATUS of <program> to FALSE, if these conditions
     *     are not met."
     *
-    * Since any value of binaryFormat passed "is not one of those specified as
-    * allowable for [this] command, an INVALID_ENUM error is generated."
+    * Any other value of binaryFormat passed "is not one of those specified
+    * as allowable for [this] command, an INVALID_ENUM error is generated."
+    */
+   if (binaryFormat != GL_PROGRAM_BINARY_FORMAT_MESA) {
+      shProg->LinkStatus = GL_FALSE;
+      _mesa_error(ctx, GL_INVALID_ENUM, "glProgramBinary");
+      return;
+   }
+
+   /* Loading a binary replaces the program's link state just like
+    * glLinkProgram does, so the same transform feedback restriction applies.
     */
-   shProg->LinkStatus = GL_FALSE;
-   _mesa_error(ctx, GL_INVALID_ENUM, "glProgramBinary");
+   if (_mesa_transform_feedback_is_using_program(ctx, shProg)) {
+      _mesa_error(ctx, GL_INVALID_OPERATION,
+                  "glProgramBinary(transform feedback is using the program)");
+      return;
+   }
+
+   FLUSH_VERTICES(ctx, _NEW_PROGRAM);
+
+   _mesa_glsl_load_program_binary(ctx, shProg, binary, length);
+
+   if (shProg->LinkStatus == GL_FALSE &&
+       (ctx->_Shader->Flags & GLSL_REPORT_ERRORS)) {
+      _mesa_debug(ctx, "Error loading binary for program %u:\n%s\n",
+                  shProg->Name, shProg->InfoLog);
+   }
 }
 
 
@@ -2499,6 +2575,7 @@ _mesa_UniformSubroutinesuiv(GLenum shadertype, GLsizei count,
 
    stage = _mesa_shader_enum_to_shader_stage(shadertype);
    shProg = ctx->_Shader->CurrentProgram[stage];
+   _mesa_wait_shader_program(ctx, shProg);
    if (!shProg) {
       _mesa_error(ctx, GL_INVALID_OPERATION, "%s", api_name);
       return;
@@ -2579,6 +2656,7 @@ _mesa_GetUniformSubroutineuiv(GLenum shadertype, GLint location,
 
    stage = _mesa_shader_enum_to_shader_stage(shadertype);
    shProg = ctx->_Shader->CurrentProgram[stage];
+   _mesa_wait_shader_program(ctx, shProg);
    if (!shProg) {
       _mesa_error(ctx, GL_INVALID_OPERATION, "%s", api_name);
       return;
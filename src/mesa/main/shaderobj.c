@@ -36,6 +36,7 @@
 #include "main/mtypes.h"
 #include "main/shaderapi.h"
 #include "main/shaderobj.h"
+#include "main/shaderqueue.h"
 #include "main/uniforms.h"
 #include "program/program.h"
 #include "program/prog_parameter.h"
@@ -120,6 +121,7 @@ _mesa_new_shader(struct gl_context *ctx, GLuint name, GLenum type)
 void
 _mesa_delete_shader(struct gl_context *ctx, struct gl_shader *sh)
 {
+   _mesa_wait_shader(sh);
    free((void *)sh->Source);
    free(sh->Label);
    _mesa_reference_program(ctx, &sh->Program, NULL);
@@ -307,6 +309,10 @@ _mesa_clear_shader_program_data(struct gl_shader_program *shProg)
       shProg->ProgramResourceList = NULL;
       shProg->NumProgramResourceList = 0;
    }
+
+   ralloc_free(shProg->Binary);
+   shProg->Binary = NULL;
+   shProg->BinarySize = 0;
 }
 
 
@@ -377,6 +383,9 @@ void
 _mesa_delete_shader_program(struct gl_context *ctx,
                             struct gl_shader_program *shProg)
 {
+   /* Nobody can look at the result of a pending link anymore. */
+   _mesa_wait_shader_program(NULL, shProg);
+
    _mesa_free_shader_program_data(ctx, shProg);
 
    ralloc_free(shProg);
@@ -400,6 +409,7 @@ _mesa_lookup_shader_program(struct gl_context *ctx, GLuint name)
       if (shProg && shProg->Type != GL_SHADER_PROGRAM_MESA) {
          return NULL;
       }
+      _mesa_wait_shader_program(ctx, shProg);
       return shProg;
    }
    return NULL;
@@ -428,6 +438,7 @@ _mesa_lookup_shader_program_err(struct gl_context *ctx, GLuint name,
          _mesa_error(ctx, GL_INVALID_OPERATION, "%s", caller);
          return NULL;
       }
+      _mesa_wait_shader_program(ctx, shProg);
       return shProg;
    }
 }
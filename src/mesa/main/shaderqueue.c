@@ -0,0 +1,516 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file shaderqueue.c
+ * Background compilation and linking of GLSL shaders.
+ *
+ * Each context lazily starts its own pool of worker threads.  Shaders and
+ * programs are shared between contexts, so the bookkeeping on the objects
+ * themselves (the number of jobs that still use them) is protected by one
+ * global mutex, and one global condition variable is signalled whenever
+ * any job finishes.
+ *
+ * A link job only reads the attached shaders.  Before a link is queued,
+ * shaders whose compilation the shader cache skipped get compile jobs of
+ * their own, and the link job waits for every attached shader's compile
+ * job before it starts.  Jobs are taken in FIFO order and compile jobs
+ * never wait, so this cannot deadlock.
+ *
+ * Compiler messages are reported through KHR_debug from whichever thread
+ * runs the job.  Applications that enable GL_DEBUG_OUTPUT_SYNCHRONOUS expect
+ * them on their own thread, during the call that caused them, so nothing is
+ * queued while synchronous debug output is enabled.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "c11/threads.h"
+#include "util/u_atomic.h"
+#include "main/glheader.h"
+#include "main/context.h"
+#include "main/errors.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+#include "main/shaderqueue.h"
+#include "glsl/program.h"
+#include "glsl/shader_cache.h"
+#include "program/ir_to_mesa.h"
+
+
+#define MAX_SHADER_THREADS 8
+
+
+struct shader_job
+{
+   struct shader_job *next;
+   struct gl_context *ctx;
+
+   /** Set for compile jobs */
+   struct gl_shader *shader;
+
+   /** Set for link jobs, with a snapshot of the attached shaders */
+   struct gl_shader_program *prog;
+   struct gl_shader **shaders;
+   GLuint num_shaders;
+};
+
+
+struct gl_shader_queue
+{
+   thrd_t threads[MAX_SHADER_THREADS];
+   unsigned num_threads;
+
+   struct shader_job *head;
+   struct shader_job **tail;
+   GLboolean shutdown;
+
+   cnd_t job_available;
+};
+
+
+static mtx_t queue_mutex = _MTX_INITIALIZER_NP;
+static cnd_t job_done;
+static once_flag job_done_once = ONCE_FLAG_INIT;
+
+
+static void
+init_job_done(void)
+{
+   cnd_init(&job_done);
+}
+
+
+/**
+ * Number of worker threads to use for each context.
+ */
+static unsigned
+num_shader_threads(void)
+{
+   const char *env = getenv("MESA_GLSL_THREADS");
+   long cpus = 1;
+
+   if (env) {
+      int n = atoi(env);
+      return n < 0 ? 0 : MIN2(n, MAX_SHADER_THREADS);
+   }
+
+#ifdef _SC_NPROCESSORS_ONLN
+   cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+   /* Leave one core to the application. */
+   if (cpus <= 1)
+      return 0;
+
+   return MIN2(cpus - 1, 4);
+}
+
+
+static void
+run_job(struct shader_job *job)
+{
+   if (job->shader) {
+      struct gl_shader *sh = job->shader;
+
+      _mesa_glsl_compile_shader(job->ctx, sh, false, false);
+      sh->CompileDeferred = false;
+      shader_cache_store_shader(job->ctx, sh);
+   } else {
+      _mesa_glsl_link_shader_run(job->ctx, job->prog);
+   }
+}
+
+
+/**
+ * Drop the references a finished job holds.  Called with queue_mutex held.
+ */
+static void
+retire_job(struct shader_job *job)
+{
+   GLuint i;
+
+   if (job->shader) {
+      job->shader->CompilePending = false;
+      job->shader->BusyJobs--;
+   } else {
+      job->prog->BusyJobs--;
+      for (i = 0; i < job->num_shaders; i++)
+         job->shaders[i]->BusyJobs--;
+   }
+
+   free(job->shaders);
+   free(job);
+}
+
+
+static GLboolean
+shaders_compiled(const struct shader_job *job)
+{
+   GLuint i;
+
+   for (i = 0; i < job->num_shaders; i++) {
+      if (job->shaders[i]->CompilePending)
+         return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+
+static int
+shader_worker(void *data)
+{
+   struct gl_shader_queue *queue = data;
+
+   mtx_lock(&queue_mutex);
+
+   while (true) {
+      struct shader_job *job;
+
+      while (!queue->head && !queue->shutdown)
+         cnd_wait(&queue->job_available, &queue_mutex);
+
+      job = queue->head;
+      if (!job)
+         break;
+
+      queue->head = job->next;
+      if (!queue->head)
+         queue->tail = &queue->head;
+
+      while (!shaders_compiled(job))
+         cnd_wait(&job_done, &queue_mutex);
+
+      mtx_unlock(&queue_mutex);
+      run_job(job);
+      mtx_lock(&queue_mutex);
+
+      retire_job(job);
+      cnd_broadcast(&job_done);
+   }
+
+   mtx_unlock(&queue_mutex);
+
+   return 0;
+}
+
+
+/**
+ * Whether compiler messages must be reported on the application thread.
+ */
+static GLboolean
+debug_output_synchronous(struct gl_context *ctx)
+{
+   return _mesa_get_debug_state_int(ctx, GL_DEBUG_OUTPUT) &&
+          _mesa_get_debug_state_int(ctx, GL_DEBUG_OUTPUT_SYNCHRONOUS);
+}
+
+
+/**
+ * Get the context's queue, starting its worker threads on first use.
+ *
+ * \return NULL if the caller has to do the work itself.
+ */
+static struct gl_shader_queue *
+get_shader_queue(struct gl_context *ctx)
+{
+   struct gl_shader_queue *queue = ctx->ShaderQueue;
+   unsigned num_threads, i;
+
+   /* This can be toggled at any time, so it is checked for every job. */
+   if (debug_output_synchronous(ctx))
+      return NULL;
+
+   if (queue)
+      return queue;
+
+   if (ctx->ShaderQueueDisabled)
+      return NULL;
+
+   /* Debug output is written as the work happens, so keep it in order. */
+   num_threads = ctx->_Shader->Flags ? 0 : num_shader_threads();
+   if (num_threads == 0) {
+      ctx->ShaderQueueDisabled = GL_TRUE;
+      return NULL;
+   }
+
+   call_once(&job_done_once, init_job_done);
+
+   queue = calloc(1, sizeof(*queue));
+   if (!queue) {
+      ctx->ShaderQueueDisabled = GL_TRUE;
+      return NULL;
+   }
+
+   queue->tail = &queue->head;
+   cnd_init(&queue->job_available);
+
+   for (i = 0; i < num_threads; i++) {
+      if (thrd_create(&queue->threads[i], shader_worker, queue) !=
+          thrd_success)
+         break;
+   }
+   queue->num_threads = i;
+
+   if (queue->num_threads == 0) {
+      cnd_destroy(&queue->job_available);
+      free(queue);
+      ctx->ShaderQueueDisabled = GL_TRUE;
+      return NULL;
+   }
+
+   ctx->ShaderQueue = queue;
+   return queue;
+}
+
+
+/**
+ * Wait for all jobs of the context and stop its worker threads.
+ */
+void
+_mesa_free_shader_queue(struct gl_context *ctx)
+{
+   struct gl_shader_queue *queue = ctx->ShaderQueue;
+   unsigned i;
+
+   if (!queue)
+      return;
+
+   /* The workers drain the queue before they exit. */
+   mtx_lock(&queue_mutex);
+   queue->shutdown = GL_TRUE;
+   cnd_broadcast(&queue->job_available);
+   mtx_unlock(&queue_mutex);
+
+   for (i = 0; i < queue->num_threads; i++)
+      thrd_join(queue->threads[i], NULL);
+
+   cnd_destroy(&queue->job_available);
+   free(queue);
+   ctx->ShaderQueue = NULL;
+}
+
+
+/**
+ * Append a job.  Called with queue_mutex held.
+ */
+static void
+push_job(struct gl_shader_queue *queue, struct shader_job *job)
+{
+   job->next = NULL;
+   *queue->tail = job;
+   queue->tail = &job->next;
+   cnd_signal(&queue->job_available);
+}
+
+
+static GLboolean
+queue_compile_locked(struct gl_shader_queue *queue, struct gl_context *ctx,
+                     struct gl_shader *sh)
+{
+   struct shader_job *job = calloc(1, sizeof(*job));
+
+   if (!job)
+      return GL_FALSE;
+
+   job->ctx = ctx;
+   job->shader = sh;
+
+   sh->CompilePending = true;
+   sh->BusyJobs++;
+   push_job(queue, job);
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Compile \c sh in the background.
+ *
+ * \return GL_FALSE if the caller has to compile the shader itself.
+ */
+GLboolean
+_mesa_queue_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
+{
+   struct gl_shader_queue *queue = get_shader_queue(ctx);
+   GLboolean queued;
+
+   if (!queue)
+      return GL_FALSE;
+
+   /* Until the job has run, the shader is neither compiled nor failed. */
+   sh->CompileStatus = GL_FALSE;
+
+   mtx_lock(&queue_mutex);
+   queued = queue_compile_locked(queue, ctx, sh);
+   mtx_unlock(&queue_mutex);
+
+   return queued;
+}
+
+
+/**
+ * Link \c prog in the background.
+ *
+ * \return GL_FALSE if the caller has to link the program itself.
+ */
+GLboolean
+_mesa_queue_link_program(struct gl_context *ctx,
+                         struct gl_shader_program *prog)
+{
+   struct gl_shader_queue *queue = get_shader_queue(ctx);
+   struct shader_job *job;
+   GLuint i;
+
+   if (!queue)
+      return GL_FALSE;
+
+   job = calloc(1, sizeof(*job));
+   if (!job)
+      return GL_FALSE;
+
+   if (prog->NumShaders) {
+      job->shaders = malloc(prog->NumShaders * sizeof(*job->shaders));
+      if (!job->shaders) {
+         free(job);
+         return GL_FALSE;
+      }
+      memcpy(job->shaders, prog->Shaders,
+             prog->NumShaders * sizeof(*job->shaders));
+   }
+   job->num_shaders = prog->NumShaders;
+   job->ctx = ctx;
+   job->prog = prog;
+
+   /* A program restored from the shader cache only needs the driver. */
+   if (!_mesa_glsl_link_shader_begin(ctx, prog)) {
+      free(job->shaders);
+      free(job);
+      _mesa_glsl_link_shader_end(ctx, prog);
+      return GL_TRUE;
+   }
+
+   mtx_lock(&queue_mutex);
+
+   for (i = 0; i < job->num_shaders; i++) {
+      struct gl_shader *sh = job->shaders[i];
+
+      /* Several links may share a shader the cache let us skip, so compile
+       * it once, in its own job, rather than inside the link.
+       */
+      if (sh->CompileDeferred && !sh->CompilePending) {
+         sh->CompileDeferred = false;
+         if (!queue_compile_locked(queue, ctx, sh))
+            sh->CompileDeferred = true;
+      }
+
+      sh->BusyJobs++;
+   }
+
+   prog->BusyJobs++;
+   prog->LinkPending = GL_TRUE;
+   push_job(queue, job);
+
+   mtx_unlock(&queue_mutex);
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Wait until no job uses \c sh anymore.
+ */
+void
+_mesa_wait_shader(struct gl_shader *sh)
+{
+   mtx_lock(&queue_mutex);
+   while (sh->BusyJobs)
+      cnd_wait(&job_done, &queue_mutex);
+   mtx_unlock(&queue_mutex);
+}
+
+
+/**
+ * Wait for a pending link of \c prog and run the driver part of it.
+ *
+ * Passing a NULL \c ctx only waits for the link job, for a program that is
+ * about to be deleted.
+ */
+void
+_mesa_wait_shader_program(struct gl_context *ctx,
+                          struct gl_shader_program *prog)
+{
+   GLboolean finish;
+
+   /* LinkPending stays set until the end of the link has run, so a thread
+    * that sees it cleared can use the program without taking the lock.
+    */
+   if (!prog || !p_atomic_read(&prog->LinkPending))
+      return;
+
+   /* Contexts sharing the program may wait for it from several threads,
+    * and only one of them must run the end of the link.
+    */
+   mtx_lock(&queue_mutex);
+   while (prog->BusyJobs || prog->LinkFinishing)
+      cnd_wait(&job_done, &queue_mutex);
+   finish = prog->LinkPending;
+   prog->LinkFinishing = finish;
+   mtx_unlock(&queue_mutex);
+
+   if (!finish)
+      return;
+
+   if (ctx) {
+      /* This may be reached from state validation, so don't flush here. */
+      ctx->NewState |= _NEW_PROGRAM;
+      _mesa_glsl_link_shader_end(ctx, prog);
+   }
+
+   mtx_lock(&queue_mutex);
+   prog->LinkFinishing = GL_FALSE;
+   prog->LinkPending = GL_FALSE;
+   cnd_broadcast(&job_done);
+   mtx_unlock(&queue_mutex);
+}
+
+
+/**
+ * Wait for every program bound to \c pipe.
+ */
+void
+_mesa_wait_pipeline(struct gl_context *ctx, struct gl_pipeline_object *pipe)
+{
+   unsigned i;
+
+   for (i = 0; i < MESA_SHADER_STAGES; i++)
+      _mesa_wait_shader_program(ctx, pipe->CurrentProgram[i]);
+
+   _mesa_wait_shader_program(ctx, pipe->ActiveProgram);
+}
@@ -0,0 +1,85 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file shaderqueue.h
+ * Background compilation and linking of GLSL shaders.
+ *
+ * glCompileShader and glLinkProgram hand the GLSL front end and linker to a
+ * pool of worker threads and return immediately.  The result is waited for
+ * when the application looks at the object again: querying its status or
+ * info log, modifying it, using the program or drawing with it.  The
+ * driver's LinkShader hook always runs on the application thread, when a
+ * pending link is waited for.
+ *
+ * While GL_DEBUG_OUTPUT_SYNCHRONOUS is enabled, shaders are compiled and
+ * linked on the application thread, so that compiler messages reach the
+ * debug callback from the call that caused them.
+ *
+ * MESA_GLSL_THREADS sets the number of worker threads.  Zero disables
+ * background compilation.
+ */
+
+
+#ifndef SHADERQUEUE_H
+#define SHADERQUEUE_H
+
+
+#include "main/glheader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct gl_context;
+struct gl_shader;
+struct gl_shader_program;
+struct gl_pipeline_object;
+struct gl_shader_queue;
+
+extern void
+_mesa_free_shader_queue(struct gl_context *ctx);
+
+extern GLboolean
+_mesa_queue_compile_shader(struct gl_context *ctx, struct gl_shader *sh);
+
+extern GLboolean
+_mesa_queue_link_program(struct gl_context *ctx,
+                         struct gl_shader_program *prog);
+
+extern void
+_mesa_wait_shader(struct gl_shader *sh);
+
+extern void
+_mesa_wait_shader_program(struct gl_context *ctx,
+                          struct gl_shader_program *prog);
+
+extern void
+_mesa_wait_pipeline(struct gl_context *ctx, struct gl_pipeline_object *pipe);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHADERQUEUE_H */
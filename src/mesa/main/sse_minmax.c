@@ -27,6 +27,7 @@
 
 #include "main/sse_minmax.h"
 #include <smmintrin.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 void
@@ -92,3 +93,142 @@ _mesa_uint_array_min_max(const unsigned *ui_indices, unsigned *min_index,
    *min_index = min_ui;
    *max_index = max_ui;
 }
+
+
+/**
+ * Generic versions of the above for all index sizes, with and without
+ * primitive restart.  When restart is enabled, restart indices are replaced
+ * by the identity value of each reduction (all ones for min, zero for max)
+ * so they never contribute to the result.
+ *
+ * \param TYPE   C type of the indices
+ * \param SUFFIX epi8/epi16/epi32, which selects the compare intrinsic
+ * \param USFX   epu8/epu16/epu32, which selects the min/max intrinsics
+ */
+#define ARRAY_MIN_MAX(TYPE, SUFFIX, USFX)                                    \
+static inline void                                                           \
+array_min_max_##USFX(const TYPE *indices, bool restart,                      \
+                     unsigned restart_index, unsigned *min_index,            \
+                     unsigned *max_index, const unsigned count)              \
+{                                                                            \
+   const unsigned lanes = 16 / sizeof(TYPE);                                 \
+   unsigned max_val = 0;                                                     \
+   unsigned min_val = ~0U;                                                   \
+   unsigned i = 0;                                                           \
+   unsigned aligned_count = count;                                           \
+                                                                             \
+   /* an out of range restart index can never match */                       \
+   if (restart && restart_index > (TYPE)~0)                                  \
+      restart = false;                                                       \
+                                                                             \
+   while (((uintptr_t)indices & 15) && aligned_count) {                      \
+      if (!restart || *indices != restart_index) {                           \
+         if (*indices > max_val)                                             \
+            max_val = *indices;                                              \
+         if (*indices < min_val)                                             \
+            min_val = *indices;                                              \
+      }                                                                      \
+      aligned_count--;                                                       \
+      indices++;                                                             \
+   }                                                                         \
+                                                                             \
+   if (aligned_count >= 2 * lanes) {                                         \
+      TYPE max_arr[16 / sizeof(TYPE)] __attribute__ ((aligned (16)));        \
+      TYPE min_arr[16 / sizeof(TYPE)] __attribute__ ((aligned (16)));        \
+      const __m128i *ptr = (const __m128i *)indices;                         \
+      const __m128i restart4 = _mm_set1_##SUFFIX((TYPE)restart_index);       \
+      __m128i max4 = _mm_setzero_si128();                                    \
+      __m128i min4 = _mm_set1_epi32(~0);                                     \
+      unsigned vec_count = aligned_count & ~(lanes - 1);                     \
+                                                                             \
+      if (restart) {                                                         \
+         for (i = 0; i < vec_count / lanes; i++) {                           \
+            __m128i v = _mm_load_si128(&ptr[i]);                             \
+            __m128i is_restart = _mm_cmpeq_##SUFFIX(v, restart4);            \
+            max4 = _mm_max_##USFX(_mm_andnot_si128(is_restart, v), max4);    \
+            min4 = _mm_min_##USFX(_mm_or_si128(is_restart, v), min4);        \
+         }                                                                   \
+      }                                                                      \
+      else {                                                                 \
+         for (i = 0; i < vec_count / lanes; i++) {                           \
+            __m128i v = _mm_load_si128(&ptr[i]);                             \
+            max4 = _mm_max_##USFX(v, max4);                                  \
+            min4 = _mm_min_##USFX(v, min4);                                  \
+         }                                                                   \
+      }                                                                      \
+                                                                             \
+      _mm_store_si128((__m128i *)max_arr, max4);                             \
+      _mm_store_si128((__m128i *)min_arr, min4);                             \
+                                                                             \
+      for (i = 0; i < lanes; i++) {                                          \
+         if (max_arr[i] > max_val)                                           \
+            max_val = max_arr[i];                                            \
+         if (min_arr[i] < min_val)                                           \
+            min_val = min_arr[i];                                            \
+      }                                                                      \
+      i = vec_count;                                                         \
+   }                                                                         \
+                                                                             \
+   for (; i < aligned_count; i++) {                                          \
+      if (restart && indices[i] == restart_index)                            \
+         continue;                                                           \
+      if (indices[i] > max_val)                                              \
+         max_val = indices[i];                                               \
+      if (indices[i] < min_val)                                              \
+         min_val = indices[i];                                               \
+   }                                                                         \
+                                                                             \
+   /* Restart-only vectors leave the type's maximum in the min lanes, but a   \
+    * real index can't be both above the max and below the min.              \
+    */                                                                       \
+   if (max_val < min_val)                                                    \
+      min_val = ~0U;                                                         \
+                                                                             \
+   *min_index = min_val;                                                     \
+   *max_index = max_val;                                                     \
+}
+
+ARRAY_MIN_MAX(uint8_t, epi8, epu8)
+ARRAY_MIN_MAX(uint16_t, epi16, epu16)
+ARRAY_MIN_MAX(uint32_t, epi32, epu32)
+
+void
+_mesa_ushort_array_min_max(const uint16_t *us_indices, unsigned *min_index,
+                           unsigned *max_index, const unsigned count)
+{
+   array_min_max_epu16(us_indices, false, 0, min_index, max_index, count);
+}
+
+void
+_mesa_ubyte_array_min_max(const uint8_t *ub_indices, unsigned *min_index,
+                          unsigned *max_index, const unsigned count)
+{
+   array_min_max_epu8(ub_indices, false, 0, min_index, max_index, count);
+}
+
+void
+_mesa_uint_array_min_max_restart(const unsigned *ui_indices,
+                                 unsigned restart_index, unsigned *min_index,
+                                 unsigned *max_index, const unsigned count)
+{
+   array_min_max_epu32(ui_indices, true, restart_index,
+                       min_index, max_index, count);
+}
+
+void
+_mesa_ushort_array_min_max_restart(const uint16_t *us_indices,
+                                   unsigned restart_index, unsigned *min_index,
+                                   unsigned *max_index, const unsigned count)
+{
+   array_min_max_epu16(us_indices, true, restart_index,
+                       min_index, max_index, count);
+}
+
+void
+_mesa_ubyte_array_min_max_restart(const uint8_t *ub_indices,
+                                  unsigned restart_index, unsigned *min_index,
+                                  unsigned *max_index, const unsigned count)
+{
+   array_min_max_epu8(ub_indices, true, restart_index,
+                      min_index, max_index, count);
+}
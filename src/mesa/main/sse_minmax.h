@@ -25,6 +25,32 @@
  *
  */
 
+#include <stdint.h>
+
 void
 _mesa_uint_array_min_max(const unsigned *ui_indices, unsigned *min_index,
                          unsigned *max_index, const unsigned count);
+
+void
+_mesa_ushort_array_min_max(const uint16_t *us_indices, unsigned *min_index,
+                           unsigned *max_index, const unsigned count);
+
+void
+_mesa_ubyte_array_min_max(const uint8_t *ub_indices, unsigned *min_index,
+                          unsigned *max_index, const unsigned count);
+
+/* Variants which skip indices equal to restart_index. */
+void
+_mesa_uint_array_min_max_restart(const unsigned *ui_indices,
+                                 unsigned restart_index, unsigned *min_index,
+                                 unsigned *max_index, const unsigned count);
+
+void
+_mesa_ushort_array_min_max_restart(const uint16_t *us_indices,
+                                   unsigned restart_index, unsigned *min_index,
+                                   unsigned *max_index, const unsigned count);
+
+void
+_mesa_ubyte_array_min_max_restart(const uint8_t *ub_indices,
+                                  unsigned restart_index, unsigned *min_index,
+                                  unsigned *max_index, const unsigned count);
@@ -45,6 +45,7 @@
 #include "program/program.h"
 #include "program/prog_parameter.h"
 #include "shaderobj.h"
+#include "shaderqueue.h"
 #include "state.h"
 #include "stencil.h"
 #include "texenvprogram.h"
@@ -500,6 +501,11 @@ _mesa_update_state_locked( struct gl_context *ctx )
 void
 _mesa_update_state( struct gl_context *ctx )
 {
+   /* The state derived below reads the linked shaders of the bound
+    * programs, which a worker may still be filling in.
+    */
+   _mesa_wait_pipeline(ctx, ctx->_Shader);
+
    _mesa_lock_context_textures(ctx);
    _mesa_update_state_locked(ctx);
    _mesa_unlock_context_textures(ctx);
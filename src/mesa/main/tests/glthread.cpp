@@ -0,0 +1,119 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name glthread.cpp
+ *
+ * Smoke test of glthread: calls recorded on the application thread are
+ * executed by the worker in order, and synchronous calls and
+ * _mesa_glthread_finish() see the result of everything recorded before.
+ */
+
+#include <gtest/gtest.h>
+
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "main/compiler.h"
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/dispatch.h"
+#include "main/glthread.h"
+#include "main/vtxfmt.h"
+#include "glapi/glapi.h"
+#include "drivers/common/driverfuncs.h"
+#include "vbo/vbo.h"
+
+class GLThread_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+};
+
+void
+GLThread_test::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&ctx, 0, sizeof(ctx));
+
+   _mesa_init_driver_functions(&driver_functions);
+
+   ASSERT_TRUE(_mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual,
+                                        NULL, &driver_functions));
+   _vbo_CreateContext(&ctx);
+
+   ctx.Version = 21;
+
+   _mesa_initialize_dispatch_tables(&ctx);
+   _mesa_initialize_vbo_vtxfmt(&ctx);
+
+   _mesa_glthread_init(&ctx);
+   ASSERT_TRUE(ctx.GLThread != NULL);
+
+   _glapi_set_context(&ctx);
+   _glapi_set_dispatch(ctx.MarshalExec);
+}
+
+void
+GLThread_test::TearDown()
+{
+   _mesa_glthread_destroy(&ctx);
+   _glapi_set_context(NULL);
+   _glapi_set_dispatch(NULL);
+   _mesa_free_context_data(&ctx);
+}
+
+/* Enough calls to fill every batch a few times over. */
+#define NUM_CALLS (4 * MARSHAL_MAX_BATCHES * MARSHAL_MAX_CMD_SIZE / 8)
+
+TEST_F(GLThread_test, SyncCallSeesRecordedCalls)
+{
+   GLint value = -1;
+
+   for (GLint i = 0; i < NUM_CALLS; i++)
+      CALL_ClearStencil(GET_DISPATCH(), (i));
+
+   CALL_GetIntegerv(GET_DISPATCH(), (GL_STENCIL_CLEAR_VALUE, &value));
+   EXPECT_EQ(NUM_CALLS - 1, value);
+
+   /* The synchronous call doesn't replace the marshalling table. */
+   EXPECT_EQ(ctx.MarshalExec, GET_DISPATCH());
+}
+
+TEST_F(GLThread_test, FinishRunsRecordedCalls)
+{
+   CALL_ClearStencil(GET_DISPATCH(), (1));
+   CALL_ClearStencil(GET_DISPATCH(), (2));
+   CALL_ClearStencil(GET_DISPATCH(), (3));
+
+   _mesa_glthread_finish(&ctx);
+   EXPECT_EQ(3u, ctx.Stencil.Clear);
+
+   /* A finish with nothing recorded doesn't wait for anything. */
+   _mesa_glthread_finish(&ctx);
+   EXPECT_EQ(3u, ctx.Stencil.Clear);
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file hash_bench.c
+ *
+ * Measures _mesa_HashLookup() throughput from several threads at once.
+ *
+ * Each thread looks up random keys among the first num_keys GL names, the
+ * way draws and binds look up buffers and textures.  The same lookups are
+ * also timed through _mesa_HashLockMutex()/_mesa_HashLookupLocked(), which
+ * is what every lookup used to cost.  Passing a sparse key offset puts the
+ * keys out of the range of the lock-free array.
+ *
+ * Usage: hash_bench [threads [keys [lookups per thread [key offset]]]]
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "c11/threads.h"
+#include "main/hash.h"
+
+struct lookup_thread {
+   struct _mesa_HashTable *table;
+   GLuint num_keys;
+   GLuint first_key;
+   unsigned lookups;
+   bool locked;
+   unsigned misses;
+};
+
+static double
+get_time(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+lookup_keys(void *data)
+{
+   struct lookup_thread *t = data;
+   uint32_t seed = (uintptr_t) t;
+   unsigned i;
+
+   for (i = 0; i < t->lookups; i++) {
+      GLuint key;
+      void *obj;
+
+      seed = seed * 1664525 + 1013904223;
+      key = t->first_key + (seed >> 8) % t->num_keys;
+
+      if (t->locked) {
+         _mesa_HashLockMutex(t->table);
+         obj = _mesa_HashLookupLocked(t->table, key);
+         _mesa_HashUnlockMutex(t->table);
+      } else {
+         obj = _mesa_HashLookup(t->table, key);
+      }
+
+      if (!obj)
+         t->misses++;
+   }
+
+   return 0;
+}
+
+static double
+run(struct _mesa_HashTable *table, unsigned num_threads, GLuint num_keys,
+    GLuint first_key, unsigned lookups, bool locked)
+{
+   struct lookup_thread *threads = calloc(num_threads, sizeof(*threads));
+   thrd_t *ids = calloc(num_threads, sizeof(*ids));
+   double start, elapsed;
+   unsigned i, misses = 0;
+
+   for (i = 0; i < num_threads; i++) {
+      threads[i].table = table;
+      threads[i].num_keys = num_keys;
+      threads[i].first_key = first_key;
+      threads[i].lookups = lookups;
+      threads[i].locked = locked;
+   }
+
+   start = get_time();
+   for (i = 0; i < num_threads; i++)
+      thrd_create(&ids[i], lookup_keys, &threads[i]);
+   for (i = 0; i < num_threads; i++) {
+      thrd_join(ids[i], NULL);
+      misses += threads[i].misses;
+   }
+   elapsed = get_time() - start;
+
+   if (misses)
+      fprintf(stderr, "%u lookups failed\n", misses);
+
+   free(ids);
+   free(threads);
+
+   return (double) num_threads * lookups / elapsed;
+}
+
+static void
+delete_nothing(GLuint key, void *data, void *userData)
+{
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned num_threads = argc > 1 ? atoi(argv[1]) : 4;
+   GLuint num_keys = argc > 2 ? atoi(argv[2]) : 1000;
+   unsigned lookups = argc > 3 ? atoi(argv[3]) : 1000000;
+   GLuint first_key = argc > 4 ? strtoul(argv[4], NULL, 0) : 1;
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   GLuint key;
+
+   if (num_threads == 0 || num_keys == 0 || first_key == 0) {
+      fprintf(stderr, "need at least one thread and key, and keys start "
+              "at 1\n");
+      return 1;
+   }
+
+   for (key = first_key; key < first_key + num_keys; key++)
+      _mesa_HashInsert(table, key, &table);
+
+   printf("%u threads, %u keys from %u:\n", num_threads, num_keys,
+          first_key);
+   printf("  _mesa_HashLookup:       %12.0f lookups/s\n",
+          run(table, num_threads, num_keys, first_key, lookups, false));
+   printf("  locked lookup:          %12.0f lookups/s\n",
+          run(table, num_threads, num_keys, first_key, lookups, true));
+
+   _mesa_HashDeleteAll(table, delete_nothing, NULL);
+   _mesa_DeleteHashTable(table);
+
+   return 0;
+}
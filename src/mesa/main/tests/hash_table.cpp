@@ -0,0 +1,273 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <gtest/gtest.h>
+#include <GL/gl.h>
+#include "c11/threads.h"
+
+extern "C" {
+#include "main/hash.h"
+#include "util/macros.h"
+}
+
+/* Any non-NULL pointer that can be told apart for each key will do. */
+static void *
+data_for_key(GLuint key)
+{
+   return (void *) ((uintptr_t) key * 2 + 1);
+}
+
+class HashTable : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void insert_range(GLuint first, GLuint count);
+
+   struct _mesa_HashTable *table;
+};
+
+void
+HashTable::SetUp()
+{
+   table = _mesa_NewHashTable();
+   ASSERT_TRUE(table != NULL);
+}
+
+static void
+delete_callback(GLuint key, void *data, void *userData)
+{
+   EXPECT_EQ(data_for_key(key), data);
+   (*(GLuint *) userData)++;
+}
+
+void
+HashTable::TearDown()
+{
+   GLuint count = 0;
+   GLuint entries = _mesa_HashNumEntries(table);
+
+   _mesa_HashDeleteAll(table, delete_callback, &count);
+   EXPECT_EQ(entries, count);
+   EXPECT_EQ(0u, _mesa_HashNumEntries(table));
+
+   _mesa_DeleteHashTable(table);
+}
+
+void
+HashTable::insert_range(GLuint first, GLuint count)
+{
+   for (GLuint key = first; key < first + count; key++)
+      _mesa_HashInsert(table, key, data_for_key(key));
+}
+
+TEST_F(HashTable, SmallKeys)
+{
+   insert_range(1, 10);
+
+   for (GLuint key = 1; key <= 10; key++)
+      EXPECT_EQ(data_for_key(key), _mesa_HashLookup(table, key));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 11));
+   EXPECT_EQ(10u, _mesa_HashNumEntries(table));
+
+   _mesa_HashRemove(table, 1);
+   _mesa_HashRemove(table, 5);
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 1));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 5));
+   EXPECT_EQ(data_for_key(6), _mesa_HashLookup(table, 6));
+   EXPECT_EQ(8u, _mesa_HashNumEntries(table));
+
+   /* Replacing an entry doesn't add one. */
+   _mesa_HashInsert(table, 6, data_for_key(6));
+   EXPECT_EQ(8u, _mesa_HashNumEntries(table));
+}
+
+TEST_F(HashTable, LargeKeys)
+{
+   static const GLuint keys[] = { 100000, 1 << 24, 0x80000001, ~0u - 1 };
+
+   for (unsigned i = 0; i < ARRAY_SIZE(keys); i++)
+      _mesa_HashInsert(table, keys[i], data_for_key(keys[i]));
+
+   for (unsigned i = 0; i < ARRAY_SIZE(keys); i++)
+      EXPECT_EQ(data_for_key(keys[i]), _mesa_HashLookup(table, keys[i]));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 100001));
+   EXPECT_EQ(ARRAY_SIZE(keys), _mesa_HashNumEntries(table));
+
+   _mesa_HashRemove(table, keys[0]);
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, keys[0]));
+   EXPECT_EQ(ARRAY_SIZE(keys) - 1, _mesa_HashNumEntries(table));
+}
+
+/* Keys that start out sparse end up in the array once it grows past them. */
+TEST_F(HashTable, Growth)
+{
+   _mesa_HashInsert(table, 5000, data_for_key(5000));
+   _mesa_HashInsert(table, 9000, data_for_key(9000));
+   insert_range(1, 4000);
+
+   for (GLuint key = 1; key <= 4000; key++)
+      ASSERT_EQ(data_for_key(key), _mesa_HashLookup(table, key));
+   EXPECT_EQ(data_for_key(5000), _mesa_HashLookup(table, 5000));
+   EXPECT_EQ(data_for_key(9000), _mesa_HashLookup(table, 9000));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 4001));
+   EXPECT_EQ(4002u, _mesa_HashNumEntries(table));
+}
+
+static void
+walk_callback(GLuint key, void *data, void *userData)
+{
+   GLuint *seen = (GLuint *) userData;
+
+   EXPECT_EQ(data_for_key(key), data);
+   seen[key == 70000 ? 0 : key]++;
+}
+
+TEST_F(HashTable, Walk)
+{
+   GLuint seen[201] = { 0 };
+
+   insert_range(1, 200);
+   _mesa_HashInsert(table, 70000, data_for_key(70000));
+   _mesa_HashRemove(table, 100);
+
+   _mesa_HashWalk(table, walk_callback, seen);
+
+   EXPECT_EQ(1u, seen[0]);
+   for (GLuint key = 1; key <= 200; key++)
+      EXPECT_EQ(key == 100 ? 0u : 1u, seen[key]);
+}
+
+struct grow_walk {
+   struct _mesa_HashTable *table;
+   GLuint seen[256];
+};
+
+static void
+grow_walk_callback(GLuint key, void *data, void *userData)
+{
+   struct grow_walk *walk = (struct grow_walk *) userData;
+
+   EXPECT_EQ(data_for_key(key), data);
+   ASSERT_LT(key, ARRAY_SIZE(walk->seen));
+   walk->seen[key]++;
+
+   /* Grow the array past 200, which moves it out of the hash table. */
+   if (key == 1) {
+      for (GLuint k = 11; k <= 150; k++)
+         _mesa_HashInsert(walk->table, k, data_for_key(k));
+   }
+}
+
+/* Entries moved by a callback that makes the array grow are still seen. */
+TEST_F(HashTable, WalkWithGrowth)
+{
+   struct grow_walk walk;
+
+   memset(&walk, 0, sizeof(walk));
+   walk.table = table;
+
+   insert_range(1, 10);
+   _mesa_HashInsert(table, 200, data_for_key(200));
+
+   _mesa_HashWalk(table, grow_walk_callback, &walk);
+
+   for (GLuint key = 1; key <= 10; key++)
+      EXPECT_EQ(1u, walk.seen[key]);
+   EXPECT_EQ(1u, walk.seen[200]);
+   for (GLuint key = 11; key <= 150; key++)
+      EXPECT_GE(1u, walk.seen[key]);
+}
+
+TEST_F(HashTable, FindFreeKeyBlock)
+{
+   insert_range(1, 10);
+   EXPECT_EQ(11u, _mesa_HashFindFreeKeyBlock(table, 5));
+
+   _mesa_HashInsert(table, ~0u - 3, data_for_key(~0u - 3));
+   _mesa_HashRemove(table, 4);
+   _mesa_HashRemove(table, 5);
+   _mesa_HashRemove(table, 6);
+   EXPECT_EQ(4u, _mesa_HashFindFreeKeyBlock(table, 3));
+}
+
+struct reader {
+   struct _mesa_HashTable *table;
+   GLuint num_keys;
+   volatile bool *done;
+   bool ok;
+};
+
+static int
+read_keys(void *data)
+{
+   struct reader *reader = (struct reader *) data;
+
+   reader->ok = true;
+   do {
+      for (GLuint key = 1; key <= reader->num_keys; key++) {
+         if (_mesa_HashLookup(reader->table, key) != data_for_key(key))
+            reader->ok = false;
+      }
+   } while (!*reader->done);
+
+   return 0;
+}
+
+/*
+ * Looks up keys from other threads while the table keeps growing, which
+ * replaces the array that they are read from.
+ */
+TEST_F(HashTable, ConcurrentLookups)
+{
+   struct reader readers[4];
+   thrd_t threads[4];
+   volatile bool done = false;
+
+   insert_range(1, 100);
+
+   for (unsigned i = 0; i < 4; i++) {
+      readers[i].table = table;
+      readers[i].num_keys = 100;
+      readers[i].done = &done;
+      ASSERT_EQ(thrd_success, thrd_create(&threads[i], read_keys, &readers[i]));
+   }
+
+   for (GLuint key = 101; key <= 200000; key++) {
+      _mesa_HashInsert(table, key, data_for_key(key));
+      if (key % 3 == 0)
+         _mesa_HashRemove(table, key);
+   }
+   done = true;
+
+   for (unsigned i = 0; i < 4; i++) {
+      thrd_join(threads[i], NULL);
+      EXPECT_TRUE(readers[i].ok);
+   }
+
+   for (GLuint key = 101; key <= 200000; key++) {
+      ASSERT_EQ(key % 3 == 0 ? NULL : data_for_key(key),
+                _mesa_HashLookup(table, key));
+   }
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name shaderqueue.cpp
+ *
+ * Compiler messages reach a GL_DEBUG_OUTPUT_SYNCHRONOUS callback on the
+ * application thread, before glCompileShader returns, even when background
+ * compilation is available.
+ */
+
+#include <stdlib.h>
+#include <gtest/gtest.h>
+
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "c11/threads.h"
+#include "main/compiler.h"
+#include "main/context.h"
+#include "main/errors.h"
+#include "main/shaderapi.h"
+#include "util/u_atomic.h"
+#include "glapi/glapi.h"
+#include "drivers/common/driverfuncs.h"
+
+static const char *const bad_source =
+   "void main()\n"
+   "{\n"
+   "   gl_FragColor = undefined;\n"
+   "}\n";
+
+static int num_messages;
+static bool message_on_other_thread;
+static thrd_t app_thread;
+
+static void GLAPIENTRY
+debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+               GLsizei length, const GLchar *message, const void *data)
+{
+   if (source != GL_DEBUG_SOURCE_SHADER_COMPILER)
+      return;
+
+   if (!thrd_equal(thrd_current(), app_thread))
+      message_on_other_thread = true;
+
+   p_atomic_inc(&num_messages);
+}
+
+class ShaderQueue_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   GLuint compile_bad_shader();
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+};
+
+void
+ShaderQueue_test::SetUp()
+{
+   /* Make sure there are workers to hand compiles to. */
+   setenv("MESA_GLSL_THREADS", "2", 1);
+
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&ctx, 0, sizeof(ctx));
+
+   _mesa_init_driver_functions(&driver_functions);
+
+   ASSERT_TRUE(_mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual,
+                                        NULL, &driver_functions));
+   ctx.Version = 21;
+   ctx.Extensions.ARB_fragment_shader = GL_TRUE;
+
+   _glapi_set_context(&ctx);
+
+   num_messages = 0;
+   message_on_other_thread = false;
+   app_thread = thrd_current();
+
+   _mesa_set_debug_state_int(&ctx, GL_DEBUG_OUTPUT, GL_TRUE);
+   _mesa_DebugMessageCallback(debug_callback, NULL);
+}
+
+void
+ShaderQueue_test::TearDown()
+{
+   _mesa_free_context_data(&ctx);
+   _glapi_set_context(NULL);
+   unsetenv("MESA_GLSL_THREADS");
+}
+
+GLuint
+ShaderQueue_test::compile_bad_shader()
+{
+   GLuint shader = _mesa_CreateShader(GL_FRAGMENT_SHADER);
+
+   _mesa_ShaderSource(shader, 1, &bad_source, NULL);
+   _mesa_CompileShader(shader);
+
+   return shader;
+}
+
+TEST_F(ShaderQueue_test, SynchronousOutputCompilesOnAppThread)
+{
+   _mesa_set_debug_state_int(&ctx, GL_DEBUG_OUTPUT_SYNCHRONOUS, GL_TRUE);
+
+   GLuint shader = compile_bad_shader();
+
+   /* The message arrived during the call, not when the status is queried. */
+   EXPECT_GT(num_messages, 0);
+   EXPECT_FALSE(message_on_other_thread);
+   EXPECT_TRUE(ctx.ShaderQueue == NULL);
+
+   GLint status = GL_TRUE;
+   _mesa_GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+   EXPECT_EQ(GL_FALSE, status);
+
+   _mesa_DeleteShader(shader);
+}
+
+TEST_F(ShaderQueue_test, AsynchronousOutputUsesQueue)
+{
+   GLuint shader = compile_bad_shader();
+
+   EXPECT_TRUE(ctx.ShaderQueue != NULL);
+
+   GLint status = GL_TRUE;
+   _mesa_GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+   EXPECT_EQ(GL_FALSE, status);
+   EXPECT_GT(num_messages, 0);
+
+   _mesa_DeleteShader(shader);
+}
@@ -3213,6 +3213,27 @@ texsubimage(struct gl_context *ctx, GLuint dims, GLenum target, GLint level,
 }
 
 
+/**
+ * Implement the glTexSubImage1/2/3D() functions in KHR_no_error contexts.
+ */
+static void
+texsubimage_no_error(struct gl_context *ctx, GLuint dims, GLenum target,
+                     GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+                     GLsizei width, GLsizei height, GLsizei depth,
+                     GLenum format, GLenum type, const GLvoid *pixels)
+{
+   struct gl_texture_object *texObj;
+   struct gl_texture_image *texImage;
+
+   texObj = _mesa_get_current_tex_object(ctx, target);
+   texImage = _mesa_select_tex_image(texObj, target, level);
+
+   _mesa_texture_sub_image(ctx, dims, texObj, texImage, target, level,
+                           xoffset, yoffset, zoffset, width, height, depth,
+                           format, type, pixels, false);
+}
+
+
 /**
  * Implement all the glTextureSubImage1/2/3D() functions.
  * Must split this out this way because of GL_TEXTURE_CUBE_MAP.
@@ -3370,6 +3391,49 @@ _mesa_TexSubImage3D( GLenum target, GLint level,
                format, type, pixels, "glTexSubImage3D");
 }
 
+void GLAPIENTRY
+_mesa_TexSubImage1D_no_error(GLenum target, GLint level,
+                             GLint xoffset, GLsizei width,
+                             GLenum format, GLenum type,
+                             const GLvoid *pixels)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   texsubimage_no_error(ctx, 1, target, level,
+                        xoffset, 0, 0,
+                        width, 1, 1,
+                        format, type, pixels);
+}
+
+
+void GLAPIENTRY
+_mesa_TexSubImage2D_no_error(GLenum target, GLint level,
+                             GLint xoffset, GLint yoffset,
+                             GLsizei width, GLsizei height,
+                             GLenum format, GLenum type,
+                             const GLvoid *pixels)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   texsubimage_no_error(ctx, 2, target, level,
+                        xoffset, yoffset, 0,
+                        width, height, 1,
+                        format, type, pixels);
+}
+
+
+void GLAPIENTRY
+_mesa_TexSubImage3D_no_error(GLenum target, GLint level,
+                             GLint xoffset, GLint yoffset, GLint zoffset,
+                             GLsizei width, GLsizei height, GLsizei depth,
+                             GLenum format, GLenum type,
+                             const GLvoid *pixels)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   texsubimage_no_error(ctx, 3, target, level,
+                        xoffset, yoffset, zoffset,
+                        width, height, depth,
+                        format, type, pixels);
+}
+
 void GLAPIENTRY
 _mesa_TextureSubImage1D(GLuint texture, GLint level,
                         GLint xoffset, GLsizei width,
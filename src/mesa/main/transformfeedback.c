@@ -39,6 +39,7 @@
 #include "transformfeedback.h"
 #include "shaderapi.h"
 #include "shaderobj.h"
+#include "shaderqueue.h"
 #include "main/dispatch.h"
 
 #include "program/prog_parameter.h"
@@ -387,8 +388,10 @@ get_xfb_source(struct gl_context *ctx)
 {
    int i;
    for (i = MESA_SHADER_GEOMETRY; i >= MESA_SHADER_VERTEX; i--) {
-      if (ctx->_Shader->CurrentProgram[i] != NULL)
+      if (ctx->_Shader->CurrentProgram[i] != NULL) {
+         _mesa_wait_shader_program(ctx, ctx->_Shader->CurrentProgram[i]);
          return ctx->_Shader->CurrentProgram[i];
+      }
    }
    return NULL;
 }
@@ -30,6 +30,7 @@
 #include "main/context.h"
 #include "main/shaderapi.h"
 #include "main/shaderobj.h"
+#include "main/shaderqueue.h"
 #include "main/uniforms.h"
 #include "glsl/ir.h"
 #include "glsl/ir_uniform.h"
@@ -167,6 +168,8 @@ validate_uniform_parameters(struct gl_context *ctx,
       return NULL;
    }
 
+   _mesa_wait_shader_program(ctx, shProg);
+
    /* From page 12 (page 26 of the PDF) of the OpenGL 2.1 spec:
     *
     *     "If a negative number is provided where an argument of type sizei or
@@ -657,6 +660,131 @@ glsl_type_name(enum glsl_base_type type)
 }
 
 
+/**
+ * Stores count values of a non-matrix uniform, starting at array element
+ * offset, and passes them on to the driver storage and to the sampler and
+ * image unit mappings.  The values are known to match the uniform's type.
+ */
+static void
+store_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
+              struct gl_uniform_storage *uni, unsigned offset,
+              GLsizei count, const GLvoid *values,
+              enum glsl_base_type basicType)
+{
+   const int size_mul = basicType == GLSL_TYPE_DOUBLE ? 2 : 1;
+   const unsigned components = uni->type->is_sampler()
+      ? 1 : uni->type->vector_elements;
+
+   /* Page 82 (page 96 of the PDF) of the OpenGL 2.1 spec says:
+    *
+    *     "When loading N elements starting at an arbitrary position k in a
+    *     uniform declared as an array, elements k through k + N - 1 in the
+    *     array will be replaced with the new values. Values for any array
+    *     element that exceeds the highest array element index used, as
+    *     reported by GetActiveUniform, will be ignored by the GL."
+    *
+    * Clamp 'count' to a valid value.  Note that for non-arrays a count > 1
+    * will have already generated an error.
+    */
+   if (uni->array_elements != 0) {
+      count = MIN2(count, (int) (uni->array_elements - offset));
+   }
+
+   FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
+
+   /* Store the data in the "actual type" backing storage for the uniform.
+    */
+   if (!uni->type->is_boolean()) {
+      memcpy(&uni->storage[size_mul * components * offset], values,
+	     sizeof(uni->storage[0]) * components * count * size_mul);
+   } else {
+      const union gl_constant_value *src =
+	 (const union gl_constant_value *) values;
+      union gl_constant_value *dst = &uni->storage[components * offset];
+      const unsigned elems = components * count;
+
+      for (unsigned i = 0; i < elems; i++) {
+	 if (basicType == GLSL_TYPE_FLOAT) {
+            dst[i].i = src[i].f != 0.0f ? ctx->Const.UniformBooleanTrue : 0;
+	 } else {
+            dst[i].i = src[i].i != 0    ? ctx->Const.UniformBooleanTrue : 0;
+	 }
+      }
+   }
+
+   uni->initialized = true;
+
+   _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+
+   /* If the uniform is a sampler, do the extra magic necessary to propagate
+    * the changes through.
+    */
+   if (uni->type->is_sampler()) {
+      bool flushed = false;
+      for (int i = 0; i < MESA_SHADER_STAGES; i++) {
+	 struct gl_shader *const sh = shProg->_LinkedShaders[i];
+
+	 /* If the shader stage doesn't use the sampler uniform, skip this.
+	  */
+	 if (sh == NULL || !uni->opaque[i].active)
+	    continue;
+
+         for (int j = 0; j < count; j++) {
+            sh->SamplerUnits[uni->opaque[i].index + offset + j] =
+               ((unsigned *) values)[j];
+         }
+
+	 struct gl_program *const prog = sh->Program;
+
+	 assert(sizeof(prog->SamplerUnits) == sizeof(sh->SamplerUnits));
+
+	 /* Determine if any of the samplers used by this shader stage have
+	  * been modified.
+	  */
+	 bool changed = false;
+	 for (unsigned j = 0; j < ARRAY_SIZE(prog->SamplerUnits); j++) {
+	    if ((sh->active_samplers & (1U << j)) != 0
+		&& (prog->SamplerUnits[j] != sh->SamplerUnits[j])) {
+	       changed = true;
+	       break;
+	    }
+	 }
+
+	 if (changed) {
+	    if (!flushed) {
+	       FLUSH_VERTICES(ctx, _NEW_TEXTURE | _NEW_PROGRAM);
+	       flushed = true;
+	    }
+
+	    memcpy(prog->SamplerUnits,
+		   sh->SamplerUnits,
+		   sizeof(sh->SamplerUnits));
+
+	    _mesa_update_shader_textures_used(shProg, prog);
+            if (ctx->Driver.SamplerUniformChange)
+	       ctx->Driver.SamplerUniformChange(ctx, prog->Target, prog);
+	 }
+      }
+   }
+
+   /* If the uniform is an image, update the mapping from image
+    * uniforms to image units present in the shader data structure.
+    */
+   if (uni->type->is_image()) {
+      for (int i = 0; i < MESA_SHADER_STAGES; i++) {
+	 if (uni->opaque[i].active) {
+            struct gl_shader *sh = shProg->_LinkedShaders[i];
+
+            for (int j = 0; j < count; j++)
+               sh->ImageUnits[uni->opaque[i].index + offset + j] =
+                  ((GLint *) values)[j];
+         }
+      }
+
+      ctx->NewDriverState |= ctx->DriverFlags.NewImageUnits;
+   }
+}
+
 /**
  * Called via glUniform*() functions.
  */
@@ -668,7 +796,6 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
               unsigned src_components)
 {
    unsigned offset;
-   int size_mul = basicType == GLSL_TYPE_DOUBLE ? 2 : 1;
 
    struct gl_uniform_storage *const uni =
       validate_uniform_parameters(ctx, shProg, location, count,
@@ -774,6 +901,26 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
       }
    }
 
+   store_uniform(ctx, shProg, uni, offset, count, values, basicType);
+}
+
+/**
+ * Stores count values of a matrix uniform, starting at array element
+ * offset, and passes them on to the driver storage.  The values are known
+ * to match the uniform's type.
+ */
+static void
+store_uniform_matrix(struct gl_context *ctx, struct gl_uniform_storage *uni,
+                     unsigned offset, GLsizei count, GLboolean transpose,
+                     const GLvoid *values, enum glsl_base_type basicType)
+{
+   const int size_mul = basicType == GLSL_TYPE_DOUBLE ? 2 : 1;
+   const unsigned vectors = uni->type->matrix_columns;
+   const unsigned components = uni->type->vector_elements;
+   const unsigned cols = vectors;
+   const unsigned rows = components;
+   const unsigned elements = components * vectors;
+
    /* Page 82 (page 96 of the PDF) of the OpenGL 2.1 spec says:
     *
     *     "When loading N elements starting at an arbitrary position k in a
@@ -793,95 +940,45 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
 
    /* Store the data in the "actual type" backing storage for the uniform.
     */
-   if (!uni->type->is_boolean()) {
-      memcpy(&uni->storage[size_mul * components * offset], values,
-	     sizeof(uni->storage[0]) * components * count * size_mul);
-   } else {
-      const union gl_constant_value *src =
-	 (const union gl_constant_value *) values;
-      union gl_constant_value *dst = &uni->storage[components * offset];
-      const unsigned elems = components * count;
+   if (!transpose) {
+      memcpy(&uni->storage[elements * offset], values,
+	     sizeof(uni->storage[0]) * elements * count * size_mul);
+   } else if (basicType == GLSL_TYPE_FLOAT) {
+      /* Copy and transpose the matrix.
+       */
+      const float *src = (const float *)values;
+      float *dst = &uni->storage[elements * offset].f;
 
-      for (unsigned i = 0; i < elems; i++) {
-	 if (basicType == GLSL_TYPE_FLOAT) {
-            dst[i].i = src[i].f != 0.0f ? ctx->Const.UniformBooleanTrue : 0;
-	 } else {
-            dst[i].i = src[i].i != 0    ? ctx->Const.UniformBooleanTrue : 0;
+      for (int i = 0; i < count; i++) {
+	 for (unsigned r = 0; r < rows; r++) {
+	    for (unsigned c = 0; c < cols; c++) {
+	       dst[(c * components) + r] = src[c + (r * vectors)];
+	    }
 	 }
-      }
-   }
-
-   uni->initialized = true;
-
-   _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
-
-   /* If the uniform is a sampler, do the extra magic necessary to propagate
-    * the changes through.
-    */
-   if (uni->type->is_sampler()) {
-      bool flushed = false;
-      for (int i = 0; i < MESA_SHADER_STAGES; i++) {
-	 struct gl_shader *const sh = shProg->_LinkedShaders[i];
-
-	 /* If the shader stage doesn't use the sampler uniform, skip this.
-	  */
-	 if (sh == NULL || !uni->opaque[i].active)
-	    continue;
 
-         for (int j = 0; j < count; j++) {
-            sh->SamplerUnits[uni->opaque[i].index + offset + j] =
-               ((unsigned *) values)[j];
-         }
-
-	 struct gl_program *const prog = sh->Program;
-
-	 assert(sizeof(prog->SamplerUnits) == sizeof(sh->SamplerUnits));
+	 dst += elements;
+	 src += elements;
+      }
+   } else {
+      assert(basicType == GLSL_TYPE_DOUBLE);
+      const double *src = (const double *)values;
+      double *dst = (double *)&uni->storage[elements * offset].f;
 
-	 /* Determine if any of the samplers used by this shader stage have
-	  * been modified.
-	  */
-	 bool changed = false;
-	 for (unsigned j = 0; j < ARRAY_SIZE(prog->SamplerUnits); j++) {
-	    if ((sh->active_samplers & (1U << j)) != 0
-		&& (prog->SamplerUnits[j] != sh->SamplerUnits[j])) {
-	       changed = true;
-	       break;
+      for (int i = 0; i < count; i++) {
+	 for (unsigned r = 0; r < rows; r++) {
+	    for (unsigned c = 0; c < cols; c++) {
+	       dst[(c * components) + r] = src[c + (r * vectors)];
 	    }
 	 }
 
-	 if (changed) {
-	    if (!flushed) {
-	       FLUSH_VERTICES(ctx, _NEW_TEXTURE | _NEW_PROGRAM);
-	       flushed = true;
-	    }
-
-	    memcpy(prog->SamplerUnits,
-		   sh->SamplerUnits,
-		   sizeof(sh->SamplerUnits));
-
-	    _mesa_update_shader_textures_used(shProg, prog);
-            if (ctx->Driver.SamplerUniformChange)
-	       ctx->Driver.SamplerUniformChange(ctx, prog->Target, prog);
-	 }
+	 dst += elements;
+	 src += elements;
       }
    }
 
-   /* If the uniform is an image, update the mapping from image
-    * uniforms to image units present in the shader data structure.
-    */
-   if (uni->type->is_image()) {
-      for (int i = 0; i < MESA_SHADER_STAGES; i++) {
-	 if (uni->opaque[i].active) {
-            struct gl_shader *sh = shProg->_LinkedShaders[i];
-
-            for (int j = 0; j < count; j++)
-               sh->ImageUnits[uni->opaque[i].index + offset + j] =
-                  ((GLint *) values)[j];
-         }
-      }
+   uni->initialized = true;
 
-      ctx->NewDriverState |= ctx->DriverFlags.NewImageUnits;
-   }
+   _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
 }
 
 /**
@@ -898,8 +995,6 @@ _mesa_uniform_matrix(struct gl_context *ctx, struct gl_shader_program *shProg,
    unsigned offset;
    unsigned vectors;
    unsigned components;
-   unsigned elements;
-   int size_mul;
    struct gl_uniform_storage *const uni =
       validate_uniform_parameters(ctx, shProg, location, count,
                                   &offset, "glUniformMatrix");
@@ -913,7 +1008,6 @@ _mesa_uniform_matrix(struct gl_context *ctx, struct gl_shader_program *shProg,
    }
 
    assert(basicType == GLSL_TYPE_FLOAT || basicType == GLSL_TYPE_DOUBLE);
-   size_mul = basicType == GLSL_TYPE_DOUBLE ? 2 : 1;
 
    assert(!uni->type->is_sampler());
    vectors = uni->type->matrix_columns;
@@ -969,66 +1063,75 @@ _mesa_uniform_matrix(struct gl_context *ctx, struct gl_shader_program *shProg,
 		  bool(transpose), shProg, location, uni);
    }
 
-   /* Page 82 (page 96 of the PDF) of the OpenGL 2.1 spec says:
-    *
-    *     "When loading N elements starting at an arbitrary position k in a
-    *     uniform declared as an array, elements k through k + N - 1 in the
-    *     array will be replaced with the new values. Values for any array
-    *     element that exceeds the highest array element index used, as
-    *     reported by GetActiveUniform, will be ignored by the GL."
-    *
-    * Clamp 'count' to a valid value.  Note that for non-arrays a count > 1
-    * will have already generated an error.
-    */
-   if (uni->array_elements != 0) {
-      count = MIN2(count, (int) (uni->array_elements - offset));
-   }
+   store_uniform_matrix(ctx, uni, offset, count, transpose, values,
+                        basicType);
+}
 
-   FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
 
-   /* Store the data in the "actual type" backing storage for the uniform.
-    */
-   elements = components * vectors;
+/**
+ * Finds the uniform at a location for the KHR_no_error versions of
+ * glUniform*(), where the application promises that the location and the
+ * values are valid for the program.
+ *
+ * Returns NULL for location -1 and for explicit locations of inactive
+ * uniforms, which are ignored without an error in any context.
+ */
+static struct gl_uniform_storage *
+lookup_uniform_no_error(struct gl_context *ctx,
+                        struct gl_shader_program *shProg,
+                        GLint location, unsigned *array_index)
+{
+   _mesa_wait_shader_program(ctx, shProg);
 
-   if (!transpose) {
-      memcpy(&uni->storage[elements * offset], values,
-	     sizeof(uni->storage[0]) * elements * count * size_mul);
-   } else if (basicType == GLSL_TYPE_FLOAT) {
-      /* Copy and transpose the matrix.
-       */
-      const float *src = (const float *)values;
-      float *dst = &uni->storage[elements * offset].f;
+   if (location == -1)
+      return NULL;
 
-      for (int i = 0; i < count; i++) {
-	 for (unsigned r = 0; r < rows; r++) {
-	    for (unsigned c = 0; c < cols; c++) {
-	       dst[(c * components) + r] = src[c + (r * vectors)];
-	    }
-	 }
+   struct gl_uniform_storage *const uni = shProg->UniformRemapTable[location];
+   if (uni == INACTIVE_UNIFORM_EXPLICIT_LOCATION)
+      return NULL;
 
-	 dst += elements;
-	 src += elements;
-      }
-   } else {
-      assert(basicType == GLSL_TYPE_DOUBLE);
-      const double *src = (const double *)values;
-      double *dst = (double *)&uni->storage[elements * offset].f;
+   *array_index = location - uni->remap_location;
+   return uni;
+}
 
-      for (int i = 0; i < count; i++) {
-	 for (unsigned r = 0; r < rows; r++) {
-	    for (unsigned c = 0; c < cols; c++) {
-	       dst[(c * components) + r] = src[c + (r * vectors)];
-	    }
-	 }
+/**
+ * Called via glUniform*() functions in KHR_no_error contexts.
+ */
+extern "C" void
+_mesa_uniform_no_error(struct gl_context *ctx,
+                       struct gl_shader_program *shProg,
+                       GLint location, GLsizei count,
+                       const GLvoid *values,
+                       enum glsl_base_type basicType)
+{
+   unsigned offset;
+   struct gl_uniform_storage *const uni =
+      lookup_uniform_no_error(ctx, shProg, location, &offset);
+   if (uni == NULL)
+      return;
 
-	 dst += elements;
-	 src += elements;
-      }
-   }
+   store_uniform(ctx, shProg, uni, offset, count, values, basicType);
+}
 
-   uni->initialized = true;
+/**
+ * Called via glUniformMatrix*() functions in KHR_no_error contexts.
+ */
+extern "C" void
+_mesa_uniform_matrix_no_error(struct gl_context *ctx,
+                              struct gl_shader_program *shProg,
+                              GLint location, GLsizei count,
+                              GLboolean transpose,
+                              const GLvoid *values,
+                              enum glsl_base_type basicType)
+{
+   unsigned offset;
+   struct gl_uniform_storage *const uni =
+      lookup_uniform_no_error(ctx, shProg, location, &offset);
+   if (uni == NULL)
+      return;
 
-   _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+   store_uniform_matrix(ctx, uni, offset, count, transpose, values,
+                        basicType);
 }
 
 
@@ -284,6 +284,167 @@ _mesa_Uniform4iv(GLint location, GLsizei count, const GLint * value)
    _mesa_uniform(ctx, ctx->_Shader->ActiveProgram, location, count, value, GLSL_TYPE_INT, 4);
 }
 
+/** Same as above for KHR_no_error contexts **/
+void GLAPIENTRY
+_mesa_Uniform1f_no_error(GLint location, GLfloat v0)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, 1, &v0,
+                          GLSL_TYPE_FLOAT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform2f_no_error(GLint location, GLfloat v0, GLfloat v1)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   GLfloat v[2];
+   v[0] = v0;
+   v[1] = v1;
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, 1, v,
+                          GLSL_TYPE_FLOAT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform3f_no_error(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   GLfloat v[3];
+   v[0] = v0;
+   v[1] = v1;
+   v[2] = v2;
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, 1, v,
+                          GLSL_TYPE_FLOAT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform4f_no_error(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   GLfloat v[4];
+   v[0] = v0;
+   v[1] = v1;
+   v[2] = v2;
+   v[3] = v3;
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, 1, v,
+                          GLSL_TYPE_FLOAT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform1i_no_error(GLint location, GLint v0)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, 1, &v0,
+                          GLSL_TYPE_INT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform2i_no_error(GLint location, GLint v0, GLint v1)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   GLint v[2];
+   v[0] = v0;
+   v[1] = v1;
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, 1, v,
+                          GLSL_TYPE_INT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform3i_no_error(GLint location, GLint v0, GLint v1, GLint v2)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   GLint v[3];
+   v[0] = v0;
+   v[1] = v1;
+   v[2] = v2;
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, 1, v,
+                          GLSL_TYPE_INT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform4i_no_error(GLint location, GLint v0, GLint v1, GLint v2, GLint v3)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   GLint v[4];
+   v[0] = v0;
+   v[1] = v1;
+   v[2] = v2;
+   v[3] = v3;
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, 1, v,
+                          GLSL_TYPE_INT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform1fv_no_error(GLint location, GLsizei count,
+                          const GLfloat *value)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, count,
+                          value, GLSL_TYPE_FLOAT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform2fv_no_error(GLint location, GLsizei count,
+                          const GLfloat *value)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, count,
+                          value, GLSL_TYPE_FLOAT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform3fv_no_error(GLint location, GLsizei count,
+                          const GLfloat *value)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, count,
+                          value, GLSL_TYPE_FLOAT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform4fv_no_error(GLint location, GLsizei count,
+                          const GLfloat *value)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, count,
+                          value, GLSL_TYPE_FLOAT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform1iv_no_error(GLint location, GLsizei count,
+                          const GLint *value)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, count,
+                          value, GLSL_TYPE_INT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform2iv_no_error(GLint location, GLsizei count,
+                          const GLint *value)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, count,
+                          value, GLSL_TYPE_INT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform3iv_no_error(GLint location, GLsizei count,
+                          const GLint *value)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, count,
+                          value, GLSL_TYPE_INT);
+}
+
+void GLAPIENTRY
+_mesa_Uniform4iv_no_error(GLint location, GLsizei count,
+                          const GLint *value)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_no_error(ctx, ctx->_Shader->ActiveProgram, location, count,
+                          value, GLSL_TYPE_INT);
+}
+
 /** Same as above with direct state access **/
 void GLAPIENTRY
 _mesa_ProgramUniform1f(GLuint program, GLint location, GLfloat v0)
@@ -574,6 +735,34 @@ _mesa_UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose,
 			4, 4, location, count, transpose, value, GLSL_TYPE_FLOAT);
 }
 
+/** Same as above for KHR_no_error contexts **/
+void GLAPIENTRY
+_mesa_UniformMatrix2fv_no_error(GLint location, GLsizei count,
+                                GLboolean transpose, const GLfloat *value)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_matrix_no_error(ctx, ctx->_Shader->ActiveProgram, location,
+                                 count, transpose, value, GLSL_TYPE_FLOAT);
+}
+
+void GLAPIENTRY
+_mesa_UniformMatrix3fv_no_error(GLint location, GLsizei count,
+                                GLboolean transpose, const GLfloat *value)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_matrix_no_error(ctx, ctx->_Shader->ActiveProgram, location,
+                                 count, transpose, value, GLSL_TYPE_FLOAT);
+}
+
+void GLAPIENTRY
+_mesa_UniformMatrix4fv_no_error(GLint location, GLsizei count,
+                                GLboolean transpose, const GLfloat *value)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   _mesa_uniform_matrix_no_error(ctx, ctx->_Shader->ActiveProgram, location,
+                                 count, transpose, value, GLSL_TYPE_FLOAT);
+}
+
 /** Same as above with direct state access **/
 
 void GLAPIENTRY
@@ -72,6 +72,44 @@ _mesa_Uniform3iv(GLint, GLsizei, const GLint *);
 void GLAPIENTRY
 _mesa_Uniform4iv(GLint, GLsizei, const GLint *);
 void GLAPIENTRY
+_mesa_Uniform1f_no_error(GLint, GLfloat);
+void GLAPIENTRY
+_mesa_Uniform2f_no_error(GLint, GLfloat, GLfloat);
+void GLAPIENTRY
+_mesa_Uniform3f_no_error(GLint, GLfloat, GLfloat, GLfloat);
+void GLAPIENTRY
+_mesa_Uniform4f_no_error(GLint, GLfloat, GLfloat, GLfloat, GLfloat);
+void GLAPIENTRY
+_mesa_Uniform1i_no_error(GLint, GLint);
+void GLAPIENTRY
+_mesa_Uniform2i_no_error(GLint, GLint, GLint);
+void GLAPIENTRY
+_mesa_Uniform3i_no_error(GLint, GLint, GLint, GLint);
+void GLAPIENTRY
+_mesa_Uniform4i_no_error(GLint, GLint, GLint, GLint, GLint);
+void GLAPIENTRY
+_mesa_Uniform1fv_no_error(GLint, GLsizei, const GLfloat *);
+void GLAPIENTRY
+_mesa_Uniform2fv_no_error(GLint, GLsizei, const GLfloat *);
+void GLAPIENTRY
+_mesa_Uniform3fv_no_error(GLint, GLsizei, const GLfloat *);
+void GLAPIENTRY
+_mesa_Uniform4fv_no_error(GLint, GLsizei, const GLfloat *);
+void GLAPIENTRY
+_mesa_Uniform1iv_no_error(GLint, GLsizei, const GLint *);
+void GLAPIENTRY
+_mesa_Uniform2iv_no_error(GLint, GLsizei, const GLint *);
+void GLAPIENTRY
+_mesa_Uniform3iv_no_error(GLint, GLsizei, const GLint *);
+void GLAPIENTRY
+_mesa_Uniform4iv_no_error(GLint, GLsizei, const GLint *);
+void GLAPIENTRY
+_mesa_UniformMatrix2fv_no_error(GLint, GLsizei, GLboolean, const GLfloat *);
+void GLAPIENTRY
+_mesa_UniformMatrix3fv_no_error(GLint, GLsizei, GLboolean, const GLfloat *);
+void GLAPIENTRY
+_mesa_UniformMatrix4fv_no_error(GLint, GLsizei, GLboolean, const GLfloat *);
+void GLAPIENTRY
 _mesa_Uniform1ui(GLint location, GLuint v0);
 void GLAPIENTRY
 _mesa_Uniform2ui(GLint location, GLuint v0, GLuint v1);
@@ -361,6 +399,21 @@ _mesa_uniform_matrix(struct gl_context *ctx, struct gl_shader_program *shProg,
                      GLboolean transpose,
                      const GLvoid *values, enum glsl_base_type basicType);
 
+void
+_mesa_uniform_no_error(struct gl_context *ctx,
+                       struct gl_shader_program *shProg,
+                       GLint location, GLsizei count,
+                       const GLvoid *values,
+                       enum glsl_base_type basicType);
+
+void
+_mesa_uniform_matrix_no_error(struct gl_context *ctx,
+                              struct gl_shader_program *shProg,
+                              GLint location, GLsizei count,
+                              GLboolean transpose,
+                              const GLvoid *values,
+                              enum glsl_base_type basicType);
+
 void
 _mesa_get_uniform(struct gl_context *ctx, GLuint program, GLint location,
 		  GLsizei bufSize, enum glsl_base_type returnType,
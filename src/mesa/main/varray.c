@@ -247,6 +247,40 @@ get_legal_types_mask(const struct gl_context *ctx)
 }
 
 
+/**
+ * Sets the format of a vertex attribute array from parameters that are
+ * known to be valid.
+ */
+static void
+set_array_format(struct gl_context *ctx,
+                 struct gl_vertex_array_object *vao,
+                 GLuint attrib, GLint size, GLenum type, GLenum format,
+                 GLboolean normalized, GLboolean integer, GLboolean doubles,
+                 GLuint relativeOffset)
+{
+   struct gl_vertex_attrib_array *array;
+   GLint elementSize;
+
+   assert(size <= 4);
+
+   elementSize = _mesa_bytes_per_vertex_attrib(size, type);
+   assert(elementSize != -1);
+
+   array = &vao->VertexAttrib[attrib];
+   array->Size = size;
+   array->Type = type;
+   array->Format = format;
+   array->Normalized = normalized;
+   array->Integer = integer;
+   array->Doubles = doubles;
+   array->RelativeOffset = relativeOffset;
+   array->_ElementSize = elementSize;
+
+   vao->NewArrays |= VERT_BIT(attrib);
+   ctx->NewState |= _NEW_ARRAY;
+}
+
+
 /**
  * Does error checking and updates the format in an attrib array.
  *
@@ -274,9 +308,7 @@ update_array_format(struct gl_context *ctx,
                     GLboolean normalized, GLboolean integer, GLboolean doubles,
                     GLuint relativeOffset)
 {
-   struct gl_vertex_attrib_array *array;
    GLbitfield typeBit;
-   GLint elementSize;
    GLenum format = GL_RGBA;
 
    if (ctx->Array.LegalTypesMask == 0 || ctx->Array.LegalTypesMaskAPI != ctx->API) {
@@ -377,25 +409,36 @@ update_array_format(struct gl_context *ctx,
       return false;
    }
 
-   assert(size <= 4);
+   set_array_format(ctx, vao, attrib, size, type, format,
+                    normalized, integer, doubles, relativeOffset);
 
-   elementSize = _mesa_bytes_per_vertex_attrib(size, type);
-   assert(elementSize != -1);
+   return true;
+}
 
-   array = &vao->VertexAttrib[attrib];
-   array->Size = size;
-   array->Type = type;
-   array->Format = format;
-   array->Normalized = normalized;
-   array->Integer = integer;
-   array->Doubles = doubles;
-   array->RelativeOffset = relativeOffset;
-   array->_ElementSize = elementSize;
 
-   vao->NewArrays |= VERT_BIT(attrib);
-   ctx->NewState |= _NEW_ARRAY;
+/**
+ * Points an attribute array at the data, in the buffer currently bound to
+ * GL_ARRAY_BUFFER, once its format has been set.
+ */
+static void
+set_array_pointer(struct gl_context *ctx, GLuint attrib, GLsizei stride,
+                  const GLvoid *ptr)
+{
+   struct gl_vertex_attrib_array *array;
+   GLsizei effectiveStride;
 
-   return true;
+   /* Reset the vertex attrib binding */
+   vertex_attrib_binding(ctx, ctx->Array.VAO, attrib, attrib);
+
+   /* The Stride and Ptr fields are not set by update_array_format() */
+   array = &ctx->Array.VAO->VertexAttrib[attrib];
+   array->Stride = stride;
+   array->Ptr = (const GLvoid *) ptr;
+
+   /* Update the vertex buffer binding */
+   effectiveStride = stride != 0 ? stride : array->_ElementSize;
+   bind_vertex_buffer(ctx, ctx->Array.VAO, attrib, ctx->Array.ArrayBufferObj,
+                      (GLintptr) ptr, effectiveStride);
 }
 
 
@@ -425,9 +468,6 @@ update_array(struct gl_context *ctx,
              GLboolean normalized, GLboolean integer, GLboolean doubles,
              const GLvoid *ptr)
 {
-   struct gl_vertex_attrib_array *array;
-   GLsizei effectiveStride;
-
    /* Page 407 (page 423 of the PDF) of the OpenGL 3.0 spec says:
     *
     *     "Client vertex arrays - all vertex array attribute pointers must
@@ -481,18 +521,7 @@ update_array(struct gl_context *ctx,
       return;
    }
 
-   /* Reset the vertex attrib binding */
-   vertex_attrib_binding(ctx, ctx->Array.VAO, attrib, attrib);
-
-   /* The Stride and Ptr fields are not set by update_array_format() */
-   array = &ctx->Array.VAO->VertexAttrib[attrib];
-   array->Stride = stride;
-   array->Ptr = (const GLvoid *) ptr;
-
-   /* Update the vertex buffer binding */
-   effectiveStride = stride != 0 ? stride : array->_ElementSize;
-   bind_vertex_buffer(ctx, ctx->Array.VAO, attrib, ctx->Array.ArrayBufferObj,
-                      (GLintptr) ptr, effectiveStride);
+   set_array_pointer(ctx, attrib, stride, ptr);
 }
 
 
@@ -695,6 +724,28 @@ _mesa_VertexAttribPointer(GLuint index, GLint size, GLenum type,
 }
 
 
+/**
+ * glVertexAttribPointer for KHR_no_error contexts.
+ */
+void GLAPIENTRY
+_mesa_VertexAttribPointer_no_error(GLuint index, GLint size, GLenum type,
+                                   GLboolean normalized,
+                                   GLsizei stride, const GLvoid *ptr)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   GLenum format = GL_RGBA;
+
+   if (size == GL_BGRA) {
+      format = GL_BGRA;
+      size = 4;
+   }
+
+   set_array_format(ctx, ctx->Array.VAO, VERT_ATTRIB_GENERIC(index),
+                    size, type, format, normalized, GL_FALSE, GL_FALSE, 0);
+   set_array_pointer(ctx, VERT_ATTRIB_GENERIC(index), stride, ptr);
+}
+
+
 /**
  * GL_EXT_gpu_shader4 / GL 3.0.
  * Set an integer-valued vertex attribute array.
@@ -2354,7 +2405,7 @@ _mesa_print_arrays(struct gl_context *ctx)
 void
 _mesa_init_varray(struct gl_context *ctx)
 {
-   ctx->Array.DefaultVAO = _mesa_new_vao(ctx, 0);
+   ctx->Array.DefaultVAO = ctx->Driver.NewArrayObject(ctx, 0);
    _mesa_reference_vao(ctx, &ctx->Array.VAO, ctx->Array.DefaultVAO);
    ctx->Array.ActiveTexture = 0;   /* GL_ARB_multitexture */
 
@@ -2370,7 +2421,7 @@ delete_arrayobj_cb(GLuint id, void *data, void *userData)
 {
    struct gl_vertex_array_object *vao = (struct gl_vertex_array_object *) data;
    struct gl_context *ctx = (struct gl_context *) userData;
-   _mesa_delete_vao(ctx, vao);
+   ctx->Driver.DeleteArrayObject(ctx, vao);
 }
 
 
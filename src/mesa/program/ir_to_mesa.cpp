@@ -45,6 +45,8 @@
 #include "glsl/nir/glsl_types.h"
 #include "glsl/linker.h"
 #include "glsl/program.h"
+#include "glsl/program_binary.h"
+#include "glsl/shader_cache.h"
 #include "program/hash_table.h"
 #include "program/prog_instruction.h"
 #include "program/prog_optimize.h"
@@ -2957,27 +2959,73 @@ _mesa_ir_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 }
 
 /**
- * Link a GLSL shader program.  Called via glLinkProgram().
+ * First step of linking: reset the program and try the shader cache.
+ *
+ * \return GL_TRUE if _mesa_glsl_link_shader_run() still has to link the
+ *         program.
  */
-void
-_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+GLboolean
+_mesa_glsl_link_shader_begin(struct gl_context *ctx,
+                             struct gl_shader_program *prog)
 {
-   unsigned int i;
-
    _mesa_clear_shader_program_data(prog);
 
    prog->LinkStatus = GL_TRUE;
 
+   return !shader_cache_load_program(ctx, prog);
+}
+
+/**
+ * Second step of linking: the GLSL linker proper.
+ *
+ * This may run on a worker thread.  The only driver hook it calls is
+ * ctx->Driver.NewShader, from link_shaders(), which must be thread-safe.
+ */
+void
+_mesa_glsl_link_shader_run(struct gl_context *ctx,
+                           struct gl_shader_program *prog)
+{
+   unsigned int i;
+
    for (i = 0; i < prog->NumShaders; i++) {
       if (!prog->Shaders[i]->CompileStatus) {
 	 linker_error(prog, "linking with uncompiled shader");
       }
    }
 
+   if (prog->LinkStatus) {
+      shader_cache_compile_deferred(ctx, prog);
+   }
+
    if (prog->LinkStatus) {
       link_shaders(ctx, prog);
    }
 
+   /* The driver lowers the linked IR in place, so the binary has to be
+    * captured before handing the program over.  Serializing isn't free, so
+    * it is only done for applications that set
+    * GL_PROGRAM_BINARY_RETRIEVABLE_HINT, and by the shader cache when it
+    * stores the program.
+    */
+   if (prog->LinkStatus) {
+      if (prog->BinaryRetreivableHint) {
+         size_t size = 0;
+
+         prog->Binary = _mesa_glsl_serialize_program(prog, ctx, prog, &size);
+         prog->BinarySize = prog->Binary ? size : 0;
+      }
+
+      shader_cache_store_program(ctx, prog);
+   }
+}
+
+/**
+ * Last step of linking: hand the program to the driver.
+ */
+void
+_mesa_glsl_link_shader_end(struct gl_context *ctx,
+                           struct gl_shader_program *prog)
+{
    if (prog->LinkStatus) {
       if (!ctx->Driver.LinkShader(ctx, prog)) {
 	 prog->LinkStatus = GL_FALSE;
@@ -2998,4 +3046,55 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
    }
 }
 
+/**
+ * Link a GLSL shader program.  Called via glLinkProgram().
+ */
+void
+_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   if (_mesa_glsl_link_shader_begin(ctx, prog))
+      _mesa_glsl_link_shader_run(ctx, prog);
+
+   _mesa_glsl_link_shader_end(ctx, prog);
+}
+
+/**
+ * Restore a linked program from a glGetProgramBinary result.  Called via
+ * glProgramBinary().
+ */
+void
+_mesa_glsl_load_program_binary(struct gl_context *ctx,
+                               struct gl_shader_program *prog,
+                               const void *binary, GLsizei length)
+{
+   _mesa_clear_shader_program_data(prog);
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i] != NULL)
+         _mesa_delete_shader(ctx, prog->_LinkedShaders[i]);
+      prog->_LinkedShaders[i] = NULL;
+   }
+
+   prog->LinkStatus =
+      _mesa_glsl_deserialize_program(ctx, prog, (const uint8_t *) binary,
+                                     length);
+   if (!prog->LinkStatus) {
+      linker_error(prog, "program binary is invalid or was created by a "
+                   "different driver or Mesa version\n");
+      return;
+   }
+
+   prog->Binary = (GLubyte *) ralloc_size(prog, length);
+   if (prog->Binary) {
+      memcpy(prog->Binary, binary, length);
+      prog->BinarySize = length;
+   }
+
+   if (!ctx->Driver.LinkShader(ctx, prog)) {
+      prog->LinkStatus = GL_FALSE;
+   } else {
+      build_program_resource_list(prog);
+   }
+}
+
 } /* extern "C" */
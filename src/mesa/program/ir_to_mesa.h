@@ -34,6 +34,15 @@ struct gl_shader;
 struct gl_shader_program;
 
 void _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog);
+GLboolean _mesa_glsl_link_shader_begin(struct gl_context *ctx,
+                                       struct gl_shader_program *prog);
+void _mesa_glsl_link_shader_run(struct gl_context *ctx,
+                                struct gl_shader_program *prog);
+void _mesa_glsl_link_shader_end(struct gl_context *ctx,
+                                struct gl_shader_program *prog);
+void _mesa_glsl_load_program_binary(struct gl_context *ctx,
+                                    struct gl_shader_program *prog,
+                                    const void *binary, GLsizei length);
 GLboolean _mesa_ir_compile_shader(struct gl_context *ctx, struct gl_shader *shader);
 GLboolean _mesa_ir_link_shader(struct gl_context *ctx, struct gl_shader_program *prog);
 
@@ -31,6 +31,7 @@
 #include "main/context.h"
 
 #include "pipe/p_defines.h"
+#include "util/u_math.h"
 #include "st_context.h"
 #include "st_atom.h"
 #include "st_cb_bitmap.h"
@@ -86,7 +87,27 @@ static const struct st_tracked_state *atoms[] =
 
 void st_init_atoms( struct st_context *st )
 {
-   /* no-op */
+   GLuint i;
+
+   STATIC_ASSERT(ARRAY_SIZE(atoms) <= 64);
+
+   /* Register each atom against every dirty bit it depends on, so that
+    * validation only has to look at the bits that are actually set.
+    */
+   memset(st->atoms_for_mesa_flag, 0, sizeof(st->atoms_for_mesa_flag));
+   memset(st->atoms_for_st_flag, 0, sizeof(st->atoms_for_st_flag));
+
+   for (i = 0; i < ARRAY_SIZE(atoms); i++) {
+      GLuint mesa = atoms[i]->dirty.mesa;
+      uint64_t flags = atoms[i]->dirty.st;
+
+      assert((mesa || flags) && atoms[i]->update);
+
+      while (mesa)
+         st->atoms_for_mesa_flag[u_bit_scan(&mesa)] |= BITFIELD64_BIT(i);
+      while (flags)
+         st->atoms_for_st_flag[u_bit_scan64(&flags)] |= BITFIELD64_BIT(i);
+   }
 }
 
 
@@ -99,18 +120,22 @@ void st_destroy_atoms( struct st_context *st )
 /***********************************************************************
  */
 
-static GLboolean check_state( const struct st_state_flags *a,
-			      const struct st_state_flags *b )
+/**
+ * Return the mask of atoms that depend on any of the given dirty flags.
+ */
+static uint64_t atoms_for_state( const struct st_context *st,
+                                 const struct st_state_flags *state )
 {
-   return ((a->mesa & b->mesa) ||
-	   (a->st & b->st));
-}
+   GLuint mesa = state->mesa;
+   uint64_t flags = state->st;
+   uint64_t mask = 0;
 
-static void accumulate_state( struct st_state_flags *a,
-			      const struct st_state_flags *b )
-{
-   a->mesa |= b->mesa;
-   a->st |= b->st;
+   while (mesa)
+      mask |= st->atoms_for_mesa_flag[u_bit_scan(&mesa)];
+   while (flags)
+      mask |= st->atoms_for_st_flag[u_bit_scan64(&flags)];
+
+   return mask;
 }
 
 
@@ -173,6 +198,7 @@ static void check_attrib_edgeflag(struct st_context *st)
 void st_validate_state( struct st_context *st )
 {
    struct st_state_flags *state = &st->dirty;
+   uint64_t pending;
    GLuint i;
 
    /* Get Mesa driver state. */
@@ -193,54 +219,27 @@ void st_validate_state( struct st_context *st )
 
    /*printf("%s %x/%x\n", __func__, state->mesa, state->st);*/
 
-#ifdef DEBUG
-   if (1) {
-#else
-   if (0) {
-#endif
-      /* Debug version which enforces various sanity checks on the
-       * state flags which are generated and checked to help ensure
-       * state atoms are ordered correctly in the list.
+   pending = atoms_for_state(st, state);
+
+   while (pending) {
+      struct st_state_flags prev = *state, generated;
+      uint64_t generated_atoms;
+
+      i = u_bit_scan64(&pending);
+      atoms[i]->update( st );
+
+      xor_states(&generated, &prev, state);
+      if (!generated.mesa && !generated.st)
+         continue;
+
+      generated_atoms = atoms_for_state(st, &generated);
+
+      /* Flags raised by an atom must only concern the atoms after it,
+       * or the atoms need to be reordered.
        */
-      struct st_state_flags examined, prev;      
-      memset(&examined, 0, sizeof(examined));
-      prev = *state;
-
-      for (i = 0; i < ARRAY_SIZE(atoms); i++) {	 
-	 const struct st_tracked_state *atom = atoms[i];
-	 struct st_state_flags generated;
-	 
-	 /*printf("atom %s %x/%x\n", atom->name, atom->dirty.mesa, atom->dirty.st);*/
-
-	 if (!(atom->dirty.mesa || atom->dirty.st) ||
-	     !atom->update) {
-	    printf("malformed atom %s\n", atom->name);
-	    assert(0);
-	 }
-
-	 if (check_state(state, &atom->dirty)) {
-	    atoms[i]->update( st );
-	    /*printf("after: %x\n", atom->dirty.mesa);*/
-	 }
-
-	 accumulate_state(&examined, &atom->dirty);
-
-	 /* generated = (prev ^ state)
-	  * if (examined & generated)
-	  *     fail;
-	  */
-	 xor_states(&generated, &prev, state);
-	 assert(!check_state(&examined, &generated));
-	 prev = *state;
-      }
-      /*printf("\n");*/
+      assert(!(generated_atoms & BITFIELD64_MASK(i + 1)));
 
-   }
-   else {
-      for (i = 0; i < ARRAY_SIZE(atoms); i++) {	 
-	 if (check_state(state, &atoms[i]->dirty))
-	    atoms[i]->update( st );
-      }
+      pending |= generated_atoms & ~BITFIELD64_MASK(i + 1);
    }
 
    memset(state, 0, sizeof(*state));
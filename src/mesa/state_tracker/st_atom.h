@@ -36,6 +36,7 @@
 
 #include "main/glheader.h"
 
+struct dd_function_table;
 struct st_context;
 struct st_tracked_state;
 
@@ -45,6 +46,8 @@ void st_destroy_atoms( struct st_context *st );
 
 void st_validate_state( struct st_context *st );
 
+void st_init_array_functions(struct dd_function_table *functions);
+
 
 extern const struct st_tracked_state st_update_array;
 extern const struct st_tracked_state st_update_framebuffer;
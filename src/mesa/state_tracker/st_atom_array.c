@@ -44,10 +44,39 @@
 
 #include "cso_cache/cso_context.h"
 #include "util/u_math.h"
+#include "main/arrayobj.h"
 #include "main/bufferobj.h"
 #include "main/glformats.h"
 
 
+/**
+ * Vertex array object that remembers the vertex elements last built from
+ * its arrays, so that drawing with it again doesn't translate them again.
+ */
+struct st_vertex_array_object
+{
+   struct gl_vertex_array_object Base;
+
+   /** Base.Generation that the vertex elements were built for, or ~0 */
+   GLuint generation;
+
+   /** The array that each vertex program input was read from */
+   const struct gl_client_array *inputs[PIPE_MAX_SHADER_INPUTS];
+   GLuint num_inputs;
+
+   GLboolean interleaved;
+   unsigned num_velements;
+   struct pipe_vertex_element velements[PIPE_MAX_ATTRIBS];
+};
+
+
+static inline struct st_vertex_array_object *
+st_vertex_array_object(struct gl_vertex_array_object *obj)
+{
+   return (struct st_vertex_array_object *) obj;
+}
+
+
 static GLuint double_types[4] = {
    PIPE_FORMAT_R64_FLOAT,
    PIPE_FORMAT_R64G64_FLOAT,
@@ -427,7 +456,7 @@ static void init_velement_lowered(struct st_context *st,
  * Set up for drawing interleaved arrays that all live in one VBO
  * or all live in user space.
  * \param vbuffer  returns vertex buffer info
- * \param velements  returns vertex element info
+ * \param velements  returns vertex element info, or NULL if already known
  */
 static boolean
 setup_interleaved_attribs(struct st_context *st,
@@ -481,32 +510,34 @@ setup_interleaved_attribs(struct st_context *st,
    /* are the arrays in user space? */
    usingVBO = _mesa_is_bufferobj(bufobj);
 
-   attr_idx = 0;
-   for (attr = 0; attr < vpv->num_inputs; attr++) {
-      const struct gl_client_array *array;
-      unsigned src_offset;
-      unsigned src_format;
+   if (velements) {
+      attr_idx = 0;
+      for (attr = 0; attr < vpv->num_inputs; attr++) {
+         const struct gl_client_array *array;
+         unsigned src_offset;
+         unsigned src_format;
 
-      array = get_client_array(vp, arrays, attr);
-      if (!array)
-         continue;
+         array = get_client_array(vp, arrays, attr);
+         if (!array)
+            continue;
 
-      src_offset = (unsigned) (array->Ptr - low_addr);
-      assert(array->_ElementSize ==
-             _mesa_bytes_per_vertex_attrib(array->Size, array->Type));
+         src_offset = (unsigned) (array->Ptr - low_addr);
+         assert(array->_ElementSize ==
+                _mesa_bytes_per_vertex_attrib(array->Size, array->Type));
 
-      src_format = st_pipe_vertex_format(array->Type,
-                                         array->Size,
-                                         array->Format,
-                                         array->Normalized,
-                                         array->Integer);
+         src_format = st_pipe_vertex_format(array->Type,
+                                            array->Size,
+                                            array->Format,
+                                            array->Normalized,
+                                            array->Integer);
 
-      init_velement_lowered(st, velements, src_offset, src_format,
-                            array->InstanceDivisor, 0,
-                            array->Size, array->Doubles, &attr_idx);
-   }
+         init_velement_lowered(st, velements, src_offset, src_format,
+                               array->InstanceDivisor, 0,
+                               array->Size, array->Doubles, &attr_idx);
+      }
 
-   *num_velements = attr_idx;
+      *num_velements = attr_idx;
+   }
 
    /*
     * Return the vbuffer info and setup user-space attrib info, if needed.
@@ -545,7 +576,7 @@ setup_interleaved_attribs(struct st_context *st,
  * Set up a separate pipe_vertex_buffer and pipe_vertex_element for each
  * vertex attribute.
  * \param vbuffer  returns vertex buffer info
- * \param velements  returns vertex element info
+ * \param velements  returns vertex element info, or NULL if already known
  */
 static boolean
 setup_non_interleaved_attribs(struct st_context *st,
@@ -617,6 +648,9 @@ setup_non_interleaved_attribs(struct st_context *st,
       /* common-case setup */
       vbuffer[attr].stride = stride; /* in bytes */
 
+      if (!velements)
+         continue;
+
       src_format = st_pipe_vertex_format(array->Type,
                                          array->Size,
                                          array->Format,
@@ -629,19 +663,86 @@ setup_non_interleaved_attribs(struct st_context *st,
 
    }
 
-   *num_velements = attr_idx;
+   if (velements)
+      *num_velements = attr_idx;
    return TRUE;
 }
 
+/**
+ * Whether the vertex elements saved in the VAO were built from the same
+ * arrays for the same vertex program inputs, and the arrays haven't
+ * changed since.
+ */
+static GLboolean
+vao_velements_are_current(const struct st_vertex_array_object *vao,
+                          const struct st_vertex_program *vp,
+                          const struct st_vp_variant *vpv,
+                          const struct gl_client_array **arrays)
+{
+   GLuint attr;
+
+   if (vao->generation != vao->Base.Generation ||
+       vao->num_inputs != vpv->num_inputs)
+      return GL_FALSE;
+
+   for (attr = 0; attr < vpv->num_inputs; attr++) {
+      if (get_client_array(vp, arrays, attr) != vao->inputs[attr])
+         return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+/**
+ * Save the vertex elements in the VAO, unless some of the arrays don't
+ * belong to it.  That happens for the current values of disabled arrays,
+ * which can change without the VAO knowing.
+ */
+static void
+save_vao_velements(struct st_vertex_array_object *vao,
+                   const struct st_vertex_program *vp,
+                   const struct st_vp_variant *vpv,
+                   const struct gl_client_array **arrays,
+                   GLboolean interleaved,
+                   const struct pipe_vertex_element *velements,
+                   unsigned num_velements)
+{
+   const struct gl_client_array *first = &vao->Base._VertexAttrib[0];
+   const struct gl_client_array *last =
+      &vao->Base._VertexAttrib[VERT_ATTRIB_MAX - 1];
+   GLuint attr;
+
+   for (attr = 0; attr < vpv->num_inputs; attr++) {
+      const struct gl_client_array *array = get_client_array(vp, arrays, attr);
+
+      if (array && (array < first || array > last))
+         return;
+   }
+
+   for (attr = 0; attr < vpv->num_inputs; attr++)
+      vao->inputs[attr] = get_client_array(vp, arrays, attr);
+
+   vao->generation = vao->Base.Generation;
+   vao->num_inputs = vpv->num_inputs;
+   vao->interleaved = interleaved;
+   vao->num_velements = num_velements;
+   memcpy(vao->velements, velements, num_velements * sizeof(*velements));
+}
+
 static void update_array(struct st_context *st)
 {
    struct gl_context *ctx = st->ctx;
    const struct gl_client_array **arrays = ctx->Array._DrawArrays;
+   struct st_vertex_array_object *vao =
+      st_vertex_array_object(ctx->Array.VAO);
    const struct st_vertex_program *vp;
    const struct st_vp_variant *vpv;
    struct pipe_vertex_buffer vbuffer[PIPE_MAX_SHADER_INPUTS];
    struct pipe_vertex_element velements[PIPE_MAX_ATTRIBS];
+   struct pipe_vertex_element *new_velements = velements;
+   const struct pipe_vertex_element *set_velements = velements;
    unsigned num_vbuffers, num_velements;
+   GLboolean interleaved;
 
    st->vertex_array_out_of_memory = FALSE;
 
@@ -653,13 +754,27 @@ static void update_array(struct st_context *st)
    vp = st->vp;
    vpv = st->vp_variant;
 
-   memset(velements, 0, sizeof(struct pipe_vertex_element) * vpv->num_inputs);
+   /* Drawing again with the same VAO and inputs only needs the vertex
+    * buffers to be set up again, since their storage may have changed.
+    */
+   if (vao_velements_are_current(vao, vp, vpv, arrays)) {
+      interleaved = vao->interleaved;
+      num_velements = vao->num_velements;
+      set_velements = vao->velements;
+      new_velements = NULL;
+   }
+   else {
+      memset(velements, 0,
+             sizeof(struct pipe_vertex_element) * vpv->num_inputs);
+      interleaved = is_interleaved_arrays(vp, vpv, arrays);
+   }
 
    /*
     * Setup the vbuffer[] and velements[] arrays.
     */
-   if (is_interleaved_arrays(vp, vpv, arrays)) {
-      if (!setup_interleaved_attribs(st, vp, vpv, arrays, vbuffer, velements, &num_velements)) {
+   if (interleaved) {
+      if (!setup_interleaved_attribs(st, vp, vpv, arrays, vbuffer,
+                                     new_velements, &num_velements)) {
          st->vertex_array_out_of_memory = TRUE;
          return;
       }
@@ -670,7 +785,7 @@ static void update_array(struct st_context *st)
    }
    else {
       if (!setup_non_interleaved_attribs(st, vp, vpv, arrays, vbuffer,
-                                         velements, &num_velements)) {
+                                         new_velements, &num_velements)) {
          st->vertex_array_out_of_memory = TRUE;
          return;
       }
@@ -678,6 +793,10 @@ static void update_array(struct st_context *st)
       num_vbuffers = vpv->num_inputs;
    }
 
+   if (new_velements)
+      save_vao_velements(vao, vp, vpv, arrays, interleaved,
+                         velements, num_velements);
+
    cso_set_vertex_buffers(st->cso_context, 0, num_vbuffers, vbuffer);
    if (st->last_num_vbuffers > num_vbuffers) {
       /* Unbind remaining buffers, if any. */
@@ -685,7 +804,31 @@ static void update_array(struct st_context *st)
                              st->last_num_vbuffers - num_vbuffers, NULL);
    }
    st->last_num_vbuffers = num_vbuffers;
-   cso_set_vertex_elements(st->cso_context, num_velements, velements);
+   cso_set_vertex_elements(st->cso_context, num_velements, set_velements);
+}
+
+
+static struct gl_vertex_array_object *
+st_new_vao(struct gl_context *ctx, GLuint name)
+{
+   struct st_vertex_array_object *obj =
+      ST_CALLOC_STRUCT(st_vertex_array_object);
+
+   if (!obj)
+      return NULL;
+
+   _mesa_initialize_vao(ctx, &obj->Base, name);
+   obj->generation = ~0;
+
+   return &obj->Base;
+}
+
+
+void
+st_init_array_functions(struct dd_function_table *functions)
+{
+   functions->NewArrayObject = st_new_vao;
+   functions->DeleteArrayObject = _mesa_delete_vao;
 }
 
 
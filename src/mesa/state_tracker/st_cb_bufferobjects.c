@@ -37,6 +37,7 @@
 #include "main/mtypes.h"
 #include "main/arrayobj.h"
 #include "main/bufferobj.h"
+#include "vbo/vbo.h"
 
 #include "st_context.h"
 #include "st_cb_bufferobjects.h"
@@ -79,6 +80,7 @@ st_bufferobj_free(struct gl_context *ctx, struct gl_buffer_object *obj)
 
    assert(obj->RefCount == 0);
    _mesa_buffer_unmap_all_mappings(ctx, obj);
+   vbo_delete_minmax_cache(obj);
 
    if (st_obj->buffer)
       pipe_resource_reference(&st_obj->buffer, NULL);
@@ -172,10 +172,12 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
     * glClear, etc.
     */
    st->uploader = u_upload_create(st->pipe, 65536, 4, PIPE_BIND_VERTEX_BUFFER);
+   u_upload_enable_ring(st->uploader, 4);
 
    if (!screen->get_param(screen, PIPE_CAP_USER_INDEX_BUFFERS)) {
       st->indexbuf_uploader = u_upload_create(st->pipe, 128 * 1024, 4,
                                               PIPE_BIND_INDEX_BUFFER);
+      u_upload_enable_ring(st->indexbuf_uploader, 4);
    }
 
    if (!screen->get_param(screen, PIPE_CAP_USER_CONSTANT_BUFFERS)) {
@@ -184,6 +186,7 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
 
       st->constbuf_uploader = u_upload_create(pipe, 128 * 1024, alignment,
                                               PIPE_BIND_CONSTANT_BUFFER);
+      u_upload_enable_ring(st->constbuf_uploader, 4);
    }
 
    st->cso_context = cso_create_context(pipe);
@@ -292,6 +295,9 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
          ctx->Const.ShaderCompilerOptions[i].EmitNoIndirectSampler = true;
    }
 
+   /* st_context_flush() finishes the glthread worker. */
+   ctx->Const.GLThreadSupported = GL_TRUE;
+
    _mesa_compute_version(ctx);
 
    if (ctx->Version == 0) {
@@ -320,7 +326,8 @@ static void st_init_driver_flags(struct gl_driver_flags *f)
 struct st_context *st_create_context(gl_api api, struct pipe_context *pipe,
                                      const struct gl_config *visual,
                                      struct st_context *share,
-                                     const struct st_config_options *options)
+                                     const struct st_config_options *options,
+                                     GLbitfield context_flags)
 {
    struct gl_context *ctx;
    struct gl_context *shareCtx = share ? share->ctx : NULL;
@@ -337,6 +344,11 @@ struct st_context *st_create_context(gl_api api, struct pipe_context *pipe,
 
    st_init_driver_flags(&ctx->DriverFlags);
 
+   /* These must be set before the dispatch tables are initialized, which
+    * picks the validation-free entry points for no-error contexts.
+    */
+   ctx->Const.ContextFlags |= context_flags;
+
    /* XXX: need a capability bit in gallium to query if the pipe
     * driver prefers DP4 or MUL/MAD for vertex transformation.
     */
@@ -410,6 +422,7 @@ void st_init_driver_functions(struct pipe_screen *screen,
    _mesa_init_shader_object_functions(functions);
    _mesa_init_sampler_object_functions(functions);
 
+   st_init_array_functions(functions);
    st_init_blit_functions(functions);
    st_init_bufferobject_functions(functions);
    st_init_clear_functions(functions);
@@ -141,6 +141,10 @@ struct st_context
 
    struct st_state_flags dirty;
 
+   /** Masks of the atoms (bit i = atoms[i]) that depend on each dirty bit */
+   uint64_t atoms_for_mesa_flag[32];
+   uint64_t atoms_for_st_flag[64];
+
    GLboolean vertdata_edgeflags;
    GLboolean edgeflag_culls_prims;
 
@@ -303,7 +307,8 @@ extern struct st_context *
 st_create_context(gl_api api, struct pipe_context *pipe,
                   const struct gl_config *visual,
                   struct st_context *share,
-                  const struct st_config_options *options);
+                  const struct st_config_options *options,
+                  GLbitfield context_flags);
 
 extern void
 st_destroy_context(struct st_context *st);
@@ -42,6 +42,7 @@
 #include "program/prog_instruction.h"
 #include "program/sampler.h"
 
+#include "os/os_time.h"
 #include "pipe/p_context.h"
 #include "pipe/p_screen.h"
 #include "tgsi/tgsi_ureg.h"
@@ -336,8 +337,9 @@ struct array_decl {
    unsigned array_size;
 };
 
+/* Rename table for rename_temp_registers(), indexed by the old register. */
 struct rename_reg_pair {
-   int old_reg;
+   bool valid;
    int new_reg;
 };
 
@@ -484,10 +486,9 @@ public:
 
    void simplify_cmp(void);
 
-   void rename_temp_registers(int num_renames, struct rename_reg_pair *renames);
-   void get_first_temp_read(int *first_reads);
-   void get_last_temp_read_first_temp_write(int *last_reads, int *first_writes);
-   void get_last_temp_write(int *last_writes);
+   void rename_temp_registers(struct rename_reg_pair *renames);
+   void get_temp_live_ranges(int *first_reads, int *last_reads,
+                             int *first_writes, int *last_writes);
 
    void copy_propagate(void);
    int eliminate_dead_code(void);
@@ -3701,131 +3702,129 @@ glsl_to_tgsi_visitor::simplify_cmp(void)
 
 /* Replaces all references to a temporary register index with another index. */
 void
-glsl_to_tgsi_visitor::rename_temp_registers(int num_renames, struct rename_reg_pair *renames)
+glsl_to_tgsi_visitor::rename_temp_registers(struct rename_reg_pair *renames)
 {
    foreach_in_list(glsl_to_tgsi_instruction, inst, &this->instructions) {
       unsigned j;
-      int k;
       for (j = 0; j < num_inst_src_regs(inst); j++) {
-         if (inst->src[j].file == PROGRAM_TEMPORARY)
-            for (k = 0; k < num_renames; k++)
-               if (inst->src[j].index == renames[k].old_reg)
-                  inst->src[j].index = renames[k].new_reg;
+         if (inst->src[j].file == PROGRAM_TEMPORARY &&
+             renames[inst->src[j].index].valid)
+            inst->src[j].index = renames[inst->src[j].index].new_reg;
       }
 
       for (j = 0; j < inst->tex_offset_num_offset; j++) {
-         if (inst->tex_offsets[j].file == PROGRAM_TEMPORARY)
-            for (k = 0; k < num_renames; k++)
-               if (inst->tex_offsets[j].index == renames[k].old_reg)
-                  inst->tex_offsets[j].index = renames[k].new_reg;
+         if (inst->tex_offsets[j].file == PROGRAM_TEMPORARY &&
+             renames[inst->tex_offsets[j].index].valid)
+            inst->tex_offsets[j].index =
+               renames[inst->tex_offsets[j].index].new_reg;
       }
 
       for (j = 0; j < num_inst_dst_regs(inst); j++) {
-         if (inst->dst[j].file == PROGRAM_TEMPORARY)
-             for (k = 0; k < num_renames; k++)
-                if (inst->dst[j].index == renames[k].old_reg)
-                   inst->dst[j].index = renames[k].new_reg;
+         if (inst->dst[j].file == PROGRAM_TEMPORARY &&
+             renames[inst->dst[j].index].valid)
+            inst->dst[j].index = renames[inst->dst[j].index].new_reg;
       }
    }
 }
 
-void
-glsl_to_tgsi_visitor::get_first_temp_read(int *first_reads)
+/* Records a read of temporary \p index by instruction \p i.  Inside a loop
+ * the read is attributed to the start of the outermost loop (first read) or
+ * to its end (last read), which is filled in by end_loop_live_ranges().
+ */
+static inline void
+record_temp_read(int index, int i, int loop_start,
+                 int *first_reads, int *last_reads,
+                 int *loop_temps, int *num_loop_temps)
 {
-   int depth = 0; /* loop depth */
-   int loop_start = -1; /* index of the first active BGNLOOP (if any) */
-   unsigned i = 0, j;
+   if (first_reads[index] == -1)
+      first_reads[index] = (loop_start == -1) ? i : loop_start;
 
-   foreach_in_list(glsl_to_tgsi_instruction, inst, &this->instructions) {
-      for (j = 0; j < num_inst_src_regs(inst); j++) {
-         if (inst->src[j].file == PROGRAM_TEMPORARY) {
-            if (first_reads[inst->src[j].index] == -1)
-                first_reads[inst->src[j].index] = (depth == 0) ? i : loop_start;
-         }
-      }
-      for (j = 0; j < inst->tex_offset_num_offset; j++) {
-         if (inst->tex_offsets[j].file == PROGRAM_TEMPORARY) {
-            if (first_reads[inst->tex_offsets[j].index] == -1)
-               first_reads[inst->tex_offsets[j].index] = (depth == 0) ? i : loop_start;
-         }
-      }
-      if (inst->op == TGSI_OPCODE_BGNLOOP) {
-         if(depth++ == 0)
-            loop_start = i;
-      } else if (inst->op == TGSI_OPCODE_ENDLOOP) {
-         if (--depth == 0)
-            loop_start = -1;
-      }
-      assert(depth >= 0);
-      i++;
+   if (loop_start == -1) {
+      last_reads[index] = i;
+   } else if (last_reads[index] != -2) {
+      last_reads[index] = -2;
+      loop_temps[(*num_loop_temps)++] = index;
    }
 }
 
+/* Computes, in a single walk over the instructions, the index of the first
+ * and last read and write of every temporary register.  Accesses inside a
+ * loop are treated as happening anywhere in the outermost loop.  Unused
+ * entries are left at -1.
+ */
 void
-glsl_to_tgsi_visitor::get_last_temp_read_first_temp_write(int *last_reads, int *first_writes)
+glsl_to_tgsi_visitor::get_temp_live_ranges(int *first_reads, int *last_reads,
+                                           int *first_writes, int *last_writes)
 {
    int depth = 0; /* loop depth */
    int loop_start = -1; /* index of the first active BGNLOOP (if any) */
-   unsigned i = 0, j;
-   int k;
+   int i = 0, k;
+   unsigned j;
+
+   /* Temporaries read or written in the current outermost loop, whose last
+    * access is moved to its ENDLOOP.  Each temporary is listed once per
+    * array since its entry is -2 until the loop ends.
+    */
+   int *loop_reads = ralloc_array(mem_ctx, int, this->next_temp);
+   int *loop_writes = ralloc_array(mem_ctx, int, this->next_temp);
+   int num_loop_reads = 0, num_loop_writes = 0;
+
+   for (k = 0; k < this->next_temp; k++) {
+      first_reads[k] = -1;
+      last_reads[k] = -1;
+      first_writes[k] = -1;
+      last_writes[k] = -1;
+   }
+
    foreach_in_list(glsl_to_tgsi_instruction, inst, &this->instructions) {
       for (j = 0; j < num_inst_src_regs(inst); j++) {
          if (inst->src[j].file == PROGRAM_TEMPORARY)
-            last_reads[inst->src[j].index] = (depth == 0) ? i : -2;
-      }
-      for (j = 0; j < num_inst_dst_regs(inst); j++) {
-         if (inst->dst[j].file == PROGRAM_TEMPORARY)
-            if (first_writes[inst->dst[j].index] == -1)
-               first_writes[inst->dst[j].index] = (depth == 0) ? i : loop_start;
+            record_temp_read(inst->src[j].index, i, loop_start,
+                             first_reads, last_reads,
+                             loop_reads, &num_loop_reads);
       }
       for (j = 0; j < inst->tex_offset_num_offset; j++) {
          if (inst->tex_offsets[j].file == PROGRAM_TEMPORARY)
-            last_reads[inst->tex_offsets[j].index] = (depth == 0) ? i : -2;
+            record_temp_read(inst->tex_offsets[j].index, i, loop_start,
+                             first_reads, last_reads,
+                             loop_reads, &num_loop_reads);
       }
+      for (j = 0; j < num_inst_dst_regs(inst); j++) {
+         if (inst->dst[j].file != PROGRAM_TEMPORARY)
+            continue;
+
+         const int index = inst->dst[j].index;
+         if (first_writes[index] == -1)
+            first_writes[index] = (depth == 0) ? i : loop_start;
+
+         if (depth == 0) {
+            last_writes[index] = i;
+         } else if (last_writes[index] != -2) {
+            last_writes[index] = -2;
+            loop_writes[num_loop_writes++] = index;
+         }
+      }
+
       if (inst->op == TGSI_OPCODE_BGNLOOP) {
          if(depth++ == 0)
             loop_start = i;
       } else if (inst->op == TGSI_OPCODE_ENDLOOP) {
          if (--depth == 0) {
             loop_start = -1;
-            for (k = 0; k < this->next_temp; k++) {
-               if (last_reads[k] == -2) {
-                  last_reads[k] = i;
-               }
-            }
+            for (k = 0; k < num_loop_reads; k++)
+               last_reads[loop_reads[k]] = i;
+            for (k = 0; k < num_loop_writes; k++)
+               last_writes[loop_writes[k]] = i;
+            num_loop_reads = 0;
+            num_loop_writes = 0;
          }
       }
       assert(depth >= 0);
       i++;
    }
-}
 
-void
-glsl_to_tgsi_visitor::get_last_temp_write(int *last_writes)
-{
-   int depth = 0; /* loop depth */
-   int i = 0, k;
-   unsigned j;
-
-   foreach_in_list(glsl_to_tgsi_instruction, inst, &this->instructions) {
-      for (j = 0; j < num_inst_dst_regs(inst); j++) {
-         if (inst->dst[j].file == PROGRAM_TEMPORARY)
-            last_writes[inst->dst[j].index] = (depth == 0) ? i : -2;
-      }
-
-      if (inst->op == TGSI_OPCODE_BGNLOOP)
-         depth++;
-      else if (inst->op == TGSI_OPCODE_ENDLOOP)
-         if (--depth == 0) {
-            for (k = 0; k < this->next_temp; k++) {
-               if (last_writes[k] == -2) {
-                  last_writes[k] = i;
-               }
-            }
-         }
-      assert(depth >= 0);
-      i++;
-   }
+   ralloc_free(loop_reads);
+   ralloc_free(loop_writes);
 }
 
 /*
@@ -4244,63 +4243,119 @@ glsl_to_tgsi_visitor::merge_two_dsts(void)
    }
 }
 
+struct temp_live_range {
+   int index;
+   int begin; /* first write */
+   int end;   /* last read */
+};
+
+static int
+compare_live_range_begin(const void *a, const void *b)
+{
+   const struct temp_live_range *ra = (const struct temp_live_range *) a;
+   const struct temp_live_range *rb = (const struct temp_live_range *) b;
+
+   if (ra->begin != rb->begin)
+      return ra->begin - rb->begin;
+   return ra->index - rb->index;
+}
+
+/* Binary min-heap of live ranges ordered by their end. */
+static void
+live_range_heap_push(struct temp_live_range *heap, int *size,
+                     struct temp_live_range range)
+{
+   int i = (*size)++;
+
+   while (i > 0 && heap[(i - 1) / 2].end > range.end) {
+      heap[i] = heap[(i - 1) / 2];
+      i = (i - 1) / 2;
+   }
+   heap[i] = range;
+}
+
+static struct temp_live_range
+live_range_heap_pop(struct temp_live_range *heap, int *size)
+{
+   struct temp_live_range top = heap[0];
+   struct temp_live_range last = heap[--(*size)];
+   int i = 0;
+
+   while (2 * i + 1 < *size) {
+      int child = 2 * i + 1;
+
+      if (child + 1 < *size && heap[child + 1].end < heap[child].end)
+         child++;
+      if (last.end <= heap[child].end)
+         break;
+      heap[i] = heap[child];
+      i = child;
+   }
+   heap[i] = last;
+
+   return top;
+}
+
 /* Merges temporary registers together where possible to reduce the number of
  * registers needed to run a program.
  *
+ * This is a linear scan over the live ranges sorted by their first write: a
+ * temporary takes over the register whose last read is earliest, if that
+ * read is no later than the temporary's first write.
+ *
  * Produces optimal code only after copy propagation and dead code elimination
  * have been run. */
 void
 glsl_to_tgsi_visitor::merge_registers(void)
 {
-   int *last_reads = rzalloc_array(mem_ctx, int, this->next_temp);
-   int *first_writes = rzalloc_array(mem_ctx, int, this->next_temp);
+   int *first_reads = ralloc_array(mem_ctx, int, this->next_temp);
+   int *last_reads = ralloc_array(mem_ctx, int, this->next_temp);
+   int *first_writes = ralloc_array(mem_ctx, int, this->next_temp);
+   int *last_writes = ralloc_array(mem_ctx, int, this->next_temp);
    struct rename_reg_pair *renames = rzalloc_array(mem_ctx, struct rename_reg_pair, this->next_temp);
-   int i, j;
-   int num_renames = 0;
+   struct temp_live_range *ranges = ralloc_array(mem_ctx, struct temp_live_range, this->next_temp);
+   struct temp_live_range *active = ralloc_array(mem_ctx, struct temp_live_range, this->next_temp);
+   int num_ranges = 0, num_active = 0;
+   int i;
 
-   /* Read the indices of the last read and first write to each temp register
-    * into an array so that we don't have to traverse the instruction list as
-    * much. */
-   for (i = 0; i < this->next_temp; i++) {
-      last_reads[i] = -1;
-      first_writes[i] = -1;
-   }
-   get_last_temp_read_first_temp_write(last_reads, first_writes);
+   get_temp_live_ranges(first_reads, last_reads, first_writes, last_writes);
 
-   /* Start looking for registers with non-overlapping usages that can be
-    * merged together. */
    for (i = 0; i < this->next_temp; i++) {
       /* Don't touch unused registers. */
       if (last_reads[i] < 0 || first_writes[i] < 0) continue;
 
-      for (j = 0; j < this->next_temp; j++) {
-         /* Don't touch unused registers. */
-         if (last_reads[j] < 0 || first_writes[j] < 0) continue;
-
-         /* We can merge the two registers if the first write to j is after or
-          * in the same instruction as the last read from i.  Note that the
-          * register at index i will always be used earlier or at the same time
-          * as the register at index j. */
-         if (first_writes[i] <= first_writes[j] &&
-             last_reads[i] <= first_writes[j]) {
-            renames[num_renames].old_reg = j;
-            renames[num_renames].new_reg = i;
-            num_renames++;
-
-            /* Update the first_writes and last_reads arrays with the new
-             * values for the merged register index, and mark the newly unused
-             * register index as such. */
-            last_reads[i] = last_reads[j];
-            first_writes[j] = -1;
-            last_reads[j] = -1;
-         }
+      ranges[num_ranges].index = i;
+      ranges[num_ranges].begin = first_writes[i];
+      ranges[num_ranges].end = last_reads[i];
+      num_ranges++;
+   }
+
+   qsort(ranges, num_ranges, sizeof(*ranges), compare_live_range_begin);
+
+   for (i = 0; i < num_ranges; i++) {
+      struct temp_live_range range = ranges[i];
+
+      /* The first write may be in the same instruction as the last read of
+       * the register being reused. */
+      if (num_active > 0 && active[0].end <= range.begin) {
+         struct temp_live_range freed = live_range_heap_pop(active, &num_active);
+
+         renames[range.index].valid = true;
+         renames[range.index].new_reg = freed.index;
+         range.index = freed.index;
       }
+
+      live_range_heap_push(active, &num_active, range);
    }
 
-   rename_temp_registers(num_renames, renames);
+   rename_temp_registers(renames);
+   ralloc_free(active);
+   ralloc_free(ranges);
    ralloc_free(renames);
+   ralloc_free(first_reads);
    ralloc_free(last_reads);
    ralloc_free(first_writes);
+   ralloc_free(last_writes);
 }
 
 /* Reassign indices to temporary registers by reusing unused indices created
@@ -4310,28 +4365,30 @@ glsl_to_tgsi_visitor::renumber_registers(void)
 {
    int i = 0;
    int new_index = 0;
-   int *first_reads = rzalloc_array(mem_ctx, int, this->next_temp);
+   int *first_reads = ralloc_array(mem_ctx, int, this->next_temp);
+   int *last_reads = ralloc_array(mem_ctx, int, this->next_temp);
+   int *first_writes = ralloc_array(mem_ctx, int, this->next_temp);
+   int *last_writes = ralloc_array(mem_ctx, int, this->next_temp);
    struct rename_reg_pair *renames = rzalloc_array(mem_ctx, struct rename_reg_pair, this->next_temp);
-   int num_renames = 0;
-   for (i = 0; i < this->next_temp; i++) {
-      first_reads[i] = -1;
-   }
-   get_first_temp_read(first_reads);
+
+   get_temp_live_ranges(first_reads, last_reads, first_writes, last_writes);
 
    for (i = 0; i < this->next_temp; i++) {
       if (first_reads[i] < 0) continue;
       if (i != new_index) {
-         renames[num_renames].old_reg = i;
-         renames[num_renames].new_reg = new_index;
-         num_renames++;
+         renames[i].valid = true;
+         renames[i].new_reg = new_index;
       }
       new_index++;
    }
 
-   rename_temp_registers(num_renames, renames);
+   rename_temp_registers(renames);
    this->next_temp = new_index;
    ralloc_free(renames);
    ralloc_free(first_reads);
+   ralloc_free(last_reads);
+   ralloc_free(first_writes);
+   ralloc_free(last_writes);
 }
 
 /* ------------------------- TGSI conversion stuff -------------------------- */
@@ -5566,15 +5623,8 @@ get_mesa_program(struct gl_context *ctx,
       int *last_writes = rzalloc_array(v->mem_ctx, int, v->next_temp);
       int *last_reads = rzalloc_array(v->mem_ctx, int, v->next_temp);
 
-      for (i = 0; i < v->next_temp; i++) {
-         first_writes[i] = -1;
-         first_reads[i] = -1;
-         last_writes[i] = -1;
-         last_reads[i] = -1;
-      }
-      v->get_first_temp_read(first_reads);
-      v->get_last_temp_read_first_temp_write(last_reads, first_writes);
-      v->get_last_temp_write(last_writes);
+      v->get_temp_live_ranges(first_reads, last_reads, first_writes,
+                              last_writes);
       for (i = 0; i < v->next_temp; i++)
          printf("Temp %d: FR=%3d FW=%3d LR=%3d LW=%3d\n", i, first_reads[i],
                 first_writes[i],
@@ -5587,6 +5637,10 @@ get_mesa_program(struct gl_context *ctx,
    }
 #endif
 
+   const bool print_stats = ctx->_Shader->Flags & GLSL_STATS;
+   const int num_temps = v->next_temp;
+   const int64_t start_time = print_stats ? os_time_get_nano() : 0;
+
    /* Perform optimizations on the instructions in the glsl_to_tgsi_visitor. */
    v->simplify_cmp();
 
@@ -5600,6 +5654,14 @@ get_mesa_program(struct gl_context *ctx,
    v->merge_registers();
    v->renumber_registers();
 
+   if (print_stats) {
+      _mesa_log("%s shader of program %u: %d -> %d temporaries, "
+                "%.3f ms in TGSI optimizations\n",
+                _mesa_shader_stage_to_string(shader->Stage),
+                shader_program->Name, num_temps, v->next_temp,
+                (os_time_get_nano() - start_time) / 1000000.0);
+   }
+
    /* Write the END instruction. */
    v->emit_asm(NULL, TGSI_OPCODE_END);
 
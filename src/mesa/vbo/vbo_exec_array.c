@@ -37,8 +37,6 @@
 #include "main/enums.h"
 #include "main/macros.h"
 #include "main/transformfeedback.h"
-#include "main/sse_minmax.h"
-#include "x86/common_x86_asm.h"
 
 #include "vbo_context.h"
 
@@ -81,151 +79,6 @@ vbo_check_buffers_are_unmapped(struct gl_context *ctx)
 
 
 
-/**
- * Compute min and max elements by scanning the index buffer for
- * glDraw[Range]Elements() calls.
- * If primitive restart is enabled, we need to ignore restart
- * indexes when computing min/max.
- */
-static void
-vbo_get_minmax_index(struct gl_context *ctx,
-		     const struct _mesa_prim *prim,
-		     const struct _mesa_index_buffer *ib,
-		     GLuint *min_index, GLuint *max_index,
-		     const GLuint count)
-{
-   const GLboolean restart = ctx->Array._PrimitiveRestart;
-   const GLuint restartIndex = _mesa_primitive_restart_index(ctx, ib->type);
-   const int index_size = vbo_sizeof_ib_type(ib->type);
-   const char *indices;
-   GLuint i;
-
-   indices = (char *) ib->ptr + prim->start * index_size;
-   if (_mesa_is_bufferobj(ib->obj)) {
-      GLsizeiptr size = MIN2(count * index_size, ib->obj->Size);
-      indices = ctx->Driver.MapBufferRange(ctx, (GLintptr) indices, size,
-                                           GL_MAP_READ_BIT, ib->obj,
-                                           MAP_INTERNAL);
-   }
-
-   switch (ib->type) {
-   case GL_UNSIGNED_INT: {
-      const GLuint *ui_indices = (const GLuint *)indices;
-      GLuint max_ui = 0;
-      GLuint min_ui = ~0U;
-      if (restart) {
-         for (i = 0; i < count; i++) {
-            if (ui_indices[i] != restartIndex) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
-         }
-      }
-      else {
-#if defined(USE_SSE41)
-         if (cpu_has_sse4_1) {
-            _mesa_uint_array_min_max(ui_indices, &min_ui, &max_ui, count);
-         }
-         else
-#endif
-            for (i = 0; i < count; i++) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
-      }
-      *min_index = min_ui;
-      *max_index = max_ui;
-      break;
-   }
-   case GL_UNSIGNED_SHORT: {
-      const GLushort *us_indices = (const GLushort *)indices;
-      GLuint max_us = 0;
-      GLuint min_us = ~0U;
-      if (restart) {
-         for (i = 0; i < count; i++) {
-            if (us_indices[i] != restartIndex) {
-               if (us_indices[i] > max_us) max_us = us_indices[i];
-               if (us_indices[i] < min_us) min_us = us_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (us_indices[i] > max_us) max_us = us_indices[i];
-            if (us_indices[i] < min_us) min_us = us_indices[i];
-         }
-      }
-      *min_index = min_us;
-      *max_index = max_us;
-      break;
-   }
-   case GL_UNSIGNED_BYTE: {
-      const GLubyte *ub_indices = (const GLubyte *)indices;
-      GLuint max_ub = 0;
-      GLuint min_ub = ~0U;
-      if (restart) {
-         for (i = 0; i < count; i++) {
-            if (ub_indices[i] != restartIndex) {
-               if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-               if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-            if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-         }
-      }
-      *min_index = min_ub;
-      *max_index = max_ub;
-      break;
-   }
-   default:
-      unreachable("not reached");
-   }
-
-   if (_mesa_is_bufferobj(ib->obj)) {
-      ctx->Driver.UnmapBuffer(ctx, ib->obj, MAP_INTERNAL);
-   }
-}
-
-/**
- * Compute min and max elements for nr_prims
- */
-void
-vbo_get_minmax_indices(struct gl_context *ctx,
-                       const struct _mesa_prim *prims,
-                       const struct _mesa_index_buffer *ib,
-                       GLuint *min_index,
-                       GLuint *max_index,
-                       GLuint nr_prims)
-{
-   GLuint tmp_min, tmp_max;
-   GLuint i;
-   GLuint count;
-
-   *min_index = ~0;
-   *max_index = 0;
-
-   for (i = 0; i < nr_prims; i++) {
-      const struct _mesa_prim *start_prim;
-
-      start_prim = &prims[i];
-      count = start_prim->count;
-      /* Do combination if possible to reduce map/unmap count */
-      while ((i + 1 < nr_prims) &&
-             (prims[i].start + prims[i].count == prims[i+1].start)) {
-         count += prims[i+1].count;
-         i++;
-      }
-      vbo_get_minmax_index(ctx, start_prim, ib, &tmp_min, &tmp_max, count);
-      *min_index = MIN2(*min_index, tmp_min);
-      *max_index = MAX2(*max_index, tmp_max);
-   }
-}
-
-
 /**
  * Check that element 'j' of the array has reasonable data.
  * Map VBO if needed.
@@ -999,14 +852,15 @@ vbo_validated_drawrangeelements(struct gl_context *ctx, GLenum mode,
 
 
 /**
- * Called by glDrawRangeElementsBaseVertex() in immediate mode.
+ * Draws for glDrawRangeElementsBaseVertex() once the parameters have been
+ * validated, ignoring the range if it can't be right.
  */
-static void GLAPIENTRY
-vbo_exec_DrawRangeElementsBaseVertex(GLenum mode,
-				     GLuint start, GLuint end,
-				     GLsizei count, GLenum type,
-				     const GLvoid *indices,
-				     GLint basevertex)
+static void
+vbo_draw_range_elements_base_vertex(struct gl_context *ctx, GLenum mode,
+                                    GLuint start, GLuint end,
+                                    GLsizei count, GLenum type,
+                                    const GLvoid *indices,
+                                    GLint basevertex)
 {
    static GLuint warnCount = 0;
    GLboolean index_bounds_valid = GL_TRUE;
@@ -1016,18 +870,6 @@ vbo_exec_DrawRangeElementsBaseVertex(GLenum mode,
     */
    GLuint max_element = 2 * 1000 * 1000 * 1000; /* just a big number */
 
-   GET_CURRENT_CONTEXT(ctx);
-
-   if (MESA_VERBOSE & VERBOSE_DRAW)
-      _mesa_debug(ctx,
-                "glDrawRangeElementsBaseVertex(%s, %u, %u, %d, %s, %p, %d)\n",
-                _mesa_enum_to_string(mode), start, end, count,
-                _mesa_enum_to_string(type), indices, basevertex);
-
-   if (!_mesa_validate_DrawRangeElements(ctx, mode, start, end, count,
-                                         type, indices))
-      return;
-
    if ((int) end + basevertex < 0 ||
        start + basevertex >= max_element) {
       /* The application requested we draw using a range of indices that's
@@ -1088,6 +930,33 @@ vbo_exec_DrawRangeElementsBaseVertex(GLenum mode,
 }
 
 
+/**
+ * Called by glDrawRangeElementsBaseVertex() in immediate mode.
+ */
+static void GLAPIENTRY
+vbo_exec_DrawRangeElementsBaseVertex(GLenum mode,
+				     GLuint start, GLuint end,
+				     GLsizei count, GLenum type,
+				     const GLvoid *indices,
+				     GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   if (MESA_VERBOSE & VERBOSE_DRAW)
+      _mesa_debug(ctx,
+                "glDrawRangeElementsBaseVertex(%s, %u, %u, %d, %s, %p, %d)\n",
+                _mesa_enum_to_string(mode), start, end, count,
+                _mesa_enum_to_string(type), indices, basevertex);
+
+   if (!_mesa_validate_DrawRangeElements(ctx, mode, start, end, count,
+                                         type, indices))
+      return;
+
+   vbo_draw_range_elements_base_vertex(ctx, mode, start, end, count, type,
+                                       indices, basevertex);
+}
+
+
 /**
  * Called by glDrawRangeElements() in immediate mode.
  */
@@ -1785,6 +1654,113 @@ vbo_exec_MultiDrawElementsIndirect(GLenum mode, GLenum type,
                                            primcount, stride);
 }
 
+/**
+ * \name Draw entry points for KHR_no_error contexts.
+ *
+ * The application promises that draws are valid, so these skip the
+ * _mesa_validate_*() calls and only prepare the context for drawing.
+ * Empty draws are still dropped, as the drivers don't expect them.
+ */
+/*@{*/
+
+static void GLAPIENTRY
+vbo_exec_DrawArrays_no_error(GLenum mode, GLint start, GLsizei count)
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   if (!_mesa_prepare_draw_no_error(ctx) || count == 0)
+      return;
+
+   vbo_draw_arrays(ctx, mode, start, count, 1, 0);
+}
+
+
+static void GLAPIENTRY
+vbo_exec_DrawArraysInstanced_no_error(GLenum mode, GLint start,
+                                      GLsizei count, GLsizei numInstances)
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   if (!_mesa_prepare_draw_no_error(ctx) || count == 0 || numInstances == 0)
+      return;
+
+   vbo_draw_arrays(ctx, mode, start, count, numInstances, 0);
+}
+
+
+static void GLAPIENTRY
+vbo_exec_DrawElements_no_error(GLenum mode, GLsizei count, GLenum type,
+                               const GLvoid *indices)
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   if (!_mesa_prepare_draw_no_error(ctx) || count == 0)
+      return;
+
+   vbo_validated_drawrangeelements(ctx, mode, GL_FALSE, ~0, ~0,
+				   count, type, indices, 0, 1, 0);
+}
+
+
+static void GLAPIENTRY
+vbo_exec_DrawElementsBaseVertex_no_error(GLenum mode, GLsizei count,
+                                         GLenum type, const GLvoid *indices,
+                                         GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   if (!_mesa_prepare_draw_no_error(ctx) || count == 0)
+      return;
+
+   vbo_validated_drawrangeelements(ctx, mode, GL_FALSE, ~0, ~0,
+				   count, type, indices, basevertex, 1, 0);
+}
+
+
+static void GLAPIENTRY
+vbo_exec_DrawRangeElementsBaseVertex_no_error(GLenum mode,
+                                              GLuint start, GLuint end,
+                                              GLsizei count, GLenum type,
+                                              const GLvoid *indices,
+                                              GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   if (!_mesa_prepare_draw_no_error(ctx) || count == 0)
+      return;
+
+   vbo_draw_range_elements_base_vertex(ctx, mode, start, end, count, type,
+                                       indices, basevertex);
+}
+
+
+static void GLAPIENTRY
+vbo_exec_DrawRangeElements_no_error(GLenum mode, GLuint start, GLuint end,
+                                    GLsizei count, GLenum type,
+                                    const GLvoid *indices)
+{
+   vbo_exec_DrawRangeElementsBaseVertex_no_error(mode, start, end, count,
+                                                 type, indices, 0);
+}
+
+
+static void GLAPIENTRY
+vbo_exec_DrawElementsInstanced_no_error(GLenum mode, GLsizei count,
+                                        GLenum type, const GLvoid *indices,
+                                        GLsizei numInstances)
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   if (!_mesa_prepare_draw_no_error(ctx) || count == 0 || numInstances == 0)
+      return;
+
+   vbo_validated_drawrangeelements(ctx, mode, GL_FALSE, ~0, ~0,
+				   count, type, indices, 0, numInstances, 0);
+}
+
+/*@}*/
+
+
 /**
  * Initialize the dispatch table with the VBO functions for drawing.
  */
@@ -1838,6 +1814,26 @@ vbo_initialize_exec_dispatch(const struct gl_context *ctx,
       SET_DrawTransformFeedbackInstanced(exec, vbo_exec_DrawTransformFeedbackInstanced);
       SET_DrawTransformFeedbackStreamInstanced(exec, vbo_exec_DrawTransformFeedbackStreamInstanced);
    }
+
+   if (_mesa_is_no_error_enabled(ctx)) {
+      SET_DrawArrays(exec, vbo_exec_DrawArrays_no_error);
+      SET_DrawElements(exec, vbo_exec_DrawElements_no_error);
+
+      if (_mesa_is_desktop_gl(ctx) || _mesa_is_gles3(ctx)) {
+         SET_DrawRangeElements(exec, vbo_exec_DrawRangeElements_no_error);
+         SET_DrawArraysInstancedARB(exec,
+                                    vbo_exec_DrawArraysInstanced_no_error);
+         SET_DrawElementsInstancedARB(exec,
+                                      vbo_exec_DrawElementsInstanced_no_error);
+      }
+
+      if (_mesa_is_desktop_gl(ctx)) {
+         SET_DrawElementsBaseVertex(exec,
+                                    vbo_exec_DrawElementsBaseVertex_no_error);
+         SET_DrawRangeElementsBaseVertex(exec,
+                                         vbo_exec_DrawRangeElementsBaseVertex_no_error);
+      }
+   }
 }
 
 
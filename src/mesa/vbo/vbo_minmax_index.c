@@ -0,0 +1,456 @@
+/**************************************************************************
+ *
+ * Copyright 2003 VMware, Inc.
+ * Copyright 2009 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \file vbo_minmax_index.c
+ * Min/max index computation for glDrawElements() calls which don't supply
+ * an index range, with a per-buffer-object cache of the results.
+ *
+ * Static index buffers are typically drawn with the same (offset, count)
+ * ranges every frame, so we remember the result of each scan in the buffer
+ * object.  Anything which may write to the buffer sets MinMaxCacheDirty,
+ * and the cache is thrown away on the next lookup.
+ */
+
+#include "main/glheader.h"
+#include "main/context.h"
+#include "main/varray.h"
+#include "main/macros.h"
+#include "main/sse_minmax.h"
+#include "x86/common_x86_asm.h"
+#include "util/hash_table.h"
+
+#include "vbo.h"
+
+
+struct minmax_cache_key {
+   GLintptr offset;
+   GLuint count;
+   GLenum type;
+   GLuint restart;
+   GLuint restart_index;
+};
+
+
+struct minmax_cache_entry {
+   struct minmax_cache_key key;
+   GLuint min;
+   GLuint max;
+};
+
+
+/* Limit on the number of ranges cached per buffer object. */
+#define MAX_MINMAX_CACHE_ENTRIES 256
+
+/* Once this many indices have been scanned on cache misses, give up on
+ * buffers which miss more than they hit.
+ */
+#define MINMAX_CACHE_MISS_THRESHOLD 500000
+
+
+static uint32_t
+vbo_minmax_cache_hash(const void *key)
+{
+   return _mesa_hash_data(key, sizeof(struct minmax_cache_key));
+}
+
+
+static bool
+vbo_minmax_cache_key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(struct minmax_cache_key)) == 0;
+}
+
+
+static void
+vbo_minmax_cache_delete_entry(struct hash_entry *entry)
+{
+   free(entry->data);
+}
+
+
+/**
+ * Can we trust cached results for this buffer?  Buffers which the GPU may
+ * write behind our back, or which are mapped persistently for writing,
+ * don't go through any of the paths which set MinMaxCacheDirty.
+ */
+static bool
+vbo_use_minmax_cache(const struct gl_buffer_object *bufferObj)
+{
+   if (bufferObj->UsageHistory & (USAGE_TEXTURE_BUFFER |
+                                  USAGE_ATOMIC_COUNTER_BUFFER |
+                                  USAGE_SHADER_STORAGE_BUFFER |
+                                  USAGE_TRANSFORM_FEEDBACK_BUFFER |
+                                  USAGE_PIXEL_PACK_BUFFER |
+                                  USAGE_DISABLE_MINMAX_CACHE))
+      return false;
+
+   if ((bufferObj->Mappings[MAP_USER].AccessFlags &
+        (GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT)) ==
+       (GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT))
+      return false;
+
+   return true;
+}
+
+
+/**
+ * Free the min/max cache of a buffer object.  Called by the driver's
+ * DeleteBuffer hook.
+ */
+void
+vbo_delete_minmax_cache(struct gl_buffer_object *bufferObj)
+{
+   if (bufferObj->MinMaxCache) {
+      _mesa_hash_table_destroy(bufferObj->MinMaxCache,
+                               vbo_minmax_cache_delete_entry);
+      bufferObj->MinMaxCache = NULL;
+   }
+   mtx_destroy(&bufferObj->MinMaxCacheMutex);
+}
+
+
+/**
+ * Throw away the cached ranges if the buffer was written since they were
+ * computed.  Called with MinMaxCacheMutex held.
+ */
+static void
+vbo_validate_minmax_cache(struct gl_buffer_object *bufferObj)
+{
+   if (bufferObj->MinMaxCacheDirty && bufferObj->MinMaxCache) {
+      _mesa_hash_table_destroy(bufferObj->MinMaxCache,
+                               vbo_minmax_cache_delete_entry);
+      bufferObj->MinMaxCache = NULL;
+   }
+   bufferObj->MinMaxCacheDirty = false;
+}
+
+
+static void
+vbo_init_minmax_cache_key(struct minmax_cache_key *key,
+                          GLintptr offset, GLuint count, GLenum type,
+                          GLboolean restart, GLuint restart_index)
+{
+   /* The key is hashed and compared as raw memory. */
+   memset(key, 0, sizeof(*key));
+   key->offset = offset;
+   key->count = count;
+   key->type = type;
+   key->restart = restart;
+   key->restart_index = restart ? restart_index : 0;
+}
+
+
+static GLboolean
+vbo_get_minmax_cached(struct gl_buffer_object *bufferObj,
+                      const struct minmax_cache_key *key,
+                      GLuint *min_index, GLuint *max_index)
+{
+   GLboolean found = GL_FALSE;
+   struct hash_entry *result;
+
+   if (!vbo_use_minmax_cache(bufferObj))
+      return GL_FALSE;
+
+   mtx_lock(&bufferObj->MinMaxCacheMutex);
+   vbo_validate_minmax_cache(bufferObj);
+
+   if (bufferObj->MinMaxCache) {
+      result = _mesa_hash_table_search(bufferObj->MinMaxCache, key);
+      if (result) {
+         const struct minmax_cache_entry *entry = result->data;
+         *min_index = entry->min;
+         *max_index = entry->max;
+         found = GL_TRUE;
+      }
+   }
+
+   if (found) {
+      bufferObj->MinMaxCacheHitIndices += key->count;
+   }
+   else {
+      bufferObj->MinMaxCacheMissIndices += key->count;
+
+      /* Buffers which are rewritten all the time only pay for inserting
+       * ranges that are never looked up again.
+       */
+      if (bufferObj->MinMaxCacheMissIndices > MINMAX_CACHE_MISS_THRESHOLD &&
+          bufferObj->MinMaxCacheHitIndices <
+          bufferObj->MinMaxCacheMissIndices) {
+         bufferObj->UsageHistory |= USAGE_DISABLE_MINMAX_CACHE;
+         if (bufferObj->MinMaxCache) {
+            _mesa_hash_table_destroy(bufferObj->MinMaxCache,
+                                     vbo_minmax_cache_delete_entry);
+            bufferObj->MinMaxCache = NULL;
+         }
+      }
+   }
+
+   mtx_unlock(&bufferObj->MinMaxCacheMutex);
+   return found;
+}
+
+
+static void
+vbo_minmax_cache_store(struct gl_buffer_object *bufferObj,
+                       const struct minmax_cache_key *key,
+                       GLuint min, GLuint max)
+{
+   struct minmax_cache_entry *entry;
+
+   if (!vbo_use_minmax_cache(bufferObj))
+      return;
+
+   mtx_lock(&bufferObj->MinMaxCacheMutex);
+
+   /* The buffer may have been written while we were scanning it. */
+   if (bufferObj->MinMaxCacheDirty)
+      goto out;
+
+   if (!bufferObj->MinMaxCache) {
+      bufferObj->MinMaxCache =
+         _mesa_hash_table_create(NULL, vbo_minmax_cache_hash,
+                                 vbo_minmax_cache_key_equal);
+      if (!bufferObj->MinMaxCache)
+         goto out;
+   }
+   else if (bufferObj->MinMaxCache->entries >= MAX_MINMAX_CACHE_ENTRIES) {
+      /* Too many distinct ranges; start over rather than grow forever. */
+      _mesa_hash_table_destroy(bufferObj->MinMaxCache,
+                               vbo_minmax_cache_delete_entry);
+      bufferObj->MinMaxCache =
+         _mesa_hash_table_create(NULL, vbo_minmax_cache_hash,
+                                 vbo_minmax_cache_key_equal);
+      if (!bufferObj->MinMaxCache)
+         goto out;
+   }
+
+   entry = MALLOC_STRUCT(minmax_cache_entry);
+   if (!entry)
+      goto out;
+
+   entry->key = *key;
+   entry->min = min;
+   entry->max = max;
+   _mesa_hash_table_insert(bufferObj->MinMaxCache, &entry->key, entry);
+
+out:
+   mtx_unlock(&bufferObj->MinMaxCacheMutex);
+}
+
+
+/**
+ * Scan 'count' mapped indices of the given type.
+ */
+static void
+vbo_get_minmax_index_mapped(GLenum type, const void *indices,
+                            GLboolean restart, GLuint restartIndex,
+                            GLuint *min_index, GLuint *max_index,
+                            const GLuint count)
+{
+   GLuint i;
+
+   switch (type) {
+   case GL_UNSIGNED_INT: {
+      const GLuint *ui_indices = (const GLuint *)indices;
+      GLuint max_ui = 0;
+      GLuint min_ui = ~0U;
+#if defined(USE_SSE41)
+      if (cpu_has_sse4_1) {
+         if (restart)
+            _mesa_uint_array_min_max_restart(ui_indices, restartIndex,
+                                             &min_ui, &max_ui, count);
+         else
+            _mesa_uint_array_min_max(ui_indices, &min_ui, &max_ui, count);
+      }
+      else
+#endif
+      if (restart) {
+         for (i = 0; i < count; i++) {
+            if (ui_indices[i] != restartIndex) {
+               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
+               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
+            }
+         }
+      }
+      else {
+         for (i = 0; i < count; i++) {
+            if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
+            if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
+         }
+      }
+      *min_index = min_ui;
+      *max_index = max_ui;
+      break;
+   }
+   case GL_UNSIGNED_SHORT: {
+      const GLushort *us_indices = (const GLushort *)indices;
+      GLuint max_us = 0;
+      GLuint min_us = ~0U;
+#if defined(USE_SSE41)
+      if (cpu_has_sse4_1) {
+         if (restart)
+            _mesa_ushort_array_min_max_restart(us_indices, restartIndex,
+                                               &min_us, &max_us, count);
+         else
+            _mesa_ushort_array_min_max(us_indices, &min_us, &max_us, count);
+      }
+      else
+#endif
+      if (restart) {
+         for (i = 0; i < count; i++) {
+            if (us_indices[i] != restartIndex) {
+               if (us_indices[i] > max_us) max_us = us_indices[i];
+               if (us_indices[i] < min_us) min_us = us_indices[i];
+            }
+         }
+      }
+      else {
+         for (i = 0; i < count; i++) {
+            if (us_indices[i] > max_us) max_us = us_indices[i];
+            if (us_indices[i] < min_us) min_us = us_indices[i];
+         }
+      }
+      *min_index = min_us;
+      *max_index = max_us;
+      break;
+   }
+   case GL_UNSIGNED_BYTE: {
+      const GLubyte *ub_indices = (const GLubyte *)indices;
+      GLuint max_ub = 0;
+      GLuint min_ub = ~0U;
+#if defined(USE_SSE41)
+      if (cpu_has_sse4_1) {
+         if (restart)
+            _mesa_ubyte_array_min_max_restart(ub_indices, restartIndex,
+                                              &min_ub, &max_ub, count);
+         else
+            _mesa_ubyte_array_min_max(ub_indices, &min_ub, &max_ub, count);
+      }
+      else
+#endif
+      if (restart) {
+         for (i = 0; i < count; i++) {
+            if (ub_indices[i] != restartIndex) {
+               if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
+               if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
+            }
+         }
+      }
+      else {
+         for (i = 0; i < count; i++) {
+            if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
+            if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
+         }
+      }
+      *min_index = min_ub;
+      *max_index = max_ub;
+      break;
+   }
+   default:
+      unreachable("not reached");
+   }
+}
+
+
+/**
+ * Compute min and max elements by scanning the index buffer for
+ * glDraw[Range]Elements() calls.
+ * If primitive restart is enabled, we need to ignore restart
+ * indexes when computing min/max.
+ */
+static void
+vbo_get_minmax_index(struct gl_context *ctx,
+		     const struct _mesa_prim *prim,
+		     const struct _mesa_index_buffer *ib,
+		     GLuint *min_index, GLuint *max_index,
+		     const GLuint count)
+{
+   const GLboolean restart = ctx->Array._PrimitiveRestart;
+   const GLuint restartIndex = _mesa_primitive_restart_index(ctx, ib->type);
+   const int index_size = vbo_sizeof_ib_type(ib->type);
+   struct minmax_cache_key key;
+   const char *indices;
+
+   indices = (char *) ib->ptr + prim->start * index_size;
+   if (_mesa_is_bufferobj(ib->obj)) {
+      GLsizeiptr size = MIN2(count * index_size, ib->obj->Size);
+
+      vbo_init_minmax_cache_key(&key, (GLintptr) indices, count, ib->type,
+                                restart, restartIndex);
+      if (vbo_get_minmax_cached(ib->obj, &key, min_index, max_index))
+         return;
+
+      indices = ctx->Driver.MapBufferRange(ctx, (GLintptr) indices, size,
+                                           GL_MAP_READ_BIT, ib->obj,
+                                           MAP_INTERNAL);
+   }
+
+   vbo_get_minmax_index_mapped(ib->type, indices, restart, restartIndex,
+                               min_index, max_index, count);
+
+   if (_mesa_is_bufferobj(ib->obj)) {
+      vbo_minmax_cache_store(ib->obj, &key, *min_index, *max_index);
+      ctx->Driver.UnmapBuffer(ctx, ib->obj, MAP_INTERNAL);
+   }
+}
+
+/**
+ * Compute min and max elements for nr_prims
+ */
+void
+vbo_get_minmax_indices(struct gl_context *ctx,
+                       const struct _mesa_prim *prims,
+                       const struct _mesa_index_buffer *ib,
+                       GLuint *min_index,
+                       GLuint *max_index,
+                       GLuint nr_prims)
+{
+   GLuint tmp_min, tmp_max;
+   GLuint i;
+   GLuint count;
+
+   *min_index = ~0;
+   *max_index = 0;
+
+   for (i = 0; i < nr_prims; i++) {
+      const struct _mesa_prim *start_prim;
+
+      start_prim = &prims[i];
+      count = start_prim->count;
+      /* Do combination if possible to reduce map/unmap count */
+      while ((i + 1 < nr_prims) &&
+             (prims[i].start + prims[i].count == prims[i+1].start)) {
+         count += prims[i+1].count;
+         i++;
+      }
+      vbo_get_minmax_index(ctx, start_prim, ib, &tmp_min, &tmp_max, count);
+      *min_index = MIN2(*min_index, tmp_min);
+      *max_index = MAX2(*max_index, tmp_max);
+   }
+}
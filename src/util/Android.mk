@@ -30,6 +30,8 @@ include $(LOCAL_PATH)/Makefile.sources
 
 include $(CLEAR_VARS)
 
+LOCAL_CFLAGS := -DHAVE_DL_ITERATE_PHDR
+
 LOCAL_SRC_FILES := \
 	$(MESA_UTIL_FILES)
 
@@ -118,6 +118,10 @@ blob_overwrite_bytes(struct blob *blob,
 bool
 blob_write_bytes(struct blob *blob, const void *bytes, size_t to_write)
 {
+   /* Empty arrays are often NULL, which memcpy() may not be passed. */
+   if (to_write == 0)
+      return true;
+
    if (! grow_to_fit(blob, to_write))
        return false;
 
@@ -81,6 +81,8 @@ blob_create (void *mem_ctx);
 /**
  * Add some unstructured, fixed-size data to a blob.
  *
+ * \p bytes may be NULL if \p to_write is 0.
+ *
  * \return True unless allocation failed.
  */
 bool
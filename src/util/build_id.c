@@ -0,0 +1,160 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef HAVE_DL_ITERATE_PHDR
+#include <elf.h>
+#include <link.h>
+#endif
+
+#ifdef HAVE_DLADDR
+#include <dlfcn.h>
+#include <sys/stat.h>
+#endif
+
+#include "ralloc.h"
+#include "build_id.h"
+
+#ifdef HAVE_DL_ITERATE_PHDR
+
+#ifndef NT_GNU_BUILD_ID
+#define NT_GNU_BUILD_ID 3
+#endif
+
+struct build_id_search {
+   uintptr_t addr;
+   void *mem_ctx;
+   char *result;
+};
+
+static char *
+read_build_id_note(void *mem_ctx, const uint8_t *notes, size_t size,
+                   size_t align)
+{
+   const uint8_t *p = notes;
+   const uint8_t *end = notes + size;
+
+   while ((size_t) (end - p) >= sizeof(ElfW(Nhdr))) {
+      const ElfW(Nhdr) *nhdr = (const ElfW(Nhdr) *) p;
+      size_t name_size = (nhdr->n_namesz + align - 1) & ~(align - 1);
+      size_t desc_size = (nhdr->n_descsz + align - 1) & ~(align - 1);
+      const uint8_t *name = p + sizeof(*nhdr);
+      const uint8_t *desc = name + name_size;
+
+      if (name_size > (size_t) (end - name) ||
+          desc_size > (size_t) (end - desc))
+         break;
+
+      if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_descsz != 0 &&
+          nhdr->n_namesz == 4 && memcmp(name, "GNU", 4) == 0) {
+         char *hex = ralloc_size(mem_ctx, 2 * nhdr->n_descsz + 1);
+         static const char digits[] = "0123456789abcdef";
+
+         if (hex == NULL)
+            return NULL;
+
+         for (unsigned i = 0; i < nhdr->n_descsz; i++) {
+            hex[2 * i] = digits[desc[i] >> 4];
+            hex[2 * i + 1] = digits[desc[i] & 0xf];
+         }
+         hex[2 * nhdr->n_descsz] = '\0';
+
+         return hex;
+      }
+
+      p = desc + desc_size;
+   }
+
+   return NULL;
+}
+
+static int
+find_build_id(struct dl_phdr_info *info, size_t size, void *closure)
+{
+   struct build_id_search *search = closure;
+   unsigned i;
+
+   (void) size;
+
+   for (i = 0; i < info->dlpi_phnum; i++) {
+      const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+      uintptr_t start = info->dlpi_addr + phdr->p_vaddr;
+
+      if (phdr->p_type == PT_LOAD &&
+          search->addr >= start && search->addr - start < phdr->p_memsz)
+         break;
+   }
+
+   if (i == info->dlpi_phnum)
+      return 0;
+
+   for (i = 0; i < info->dlpi_phnum && search->result == NULL; i++) {
+      const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+
+      if (phdr->p_type != PT_NOTE)
+         continue;
+
+      search->result =
+         read_build_id_note(search->mem_ctx,
+                            (const uint8_t *) (info->dlpi_addr +
+                                               phdr->p_vaddr),
+                            phdr->p_memsz, phdr->p_align == 8 ? 8 : 4);
+   }
+
+   /* Stop iterating, the address can't be in any other object. */
+   return 1;
+}
+
+#endif /* HAVE_DL_ITERATE_PHDR */
+
+char *
+build_id_for_address(void *mem_ctx, const void *addr)
+{
+#ifdef HAVE_DL_ITERATE_PHDR
+   struct build_id_search search = { (uintptr_t) addr, mem_ctx, NULL };
+
+   dl_iterate_phdr(find_build_id, &search);
+   if (search.result != NULL)
+      return search.result;
+#endif
+
+#ifdef HAVE_DLADDR
+   {
+      Dl_info info;
+      struct stat st;
+
+      if (dladdr((void *) addr, &info) != 0 && info.dli_fname != NULL &&
+          info.dli_fname[0] != '\0' && stat(info.dli_fname, &st) == 0) {
+         return ralloc_asprintf(mem_ctx, "%s %lld %lld", info.dli_fname,
+                                (long long) st.st_size,
+                                (long long) st.st_mtime);
+      }
+   }
+#endif
+
+   (void) mem_ctx;
+   (void) addr;
+   return NULL;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef BUILD_ID_H
+#define BUILD_ID_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Identify the build of the executable or shared library containing \c addr.
+ *
+ * This is the GNU build-id note of the binary if it has one.  Otherwise it
+ * is made up of the path, size and modification time of the file it was
+ * loaded from.
+ *
+ * \return A string allocated with ralloc against \c mem_ctx, or NULL if the
+ *         binary can't be identified on this platform.
+ */
+char *
+build_id_for_address(void *mem_ctx, const void *addr);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* BUILD_ID_H */
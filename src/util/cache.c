@@ -0,0 +1,591 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifdef ENABLE_SHADER_CACHE
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "util/u_atomic.h"
+#include "util/hash_table.h"
+#include "cache.h"
+
+/* Number of first-level subdirectories, one per value of the first key byte.
+ * Spreading entries out keeps directories small and gives eviction a cheap
+ * way to pick a random victim.
+ */
+#define CACHE_SUBDIRS 256
+
+#define CACHE_ENTRY_MAGIC 0x4d534743 /* "MSGC" */
+
+/* Give up on making room for a new entry after this many evictions. */
+#define CACHE_MAX_EVICTIONS_PER_PUT 16
+
+struct cache_entry_header {
+   uint32_t magic;
+   uint32_t size;
+   uint32_t checksum;
+   uint8_t key[CACHE_KEY_SIZE];
+};
+
+struct disk_cache {
+   /* Root of the cache directory, without a trailing slash. */
+   char *path;
+
+   /* Total size of all entries in bytes.  This lives in a small file that
+    * every process using the directory maps, so that all of them see (and
+    * update) the same value.
+    */
+   uint64_t *size;
+   uint64_t max_size;
+
+   uint32_t seed;
+
+   bool print_stats;
+   struct {
+      unsigned hits;
+      unsigned misses;
+      unsigned puts;
+      unsigned evictions;
+   } stats;
+};
+
+/**
+ * Create \c path as a directory unless it already is one.
+ */
+static bool
+ensure_directory(const char *path)
+{
+   struct stat sb;
+
+   if (mkdir(path, 0755) == 0)
+      return true;
+
+   if (errno != EEXIST)
+      return false;
+
+   return stat(path, &sb) == 0 && S_ISDIR(sb.st_mode);
+}
+
+/**
+ * Pick the cache directory and make sure it exists.  The result is
+ * malloc'ed.
+ */
+static char *
+cache_directory(void)
+{
+   const char *dir = getenv("MESA_GLSL_CACHE_DIR");
+   char *path;
+
+   if (dir) {
+      if (!ensure_directory(dir))
+         return NULL;
+      return strdup(dir);
+   }
+
+   dir = getenv("XDG_CACHE_HOME");
+   if (dir) {
+      if (!ensure_directory(dir))
+         return NULL;
+      if (asprintf(&path, "%s/mesa", dir) == -1)
+         return NULL;
+   } else {
+      const char *home = getenv("HOME");
+      char *dot_cache;
+
+      if (!home) {
+         struct passwd *pwd = getpwuid(getuid());
+         if (!pwd)
+            return NULL;
+         home = pwd->pw_dir;
+      }
+
+      if (asprintf(&dot_cache, "%s/.cache", home) == -1)
+         return NULL;
+
+      if (!ensure_directory(dot_cache)) {
+         free(dot_cache);
+         return NULL;
+      }
+
+      if (asprintf(&path, "%s/mesa", dot_cache) == -1)
+         path = NULL;
+      free(dot_cache);
+      if (!path)
+         return NULL;
+   }
+
+   if (!ensure_directory(path)) {
+      free(path);
+      return NULL;
+   }
+
+   return path;
+}
+
+/**
+ * Parse MESA_GLSL_CACHE_MAX_SIZE.
+ */
+static uint64_t
+cache_max_size(void)
+{
+   const uint64_t default_size = 1024 * 1024 * 1024;
+   const char *str = getenv("MESA_GLSL_CACHE_MAX_SIZE");
+   char *end;
+   uint64_t size;
+
+   if (!str)
+      return default_size;
+
+   size = strtoull(str, &end, 10);
+   if (end == str || size == 0)
+      return default_size;
+
+   switch (toupper(*end)) {
+   case 'K':
+      return size * 1024;
+   case 'M':
+      return size * 1024 * 1024;
+   case 'G':
+   case '\0':
+      return size * 1024 * 1024 * 1024;
+   default:
+      return default_size;
+   }
+}
+
+/**
+ * Map the shared file holding the total size of the cache.
+ */
+static uint64_t *
+map_size_file(const char *root)
+{
+   struct stat sb;
+   char *path;
+   void *map;
+   int fd;
+
+   if (asprintf(&path, "%s/index", root) == -1)
+      return NULL;
+
+   fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+   free(path);
+   if (fd == -1)
+      return NULL;
+
+   /* Several processes may race to initialize the file, but extending it
+    * with zeroes is idempotent.
+    */
+   if (fstat(fd, &sb) == -1 ||
+       (sb.st_size < (off_t) sizeof(uint64_t) &&
+        ftruncate(fd, sizeof(uint64_t)) == -1)) {
+      close(fd);
+      return NULL;
+   }
+
+   map = mmap(NULL, sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED,
+              fd, 0);
+   close(fd);
+
+   return map == MAP_FAILED ? NULL : map;
+}
+
+struct disk_cache *
+cache_create(void)
+{
+   struct disk_cache *cache;
+
+   if (getenv("MESA_GLSL_CACHE_DISABLE"))
+      return NULL;
+
+   cache = calloc(1, sizeof(*cache));
+   if (!cache)
+      return NULL;
+
+   cache->path = cache_directory();
+   if (!cache->path)
+      goto fail;
+
+   cache->size = map_size_file(cache->path);
+   if (!cache->size)
+      goto fail;
+
+   cache->max_size = cache_max_size();
+   cache->seed = (uint32_t) time(NULL) ^ ((uint32_t) getpid() << 16);
+   if (cache->seed == 0)
+      cache->seed = 1;
+   cache->print_stats = getenv("MESA_GLSL_CACHE_STATS") != NULL;
+
+   return cache;
+
+fail:
+   free(cache->path);
+   free(cache);
+   return NULL;
+}
+
+void
+cache_destroy(struct disk_cache *cache)
+{
+   if (!cache)
+      return;
+
+   if (cache->print_stats) {
+      unsigned lookups = cache->stats.hits + cache->stats.misses;
+
+      fprintf(stderr,
+              "Mesa GLSL cache %s: %u hits, %u misses (%.1f%% hit rate), "
+              "%u stores, %u evictions, %.1f MB used\n",
+              cache->path, cache->stats.hits, cache->stats.misses,
+              lookups ? 100.0 * cache->stats.hits / lookups : 0.0,
+              cache->stats.puts, cache->stats.evictions,
+              *cache->size / (1024.0 * 1024.0));
+   }
+
+   munmap(cache->size, sizeof(uint64_t));
+   free(cache->path);
+   free(cache);
+}
+
+/**
+ * Build the path of the entry for \c key, optionally creating its
+ * subdirectory.  The result is malloc'ed.
+ */
+static char *
+entry_path(struct disk_cache *cache, const cache_key key, bool create)
+{
+   char hex[2 * CACHE_KEY_SIZE + 1];
+   char *path;
+   unsigned i;
+
+   for (i = 0; i < CACHE_KEY_SIZE; i++)
+      snprintf(&hex[2 * i], 3, "%02x", key[i]);
+
+   if (asprintf(&path, "%s/%c%c", cache->path, hex[0], hex[1]) == -1)
+      return NULL;
+
+   if (create && !ensure_directory(path)) {
+      free(path);
+      return NULL;
+   }
+   free(path);
+
+   if (asprintf(&path, "%s/%c%c/%s", cache->path, hex[0], hex[1],
+                &hex[2]) == -1)
+      return NULL;
+
+   return path;
+}
+
+static void
+subtract_size(struct disk_cache *cache, uint64_t size)
+{
+   /* Entries may have been removed behind our back, so never let the shared
+    * counter wrap around.
+    */
+   uint64_t old = *cache->size;
+
+   while (true) {
+      uint64_t new_size = old > size ? old - size : 0;
+      uint64_t prev = p_atomic_cmpxchg(cache->size, old, new_size);
+      if (prev == old)
+         break;
+      old = prev;
+   }
+}
+
+/**
+ * Remove the least recently used entry of the subdirectory \c dir_path.
+ *
+ * \return false if the directory holds no entries.
+ */
+static bool
+evict_from_directory(struct disk_cache *cache, const char *dir_path)
+{
+   struct dirent *entry;
+   char *victim = NULL;
+   time_t victim_time = 0;
+   off_t victim_size = 0;
+   DIR *dir;
+
+   dir = opendir(dir_path);
+   if (!dir)
+      return false;
+
+   while ((entry = readdir(dir)) != NULL) {
+      struct stat sb;
+      char *path;
+
+      /* Skip ".", ".." and in-progress writes. */
+      if (strlen(entry->d_name) != 2 * CACHE_KEY_SIZE - 2)
+         continue;
+
+      if (asprintf(&path, "%s/%s", dir_path, entry->d_name) == -1)
+         continue;
+
+      if (stat(path, &sb) == 0 && S_ISREG(sb.st_mode) &&
+          (!victim || sb.st_atime < victim_time)) {
+         free(victim);
+         victim = path;
+         victim_time = sb.st_atime;
+         victim_size = sb.st_size;
+      } else {
+         free(path);
+      }
+   }
+
+   closedir(dir);
+
+   if (!victim)
+      return false;
+
+   if (unlink(victim) == 0) {
+      subtract_size(cache, victim_size);
+      p_atomic_inc(&cache->stats.evictions);
+   }
+   free(victim);
+
+   return true;
+}
+
+/**
+ * Evict an entry from a randomly chosen subdirectory.
+ *
+ * \return false if the whole cache is empty.
+ */
+static bool
+evict_random_entry(struct disk_cache *cache)
+{
+   unsigned start, i;
+
+   /* xorshift32 */
+   cache->seed ^= cache->seed << 13;
+   cache->seed ^= cache->seed >> 17;
+   cache->seed ^= cache->seed << 5;
+   start = cache->seed % CACHE_SUBDIRS;
+
+   for (i = 0; i < CACHE_SUBDIRS; i++) {
+      unsigned subdir = (start + i) % CACHE_SUBDIRS;
+      bool evicted;
+      char *path;
+
+      if (asprintf(&path, "%s/%02x", cache->path, subdir) == -1)
+         return false;
+
+      evicted = evict_from_directory(cache, path);
+      free(path);
+
+      if (evicted)
+         return true;
+   }
+
+   /* Nothing left on disk, so whatever the counter says is stale. */
+   p_atomic_set(cache->size, 0);
+   return false;
+}
+
+static bool
+write_all(int fd, const void *data, size_t size)
+{
+   const uint8_t *p = data;
+
+   while (size > 0) {
+      ssize_t ret = write(fd, p, size);
+      if (ret == -1) {
+         if (errno == EINTR)
+            continue;
+         return false;
+      }
+      p += ret;
+      size -= ret;
+   }
+
+   return true;
+}
+
+static bool
+read_all(int fd, void *data, size_t size)
+{
+   uint8_t *p = data;
+
+   while (size > 0) {
+      ssize_t ret = read(fd, p, size);
+      if (ret == -1) {
+         if (errno == EINTR)
+            continue;
+         return false;
+      }
+      if (ret == 0)
+         return false;
+      p += ret;
+      size -= ret;
+   }
+
+   return true;
+}
+
+void
+cache_put(struct disk_cache *cache, const cache_key key,
+          const void *data, size_t size)
+{
+   struct cache_entry_header header;
+   uint64_t entry_size = sizeof(header) + size;
+   char *path, *tmp_path = NULL;
+   unsigned evictions = 0;
+   int fd = -1;
+
+   if (!cache || size > UINT32_MAX || entry_size > cache->max_size)
+      return;
+
+   path = entry_path(cache, key, true);
+   if (!path)
+      return;
+
+   if (access(path, F_OK) == 0)
+      goto done;
+
+   if (asprintf(&tmp_path, "%s.tmp", path) == -1) {
+      tmp_path = NULL;
+      goto done;
+   }
+
+   /* Whoever holds the lock on the temporary file is writing this entry
+    * already; there is no point in waiting for them.  A temporary file left
+    * behind by a crashed process is not locked and simply gets reused.
+    */
+   fd = open(tmp_path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+   if (fd == -1)
+      goto done;
+
+   if (flock(fd, LOCK_EX | LOCK_NB) == -1)
+      goto done;
+
+   /* The other writer may have finished between our two checks. */
+   if (access(path, F_OK) == 0) {
+      unlink(tmp_path);
+      goto done;
+   }
+
+   while (*cache->size + entry_size > cache->max_size &&
+          evictions++ < CACHE_MAX_EVICTIONS_PER_PUT &&
+          evict_random_entry(cache))
+      ;
+
+   header.magic = CACHE_ENTRY_MAGIC;
+   header.size = size;
+   header.checksum = _mesa_hash_data(data, size);
+   memcpy(header.key, key, CACHE_KEY_SIZE);
+
+   if (ftruncate(fd, 0) == -1 ||
+       !write_all(fd, &header, sizeof(header)) ||
+       !write_all(fd, data, size) ||
+       rename(tmp_path, path) == -1) {
+      unlink(tmp_path);
+      goto done;
+   }
+
+   p_atomic_add(cache->size, entry_size);
+   p_atomic_inc(&cache->stats.puts);
+
+done:
+   if (fd != -1)
+      close(fd);
+   free(tmp_path);
+   free(path);
+}
+
+void *
+cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
+{
+   struct cache_entry_header header;
+   void *data = NULL;
+   struct stat sb;
+   char *path;
+   int fd;
+
+   if (!cache)
+      return NULL;
+
+   sb.st_size = 0;
+
+   path = entry_path(cache, key, false);
+   if (!path)
+      goto miss;
+
+   fd = open(path, O_RDONLY | O_CLOEXEC);
+   if (fd == -1)
+      goto miss;
+
+   if (fstat(fd, &sb) == -1 || sb.st_size < (off_t) sizeof(header) ||
+       !read_all(fd, &header, sizeof(header)) ||
+       header.magic != CACHE_ENTRY_MAGIC ||
+       memcmp(header.key, key, CACHE_KEY_SIZE) != 0 ||
+       sb.st_size != (off_t) (sizeof(header) + header.size))
+      goto corrupt;
+
+   data = malloc(header.size ? header.size : 1);
+   if (!data) {
+      close(fd);
+      goto miss;
+   }
+
+   if (!read_all(fd, data, header.size) ||
+       _mesa_hash_data(data, header.size) != header.checksum)
+      goto corrupt;
+
+   close(fd);
+   free(path);
+
+   *size = header.size;
+   p_atomic_inc(&cache->stats.hits);
+   return data;
+
+corrupt:
+   /* Drop entries that were truncated or damaged so that the next put can
+    * replace them.
+    */
+   close(fd);
+   if (unlink(path) == 0)
+      subtract_size(cache, sb.st_size);
+   free(data);
+   data = NULL;
+
+miss:
+   free(path);
+   p_atomic_inc(&cache->stats.misses);
+   return NULL;
+}
+
+#endif /* ENABLE_SHADER_CACHE */
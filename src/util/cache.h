@@ -0,0 +1,127 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \file cache.h
+ *
+ * A persistent, size-bounded cache of binary blobs indexed by SHA-1 keys.
+ *
+ * Entries live in one file each below the cache directory, which is chosen
+ * from the following, in order:
+ *
+ *   $MESA_GLSL_CACHE_DIR
+ *   $XDG_CACHE_HOME/mesa
+ *   <home directory>/.cache/mesa
+ *
+ * MESA_GLSL_CACHE_MAX_SIZE bounds the total size of all entries.  It is a
+ * number with an optional K, M or G suffix; a bare number means gigabytes.
+ * The default is 1G.  Setting MESA_GLSL_CACHE_DISABLE turns the cache off
+ * and MESA_GLSL_CACHE_STATS prints hit statistics when it is destroyed.
+ *
+ * Several processes may share one cache directory.  Entries are written to
+ * a temporary file and renamed into place, so a reader never sees a partial
+ * entry.
+ */
+
+#define CACHE_KEY_SIZE 20
+
+typedef uint8_t cache_key[CACHE_KEY_SIZE];
+
+struct disk_cache;
+
+#ifdef ENABLE_SHADER_CACHE
+
+/**
+ * Open the cache directory, creating it if needed.
+ *
+ * \return NULL if the cache is disabled or cannot be used.
+ */
+struct disk_cache *
+cache_create(void);
+
+/**
+ * Close \c cache, printing its statistics if MESA_GLSL_CACHE_STATS is set.
+ */
+void
+cache_destroy(struct disk_cache *cache);
+
+/**
+ * Store \c size bytes of \c data under \c key, evicting old entries to stay
+ * within the size limit.  Failures are silently ignored.
+ */
+void
+cache_put(struct disk_cache *cache, const cache_key key,
+          const void *data, size_t size);
+
+/**
+ * Look up \c key.
+ *
+ * \return A malloc'ed copy of the entry, with its size in \c size, or NULL
+ *         if there is no valid entry.
+ */
+void *
+cache_get(struct disk_cache *cache, const cache_key key, size_t *size);
+
+#else
+
+static inline struct disk_cache *
+cache_create(void)
+{
+   return NULL;
+}
+
+static inline void
+cache_destroy(struct disk_cache *cache)
+{
+}
+
+static inline void
+cache_put(struct disk_cache *cache, const cache_key key,
+          const void *data, size_t size)
+{
+}
+
+static inline void *
+cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
+{
+   return NULL;
+}
+
+#endif /* ENABLE_SHADER_CACHE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CACHE_H */
@@ -0,0 +1,221 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+
+static bool failed = false;
+
+static void
+expect(bool cond, const char *what)
+{
+   if (!cond) {
+      fprintf(stderr, "FAIL: %s\n", what);
+      failed = true;
+   }
+}
+
+static void
+make_key(cache_key key, unsigned seed)
+{
+   unsigned i;
+
+   for (i = 0; i < CACHE_KEY_SIZE; i++)
+      key[i] = (seed * 37 + i * 11) & 0xff;
+}
+
+static unsigned
+count_entries(const char *root)
+{
+   unsigned count = 0, i;
+
+   for (i = 0; i < 256; i++) {
+      char path[4096];
+      struct dirent *entry;
+      DIR *dir;
+
+      snprintf(path, sizeof(path), "%s/%02x", root, i);
+      dir = opendir(path);
+      if (!dir)
+         continue;
+
+      while ((entry = readdir(dir)) != NULL) {
+         if (strlen(entry->d_name) == 2 * CACHE_KEY_SIZE - 2)
+            count++;
+      }
+      closedir(dir);
+   }
+
+   return count;
+}
+
+static void
+remove_tree(const char *path)
+{
+   char cmd[4096];
+
+   snprintf(cmd, sizeof(cmd), "rm -rf '%s'", path);
+   if (system(cmd) != 0)
+      fprintf(stderr, "failed to remove %s\n", path);
+}
+
+static void
+test_put_get(void)
+{
+   struct disk_cache *cache = cache_create();
+   const char blob[] = "linked program";
+   cache_key key, other;
+   size_t size = 0;
+   char *data;
+
+   expect(cache != NULL, "cache_create");
+   if (!cache)
+      return;
+
+   make_key(key, 1);
+   make_key(other, 2);
+
+   expect(cache_get(cache, key, &size) == NULL, "lookup in empty cache");
+
+   cache_put(cache, key, blob, sizeof(blob));
+   data = cache_get(cache, key, &size);
+   expect(data != NULL && size == sizeof(blob) &&
+          memcmp(data, blob, size) == 0, "lookup after put");
+   free(data);
+
+   expect(cache_get(cache, other, &size) == NULL, "lookup of other key");
+
+   /* Storing the same key again is harmless. */
+   cache_put(cache, key, blob, sizeof(blob));
+   data = cache_get(cache, key, &size);
+   expect(data != NULL && size == sizeof(blob), "lookup after second put");
+   free(data);
+
+   /* Empty entries are valid. */
+   cache_put(cache, other, NULL, 0);
+   data = cache_get(cache, other, &size);
+   expect(data != NULL && size == 0, "lookup of empty entry");
+   free(data);
+
+   cache_destroy(cache);
+}
+
+static void
+test_corruption(const char *root)
+{
+   struct disk_cache *cache = cache_create();
+   const char blob[] = "this entry is about to be damaged";
+   char path[4096];
+   cache_key key;
+   size_t size;
+   FILE *f;
+   unsigned i;
+
+   if (!cache)
+      return;
+
+   make_key(key, 3);
+   cache_put(cache, key, blob, sizeof(blob));
+
+   i = snprintf(path, sizeof(path), "%s/%02x/", root, key[0]);
+   for (unsigned k = 1; k < CACHE_KEY_SIZE; k++)
+      i += snprintf(path + i, sizeof(path) - i, "%02x", key[k]);
+
+   /* Flip the last byte of the payload. */
+   f = fopen(path, "r+b");
+   expect(f != NULL, "entry file exists");
+   if (f) {
+      fseek(f, -1, SEEK_END);
+      fputc('X', f);
+      fclose(f);
+   }
+
+   expect(cache_get(cache, key, &size) == NULL, "damaged entry is a miss");
+   expect(access(path, F_OK) != 0, "damaged entry is removed");
+
+   cache_destroy(cache);
+}
+
+static void
+test_eviction(const char *root)
+{
+   struct disk_cache *cache;
+   char blob[1000];
+   unsigned i;
+
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "4K", 1);
+   cache = cache_create();
+   unsetenv("MESA_GLSL_CACHE_MAX_SIZE");
+   if (!cache)
+      return;
+
+   memset(blob, 0x5a, sizeof(blob));
+   for (i = 0; i < 32; i++) {
+      cache_key key;
+
+      make_key(key, 100 + i);
+      cache_put(cache, key, blob, sizeof(blob));
+   }
+
+   expect(count_entries(root) <= 4, "cache stays within its size limit");
+   expect(count_entries(root) >= 1, "eviction leaves recent entries");
+
+   cache_destroy(cache);
+}
+
+int
+main(int argc, char *argv[])
+{
+   char template[] = "/tmp/mesa-cache-test-XXXXXX";
+   char *root = mkdtemp(template);
+
+   if (!root) {
+      fprintf(stderr, "could not create a temporary directory\n");
+      return 1;
+   }
+
+   setenv("MESA_GLSL_CACHE_DIR", root, 1);
+   unsetenv("MESA_GLSL_CACHE_DISABLE");
+
+   test_put_get();
+   test_corruption(root);
+
+   remove_tree(root);
+   if (mkdir(root, 0755) != 0)
+      return 1;
+   test_eviction(root);
+
+   setenv("MESA_GLSL_CACHE_DISABLE", "1", 1);
+   expect(cache_create() == NULL, "MESA_GLSL_CACHE_DISABLE");
+
+   remove_tree(root);
+
+   return failed;
+}
@@ -33,9 +33,11 @@
  */
 
 /**
- * Implements an open-addressing, linear-reprobing hash table.
+ * Implements an open-addressing hash table with power-of-two sizes, and an
+ * array of control bytes next to the entries that lets lookups check a
+ * whole group of entries at once.  See hash_table_ctrl.h.
  *
- * For more information, see:
+ * For more information on the original design, see:
  *
  * http://cgit.freedesktop.org/~anholt/hash_table/tree/README
  */
@@ -45,68 +47,40 @@
 #include <assert.h>
 
 #include "hash_table.h"
+#include "hash_table_ctrl.h"
 #include "ralloc.h"
 #include "macros.h"
 
 static const uint32_t deleted_key_value;
 
-/**
- * From Knuth -- a good choice for hash/rehash values is p, p-2 where
- * p and p-2 are both prime.  These tables are sized to have an extra 10%
- * free to avoid exponential performance degradation as the hash table fills
- */
-static const struct {
-   uint32_t max_entries, size, rehash;
-} hash_sizes[] = {
-   { 2,			5,		3	  },
-   { 4,			7,		5	  },
-   { 8,			13,		11	  },
-   { 16,		19,		17	  },
-   { 32,		43,		41        },
-   { 64,		73,		71        },
-   { 128,		151,		149       },
-   { 256,		283,		281       },
-   { 512,		571,		569       },
-   { 1024,		1153,		1151      },
-   { 2048,		2269,		2267      },
-   { 4096,		4519,		4517      },
-   { 8192,		9013,		9011      },
-   { 16384,		18043,		18041     },
-   { 32768,		36109,		36107     },
-   { 65536,		72091,		72089     },
-   { 131072,		144409,		144407    },
-   { 262144,		288361,		288359    },
-   { 524288,		576883,		576881    },
-   { 1048576,		1153459,	1153457   },
-   { 2097152,		2307163,	2307161   },
-   { 4194304,		4613893,	4613891   },
-   { 8388608,		9227641,	9227639   },
-   { 16777216,		18455029,	18455027  },
-   { 33554432,		36911011,	36911009  },
-   { 67108864,		73819861,	73819859  },
-   { 134217728,		147639589,	147639587 },
-   { 268435456,		295279081,	295279079 },
-   { 536870912,		590559793,	590559791 },
-   { 1073741824,	1181116273,	1181116271},
-   { 2147483648ul,	2362232233ul,	2362232231ul}
-};
-
-static int
-entry_is_free(const struct hash_entry *entry)
+static bool
+hash_table_alloc(struct hash_table *ht, uint32_t size_index)
 {
-   return entry->key == NULL;
-}
+   uint32_t size = 1u << size_index;
+   struct hash_entry *table;
+   uint8_t *ctrl;
 
-static int
-entry_is_deleted(const struct hash_table *ht, struct hash_entry *entry)
-{
-   return entry->key == ht->deleted_key;
-}
+   table = ralloc_array(ht, struct hash_entry, size);
+   if (table == NULL)
+      return false;
 
-static int
-entry_is_present(const struct hash_table *ht, struct hash_entry *entry)
-{
-   return entry->key != NULL && entry->key != ht->deleted_key;
+   ctrl = ralloc_array(ht, uint8_t, hash_ctrl_alloc_size(size));
+   if (ctrl == NULL) {
+      ralloc_free(table);
+      return false;
+   }
+
+   hash_ctrl_init(ctrl, size);
+
+   ht->table = table;
+   ht->ctrl = ctrl;
+   ht->size_index = size_index;
+   ht->size = size;
+   ht->max_entries = hash_ctrl_max_entries(size);
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+
+   return true;
 }
 
 struct hash_table *
@@ -121,18 +95,11 @@ _mesa_hash_table_create(void *mem_ctx,
    if (ht == NULL)
       return NULL;
 
-   ht->size_index = 0;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(ht, struct hash_entry, ht->size);
-   ht->entries = 0;
-   ht->deleted_entries = 0;
    ht->deleted_key = &deleted_key_value;
 
-   if (ht->table == NULL) {
+   if (!hash_table_alloc(ht, HASH_MIN_SIZE_LOG2)) {
       ralloc_free(ht);
       return NULL;
    }
@@ -165,11 +132,12 @@ _mesa_hash_table_destroy(struct hash_table *ht,
 
 /** Sets the value of the key pointer used for deleted entries in the table.
  *
- * The assumption is that usually keys are actual pointers, so we use a
- * default value of a pointer to an arbitrary piece of storage in the library.
- * But in some cases a consumer wants to store some other sort of value in the
- * table, like a uint32_t, in which case that pointer may conflict with one of
- * their valid keys.  This lets that user select a safe value.
+ * Deleted entries are tracked in the control bytes, so the key is only
+ * written to the entry to poison it.  The assumption is that usually keys
+ * are actual pointers, so we use a default value of a pointer to an
+ * arbitrary piece of storage in the library.  Users storing some other sort
+ * of value in the table, like a uint32_t, can pick a value that is easier to
+ * tell apart from their valid keys.
  *
  * This must be called before any keys are actually deleted from the table.
  */
@@ -182,26 +150,28 @@ _mesa_hash_table_set_deleted_key(struct hash_table *ht, const void *deleted_key)
 static struct hash_entry *
 hash_table_search(struct hash_table *ht, uint32_t hash, const void *key)
 {
-   uint32_t start_hash_address = hash % ht->size;
-   uint32_t hash_address = start_hash_address;
+   uint32_t mixed = hash_ctrl_mix(hash);
+   uint8_t tag = hash_ctrl_tag(mixed);
+   struct hash_probe probe;
 
+   hash_probe_init(&probe, mixed, ht->size);
    do {
-      uint32_t double_hash;
+      uint32_t offset = hash_probe_offset(&probe);
+      const uint8_t *group = ht->ctrl + offset;
+      unsigned match = hash_group_match(group, tag);
 
-      struct hash_entry *entry = ht->table + hash_address;
+      while (match) {
+         struct hash_entry *entry = ht->table + offset + u_bit_scan(&match);
 
-      if (entry_is_free(entry)) {
-         return NULL;
-      } else if (entry_is_present(ht, entry) && entry->hash == hash) {
-         if (ht->key_equals_function(key, entry->key)) {
+         if (entry->hash == hash &&
+             ht->key_equals_function(key, entry->key)) {
             return entry;
          }
       }
 
-      double_hash = 1 + hash % ht->rehash;
-
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != start_hash_address);
+      if (hash_group_match(group, HASH_CTRL_EMPTY))
+         return NULL;
+   } while (hash_probe_next(&probe));
 
    return NULL;
 }
@@ -227,47 +197,67 @@ _mesa_hash_table_search_pre_hashed(struct hash_table *ht, uint32_t hash,
    return hash_table_search(ht, hash, key);
 }
 
-static struct hash_entry *
-hash_table_insert(struct hash_table *ht, uint32_t hash,
-                  const void *key, void *data);
+/**
+ * Puts an entry that is known not to be in the table yet into the first
+ * available slot, without comparing any keys.  Used when rehashing.
+ */
+static void
+hash_table_insert_unique(struct hash_table *ht, uint32_t hash,
+                         const void *key, void *data)
+{
+   uint32_t mixed = hash_ctrl_mix(hash);
+   struct hash_probe probe;
+
+   hash_probe_init(&probe, mixed, ht->size);
+   do {
+      uint32_t offset = hash_probe_offset(&probe);
+      unsigned available = hash_group_match_available(ht->ctrl + offset);
+
+      if (available) {
+         uint32_t i = offset + u_bit_scan(&available);
+
+         ht->ctrl[i] = hash_ctrl_tag(mixed);
+         ht->table[i].hash = hash;
+         ht->table[i].key = key;
+         ht->table[i].data = data;
+         ht->entries++;
+         return;
+      }
+   } while (hash_probe_next(&probe));
+
+   assert(!"hash table full while rehashing");
+}
 
 static void
 _mesa_hash_table_rehash(struct hash_table *ht, unsigned new_size_index)
 {
    struct hash_table old_ht;
-   struct hash_entry *table, *entry;
-
-   if (new_size_index >= ARRAY_SIZE(hash_sizes))
-      return;
+   struct hash_entry *entry;
 
-   table = rzalloc_array(ht, struct hash_entry,
-                         hash_sizes[new_size_index].size);
-   if (table == NULL)
+   if (new_size_index >= 32)
       return;
 
    old_ht = *ht;
 
-   ht->table = table;
-   ht->size_index = new_size_index;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
-   ht->entries = 0;
-   ht->deleted_entries = 0;
+   if (!hash_table_alloc(ht, new_size_index))
+      return;
 
    hash_table_foreach(&old_ht, entry) {
-      hash_table_insert(ht, entry->hash, entry->key, entry->data);
+      hash_table_insert_unique(ht, entry->hash, entry->key, entry->data);
    }
 
    ralloc_free(old_ht.table);
+   ralloc_free(old_ht.ctrl);
 }
 
 static struct hash_entry *
 hash_table_insert(struct hash_table *ht, uint32_t hash,
                   const void *key, void *data)
 {
-   uint32_t start_hash_address, hash_address;
-   struct hash_entry *available_entry = NULL;
+   uint32_t mixed, available_index = ~0u;
+   struct hash_entry *available_entry;
+   struct hash_probe probe;
+   uint8_t tag;
 
    if (ht->entries >= ht->max_entries) {
       _mesa_hash_table_rehash(ht, ht->size_index + 1);
@@ -275,19 +265,14 @@ hash_table_insert(struct hash_table *ht, uint32_t hash,
       _mesa_hash_table_rehash(ht, ht->size_index);
    }
 
-   start_hash_address = hash % ht->size;
-   hash_address = start_hash_address;
+   mixed = hash_ctrl_mix(hash);
+   tag = hash_ctrl_tag(mixed);
+
+   hash_probe_init(&probe, mixed, ht->size);
    do {
-      struct hash_entry *entry = ht->table + hash_address;
-      uint32_t double_hash;
-
-      if (!entry_is_present(ht, entry)) {
-         /* Stash the first available entry we find */
-         if (available_entry == NULL)
-            available_entry = entry;
-         if (entry_is_free(entry))
-            break;
-      }
+      uint32_t offset = hash_probe_offset(&probe);
+      const uint8_t *group = ht->ctrl + offset;
+      unsigned match = hash_group_match(group, tag);
 
       /* Implement replacement when another insert happens
        * with a matching key.  This is a relatively common
@@ -300,33 +285,45 @@ hash_table_insert(struct hash_table *ht, uint32_t hash,
        * required to avoid memory leaks, perform a search
        * before inserting.
        */
-      if (entry->hash == hash &&
-          ht->key_equals_function(key, entry->key)) {
-         entry->key = key;
-         entry->data = data;
-         return entry;
-      }
+      while (match) {
+         struct hash_entry *entry = ht->table + offset + u_bit_scan(&match);
 
+         if (entry->hash == hash &&
+             ht->key_equals_function(key, entry->key)) {
+            entry->key = key;
+            entry->data = data;
+            return entry;
+         }
+      }
 
-      double_hash = 1 + hash % ht->rehash;
+      /* Stash the first available entry we find */
+      if (available_index == ~0u) {
+         unsigned available = hash_group_match_available(group);
 
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != start_hash_address);
+         if (available)
+            available_index = offset + u_bit_scan(&available);
+      }
 
-   if (available_entry) {
-      if (entry_is_deleted(ht, available_entry))
-         ht->deleted_entries--;
-      available_entry->hash = hash;
-      available_entry->key = key;
-      available_entry->data = data;
-      ht->entries++;
-      return available_entry;
-   }
+      if (hash_group_match(group, HASH_CTRL_EMPTY))
+         break;
+   } while (hash_probe_next(&probe));
 
-   /* We could hit here if a required resize failed. An unchecked-malloc
+   /* We could hit this if a required resize failed. An unchecked-malloc
     * application could ignore this result.
     */
-   return NULL;
+   if (available_index == ~0u)
+      return NULL;
+
+   if (ht->ctrl[available_index] == HASH_CTRL_DELETED)
+      ht->deleted_entries--;
+
+   ht->ctrl[available_index] = tag;
+   available_entry = ht->table + available_index;
+   available_entry->hash = hash;
+   available_entry->key = key;
+   available_entry->data = data;
+   ht->entries++;
+   return available_entry;
 }
 
 /**
@@ -360,12 +357,26 @@ void
 _mesa_hash_table_remove(struct hash_table *ht,
                         struct hash_entry *entry)
 {
+   uint32_t i, group;
+
    if (!entry)
       return;
 
+   i = entry - ht->table;
+   group = i & ~(HASH_GROUP_SIZE - 1);
+
+   /* Lookups never went past a group that still has an empty slot, so
+    * the slot can simply be emptied in that case.
+    */
+   if (hash_group_match(ht->ctrl + group, HASH_CTRL_EMPTY)) {
+      ht->ctrl[i] = HASH_CTRL_EMPTY;
+   } else {
+      ht->ctrl[i] = HASH_CTRL_DELETED;
+      ht->deleted_entries++;
+   }
+
    entry->key = ht->deleted_key;
    ht->entries--;
-   ht->deleted_entries++;
 }
 
 /**
@@ -378,15 +389,11 @@ struct hash_entry *
 _mesa_hash_table_next_entry(struct hash_table *ht,
                             struct hash_entry *entry)
 {
-   if (entry == NULL)
-      entry = ht->table;
-   else
-      entry = entry + 1;
-
-   for (; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(ht, entry)) {
-         return entry;
-      }
+   uint32_t i = entry == NULL ? 0 : entry - ht->table + 1;
+
+   for (; i < ht->size; i++) {
+      if (hash_ctrl_is_full(ht->ctrl[i]))
+         return ht->table + i;
    }
 
    return NULL;
@@ -404,30 +411,24 @@ struct hash_entry *
 _mesa_hash_table_random_entry(struct hash_table *ht,
                               bool (*predicate)(struct hash_entry *entry))
 {
-   struct hash_entry *entry;
-   uint32_t i = rand() % ht->size;
+   uint32_t start = rand() & (ht->size - 1);
+   uint32_t i;
 
    if (ht->entries == 0)
       return NULL;
 
-   for (entry = ht->table + i; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(ht, entry) &&
-          (!predicate || predicate(entry))) {
-         return entry;
-      }
-   }
+   for (i = 0; i < ht->size; i++) {
+      uint32_t j = (start + i) & (ht->size - 1);
 
-   for (entry = ht->table; entry != ht->table + i; entry++) {
-      if (entry_is_present(ht, entry) &&
-          (!predicate || predicate(entry))) {
-         return entry;
+      if (hash_ctrl_is_full(ht->ctrl[j]) &&
+          (!predicate || predicate(ht->table + j))) {
+         return ht->table + j;
       }
    }
 
    return NULL;
 }
 
-
 /**
  * Quick FNV-1a hash implementation based on:
  * http://www.isthe.com/chongo/tech/comp/fnv/
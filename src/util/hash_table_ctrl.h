@@ -0,0 +1,183 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file hash_table_ctrl.h
+ *
+ * Control bytes shared by the hash table and set implementations.
+ *
+ * Next to its array of entries, each table keeps an array with one control
+ * byte per entry.  The byte says whether the slot is empty, deleted or in
+ * use, and for slots in use it holds 7 bits of the hash.  Lookups walk the
+ * control bytes a group of HASH_GROUP_SIZE at a time, comparing the whole
+ * group at once (with SSE2 when available), and only load the entries whose
+ * control byte matches.  A lookup stops at the first group with an empty
+ * slot, which is why removing an entry only needs a tombstone when its
+ * group is full.
+ *
+ * Table sizes are powers of two.  Tables smaller than a group still get a
+ * full group of control bytes, with HASH_CTRL_SENTINEL past the end of the
+ * table so that those slots never match anything.
+ */
+
+#ifndef _HASH_TABLE_CTRL_H
+#define _HASH_TABLE_CTRL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "util/u_math.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HASH_CTRL_USE_SSE2
+#endif
+
+#define HASH_CTRL_EMPTY    0x80
+#define HASH_CTRL_DELETED  0xfe
+#define HASH_CTRL_SENTINEL 0xff
+
+#define HASH_GROUP_SIZE    16
+
+/** log2 of the size of a newly created table. */
+#define HASH_MIN_SIZE_LOG2 3
+
+/**
+ * Tables are grown (or cleaned of tombstones) once used and deleted slots
+ * reach 7/8 of the size, so every probe sequence ends at an empty slot.
+ */
+static inline uint32_t
+hash_ctrl_max_entries(uint32_t size)
+{
+   return size - size / 8;
+}
+
+static inline uint32_t
+hash_ctrl_alloc_size(uint32_t size)
+{
+   return MAX2(size, HASH_GROUP_SIZE);
+}
+
+/**
+ * Scrambles the caller's hash, so that hash functions like the identity on
+ * pointers still spread the entries over the table.  The low 7 bits are
+ * stored in the control byte and the rest picks the first group to probe.
+ */
+static inline uint32_t
+hash_ctrl_mix(uint32_t hash)
+{
+   hash *= 0x9e3779b1;
+   return hash ^ (hash >> 15);
+}
+
+static inline uint8_t
+hash_ctrl_tag(uint32_t mixed)
+{
+   return mixed & 0x7f;
+}
+
+static inline bool
+hash_ctrl_is_full(uint8_t ctrl)
+{
+   return ctrl < HASH_CTRL_EMPTY;
+}
+
+static inline void
+hash_ctrl_init(uint8_t *ctrl, uint32_t size)
+{
+   memset(ctrl, HASH_CTRL_EMPTY, size);
+   if (size < HASH_GROUP_SIZE)
+      memset(ctrl + size, HASH_CTRL_SENTINEL, HASH_GROUP_SIZE - size);
+}
+
+/**
+ * Returns a bitmask of the slots in the group starting at ctrl whose
+ * control byte equals value.
+ */
+static inline unsigned
+hash_group_match(const uint8_t *ctrl, uint8_t value)
+{
+#ifdef HASH_CTRL_USE_SSE2
+   __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+#else
+   unsigned mask = 0;
+   unsigned i;
+
+   for (i = 0; i < HASH_GROUP_SIZE; i++) {
+      if (ctrl[i] == value)
+         mask |= 1u << i;
+   }
+
+   return mask;
+#endif
+}
+
+/** Returns a bitmask of the empty or deleted slots of the group. */
+static inline unsigned
+hash_group_match_available(const uint8_t *ctrl)
+{
+   return hash_group_match(ctrl, HASH_CTRL_EMPTY) |
+          hash_group_match(ctrl, HASH_CTRL_DELETED);
+}
+
+/**
+ * Iterator over the groups to look at for a hash.
+ *
+ * Groups are visited in triangular order (start, start + 1, start + 3,
+ * start + 6, ...), which covers every group exactly once since the
+ * number of groups is a power of two.
+ */
+struct hash_probe {
+   uint32_t group;
+   uint32_t stride;
+   uint32_t mask;
+};
+
+static inline void
+hash_probe_init(struct hash_probe *probe, uint32_t mixed, uint32_t size)
+{
+   probe->mask = size > HASH_GROUP_SIZE ? size / HASH_GROUP_SIZE - 1 : 0;
+   probe->group = (mixed >> 7) & probe->mask;
+   probe->stride = 0;
+}
+
+/** Returns the index of the first slot of the current group. */
+static inline uint32_t
+hash_probe_offset(const struct hash_probe *probe)
+{
+   return probe->group * HASH_GROUP_SIZE;
+}
+
+static inline bool
+hash_probe_next(struct hash_probe *probe)
+{
+   if (probe->stride == probe->mask)
+      return false;
+
+   probe->stride++;
+   probe->group = (probe->group + probe->stride) & probe->mask;
+   return true;
+}
+
+#endif /* _HASH_TABLE_CTRL_H */
@@ -513,3 +513,199 @@ ralloc_vasprintf_rewrite_tail(char **str, size_t *start, const char *fmt,
    *start += new_length;
    return true;
 }
+
+/*
+ * Linear allocator for short-lived trees.
+ *
+ * A linear parent is the start of a ralloc'd buffer.  Children are carved
+ * out of that buffer, and once it is full out of further buffers that are
+ * ralloc children of the first one, so freeing or stealing the parent's
+ * buffer takes all of them along.
+ */
+
+#define LMAGIC 0x87b9c7d3
+#define MIN_LINEAR_BUFSIZE 2048
+#define SUBALLOC_ALIGNMENT 8
+
+struct linear_header {
+#ifdef DEBUG
+   unsigned magic;
+#endif
+   unsigned offset;              /* first unused byte of this buffer */
+   unsigned size;                /* usable size of this buffer */
+   struct linear_header *latest; /* buffer with free space (parent only) */
+
+   /* Statistics, only kept in the parent's buffer */
+   unsigned num_buffers;
+   unsigned num_allocations;
+   size_t bytes_allocated;
+};
+
+typedef struct linear_header linear_header;
+
+#define LINEAR_HEADER_SIZE \
+   ((sizeof(linear_header) + SUBALLOC_ALIGNMENT - 1) & \
+    ~(size_t) (SUBALLOC_ALIGNMENT - 1))
+
+#define LINEAR_PARENT_TO_HEADER(parent) \
+   ((linear_header *) ((char *) (parent) - LINEAR_HEADER_SIZE))
+
+static linear_header *
+get_linear_header(const void *parent)
+{
+   linear_header *first = LINEAR_PARENT_TO_HEADER(parent);
+#ifdef DEBUG
+   assert(first->magic == LMAGIC);
+#endif
+   return first;
+}
+
+static linear_header *
+create_linear_buffer(const void *ralloc_ctx, unsigned size)
+{
+   linear_header *node;
+
+   if (size < MIN_LINEAR_BUFSIZE)
+      size = MIN_LINEAR_BUFSIZE;
+
+   node = ralloc_size(ralloc_ctx, LINEAR_HEADER_SIZE + size);
+   if (unlikely(node == NULL))
+      return NULL;
+
+#ifdef DEBUG
+   node->magic = LMAGIC;
+#endif
+   node->offset = 0;
+   node->size = size;
+   node->latest = node;
+   node->num_buffers = 1;
+   node->num_allocations = 0;
+   node->bytes_allocated = 0;
+
+   return node;
+}
+
+void *
+linear_alloc_child(void *parent, unsigned size)
+{
+   linear_header *first = get_linear_header(parent);
+   linear_header *latest = first->latest;
+   void *ptr;
+
+   size = (size + SUBALLOC_ALIGNMENT - 1) & ~(SUBALLOC_ALIGNMENT - 1);
+
+   if (unlikely(latest->offset + size > latest->size)) {
+      linear_header *node = create_linear_buffer(first, size);
+      if (unlikely(node == NULL))
+         return NULL;
+
+      /* Don't give up the rest of the current buffer for a big block. */
+      if (node->size - size >= latest->size - latest->offset)
+         first->latest = node;
+      first->num_buffers++;
+      latest = node;
+   }
+
+   ptr = (char *) latest + LINEAR_HEADER_SIZE + latest->offset;
+   latest->offset += size;
+
+   first->num_allocations++;
+   first->bytes_allocated += size;
+
+   return ptr;
+}
+
+void *
+linear_alloc_parent(const void *ralloc_ctx, unsigned size)
+{
+   linear_header *node = create_linear_buffer(ralloc_ctx, size);
+
+   if (unlikely(node == NULL))
+      return NULL;
+
+   /* The parent pointer is the start of the first buffer's space, which is
+    * where its own allocation of \p size bytes lives.
+    */
+   size = (size + SUBALLOC_ALIGNMENT - 1) & ~(SUBALLOC_ALIGNMENT - 1);
+   node->offset = size;
+   node->bytes_allocated = size;
+
+   return (char *) node + LINEAR_HEADER_SIZE;
+}
+
+void *
+linear_zalloc_child(void *parent, unsigned size)
+{
+   void *ptr = linear_alloc_child(parent, size);
+
+   if (likely(ptr != NULL))
+      memset(ptr, 0, size);
+   return ptr;
+}
+
+void *
+linear_zalloc_parent(const void *ralloc_ctx, unsigned size)
+{
+   void *ptr = linear_alloc_parent(ralloc_ctx, size);
+
+   if (likely(ptr != NULL))
+      memset(ptr, 0, size);
+   return ptr;
+}
+
+void
+linear_free_parent(void *parent)
+{
+   if (unlikely(parent == NULL))
+      return;
+
+   ralloc_free(get_linear_header(parent));
+}
+
+void
+ralloc_steal_linear_parent(const void *new_ralloc_ctx, void *parent)
+{
+   if (unlikely(parent == NULL))
+      return;
+
+   ralloc_steal(new_ralloc_ctx, get_linear_header(parent));
+}
+
+char *
+linear_strdup(void *parent, const char *str)
+{
+   size_t n;
+   char *ptr;
+
+   if (unlikely(str == NULL))
+      return NULL;
+
+   n = strlen(str);
+   ptr = linear_alloc_child(parent, n + 1);
+   if (unlikely(ptr == NULL))
+      return NULL;
+
+   memcpy(ptr, str, n);
+   ptr[n] = '\0';
+   return ptr;
+}
+
+void
+linear_get_stats(const void *parent, struct linear_stats *stats)
+{
+   const linear_header *first = get_linear_header(parent);
+   const ralloc_header *child;
+
+   stats->num_buffers = first->num_buffers;
+   stats->num_allocations = first->num_allocations;
+   stats->bytes_allocated = first->bytes_allocated;
+
+   /* Every buffer but the first is a ralloc child of the first one. */
+   stats->bytes_reserved = first->size;
+   for (child = get_header(first)->child; child != NULL;
+        child = child->next) {
+      const linear_header *node =
+         (const linear_header *) PTR_FROM_HEADER(child);
+      stats->bytes_reserved += node->size;
+   }
+}
@@ -407,6 +407,60 @@ bool ralloc_asprintf_append (char **str, const char *fmt, ...)
 bool ralloc_vasprintf_append(char **str, const char *fmt, va_list args);
 /// @}
 
+/**
+ * \name Linear allocator
+ *
+ * A fast alternative to ralloc for trees of small objects that are all freed
+ * together, such as the AST of a shader.
+ *
+ * A linear parent is created out of a ralloc context, and is freed or
+ * stolen along with it like any other ralloc'd block.  Children of a linear
+ * parent are carved out of large buffers owned by the parent.  They have no
+ * header, cannot be freed, reallocated or stolen individually and must not
+ * be passed to any ralloc function; their memory is reclaimed when the
+ * parent is freed.
+ */
+/// @{
+
+/**
+ * Allocate a linear parent of \p size bytes owned by \p ralloc_ctx.
+ *
+ * The returned pointer is used as the parent of linear children.
+ */
+void *linear_alloc_parent(const void *ralloc_ctx, unsigned size);
+
+/** Like linear_alloc_parent(), but the memory is zeroed. */
+void *linear_zalloc_parent(const void *ralloc_ctx, unsigned size);
+
+/** Allocate \p size bytes from the buffers of linear \p parent. */
+void *linear_alloc_child(void *parent, unsigned size);
+
+/** Like linear_alloc_child(), but the memory is zeroed. */
+void *linear_zalloc_child(void *parent, unsigned size);
+
+/** Free a linear parent together with all of its children. */
+void linear_free_parent(void *parent);
+
+/** Move a linear parent and its children to another ralloc context. */
+void ralloc_steal_linear_parent(const void *new_ralloc_ctx, void *parent);
+
+/** Duplicate a string into a linear child of \p parent. */
+char *linear_strdup(void *parent, const char *str);
+
+/**
+ * Memory usage of a linear parent and its children.
+ */
+struct linear_stats
+{
+   unsigned num_buffers;     /**< Buffers the allocations were carved out of */
+   unsigned num_allocations; /**< Children allocated */
+   size_t bytes_allocated;   /**< Bytes handed out, including the parent */
+   size_t bytes_reserved;    /**< Bytes in all buffers */
+};
+
+void linear_get_stats(const void *parent, struct linear_stats *stats);
+/// @}
+
 #ifdef __cplusplus
 } /* end of extern "C" */
 #endif
@@ -449,4 +503,29 @@ public:                                                                  \
    }
 
 
+/**
+ * Declare C++ new and delete operators which use the linear allocator.
+ *
+ * Placing this macro in the body of a class makes it possible to do:
+ *
+ * TYPE *var = new(linear_parent) TYPE(...);
+ *
+ * The memory is zeroed like that of ralloc'd objects.  Destructors are not
+ * run when the linear parent is freed, and delete does not release memory.
+ */
+#define DECLARE_LINEAR_ZALLOC_CXX_OPERATORS(TYPE)                         \
+public:                                                                  \
+   static void* operator new(size_t size, void *linear_parent)           \
+   {                                                                     \
+      void *p = linear_zalloc_child(linear_parent, size);                \
+      assert(p != NULL);                                                 \
+      return p;                                                          \
+   }                                                                     \
+                                                                         \
+   static void operator delete(void *p)                                  \
+   {                                                                     \
+      /* The memory is freed along with the linear parent. */            \
+   }
+
+
 #endif
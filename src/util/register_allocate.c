@@ -68,9 +68,15 @@
  * up front and stored in a 2-dimensional array, so that the cost of
  * coloring a node is constant with the number of registers.  We do
  * this during ra_set_finalize().
+ *
+ * Large shaders produce graphs with tens of thousands of nodes, so
+ * simplification never rescans the whole graph to find the next node
+ * to push: the nodes passing the pq test are kept in a bitset, and the
+ * ones failing it in a heap ordered by q total.
  */
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "ralloc.h"
 #include "main/imports.h"
@@ -174,6 +180,26 @@ struct ra_graph {
     * stack.
     */
    unsigned int stack_optimistic_start;
+
+   /** @{
+    * Worklists used during ra_simplify().
+    *
+    * ready has a bit set for each node that is not on the stack yet and
+    * passes the pq test.  optimistic is a binary min-heap holding the other
+    * nodes, keyed by ra_optimistic_key().  Heap entries aren't updated in
+    * place when a q total drops.  Instead the node is added to the dirty
+    * list, which gets pushed into the heap again only when an optimistic
+    * node is actually needed, and stale entries are thrown away when they
+    * reach the top.
+    */
+   BITSET_WORD *ready;
+   uint64_t *optimistic;
+   unsigned int optimistic_count;
+   unsigned int optimistic_size;
+   BITSET_WORD *dirty;
+   unsigned int *dirty_list;
+   unsigned int dirty_count;
+   /** @} */
 };
 
 /**
@@ -341,7 +367,7 @@ reg_belongs_to_class(unsigned int r, struct ra_class *c)
 void
 ra_set_finalize(struct ra_regs *regs, unsigned int **q_values)
 {
-   unsigned int b, c;
+   unsigned int b, c, i;
 
    for (b = 0; b < regs->class_count; b++) {
       regs->classes[b]->q = ralloc_array(regs, unsigned int, regs->class_count);
@@ -356,27 +382,35 @@ ra_set_finalize(struct ra_regs *regs, unsigned int **q_values)
    } else {
       /* Compute, for each class B and C, how many regs of B an
        * allocation to C could conflict with.
+       *
+       * Only the members of C are visited, rather than testing every
+       * register for membership.  The counts come from the conflict lists,
+       * which leave out what ra_make_reg_conflicts_transitive() adds.
        */
       for (b = 0; b < regs->class_count; b++) {
-         for (c = 0; c < regs->class_count; c++) {
-            unsigned int rc;
-            int max_conflicts = 0;
+         for (c = 0; c < regs->class_count; c++)
+            regs->classes[b]->q[c] = 0;
+      }
+
+      for (c = 0; c < regs->class_count; c++) {
+         BITSET_WORD tmp;
+         int rc;
 
-            for (rc = 0; rc < regs->count; rc++) {
-               int conflicts = 0;
-               unsigned int i;
+         BITSET_FOREACH_SET(rc, tmp, regs->classes[c]->regs, regs->count) {
+            const struct ra_reg *reg = &regs->regs[rc];
 
-               if (!reg_belongs_to_class(rc, regs->classes[c]))
-                  continue;
+            for (b = 0; b < regs->class_count; b++) {
+               unsigned int conflicts = 0;
 
-               for (i = 0; i < regs->regs[rc].num_conflicts; i++) {
-                  unsigned int rb = regs->regs[rc].conflict_list[i];
-                  if (reg_belongs_to_class(rb, regs->classes[b]))
+               for (i = 0; i < reg->num_conflicts; i++) {
+                  if (reg_belongs_to_class(reg->conflict_list[i],
+                                           regs->classes[b]))
                      conflicts++;
                }
-               max_conflicts = MAX2(max_conflicts, conflicts);
+
+               regs->classes[b]->q[c] = MAX2(regs->classes[b]->q[c],
+                                             conflicts);
             }
-            regs->classes[b]->q[c] = max_conflicts;
          }
       }
    }
@@ -465,6 +499,62 @@ pq_test(struct ra_graph *g, unsigned int n)
    return g->nodes[n].q_total < g->regs->classes[n_class]->p;
 }
 
+/**
+ * Heap key for the optimistic worklist.  Nodes with a lower q total
+ * come first, and ties go to the highest-numbered node.
+ */
+static uint64_t
+ra_optimistic_key(struct ra_graph *g, unsigned int n)
+{
+   return ((uint64_t)g->nodes[n].q_total << 32) | (UINT32_MAX - n);
+}
+
+static void
+ra_optimistic_push(struct ra_graph *g, unsigned int n)
+{
+   uint64_t key = ra_optimistic_key(g, n);
+   unsigned int i;
+
+   if (g->optimistic_count == g->optimistic_size) {
+      g->optimistic_size *= 2;
+      g->optimistic = reralloc(g, g->optimistic, uint64_t,
+                               g->optimistic_size);
+   }
+
+   i = g->optimistic_count++;
+   while (i > 0 && g->optimistic[(i - 1) / 2] > key) {
+      g->optimistic[i] = g->optimistic[(i - 1) / 2];
+      i = (i - 1) / 2;
+   }
+   g->optimistic[i] = key;
+}
+
+static uint64_t
+ra_optimistic_pop(struct ra_graph *g)
+{
+   uint64_t top = g->optimistic[0];
+   uint64_t last = g->optimistic[--g->optimistic_count];
+   unsigned int i = 0;
+
+   for (;;) {
+      unsigned int child = 2 * i + 1;
+
+      if (child >= g->optimistic_count)
+         break;
+      if (child + 1 < g->optimistic_count &&
+          g->optimistic[child + 1] < g->optimistic[child])
+         child++;
+      if (last <= g->optimistic[child])
+         break;
+
+      g->optimistic[i] = g->optimistic[child];
+      i = child;
+   }
+   g->optimistic[i] = last;
+
+   return top;
+}
+
 static void
 decrement_q(struct ra_graph *g, unsigned int n)
 {
@@ -476,12 +566,58 @@ decrement_q(struct ra_graph *g, unsigned int n)
       unsigned int n2_class = g->nodes[n2].class;
 
       if (n != n2 && !g->nodes[n2].in_stack) {
-         assert(g->nodes[n2].q_total >= g->regs->classes[n2_class]->q[n_class]);
-         g->nodes[n2].q_total -= g->regs->classes[n2_class]->q[n_class];
+         unsigned int q = g->regs->classes[n2_class]->q[n_class];
+
+         assert(g->nodes[n2].q_total >= q);
+         g->nodes[n2].q_total -= q;
+
+         if (q == 0 || g->nodes[n2].reg != NO_REG ||
+             BITSET_TEST(g->ready, n2))
+            continue;
+
+         if (pq_test(g, n2)) {
+            BITSET_SET(g->ready, n2);
+         } else if (!BITSET_TEST(g->dirty, n2)) {
+            BITSET_SET(g->dirty, n2);
+            g->dirty_list[g->dirty_count++] = n2;
+         }
       }
    }
 }
 
+/**
+ * Returns the highest-numbered node below limit in the ready set, or -1
+ * if there is none.
+ */
+static int
+ra_find_ready_node(struct ra_graph *g, unsigned int limit)
+{
+   while (limit > 0) {
+      unsigned int w = (limit - 1) / BITSET_WORDBITS;
+      unsigned int bits = limit - w * BITSET_WORDBITS;
+      BITSET_WORD word = g->ready[w];
+
+      if (bits < BITSET_WORDBITS)
+         word &= (1u << bits) - 1;
+      if (word)
+         return w * BITSET_WORDBITS + util_last_bit(word) - 1;
+
+      limit = w * BITSET_WORDBITS;
+   }
+
+   return -1;
+}
+
+static void
+ra_push_node(struct ra_graph *g, unsigned int n)
+{
+   BITSET_CLEAR(g->ready, n);
+   g->nodes[n].in_stack = true;
+   decrement_q(g, n);
+   g->stack[g->stack_count] = n;
+   g->stack_count++;
+}
+
 /**
  * Simplifies the interference graph by pushing all
  * trivially-colorable nodes into a stack of nodes to be colored,
@@ -497,45 +633,78 @@ ra_simplify(struct ra_graph *g)
 {
    bool progress = true;
    unsigned int stack_optimistic_start = UINT_MAX;
-   int i;
+   unsigned int i;
+
+   g->ready = rzalloc_array(g, BITSET_WORD, BITSET_WORDS(g->count));
+   g->optimistic_size = MAX2(g->count, 4);
+   g->optimistic = ralloc_array(g, uint64_t, g->optimistic_size);
+   g->optimistic_count = 0;
+   g->dirty = rzalloc_array(g, BITSET_WORD, BITSET_WORDS(g->count));
+   g->dirty_list = ralloc_array(g, unsigned int, g->count);
+   g->dirty_count = 0;
+
+   for (i = 0; i < g->count; i++) {
+      if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
+         continue;
+
+      if (pq_test(g, i))
+         BITSET_SET(g->ready, i);
+      else
+         ra_optimistic_push(g, i);
+   }
 
    while (progress) {
-      unsigned int best_optimistic_node = ~0;
-      unsigned int lowest_q_total = ~0;
+      unsigned int limit = g->count;
+      int n;
 
       progress = false;
 
-      for (i = g->count - 1; i >= 0; i--) {
-	 if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
-	    continue;
+      /* Walk down from the top of the graph, pushing every trivially
+       * colorable node we pass, including the ones that only become
+       * colorable because of a node pushed earlier in the same walk.
+       */
+      while ((n = ra_find_ready_node(g, limit)) >= 0) {
+         ra_push_node(g, n);
+         limit = n;
+         progress = true;
+      }
 
-	 if (pq_test(g, i)) {
-	    decrement_q(g, i);
-	    g->stack[g->stack_count] = i;
-	    g->stack_count++;
-	    g->nodes[i].in_stack = true;
-	    progress = true;
-	 } else {
-	    unsigned int new_q_total = g->nodes[i].q_total;
-	    if (new_q_total < lowest_q_total) {
-	       best_optimistic_node = i;
-	       lowest_q_total = new_q_total;
-	    }
-	 }
+      if (progress)
+         continue;
+
+      for (i = 0; i < g->dirty_count; i++) {
+         n = g->dirty_list[i];
+         BITSET_CLEAR(g->dirty, n);
+         if (!g->nodes[n].in_stack && !BITSET_TEST(g->ready, n))
+            ra_optimistic_push(g, n);
       }
+      g->dirty_count = 0;
+
+      while (g->optimistic_count > 0) {
+         uint64_t key = ra_optimistic_pop(g);
+
+         n = UINT32_MAX - (uint32_t)key;
+         if (g->nodes[n].in_stack || key != ra_optimistic_key(g, n))
+            continue;
 
-      if (!progress && best_optimistic_node != ~0U) {
          if (stack_optimistic_start == UINT_MAX)
             stack_optimistic_start = g->stack_count;
 
-	 decrement_q(g, best_optimistic_node);
-	 g->stack[g->stack_count] = best_optimistic_node;
-	 g->stack_count++;
-	 g->nodes[best_optimistic_node].in_stack = true;
-	 progress = true;
+         ra_push_node(g, n);
+         progress = true;
+         break;
       }
    }
 
+   ralloc_free(g->ready);
+   ralloc_free(g->optimistic);
+   ralloc_free(g->dirty);
+   ralloc_free(g->dirty_list);
+   g->ready = NULL;
+   g->optimistic = NULL;
+   g->dirty = NULL;
+   g->dirty_list = NULL;
+
    g->stack_optimistic_start = stack_optimistic_start;
 }
 
@@ -549,34 +718,53 @@ ra_simplify(struct ra_graph *g)
 static bool
 ra_select(struct ra_graph *g)
 {
+   const unsigned int reg_words = BITSET_WORDS(g->regs->count);
+   BITSET_WORD *used = rzalloc_array(g, BITSET_WORD, reg_words);
    int start_search_reg = 0;
 
    while (g->stack_count != 0) {
-      unsigned int i;
+      unsigned int i, w;
       unsigned int ri;
       unsigned int r = -1;
       int n = g->stack[g->stack_count - 1];
       struct ra_class *c = g->regs->classes[g->nodes[n].class];
 
+      /* Gather the registers already given to our neighbors, so that each
+       * candidate register below is checked against all of them at once
+       * instead of walking the adjacency list again.
+       */
+      for (i = 0; i < g->nodes[n].adjacency_count; i++) {
+         unsigned int n2 = g->nodes[n].adjacency_list[i];
+
+         if (!g->nodes[n2].in_stack && g->nodes[n2].reg != NO_REG)
+            BITSET_SET(used, g->nodes[n2].reg);
+      }
+
       /* Find the lowest-numbered reg which is not used by a member
        * of the graph adjacent to us.
        */
       for (ri = 0; ri < g->regs->count; ri++) {
+         const BITSET_WORD *conflicts;
+
          r = (start_search_reg + ri) % g->regs->count;
          if (!reg_belongs_to_class(r, c))
 	    continue;
 
 	 /* Check if any of our neighbors conflict with this register choice. */
-	 for (i = 0; i < g->nodes[n].adjacency_count; i++) {
-	    unsigned int n2 = g->nodes[n].adjacency_list[i];
-
-	    if (!g->nodes[n2].in_stack &&
-		BITSET_TEST(g->regs->regs[r].conflicts, g->nodes[n2].reg)) {
-	       break;
-	    }
-	 }
-	 if (i == g->nodes[n].adjacency_count)
-	    break;
+         conflicts = g->regs->regs[r].conflicts;
+         for (w = 0; w < reg_words; w++) {
+            if (conflicts[w] & used[w])
+               break;
+         }
+         if (w == reg_words)
+            break;
+      }
+
+      for (i = 0; i < g->nodes[n].adjacency_count; i++) {
+         unsigned int n2 = g->nodes[n].adjacency_list[i];
+
+         if (g->nodes[n2].reg != NO_REG)
+            BITSET_CLEAR(used, g->nodes[n2].reg);
       }
 
       /* set this to false even if we return here so that
@@ -584,8 +772,10 @@ ra_select(struct ra_graph *g)
        */
       g->nodes[n].in_stack = false;
 
-      if (ri == g->regs->count)
+      if (ri == g->regs->count) {
+         ralloc_free(used);
 	 return false;
+      }
 
       g->nodes[n].reg = r;
       g->stack_count--;
@@ -604,6 +794,7 @@ ra_select(struct ra_graph *g)
          start_search_reg = r + 1;
    }
 
+   ralloc_free(used);
    return true;
 }
 
@@ -39,10 +39,12 @@ struct ra_regs;
 /* @{
  * Register set setup.
  *
- * This should be done once at backend initializaion, as
- * ra_set_finalize is O(r^2*c^2).  The registers may be virtual
- * registers, such as aligned register pairs that conflict with the
- * two real registers from which they are composed.
+ * This should be done once at backend initializaion, as unless q values
+ * are passed in, ra_set_finalize walks the conflict list of every member
+ * of every class once per class.  That is O(c^2*r*k) for c classes of up
+ * to r registers with up to k conflicts each.  The registers may be
+ * virtual registers, such as aligned register pairs that conflict with
+ * the two real registers from which they are composed.
  */
 struct ra_regs *ra_alloc_reg_set(void *mem_ctx, unsigned int count,
                                  bool need_conflict_lists);
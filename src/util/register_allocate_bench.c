@@ -0,0 +1,220 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file register_allocate_bench.c
+ *
+ * Times the register allocator on synthetic interference graphs.
+ *
+ * The register set looks like a typical scalar backend: a file of base
+ * registers, plus classes of aligned 2- and 4-register vectors that
+ * conflict with the base registers they cover.  Each graph is made of
+ * random live ranges over a straight-line program, with two nodes
+ * interfering when their ranges overlap.  Every allocation is checked
+ * for interfering nodes ending up in conflicting registers.
+ *
+ * Usage: register_allocate_bench [nodes [registers [iterations]]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ralloc.h"
+#include "register_allocate.h"
+
+struct live_range {
+   unsigned start, end;
+   unsigned size;
+};
+
+static unsigned class_size[] = { 1, 2, 4 };
+#define CLASS_COUNT (sizeof(class_size) / sizeof(class_size[0]))
+
+static double
+get_time(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Register number of the first vector of the given class. */
+static unsigned
+class_base(unsigned base_regs, unsigned c)
+{
+   unsigned i, base = 0;
+
+   for (i = 0; i < c; i++)
+      base += base_regs / class_size[i];
+
+   return base;
+}
+
+static struct ra_regs *
+build_reg_set(unsigned base_regs, unsigned *classes)
+{
+   unsigned total = class_base(base_regs, CLASS_COUNT);
+   struct ra_regs *regs = ra_alloc_reg_set(NULL, total, true);
+   unsigned c, i, j;
+
+   for (c = 0; c < CLASS_COUNT; c++) {
+      unsigned base = class_base(base_regs, c);
+
+      classes[c] = ra_alloc_reg_class(regs);
+
+      for (i = 0; i < base_regs / class_size[c]; i++) {
+         ra_class_add_reg(regs, classes[c], base + i);
+
+         if (c == 0)
+            continue;
+
+         for (j = 0; j < class_size[c]; j++)
+            ra_add_transitive_reg_conflict(regs, i * class_size[c] + j,
+                                           base + i);
+      }
+   }
+
+   ra_set_finalize(regs, NULL);
+
+   return regs;
+}
+
+static bool
+ranges_interfere(const struct live_range *a, const struct live_range *b)
+{
+   return a->start < b->end && b->start < a->end;
+}
+
+/* Finds the range of base registers covered by register r. */
+static void
+reg_span(unsigned base_regs, unsigned r, unsigned *first, unsigned *last)
+{
+   unsigned c = CLASS_COUNT - 1;
+
+   while (r < class_base(base_regs, c))
+      c--;
+
+   *first = (r - class_base(base_regs, c)) * class_size[c];
+   *last = *first + class_size[c] - 1;
+}
+
+static bool
+check_allocation(struct ra_graph *g, const struct live_range *ranges,
+                 unsigned count, unsigned base_regs)
+{
+   unsigned i, j;
+
+   for (i = 0; i < count; i++) {
+      unsigned first_i, last_i;
+
+      reg_span(base_regs, ra_get_node_reg(g, i), &first_i, &last_i);
+
+      for (j = i + 1; j < count; j++) {
+         unsigned first_j, last_j;
+
+         if (!ranges_interfere(&ranges[i], &ranges[j]))
+            continue;
+
+         reg_span(base_regs, ra_get_node_reg(g, j), &first_j, &last_j);
+         if (first_i <= last_j && first_j <= last_i) {
+            fprintf(stderr, "nodes %u and %u were given conflicting "
+                    "registers\n", i, j);
+            return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned count = argc > 1 ? atoi(argv[1]) : 10000;
+   unsigned base_regs = argc > 2 ? atoi(argv[2]) : 128;
+   unsigned iterations = argc > 3 ? atoi(argv[3]) : 5;
+   unsigned classes[CLASS_COUNT];
+   struct live_range *ranges;
+   struct ra_regs *regs;
+   double start, finalize_time, build_time = 0, alloc_time = 0;
+   unsigned iter, i, j, failed = 0;
+   bool ok = true;
+
+   srand(0);
+
+   start = get_time();
+   regs = build_reg_set(base_regs, classes);
+   finalize_time = get_time() - start;
+
+   ranges = malloc(count * sizeof(*ranges));
+
+   for (iter = 0; iter < iterations; iter++) {
+      struct ra_graph *g;
+      bool colored;
+
+      /* Keep the register pressure around the size of the register file,
+       * so that some graphs need optimistic coloring.
+       */
+      for (i = 0; i < count; i++) {
+         ranges[i].start = rand() % count;
+         ranges[i].end = ranges[i].start + 1 + rand() % (base_regs / 3);
+         ranges[i].size = rand() % CLASS_COUNT;
+      }
+
+      start = get_time();
+      g = ra_alloc_interference_graph(regs, count);
+      for (i = 0; i < count; i++) {
+         ra_set_node_class(g, i, classes[ranges[i].size]);
+         for (j = 0; j < i; j++) {
+            if (ranges_interfere(&ranges[i], &ranges[j]))
+               ra_add_node_interference(g, i, j);
+         }
+      }
+      build_time += get_time() - start;
+
+      start = get_time();
+      colored = ra_allocate(g);
+      alloc_time += get_time() - start;
+
+      if (!colored)
+         failed++;
+      else if (!check_allocation(g, ranges, count, base_regs))
+         ok = false;
+
+      ralloc_free(g);
+   }
+
+   printf("%u nodes, %u registers, %u iterations (%u failed to color)\n",
+          count, base_regs, iterations, failed);
+   printf("ra_set_finalize:    %10.3f ms\n", finalize_time * 1000);
+   printf("graph construction: %10.3f ms/graph\n",
+          build_time * 1000 / iterations);
+   printf("ra_allocate:        %10.3f ms/graph\n",
+          alloc_time * 1000 / iterations);
+
+   free(ranges);
+   ralloc_free(regs);
+
+   return ok ? 0 : 1;
+}
@@ -38,68 +38,39 @@
 #include "macros.h"
 #include "ralloc.h"
 #include "set.h"
-
-/*
- * From Knuth -- a good choice for hash/rehash values is p, p-2 where
- * p and p-2 are both prime.  These tables are sized to have an extra 10%
- * free to avoid exponential performance degradation as the hash table fills
- */
+#include "hash_table_ctrl.h"
 
 uint32_t deleted_key_value;
 const void *deleted_key = &deleted_key_value;
 
-static const struct {
-   uint32_t max_entries, size, rehash;
-} hash_sizes[] = {
-   { 2,            5,            3            },
-   { 4,            7,            5            },
-   { 8,            13,           11           },
-   { 16,           19,           17           },
-   { 32,           43,           41           },
-   { 64,           73,           71           },
-   { 128,          151,          149          },
-   { 256,          283,          281          },
-   { 512,          571,          569          },
-   { 1024,         1153,         1151         },
-   { 2048,         2269,         2267         },
-   { 4096,         4519,         4517         },
-   { 8192,         9013,         9011         },
-   { 16384,        18043,        18041        },
-   { 32768,        36109,        36107        },
-   { 65536,        72091,        72089        },
-   { 131072,       144409,       144407       },
-   { 262144,       288361,       288359       },
-   { 524288,       576883,       576881       },
-   { 1048576,      1153459,      1153457      },
-   { 2097152,      2307163,      2307161      },
-   { 4194304,      4613893,      4613891      },
-   { 8388608,      9227641,      9227639      },
-   { 16777216,     18455029,     18455027     },
-   { 33554432,     36911011,     36911009     },
-   { 67108864,     73819861,     73819859     },
-   { 134217728,    147639589,    147639587    },
-   { 268435456,    295279081,    295279079    },
-   { 536870912,    590559793,    590559791    },
-   { 1073741824,   1181116273,   1181116271   },
-   { 2147483648ul, 2362232233ul, 2362232231ul }
-};
-
-static int
-entry_is_free(struct set_entry *entry)
+static bool
+set_alloc(struct set *ht, uint32_t size_index)
 {
-   return entry->key == NULL;
-}
+   uint32_t size = 1u << size_index;
+   struct set_entry *table;
+   uint8_t *ctrl;
 
-static int
-entry_is_deleted(struct set_entry *entry)
-{
-   return entry->key == deleted_key;
-}
+   table = ralloc_array(ht, struct set_entry, size);
+   if (table == NULL)
+      return false;
 
-static int
-entry_is_present(struct set_entry *entry)
-{
-   return entry->key != NULL && entry->key != deleted_key;
+   ctrl = ralloc_array(ht, uint8_t, hash_ctrl_alloc_size(size));
+   if (ctrl == NULL) {
+      ralloc_free(table);
+      return false;
+   }
+
+   hash_ctrl_init(ctrl, size);
+
+   ht->table = table;
+   ht->ctrl = ctrl;
+   ht->size_index = size_index;
+   ht->size = size;
+   ht->max_entries = hash_ctrl_max_entries(size);
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+
+   return true;
 }
 
 struct set *
@@ -114,17 +85,10 @@ _mesa_set_create(void *mem_ctx,
    if (ht == NULL)
       return NULL;
 
-   ht->size_index = 0;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(ht, struct set_entry, ht->size);
-   ht->entries = 0;
-   ht->deleted_entries = 0;
 
-   if (ht->table == NULL) {
+   if (!set_alloc(ht, HASH_MIN_SIZE_LOG2)) {
       ralloc_free(ht);
       return NULL;
    }
@@ -152,6 +116,7 @@ _mesa_set_destroy(struct set *ht, void (*delete_function)(struct set_entry *entr
       }
    }
    ralloc_free(ht->table);
+   ralloc_free(ht->ctrl);
    ralloc_free(ht);
 }
 
@@ -163,26 +128,28 @@ _mesa_set_destroy(struct set *ht, void (*delete_function)(struct set_entry *entr
 static struct set_entry *
 set_search(const struct set *ht, uint32_t hash, const void *key)
 {
-   uint32_t hash_address;
+   uint32_t mixed = hash_ctrl_mix(hash);
+   uint8_t tag = hash_ctrl_tag(mixed);
+   struct hash_probe probe;
 
-   hash_address = hash % ht->size;
+   hash_probe_init(&probe, mixed, ht->size);
    do {
-      uint32_t double_hash;
+      uint32_t offset = hash_probe_offset(&probe);
+      const uint8_t *group = ht->ctrl + offset;
+      unsigned match = hash_group_match(group, tag);
 
-      struct set_entry *entry = ht->table + hash_address;
+      while (match) {
+         struct set_entry *entry = ht->table + offset + u_bit_scan(&match);
 
-      if (entry_is_free(entry)) {
-         return NULL;
-      } else if (entry_is_present(entry) && entry->hash == hash) {
-         if (ht->key_equals_function(key, entry->key)) {
+         if (entry->hash == hash &&
+             ht->key_equals_function(key, entry->key)) {
             return entry;
          }
       }
 
-      double_hash = 1 + hash % ht->rehash;
-
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != hash % ht->size);
+      if (hash_group_match(group, HASH_CTRL_EMPTY))
+         return NULL;
+   } while (hash_probe_next(&probe));
 
    return NULL;
 }
@@ -203,42 +170,55 @@ _mesa_set_search_pre_hashed(const struct set *set, uint32_t hash,
    return set_search(set, hash, key);
 }
 
-static struct set_entry *
-set_add(struct set *ht, uint32_t hash, const void *key);
+/**
+ * Puts an entry that is known not to be in the set yet into the first
+ * available slot, without comparing any keys.  Used when rehashing.
+ */
+static void
+set_add_unique(struct set *ht, uint32_t hash, const void *key)
+{
+   uint32_t mixed = hash_ctrl_mix(hash);
+   struct hash_probe probe;
+
+   hash_probe_init(&probe, mixed, ht->size);
+   do {
+      uint32_t offset = hash_probe_offset(&probe);
+      unsigned available = hash_group_match_available(ht->ctrl + offset);
+
+      if (available) {
+         uint32_t i = offset + u_bit_scan(&available);
+
+         ht->ctrl[i] = hash_ctrl_tag(mixed);
+         ht->table[i].hash = hash;
+         ht->table[i].key = key;
+         ht->entries++;
+         return;
+      }
+   } while (hash_probe_next(&probe));
+
+   assert(!"set full while rehashing");
+}
 
 static void
 set_rehash(struct set *ht, unsigned new_size_index)
 {
    struct set old_ht;
-   struct set_entry *table, *entry;
-
-   if (new_size_index >= ARRAY_SIZE(hash_sizes))
-      return;
+   struct set_entry *entry;
 
-   table = rzalloc_array(ht, struct set_entry,
-                         hash_sizes[new_size_index].size);
-   if (table == NULL)
+   if (new_size_index >= 32)
       return;
 
    old_ht = *ht;
 
-   ht->table = table;
-   ht->size_index = new_size_index;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
-   ht->entries = 0;
-   ht->deleted_entries = 0;
+   if (!set_alloc(ht, new_size_index))
+      return;
 
-   for (entry = old_ht.table;
-        entry != old_ht.table + old_ht.size;
-        entry++) {
-      if (entry_is_present(entry)) {
-         set_add(ht, entry->hash, entry->key);
-      }
+   set_foreach(&old_ht, entry) {
+      set_add_unique(ht, entry->hash, entry->key);
    }
 
    ralloc_free(old_ht.table);
+   ralloc_free(old_ht.ctrl);
 }
 
 /**
@@ -250,8 +230,10 @@ set_rehash(struct set *ht, unsigned new_size_index)
 static struct set_entry *
 set_add(struct set *ht, uint32_t hash, const void *key)
 {
-   uint32_t hash_address;
-   struct set_entry *available_entry = NULL;
+   uint32_t mixed, available_index = ~0u;
+   struct set_entry *available_entry;
+   struct hash_probe probe;
+   uint8_t tag;
 
    if (ht->entries >= ht->max_entries) {
       set_rehash(ht, ht->size_index + 1);
@@ -259,18 +241,14 @@ set_add(struct set *ht, uint32_t hash, const void *key)
       set_rehash(ht, ht->size_index);
    }
 
-   hash_address = hash % ht->size;
+   mixed = hash_ctrl_mix(hash);
+   tag = hash_ctrl_tag(mixed);
+
+   hash_probe_init(&probe, mixed, ht->size);
    do {
-      struct set_entry *entry = ht->table + hash_address;
-      uint32_t double_hash;
-
-      if (!entry_is_present(entry)) {
-         /* Stash the first available entry we find */
-         if (available_entry == NULL)
-            available_entry = entry;
-         if (entry_is_free(entry))
-            break;
-      }
+      uint32_t offset = hash_probe_offset(&probe);
+      const uint8_t *group = ht->ctrl + offset;
+      unsigned match = hash_group_match(group, tag);
 
       /* Implement replacement when another insert happens
        * with a matching key.  This is a relatively common
@@ -282,30 +260,43 @@ set_add(struct set *ht, uint32_t hash, const void *key)
        * If freeing of old keys is required to avoid memory leaks,
        * perform a search before inserting.
        */
-      if (entry->hash == hash &&
-          ht->key_equals_function(key, entry->key)) {
-         entry->key = key;
-         return entry;
+      while (match) {
+         struct set_entry *entry = ht->table + offset + u_bit_scan(&match);
+
+         if (entry->hash == hash &&
+             ht->key_equals_function(key, entry->key)) {
+            entry->key = key;
+            return entry;
+         }
       }
 
-      double_hash = 1 + hash % ht->rehash;
+      /* Stash the first available entry we find */
+      if (available_index == ~0u) {
+         unsigned available = hash_group_match_available(group);
 
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != hash % ht->size);
+         if (available)
+            available_index = offset + u_bit_scan(&available);
+      }
 
-   if (available_entry) {
-      if (entry_is_deleted(available_entry))
-         ht->deleted_entries--;
-      available_entry->hash = hash;
-      available_entry->key = key;
-      ht->entries++;
-      return available_entry;
-   }
+      if (hash_group_match(group, HASH_CTRL_EMPTY))
+         break;
+   } while (hash_probe_next(&probe));
 
-   /* We could hit here if a required resize failed. An unchecked-malloc
+   /* We could hit this if a required resize failed. An unchecked-malloc
     * application could ignore this result.
     */
-   return NULL;
+   if (available_index == ~0u)
+      return NULL;
+
+   if (ht->ctrl[available_index] == HASH_CTRL_DELETED)
+      ht->deleted_entries--;
+
+   ht->ctrl[available_index] = tag;
+   available_entry = ht->table + available_index;
+   available_entry->hash = hash;
+   available_entry->key = key;
+   ht->entries++;
+   return available_entry;
 }
 
 struct set_entry *
@@ -332,12 +323,26 @@ _mesa_set_add_pre_hashed(struct set *set, uint32_t hash, const void *key)
 void
 _mesa_set_remove(struct set *ht, struct set_entry *entry)
 {
+   uint32_t i, group;
+
    if (!entry)
       return;
 
+   i = entry - ht->table;
+   group = i & ~(HASH_GROUP_SIZE - 1);
+
+   /* Lookups never went past a group that still has an empty slot, so
+    * the slot can simply be emptied in that case.
+    */
+   if (hash_group_match(ht->ctrl + group, HASH_CTRL_EMPTY)) {
+      ht->ctrl[i] = HASH_CTRL_EMPTY;
+   } else {
+      ht->ctrl[i] = HASH_CTRL_DELETED;
+      ht->deleted_entries++;
+   }
+
    entry->key = deleted_key;
    ht->entries--;
-   ht->deleted_entries++;
 }
 
 /**
@@ -349,15 +354,11 @@ _mesa_set_remove(struct set *ht, struct set_entry *entry)
 struct set_entry *
 _mesa_set_next_entry(const struct set *ht, struct set_entry *entry)
 {
-   if (entry == NULL)
-      entry = ht->table;
-   else
-      entry = entry + 1;
-
-   for (; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(entry)) {
-         return entry;
-      }
+   uint32_t i = entry == NULL ? 0 : entry - ht->table + 1;
+
+   for (; i < ht->size; i++) {
+      if (hash_ctrl_is_full(ht->ctrl[i]))
+         return ht->table + i;
    }
 
    return NULL;
@@ -367,23 +368,18 @@ struct set_entry *
 _mesa_set_random_entry(struct set *ht,
                        int (*predicate)(struct set_entry *entry))
 {
-   struct set_entry *entry;
-   uint32_t i = rand() % ht->size;
+   uint32_t start = rand() & (ht->size - 1);
+   uint32_t i;
 
    if (ht->entries == 0)
       return NULL;
 
-   for (entry = ht->table + i; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(entry) &&
-          (!predicate || predicate(entry))) {
-         return entry;
-      }
-   }
+   for (i = 0; i < ht->size; i++) {
+      uint32_t j = (start + i) & (ht->size - 1);
 
-   for (entry = ht->table; entry != ht->table + i; entry++) {
-      if (entry_is_present(entry) &&
-          (!predicate || predicate(entry))) {
-         return entry;
+      if (hash_ctrl_is_full(ht->ctrl[j]) &&
+          (!predicate || predicate(ht->table + j))) {
+         return ht->table + j;
       }
    }
 
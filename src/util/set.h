@@ -43,12 +43,13 @@ struct set_entry {
 struct set {
    void *mem_ctx;
    struct set_entry *table;
+   /** One control byte per entry of table, see hash_table_ctrl.h. */
+   uint8_t *ctrl;
    uint32_t (*key_hash_function)(const void *key);
    bool (*key_equals_function)(const void *a, const void *b);
    uint32_t size;
-   uint32_t rehash;
    uint32_t max_entries;
-   uint32_t size_index;
+   uint32_t size_index; /**< log2 of size */
    uint32_t entries;
    uint32_t deleted_entries;
 };
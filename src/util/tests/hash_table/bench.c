@@ -0,0 +1,180 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Microbenchmarks for the hash table and set.
+ *
+ * For a few table sizes, this times inserting pointer keys, looking up
+ * keys that are present and keys that are not, and removing everything
+ * again, and prints the average time per operation.  It isn't run as part
+ * of "make check".
+ *
+ * Usage: bench [max_size]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <assert.h>
+#include "hash_table.h"
+#include "set.h"
+
+struct key {
+   uint32_t value;
+   uint32_t pad;
+};
+
+static double
+get_time(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+report(const char *what, unsigned size, double time, unsigned ops)
+{
+   printf("%-10s %8u entries: %8.2f ns/op\n", what, size, time * 1e9 / ops);
+}
+
+static void
+bench_hash_table(struct key *keys, struct key *missing, unsigned size,
+                 unsigned rounds)
+{
+   double insert = 0, hit = 0, miss = 0, remove = 0, start;
+   unsigned r, i;
+
+   for (r = 0; r < rounds; r++) {
+      struct hash_table *ht =
+         _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                                 _mesa_key_pointer_equal);
+
+      start = get_time();
+      for (i = 0; i < size; i++)
+         _mesa_hash_table_insert(ht, &keys[i], NULL);
+      insert += get_time() - start;
+
+      start = get_time();
+      for (i = 0; i < size; i++) {
+         struct hash_entry *entry = _mesa_hash_table_search(ht, &keys[i]);
+         assert(entry);
+         (void) entry;
+      }
+      hit += get_time() - start;
+
+      start = get_time();
+      for (i = 0; i < size; i++) {
+         struct hash_entry *entry = _mesa_hash_table_search(ht, &missing[i]);
+         assert(!entry);
+         (void) entry;
+      }
+      miss += get_time() - start;
+
+      start = get_time();
+      for (i = 0; i < size; i++) {
+         _mesa_hash_table_remove(ht, _mesa_hash_table_search(ht, &keys[i]));
+      }
+      remove += get_time() - start;
+
+      assert(ht->entries == 0);
+      _mesa_hash_table_destroy(ht, NULL);
+   }
+
+   report("ht insert", size, insert, size * rounds);
+   report("ht hit", size, hit, size * rounds);
+   report("ht miss", size, miss, size * rounds);
+   report("ht remove", size, remove, size * rounds);
+}
+
+static void
+bench_set(struct key *keys, struct key *missing, unsigned size,
+          unsigned rounds)
+{
+   double insert = 0, hit = 0, miss = 0, remove = 0, start;
+   unsigned r, i;
+
+   for (r = 0; r < rounds; r++) {
+      struct set *set =
+         _mesa_set_create(NULL, _mesa_hash_pointer, _mesa_key_pointer_equal);
+
+      start = get_time();
+      for (i = 0; i < size; i++)
+         _mesa_set_add(set, &keys[i]);
+      insert += get_time() - start;
+
+      start = get_time();
+      for (i = 0; i < size; i++) {
+         struct set_entry *entry = _mesa_set_search(set, &keys[i]);
+         assert(entry);
+         (void) entry;
+      }
+      hit += get_time() - start;
+
+      start = get_time();
+      for (i = 0; i < size; i++) {
+         struct set_entry *entry = _mesa_set_search(set, &missing[i]);
+         assert(!entry);
+         (void) entry;
+      }
+      miss += get_time() - start;
+
+      start = get_time();
+      for (i = 0; i < size; i++)
+         _mesa_set_remove(set, _mesa_set_search(set, &keys[i]));
+      remove += get_time() - start;
+
+      assert(set->entries == 0);
+      _mesa_set_destroy(set, NULL);
+   }
+
+   report("set insert", size, insert, size * rounds);
+   report("set hit", size, hit, size * rounds);
+   report("set miss", size, miss, size * rounds);
+   report("set remove", size, remove, size * rounds);
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned max_size = argc > 1 ? atoi(argv[1]) : 1000000;
+   struct key *keys, *missing;
+   unsigned size;
+
+   keys = calloc(max_size, sizeof(*keys));
+   missing = calloc(max_size, sizeof(*missing));
+
+   for (size = 10; size <= max_size; size *= 10) {
+      /* Do about the same amount of work at every size. */
+      unsigned rounds = max_size > size ? max_size / size : 1;
+
+      bench_hash_table(keys, missing, size, rounds);
+      bench_set(keys, missing, size, rounds);
+   }
+
+   free(keys);
+   free(missing);
+
+   return 0;
+}
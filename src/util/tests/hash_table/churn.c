@@ -0,0 +1,134 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Does a long random sequence of inserts and removals on a hash table and a
+ * set with a small key space, so that tombstones pile up and the tables get
+ * rehashed in place many times, and checks the results against a plain
+ * array of which keys should be present.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "hash_table.h"
+#include "set.h"
+
+#define KEYS 300
+#define STEPS 200000
+
+static uint32_t
+key_value(const void *key)
+{
+   return *(const uint32_t *)key;
+}
+
+static bool
+uint32_t_key_equals(const void *a, const void *b)
+{
+   return key_value(a) == key_value(b);
+}
+
+static void
+check_contents(struct hash_table *ht, struct set *set, const bool *present,
+               unsigned count)
+{
+   struct hash_entry *entry;
+   struct set_entry *set_entry;
+   unsigned found = 0;
+
+   assert(ht->entries == count);
+   assert(set->entries == count);
+
+   hash_table_foreach(ht, entry) {
+      assert(present[key_value(entry->key)]);
+      assert(entry->data == entry->key);
+      found++;
+   }
+   assert(found == count);
+
+   found = 0;
+   set_foreach(set, set_entry) {
+      assert(present[key_value(set_entry->key)]);
+      found++;
+   }
+   assert(found == count);
+}
+
+int
+main(int argc, char **argv)
+{
+   struct hash_table *ht;
+   struct set *set;
+   uint32_t keys[KEYS];
+   bool present[KEYS];
+   unsigned count = 0;
+   unsigned i;
+
+   (void) argc;
+   (void) argv;
+
+   ht = _mesa_hash_table_create(NULL, key_value, uint32_t_key_equals);
+   set = _mesa_set_create(NULL, key_value, uint32_t_key_equals);
+
+   for (i = 0; i < KEYS; i++) {
+      keys[i] = i;
+      present[i] = false;
+   }
+
+   srand(0);
+
+   for (i = 0; i < STEPS; i++) {
+      uint32_t k = rand() % KEYS;
+      struct hash_entry *entry = _mesa_hash_table_search(ht, &k);
+      struct set_entry *set_entry = _mesa_set_search(set, &k);
+
+      assert((entry != NULL) == present[k]);
+      assert((set_entry != NULL) == present[k]);
+
+      /* Keep the tables about half full of the key space. */
+      if (present[k] && rand() % KEYS < count) {
+         _mesa_hash_table_remove(ht, entry);
+         _mesa_set_remove(set, set_entry);
+         present[k] = false;
+         count--;
+      } else {
+         _mesa_hash_table_insert(ht, keys + k, keys + k);
+         _mesa_set_add(set, keys + k);
+         if (!present[k])
+            count++;
+         present[k] = true;
+      }
+
+      if (i % 1000 == 0)
+         check_contents(ht, set, present, count);
+   }
+
+   check_contents(ht, set, present, count);
+
+   _mesa_hash_table_destroy(ht, NULL);
+   _mesa_set_destroy(set, NULL);
+
+   return 0;
+}
@@ -0,0 +1,373 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "u_queue.h"
+#include "util/u_math.h"
+
+/*
+ * Ring buffer
+ *
+ * This is the bounded MPMC queue described by Dmitry Vyukov.  Every slot
+ * carries a sequence number saying which lap of the ring it is ready for,
+ * so producers and consumers only need to agree on tail and head with a
+ * compare-and-swap, and never touch each other's cursor.
+ *
+ * The atomic operations from u_atomic.h are full barriers, so winning the
+ * compare-and-swap orders the read of the sequence number before the slot
+ * is accessed, and bumping the sequence number publishes the slot.
+ */
+
+static bool
+ring_init(struct util_queue_ring *ring, unsigned size)
+{
+   unsigned i;
+
+   ring->slots = calloc(size, sizeof(*ring->slots));
+   if (!ring->slots)
+      return false;
+
+   ring->mask = size - 1;
+   ring->head = 0;
+   ring->tail = 0;
+
+   for (i = 0; i < size; i++)
+      ring->slots[i].sequence = i;
+
+   return true;
+}
+
+static bool
+ring_push(struct util_queue_ring *ring, void *job,
+          struct util_queue_fence *fence, util_queue_execute_func execute)
+{
+   unsigned pos = ring->tail;
+   struct util_queue_slot *slot;
+
+   for (;;) {
+      int diff;
+
+      slot = &ring->slots[pos & ring->mask];
+      diff = (int)(slot->sequence - pos);
+
+      if (diff == 0) {
+         unsigned old = p_atomic_cmpxchg(&ring->tail, pos, pos + 1);
+         if (old == pos)
+            break;
+         pos = old;
+      } else if (diff < 0) {
+         /* The slot still holds a job from the previous lap. */
+         return false;
+      } else {
+         pos = ring->tail;
+      }
+   }
+
+   slot->job = job;
+   slot->fence = fence;
+   slot->execute = execute;
+   p_atomic_inc(&slot->sequence);
+
+   return true;
+}
+
+static bool
+ring_pop(struct util_queue_ring *ring, struct util_queue_slot *out)
+{
+   unsigned pos = ring->head;
+   struct util_queue_slot *slot;
+
+   for (;;) {
+      int diff;
+
+      slot = &ring->slots[pos & ring->mask];
+      diff = (int)(slot->sequence - (pos + 1));
+
+      if (diff == 0) {
+         unsigned old = p_atomic_cmpxchg(&ring->head, pos, pos + 1);
+         if (old == pos)
+            break;
+         pos = old;
+      } else if (diff < 0) {
+         /* Nothing has been written to the slot yet. */
+         return false;
+      } else {
+         pos = ring->head;
+      }
+   }
+
+   out->job = slot->job;
+   out->fence = slot->fence;
+   out->execute = slot->execute;
+
+   /* Hand the slot over to the producers of the next lap. */
+   p_atomic_add(&slot->sequence, ring->mask);
+
+   return true;
+}
+
+/*
+ * Fences
+ */
+
+void
+util_queue_fence_init(struct util_queue_fence *fence)
+{
+   mtx_init(&fence->mutex, mtx_plain);
+   cnd_init(&fence->cond);
+   fence->pending = 0;
+}
+
+void
+util_queue_fence_destroy(struct util_queue_fence *fence)
+{
+   assert(util_queue_fence_is_signalled(fence));
+   cnd_destroy(&fence->cond);
+   mtx_destroy(&fence->mutex);
+}
+
+/**
+ * Waits until every job added with the fence so far has finished.
+ */
+void
+util_queue_fence_wait(struct util_queue_fence *fence)
+{
+   /* Take the mutex even if the fence looks signalled already, so that the
+    * worker signalling it is done with it by the time we return and the
+    * caller frees it.
+    */
+   mtx_lock(&fence->mutex);
+   while (fence->pending)
+      cnd_wait(&fence->cond, &fence->mutex);
+   mtx_unlock(&fence->mutex);
+}
+
+static void
+util_queue_fence_signal(struct util_queue_fence *fence)
+{
+   mtx_lock(&fence->mutex);
+   if (p_atomic_dec_zero(&fence->pending))
+      cnd_broadcast(&fence->cond);
+   mtx_unlock(&fence->mutex);
+}
+
+/*
+ * Queue
+ */
+
+struct thread_input {
+   struct util_queue *queue;
+   int thread_index;
+};
+
+static bool
+util_queue_get_job(struct util_queue *queue, struct util_queue_slot *job)
+{
+   unsigned i;
+
+   for (i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++) {
+      if (ring_pop(&queue->rings[i], job))
+         return true;
+   }
+
+   return false;
+}
+
+static int
+util_queue_thread_func(void *input)
+{
+   struct util_queue *queue = ((struct thread_input *)input)->queue;
+   int thread_index = ((struct thread_input *)input)->thread_index;
+
+   free(input);
+
+   for (;;) {
+      struct util_queue_slot job;
+
+      if (!util_queue_get_job(queue, &job)) {
+         mtx_lock(&queue->lock);
+
+         /* Look again once producers can see that we're going to sleep, so
+          * that we can't miss the wakeup for a job added in between.
+          */
+         p_atomic_inc(&queue->num_idle);
+         while (!util_queue_get_job(queue, &job)) {
+            if (queue->kill_threads) {
+               p_atomic_dec(&queue->num_idle);
+               mtx_unlock(&queue->lock);
+               return 0;
+            }
+            cnd_wait(&queue->has_job_cond, &queue->lock);
+         }
+         p_atomic_dec(&queue->num_idle);
+
+         mtx_unlock(&queue->lock);
+      }
+
+      if (p_atomic_read(&queue->num_full_waiters)) {
+         mtx_lock(&queue->lock);
+         cnd_broadcast(&queue->has_space_cond);
+         mtx_unlock(&queue->lock);
+      }
+
+      job.execute(job.job, thread_index);
+
+      if (job.fence)
+         util_queue_fence_signal(job.fence);
+   }
+}
+
+/**
+ * Creates a queue with num_threads workers.
+ *
+ * Up to max_jobs jobs of each priority can be waiting at a time (rounded up
+ * to a power of two); util_queue_add_job() blocks while that many are.
+ */
+bool
+util_queue_init(struct util_queue *queue,
+                const char *name,
+                unsigned max_jobs,
+                unsigned num_threads)
+{
+   unsigned size = util_next_power_of_two(MAX2(max_jobs, 2));
+   unsigned i;
+
+   memset(queue, 0, sizeof(*queue));
+   queue->name = name;
+
+   for (i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++) {
+      if (!ring_init(&queue->rings[i], size))
+         goto fail;
+   }
+
+   mtx_init(&queue->lock, mtx_plain);
+   cnd_init(&queue->has_job_cond);
+   cnd_init(&queue->has_space_cond);
+
+   queue->threads = calloc(num_threads, sizeof(thrd_t));
+   if (!queue->threads)
+      goto fail_threads;
+
+   for (i = 0; i < num_threads; i++) {
+      struct thread_input *input = malloc(sizeof(*input));
+
+      if (!input)
+         break;
+
+      input->queue = queue;
+      input->thread_index = i;
+
+      if (thrd_create(&queue->threads[i], util_queue_thread_func,
+                      input) != thrd_success) {
+         free(input);
+         break;
+      }
+   }
+
+   /* Carry on with fewer threads if some of them couldn't be created. */
+   queue->num_threads = i;
+   if (queue->num_threads == 0) {
+      free(queue->threads);
+      goto fail_threads;
+   }
+
+   return true;
+
+fail_threads:
+   cnd_destroy(&queue->has_space_cond);
+   cnd_destroy(&queue->has_job_cond);
+   mtx_destroy(&queue->lock);
+fail:
+   for (i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++)
+      free(queue->rings[i].slots);
+   memset(queue, 0, sizeof(*queue));
+   return false;
+}
+
+/**
+ * Runs the jobs left in the queue, then stops the workers and frees the
+ * queue.
+ */
+void
+util_queue_destroy(struct util_queue *queue)
+{
+   unsigned i;
+
+   mtx_lock(&queue->lock);
+   queue->kill_threads = true;
+   cnd_broadcast(&queue->has_job_cond);
+   mtx_unlock(&queue->lock);
+
+   for (i = 0; i < queue->num_threads; i++)
+      thrd_join(queue->threads[i], NULL);
+
+   cnd_destroy(&queue->has_space_cond);
+   cnd_destroy(&queue->has_job_cond);
+   mtx_destroy(&queue->lock);
+   free(queue->threads);
+
+   for (i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++)
+      free(queue->rings[i].slots);
+}
+
+/**
+ * Adds a job to the queue.
+ *
+ * fence may be NULL.  Otherwise it stays unsignalled until the job (and
+ * any other job added with it) has finished.
+ */
+void
+util_queue_add_job(struct util_queue *queue,
+                   void *job,
+                   struct util_queue_fence *fence,
+                   util_queue_execute_func execute,
+                   enum util_queue_priority priority)
+{
+   struct util_queue_ring *ring = &queue->rings[priority];
+
+   assert(priority < UTIL_QUEUE_NUM_PRIORITIES);
+
+   if (fence)
+      p_atomic_inc(&fence->pending);
+
+   if (!ring_push(ring, job, fence, execute)) {
+      mtx_lock(&queue->lock);
+      p_atomic_inc(&queue->num_full_waiters);
+      while (!ring_push(ring, job, fence, execute))
+         cnd_wait(&queue->has_space_cond, &queue->lock);
+      p_atomic_dec(&queue->num_full_waiters);
+      mtx_unlock(&queue->lock);
+   }
+
+   /* The job was published with a full barrier, so either a worker going
+    * idle sees it, or we see that worker in num_idle here.
+    */
+   if (p_atomic_read(&queue->num_idle)) {
+      mtx_lock(&queue->lock);
+      cnd_signal(&queue->has_job_cond);
+      mtx_unlock(&queue->lock);
+   }
+}
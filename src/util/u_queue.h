@@ -0,0 +1,142 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file u_queue.h
+ *
+ * A job queue served by a pool of worker threads.
+ *
+ * Jobs are a pointer and a function to call on it from one of the workers.
+ * A job can be added with a fence, which is signalled once the job has run.
+ * Several jobs can share a fence to wait for a whole batch at once.
+ *
+ * There is one queue for each priority, and workers always take the oldest
+ * job of the highest priority available.  Each of those queues is a bounded
+ * lock-free ring buffer that any number of threads can add to and take
+ * from.  The queue lock is only taken to put idle workers to sleep and to
+ * wake them up, and to block producers while a ring is full.
+ */
+
+#ifndef U_QUEUE_H
+#define U_QUEUE_H
+
+#include <stdbool.h>
+
+#include "c11/threads.h"
+#include "util/u_atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UTIL_QUEUE_CACHE_LINE_SIZE 64
+
+enum util_queue_priority {
+   UTIL_QUEUE_PRIORITY_HIGH,
+   UTIL_QUEUE_PRIORITY_NORMAL,
+   UTIL_QUEUE_PRIORITY_LOW,
+   UTIL_QUEUE_NUM_PRIORITIES
+};
+
+/**
+ * Signalled once every job added with it has finished.
+ *
+ * A fence may be reused once it is signalled.
+ */
+struct util_queue_fence {
+   mtx_t mutex;
+   cnd_t cond;
+   unsigned pending; /**< jobs added with this fence that haven't finished */
+};
+
+typedef void (*util_queue_execute_func)(void *job, int thread_index);
+
+struct util_queue_slot {
+   /**
+    * Position in the ring that this slot may be written at next, or that
+    * position plus one once the job in it can be read.
+    */
+   volatile unsigned sequence;
+   void *job;
+   struct util_queue_fence *fence;
+   util_queue_execute_func execute;
+};
+
+/**
+ * Bounded multi-producer, multi-consumer ring buffer of jobs.
+ *
+ * head and tail only ever grow, and each sit on their own cache line so
+ * that producers and consumers don't keep stealing it from each other.
+ */
+struct util_queue_ring {
+   struct util_queue_slot *slots;
+   unsigned mask;
+   char pad0[UTIL_QUEUE_CACHE_LINE_SIZE];
+   volatile unsigned head; /**< next position to take a job from */
+   char pad1[UTIL_QUEUE_CACHE_LINE_SIZE];
+   volatile unsigned tail; /**< next position to add a job at */
+   char pad2[UTIL_QUEUE_CACHE_LINE_SIZE];
+};
+
+struct util_queue {
+   const char *name;
+   struct util_queue_ring rings[UTIL_QUEUE_NUM_PRIORITIES];
+
+   mtx_t lock;
+   cnd_t has_job_cond;
+   cnd_t has_space_cond;
+   unsigned num_idle;          /**< workers waiting on has_job_cond */
+   unsigned num_full_waiters;  /**< producers waiting on has_space_cond */
+   bool kill_threads;
+
+   unsigned num_threads;
+   thrd_t *threads;
+};
+
+bool util_queue_init(struct util_queue *queue,
+                     const char *name,
+                     unsigned max_jobs,
+                     unsigned num_threads);
+void util_queue_destroy(struct util_queue *queue);
+
+void util_queue_fence_init(struct util_queue_fence *fence);
+void util_queue_fence_destroy(struct util_queue_fence *fence);
+void util_queue_fence_wait(struct util_queue_fence *fence);
+
+void util_queue_add_job(struct util_queue *queue,
+                        void *job,
+                        struct util_queue_fence *fence,
+                        util_queue_execute_func execute,
+                        enum util_queue_priority priority);
+
+/** Returns whether every job added with the fence has finished. */
+static inline bool
+util_queue_fence_is_signalled(struct util_queue_fence *fence)
+{
+   return p_atomic_read(&fence->pending) == 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_QUEUE_H */
@@ -0,0 +1,144 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file u_queue_bench.c
+ *
+ * Measures how many jobs per second go through a util_queue.
+ *
+ * A number of producer threads each add their share of small jobs, all
+ * under one fence, and the main thread waits for it.  The work done by each
+ * job can be made larger to see how the queue behaves once it is no longer
+ * the bottleneck.
+ *
+ * Usage: u_queue_bench [workers [producers [jobs [work]]]]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "u_queue.h"
+
+struct producer {
+   struct util_queue *queue;
+   struct util_queue_fence *fence;
+   unsigned jobs;
+};
+
+static unsigned work;
+static unsigned results;
+
+static double
+get_time(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+execute(void *job, int thread_index)
+{
+   unsigned x = (unsigned)(uintptr_t)job;
+   unsigned i;
+
+   (void) thread_index;
+
+   for (i = 0; i < work; i++)
+      x = x * 1664525 + 1013904223;
+
+   if (x == 0)
+      p_atomic_inc(&results);
+}
+
+static int
+produce(void *data)
+{
+   struct producer *producer = data;
+   unsigned i;
+
+   for (i = 0; i < producer->jobs; i++) {
+      util_queue_add_job(producer->queue, (void *)(uintptr_t)i,
+                         producer->fence, execute,
+                         UTIL_QUEUE_PRIORITY_NORMAL);
+   }
+
+   return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned num_workers = argc > 1 ? atoi(argv[1]) : 4;
+   unsigned num_producers = argc > 2 ? atoi(argv[2]) : 1;
+   unsigned num_jobs = argc > 3 ? atoi(argv[3]) : 1000000;
+   struct util_queue queue;
+   struct util_queue_fence fence;
+   struct producer producer;
+   thrd_t *threads;
+   double start, elapsed;
+   unsigned i;
+
+   work = argc > 4 ? atoi(argv[4]) : 0;
+
+   if (num_workers == 0 || num_producers == 0) {
+      fprintf(stderr, "need at least one worker and one producer\n");
+      return 1;
+   }
+
+   if (!util_queue_init(&queue, "bench", 1024, num_workers)) {
+      fprintf(stderr, "failed to create the queue\n");
+      return 1;
+   }
+   util_queue_fence_init(&fence);
+
+   producer.queue = &queue;
+   producer.fence = &fence;
+   producer.jobs = num_jobs / num_producers;
+
+   threads = malloc(num_producers * sizeof(*threads));
+
+   start = get_time();
+
+   for (i = 0; i < num_producers; i++)
+      thrd_create(&threads[i], produce, &producer);
+   for (i = 0; i < num_producers; i++)
+      thrd_join(threads[i], NULL);
+
+   util_queue_fence_wait(&fence);
+
+   elapsed = get_time() - start;
+
+   printf("%u workers, %u producers, %u jobs of %u iterations: "
+          "%.3f s, %.0f jobs/s\n",
+          queue.num_threads, num_producers, producer.jobs * num_producers,
+          work, elapsed, producer.jobs * num_producers / elapsed);
+
+   free(threads);
+   util_queue_fence_destroy(&fence);
+   util_queue_destroy(&queue);
+
+   return 0;
+}
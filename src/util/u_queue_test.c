@@ -0,0 +1,278 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Force assertions, even on release builds. */
+#undef NDEBUG
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "u_queue.h"
+
+#define NUM_THREADS 4
+
+static unsigned counter;
+
+static void
+increment(void *job, int thread_index)
+{
+   (void) job;
+   assert(thread_index >= 0 && thread_index < NUM_THREADS);
+   p_atomic_inc(&counter);
+}
+
+/* Waits for a whole batch of jobs through a single fence. */
+static void
+test_batch(void)
+{
+   struct util_queue queue;
+   struct util_queue_fence fence;
+   unsigned i;
+
+   counter = 0;
+   assert(util_queue_init(&queue, "test", 64, NUM_THREADS));
+   util_queue_fence_init(&fence);
+
+   for (i = 0; i < 10000; i++) {
+      util_queue_add_job(&queue, NULL, &fence, increment,
+                         UTIL_QUEUE_PRIORITY_NORMAL);
+   }
+
+   util_queue_fence_wait(&fence);
+   assert(util_queue_fence_is_signalled(&fence));
+   assert(counter == 10000);
+
+   util_queue_fence_destroy(&fence);
+   util_queue_destroy(&queue);
+}
+
+struct square_job {
+   unsigned in, out;
+   struct util_queue_fence fence;
+};
+
+static void
+square(void *job, int thread_index)
+{
+   struct square_job *sq = job;
+
+   (void) thread_index;
+   sq->out = sq->in * sq->in;
+}
+
+/* Waits for jobs one by one through their own fences. */
+static void
+test_fences(void)
+{
+   struct util_queue queue;
+   struct square_job jobs[100];
+   unsigned round, i;
+
+   assert(util_queue_init(&queue, "test", 16, NUM_THREADS));
+
+   for (round = 0; round < 10; round++) {
+      for (i = 0; i < 100; i++) {
+         jobs[i].in = i + round;
+         jobs[i].out = 0;
+         if (round == 0)
+            util_queue_fence_init(&jobs[i].fence);
+         util_queue_add_job(&queue, &jobs[i], &jobs[i].fence, square,
+                            UTIL_QUEUE_PRIORITY_NORMAL);
+      }
+
+      for (i = 0; i < 100; i++) {
+         util_queue_fence_wait(&jobs[i].fence);
+         assert(jobs[i].out == (i + round) * (i + round));
+      }
+   }
+
+   for (i = 0; i < 100; i++)
+      util_queue_fence_destroy(&jobs[i].fence);
+
+   util_queue_destroy(&queue);
+}
+
+static mtx_t gate_mutex;
+static cnd_t gate_cond;
+static bool gate_open;
+static unsigned order[3];
+static unsigned order_count;
+
+static void
+wait_for_gate(void *job, int thread_index)
+{
+   (void) job;
+   (void) thread_index;
+
+   mtx_lock(&gate_mutex);
+   while (!gate_open)
+      cnd_wait(&gate_cond, &gate_mutex);
+   mtx_unlock(&gate_mutex);
+}
+
+static void
+record(void *job, int thread_index)
+{
+   (void) thread_index;
+   order[order_count++] = *(unsigned *)job;
+}
+
+/*
+ * With a single worker held up by a first job, checks that the jobs queued
+ * behind it run by priority rather than in the order they were added.
+ */
+static void
+test_priorities(void)
+{
+   static unsigned priorities[] = {
+      UTIL_QUEUE_PRIORITY_LOW,
+      UTIL_QUEUE_PRIORITY_NORMAL,
+      UTIL_QUEUE_PRIORITY_HIGH,
+   };
+   struct util_queue queue;
+   struct util_queue_fence gate_fence, fence;
+   unsigned i;
+
+   mtx_init(&gate_mutex, mtx_plain);
+   cnd_init(&gate_cond);
+   gate_open = false;
+   order_count = 0;
+
+   assert(util_queue_init(&queue, "test", 8, 1));
+   util_queue_fence_init(&gate_fence);
+   util_queue_fence_init(&fence);
+
+   util_queue_add_job(&queue, NULL, &gate_fence, wait_for_gate,
+                      UTIL_QUEUE_PRIORITY_NORMAL);
+
+   /* Make sure the worker took the gate job before queueing the rest. */
+   while (p_atomic_read(&queue.rings[UTIL_QUEUE_PRIORITY_NORMAL].head) == 0)
+      thrd_yield();
+
+   for (i = 0; i < 3; i++) {
+      util_queue_add_job(&queue, &priorities[i], &fence, record,
+                         priorities[i]);
+   }
+
+   mtx_lock(&gate_mutex);
+   gate_open = true;
+   cnd_broadcast(&gate_cond);
+   mtx_unlock(&gate_mutex);
+
+   util_queue_fence_wait(&fence);
+   assert(order_count == 3);
+   assert(order[0] == UTIL_QUEUE_PRIORITY_HIGH);
+   assert(order[1] == UTIL_QUEUE_PRIORITY_NORMAL);
+   assert(order[2] == UTIL_QUEUE_PRIORITY_LOW);
+
+   util_queue_fence_wait(&gate_fence);
+   util_queue_fence_destroy(&gate_fence);
+   util_queue_fence_destroy(&fence);
+   util_queue_destroy(&queue);
+   cnd_destroy(&gate_cond);
+   mtx_destroy(&gate_mutex);
+}
+
+struct producer {
+   struct util_queue *queue;
+   struct util_queue_fence *fence;
+};
+
+static int
+produce(void *data)
+{
+   struct producer *producer = data;
+   unsigned i;
+
+   for (i = 0; i < 10000; i++) {
+      util_queue_add_job(producer->queue, NULL, producer->fence, increment,
+                         i % UTIL_QUEUE_NUM_PRIORITIES);
+   }
+
+   return 0;
+}
+
+/*
+ * Several threads adding jobs to a queue much smaller than the number of
+ * jobs, so that they keep having to wait for room.
+ */
+static void
+test_producers(void)
+{
+   struct util_queue queue;
+   struct util_queue_fence fence;
+   struct producer producer;
+   thrd_t threads[4];
+   unsigned i;
+
+   counter = 0;
+   assert(util_queue_init(&queue, "test", 4, NUM_THREADS));
+   util_queue_fence_init(&fence);
+
+   producer.queue = &queue;
+   producer.fence = &fence;
+
+   for (i = 0; i < 4; i++)
+      assert(thrd_create(&threads[i], produce, &producer) == thrd_success);
+   for (i = 0; i < 4; i++)
+      thrd_join(threads[i], NULL);
+
+   util_queue_fence_wait(&fence);
+   assert(counter == 40000);
+
+   util_queue_fence_destroy(&fence);
+   util_queue_destroy(&queue);
+}
+
+/* Jobs without a fence still get to run before the queue goes away. */
+static void
+test_destroy(void)
+{
+   struct util_queue queue;
+   unsigned i;
+
+   counter = 0;
+   assert(util_queue_init(&queue, "test", 1024, NUM_THREADS));
+
+   for (i = 0; i < 1000; i++) {
+      util_queue_add_job(&queue, NULL, NULL, increment,
+                         UTIL_QUEUE_PRIORITY_LOW);
+   }
+
+   util_queue_destroy(&queue);
+   assert(counter == 1000);
+}
+
+int
+main()
+{
+   test_batch();
+   test_fences();
+   test_priorities();
+   test_producers();
+   test_destroy();
+
+   return 0;
+}